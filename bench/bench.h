@@ -0,0 +1,73 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_BENCH_BENCH_H
+#define OBSIDIAN_BENCH_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+
+/// Results are stored here, so the compiler cannot drop the work that computed them.
+static volatile uint64_t bench_sink;
+
+
+/*!
+ * Reads the monotonic clock.
+ * \return Time in nanoseconds.
+ */
+static inline uint64_t bench_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/*!
+ * Xorshift generator, so every run measures the same work.
+ */
+static inline uint32_t bench_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/*!
+ * Prints the time per operation of a measurement.
+ * \param name Name of the measurement.
+ * \param elapsed Time the operations took in nanoseconds.
+ * \param operations Amount of operations.
+ */
+static inline void bench_report_ops(char const* name, uint64_t const elapsed, size_t const operations) {
+    printf("%-48s %12.1f ns/op\n", name, (double) elapsed / (double) operations);
+}
+
+/*!
+ * Prints the throughput of a measurement.
+ * \param name Name of the measurement.
+ * \param elapsed Time the bytes took in nanoseconds.
+ * \param bytes Amount of bytes processed.
+ */
+static inline void bench_report_bytes(char const* name, uint64_t const elapsed, size_t const bytes) {
+    printf("%-48s %12.1f MB/s\n", name, (double) bytes * 1000.0 / (double) elapsed);
+}
+
+#endif // !OBSIDIAN_BENCH_BENCH_H
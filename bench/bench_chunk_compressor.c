@@ -0,0 +1,120 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "terrain.h"
+
+#include "obsidian/memory.h"
+#include "obsidian/minecraft/chunk_compressor.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/// Amount of distinct chunks compressed, a 8 by 8 area of terrain.
+#define CHUNK_COUNT 64
+
+/// Amount of jobs per measurement, every chunk several times.
+#define JOB_COUNT 1024
+
+/// Compression level of the measurements, the zlib default.
+#define LEVEL 6
+
+
+/*!
+ * Releases the result of a job and counts it.
+ */
+static void complete_job(struct mc_chunk_job* job) {
+    if (job->compressed != NULL) {
+        *(size_t*) job->user_data += job->compressed->size;
+        obs_shared_buffer_release(job->compressed);
+        job->compressed = NULL;
+    }
+}
+
+/*!
+ * Compresses every job on a pool of workers, draining results the way the server does between polls.
+ */
+static void bench_workers(unsigned const worker_count, struct obs_shared_buffer* snapshots[CHUNK_COUNT],
+                          uint64_t* baseline) {
+    struct mc_chunk_compressor_params const params = {.worker_count = worker_count, .level = LEVEL};
+    struct mc_chunk_compressor* compressor = mc_chunk_compressor_create(&params);
+    if (compressor == NULL) {
+        fprintf(stderr, "Failed to create a compressor with %u workers\n", worker_count);
+        exit(EXIT_FAILURE);
+    }
+    static struct mc_chunk_job jobs[JOB_COUNT];
+    size_t compressed_bytes = 0;
+    uint64_t const start = bench_now();
+    for (size_t i = 0; i < JOB_COUNT; ++i) {
+        jobs[i] = (struct mc_chunk_job) {
+            .type = MC_CHUNK_JOB_COMPRESS,
+            .snapshot = snapshots[i % CHUNK_COUNT],
+            .complete = complete_job,
+            .user_data = &compressed_bytes,
+        };
+        mc_chunk_compressor_submit(compressor, &jobs[i]);
+    }
+    struct timespec const pause = {.tv_nsec = 100000};
+    while (mc_chunk_compressor_pending(compressor) > 0) {
+        mc_chunk_compressor_poll(compressor);
+        nanosleep(&pause, NULL);
+    }
+    uint64_t const elapsed = bench_now() - start;
+    mc_chunk_compressor_destroy(compressor);
+
+    if (*baseline == 0) {
+        *baseline = elapsed;
+    }
+    printf("%2u worker(s) %12.0f chunks/s %10.1f MB/s in %8.2fx speedup %8.1f%% of input out\n", worker_count,
+           JOB_COUNT * 1e9 / (double) elapsed, (double) JOB_COUNT * snapshots[0]->size * 1000.0 / (double) elapsed,
+           (double) *baseline / (double) elapsed,
+           100.0 * (double) compressed_bytes / ((double) JOB_COUNT * snapshots[0]->size));
+}
+
+int main(void) {
+    struct obs_shared_buffer* snapshots[CHUNK_COUNT];
+    for (int32_t i = 0; i < CHUNK_COUNT; ++i) {
+        struct mc_chunk* chunk = mc_chunk_create(i % 8, i / 8);
+        if (chunk == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return EXIT_FAILURE;
+        }
+        terrain_generate(chunk, 0x0BEE);
+        snapshots[i] = mc_chunk_snapshot(chunk);
+        mc_chunk_destroy(chunk);
+    }
+
+    // Past the amount of processors the workers only take turns, which is shown as well.
+    long const processors = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned const max_workers = processors > 4 ? (unsigned) processors : 4;
+    printf("%ld processor(s) online, level %d\n", processors, LEVEL);
+    uint64_t baseline = 0;
+    for (unsigned workers = 1; workers <= max_workers; workers *= 2) {
+        bench_workers(workers, snapshots, &baseline);
+    }
+    if ((max_workers & (max_workers - 1)) != 0) {
+        bench_workers(max_workers, snapshots, &baseline);
+    }
+
+    for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+        obs_shared_buffer_release(snapshots[i]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,257 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include "obsidian/minecraft/chunk_map.h"
+
+#include <stdlib.h>
+
+
+/// Amount of lookups measured per chunk in the map.
+#define LOOKUP_ROUNDS 16
+
+/// Map sizes measured: a view area of one player, a few hundred players, and a large loaded world.
+static size_t const chunk_counts[] = {441, 16384, 65536};
+
+
+/*!
+ * Node of the chained map.
+ */
+struct chained_node {
+    uint64_t key;
+    struct mc_chunk* chunk;
+    struct chained_node* next;
+};
+
+/*!
+ * A plain hash map with a linked list of nodes per bucket, which the chunk map is measured against.
+ */
+struct chained_map {
+    struct chained_node** buckets;
+    size_t mask;
+    size_t size;
+};
+
+/*!
+ * Mixes the bits of a key, the same finalizer the chunk map hashes with.
+ */
+static inline uint64_t hash_key(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static void chained_init(struct chained_map* map, size_t const bucket_count) {
+    map->buckets = calloc(bucket_count, sizeof(*map->buckets));
+    map->mask = bucket_count - 1;
+    map->size = 0;
+}
+
+static void chained_free(struct chained_map* map) {
+    for (size_t i = 0; i <= map->mask; ++i) {
+        struct chained_node* node = map->buckets[i];
+        while (node != NULL) {
+            struct chained_node* next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    free(map->buckets);
+}
+
+/*!
+ * Doubles the buckets once there are as many nodes as buckets.
+ */
+static void chained_grow(struct chained_map* map) {
+    struct chained_map grown;
+    chained_init(&grown, 2 * (map->mask + 1));
+    for (size_t i = 0; i <= map->mask; ++i) {
+        struct chained_node* node = map->buckets[i];
+        while (node != NULL) {
+            struct chained_node* next = node->next;
+            struct chained_node** bucket = &grown.buckets[hash_key(node->key) & grown.mask];
+            node->next = *bucket;
+            *bucket = node;
+            node = next;
+        }
+    }
+    free(map->buckets);
+    map->buckets = grown.buckets;
+    map->mask = grown.mask;
+}
+
+static struct mc_chunk* chained_get(struct chained_map const* map, uint64_t const key) {
+    for (struct chained_node* node = map->buckets[hash_key(key) & map->mask]; node != NULL; node = node->next) {
+        if (node->key == key) {
+            return node->chunk;
+        }
+    }
+    return NULL;
+}
+
+static void chained_put(struct chained_map* map, struct mc_chunk* chunk) {
+    if (map->size > map->mask) {
+        chained_grow(map);
+    }
+    uint64_t const key = mc_chunk_key(chunk->x, chunk->z);
+    struct chained_node** bucket = &map->buckets[hash_key(key) & map->mask];
+    struct chained_node* node = malloc(sizeof(*node));
+    *node = (struct chained_node) {.key = key, .chunk = chunk, .next = *bucket};
+    *bucket = node;
+    ++map->size;
+}
+
+static struct mc_chunk* chained_remove(struct chained_map* map, uint64_t const key) {
+    for (struct chained_node** link = &map->buckets[hash_key(key) & map->mask]; *link != NULL;
+         link = &(*link)->next) {
+        struct chained_node* node = *link;
+        if (node->key == key) {
+            struct mc_chunk* chunk = node->chunk;
+            *link = node->next;
+            free(node);
+            --map->size;
+            return chunk;
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * Lays chunks out in a square around the origin, the way a loaded world is, and shuffles them so they are not put or
+ * looked up in coordinate order.
+ * \note Only the coordinates of the chunks are written, so the blocks of the chunks are never paged in.
+ */
+static struct mc_chunk** create_chunks(struct mc_chunk** storage, size_t const count, uint32_t* state) {
+    *storage = aligned_alloc(_Alignof(struct mc_chunk), count * sizeof(struct mc_chunk));
+    struct mc_chunk** chunks = malloc(count * sizeof(*chunks));
+    if (*storage == NULL || chunks == NULL) {
+        fprintf(stderr, "Out of memory for %zu chunks\n", count);
+        exit(EXIT_FAILURE);
+    }
+    size_t side = 1;
+    while (side * side < count) {
+        ++side;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        chunks[i] = &(*storage)[i];
+        chunks[i]->x = (int32_t) (i % side) - (int32_t) side / 2;
+        chunks[i]->z = (int32_t) (i / side) - (int32_t) side / 2;
+    }
+    for (size_t i = count - 1; i > 0; --i) {
+        size_t const j = bench_random(state) % (i + 1);
+        struct mc_chunk* swap = chunks[i];
+        chunks[i] = chunks[j];
+        chunks[j] = swap;
+    }
+    return chunks;
+}
+
+/*!
+ * Measures putting, looking up and replacing chunks in both maps.
+ */
+static void bench_maps(size_t const count) {
+    uint32_t state = 0x0BEE;
+    struct mc_chunk* storage;
+    struct mc_chunk** chunks = create_chunks(&storage, count, &state);
+    uint64_t* keys = malloc(count * sizeof(*keys));
+    uint64_t* misses = malloc(count * sizeof(*misses));
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = mc_chunk_key(chunks[i]->x, chunks[i]->z);
+        // Far outside of the square of loaded chunks.
+        misses[i] = mc_chunk_key(chunks[i]->x + 100000, chunks[i]->z);
+    }
+    size_t const lookups = count * LOOKUP_ROUNDS;
+    char name[64];
+    uint64_t sum = 0;
+
+    struct mc_chunk_map* map = mc_chunk_map_create(16);
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < count; ++i) {
+        mc_chunk_map_put(map, chunks[i]);
+    }
+    snprintf(name, sizeof(name), "chunk map, %zu chunks, put growing", count);
+    bench_report_ops(name, bench_now() - start, count);
+    start = bench_now();
+    for (size_t i = 0; i < lookups; ++i) {
+        sum += (uintptr_t) mc_chunk_map_get(map, keys[(i * 7919) % count]);
+    }
+    snprintf(name, sizeof(name), "chunk map, %zu chunks, get hit", count);
+    bench_report_ops(name, bench_now() - start, lookups);
+    start = bench_now();
+    for (size_t i = 0; i < lookups; ++i) {
+        sum += (uintptr_t) mc_chunk_map_get(map, misses[(i * 7919) % count]);
+    }
+    snprintf(name, sizeof(name), "chunk map, %zu chunks, get miss", count);
+    bench_report_ops(name, bench_now() - start, lookups);
+    start = bench_now();
+    for (size_t i = 0; i < lookups; ++i) {
+        size_t const index = bench_random(&state) % count;
+        mc_chunk_map_remove(map, keys[index]);
+        mc_chunk_map_put(map, chunks[index]);
+    }
+    snprintf(name, sizeof(name), "chunk map, %zu chunks, remove and put", count);
+    bench_report_ops(name, bench_now() - start, lookups);
+    mc_chunk_map_destroy(map);
+
+    struct chained_map chained;
+    chained_init(&chained, 16);
+    start = bench_now();
+    for (size_t i = 0; i < count; ++i) {
+        chained_put(&chained, chunks[i]);
+    }
+    snprintf(name, sizeof(name), "chained map, %zu chunks, put growing", count);
+    bench_report_ops(name, bench_now() - start, count);
+    start = bench_now();
+    for (size_t i = 0; i < lookups; ++i) {
+        sum += (uintptr_t) chained_get(&chained, keys[(i * 7919) % count]);
+    }
+    snprintf(name, sizeof(name), "chained map, %zu chunks, get hit", count);
+    bench_report_ops(name, bench_now() - start, lookups);
+    start = bench_now();
+    for (size_t i = 0; i < lookups; ++i) {
+        sum += (uintptr_t) chained_get(&chained, misses[(i * 7919) % count]);
+    }
+    snprintf(name, sizeof(name), "chained map, %zu chunks, get miss", count);
+    bench_report_ops(name, bench_now() - start, lookups);
+    start = bench_now();
+    for (size_t i = 0; i < lookups; ++i) {
+        size_t const index = bench_random(&state) % count;
+        chained_remove(&chained, keys[index]);
+        chained_put(&chained, chunks[index]);
+    }
+    snprintf(name, sizeof(name), "chained map, %zu chunks, remove and put", count);
+    bench_report_ops(name, bench_now() - start, lookups);
+    chained_free(&chained);
+
+    bench_sink = sum;
+    free(misses);
+    free(keys);
+    free(chunks);
+    free(storage);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(chunk_counts) / sizeof(chunk_counts[0]); ++i) {
+        bench_maps(chunk_counts[i]);
+    }
+    return EXIT_SUCCESS;
+}
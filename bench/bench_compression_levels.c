@@ -0,0 +1,92 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "terrain.h"
+
+#include "obsidian/memory.h"
+
+#include <stdlib.h>
+#include <zlib.h>
+
+
+/// Amount of distinct chunks compressed, a 8 by 8 area of terrain.
+#define CHUNK_COUNT 64
+
+/// Amount of times every chunk is compressed per level.
+#define ROUNDS 4
+
+
+int main(void) {
+    struct obs_shared_buffer* snapshots[CHUNK_COUNT];
+    for (int32_t i = 0; i < CHUNK_COUNT; ++i) {
+        struct mc_chunk* chunk = mc_chunk_create(i % 8, i / 8);
+        if (chunk == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return EXIT_FAILURE;
+        }
+        terrain_generate(chunk, 0x0BEE);
+        snapshots[i] = mc_chunk_snapshot(chunk);
+        mc_chunk_destroy(chunk);
+    }
+    size_t const input_size = snapshots[0]->size;
+    uLong const capacity = compressBound(input_size);
+    uint8_t* output = malloc(capacity);
+    if (output == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    // Every level the workers can be set to, with one stream reset between chunks as a worker does.
+    printf("%5s %12s %12s %10s %14s\n", "level", "us/chunk", "bytes/chunk", "ratio", "chunks/s/core");
+    for (int level = 0; level <= 9; ++level) {
+        z_stream stream = {0};
+        if (deflateInit(&stream, level) != Z_OK) {
+            fprintf(stderr, "Failed to initialize deflate at level %d\n", level);
+            return EXIT_FAILURE;
+        }
+        size_t compressed = 0;
+        uint64_t const start = bench_now();
+        for (size_t round = 0; round < ROUNDS; ++round) {
+            for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+                deflateReset(&stream);
+                stream.next_in = snapshots[i]->data;
+                stream.avail_in = (uInt) input_size;
+                stream.next_out = output;
+                stream.avail_out = (uInt) capacity;
+                if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+                    fprintf(stderr, "Failed to deflate at level %d\n", level);
+                    return EXIT_FAILURE;
+                }
+                compressed += stream.total_out;
+            }
+        }
+        uint64_t const elapsed = bench_now() - start;
+        deflateEnd(&stream);
+        size_t const chunks = ROUNDS * CHUNK_COUNT;
+        printf("%5d %12.1f %12zu %9.1f%% %14.0f\n", level, (double) elapsed / 1000.0 / (double) chunks,
+               compressed / chunks, 100.0 * (double) compressed / ((double) chunks * (double) input_size),
+               (double) chunks * 1e9 / (double) elapsed);
+    }
+
+    free(output);
+    for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+        obs_shared_buffer_release(snapshots[i]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include "obsidian/minecraft/protocol.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/// Size of the generated client traffic.
+#define STREAM_SIZE (1024 * 1024)
+
+/// Size of the segments the traffic arrives in, the maximum segment size of TCP over Ethernet.
+#define SEGMENT_SIZE 1460
+
+/// Capacity of the lengths array handed to the scan, as in the server.
+#define MAX_PACKETS 64
+
+/// Amount of times the traffic is processed per measurement.
+#define ROUNDS 64
+
+
+/*!
+ * Appends a packet of a given type and length, its fields left zero.
+ */
+static size_t append_packet(uint8_t* stream, size_t const size, mc_byte const type, size_t const length) {
+    stream[size] = (uint8_t) type;
+    memset(stream + size + 1, 0, length - 1);
+    return size + length;
+}
+
+/*!
+ * Generates what a moving player sends: mostly position and look updates, some digging and now and then a chat message.
+ * \return Amount of packets generated.
+ */
+static size_t generate_traffic(struct mc_proto_codec const* codec, uint8_t* stream, size_t* size) {
+    uint32_t state = 0x0BEE;
+    size_t count = 0;
+    *size = 0;
+    while (*size + 256 < STREAM_SIZE) {
+        uint32_t const pick = bench_random(&state) % 100;
+        if (pick < 50) {
+            *size = append_packet(stream, *size, MC_PACKET_PLAYER_TRANSFORM, 42);
+        }
+        else if (pick < 75) {
+            *size = append_packet(stream, *size, MC_PACKET_PLAYER_POSITION, 34);
+        }
+        else if (pick < 85) {
+            *size = append_packet(stream, *size, MC_PACKET_PLAYER_ROTATION, 10);
+        }
+        else if (pick < 93) {
+            *size = append_packet(stream, *size, MC_PACKET_PLAYER_GROUNDED, 2);
+        }
+        else if (pick < 98) {
+            *size = append_packet(stream, *size, MC_PACKET_PLAYER_DIG, 12);
+        }
+        else {
+            // A chat message of up to 60 characters.
+            size_t const length = 1 + bench_random(&state) % 60;
+            size_t const unit = codec->string_encoding == MC_PROTO_STRINGS_UCS2 ? 2 : 1;
+            stream[(*size)++] = MC_PACKET_CHAT;
+            stream[(*size)++] = (uint8_t) (length >> 8);
+            stream[(*size)++] = (uint8_t) length;
+            for (size_t i = 0; i < length; ++i) {
+                if (unit == 2) {
+                    stream[(*size)++] = 0;
+                }
+                stream[(*size)++] = (uint8_t) ('a' + i % 26);
+            }
+        }
+        ++count;
+    }
+    return count;
+}
+
+/*!
+ * Scans the traffic, and decodes or views every complete packet if asked to.
+ * \return Amount of packets found.
+ */
+static size_t scan(struct mc_proto_codec const* codec, uint8_t const* data, size_t const size, int const mode,
+                   size_t* consumed) {
+    static struct mc_proto_client_packet packet;
+    static struct mc_proto_client_view view;
+    size_t lengths[MAX_PACKETS];
+    size_t packets = 0;
+    size_t offset = 0;
+    for (;;) {
+        int status;
+        size_t const found = mc_proto_scan_client_packets(codec, data + offset, size - offset, lengths, MAX_PACKETS,
+                                                          &status);
+        for (size_t i = 0; i < found; ++i) {
+            if (mode == 1) {
+                mc_proto_decode_client_packet(codec, data + offset, lengths[i], &packet);
+            }
+            else if (mode == 2) {
+                mc_proto_view_client_packet(codec, data + offset, lengths[i], &view);
+            }
+            offset += lengths[i];
+        }
+        packets += found;
+        if (found < MAX_PACKETS || status <= 0) {
+            break;
+        }
+    }
+    *consumed = offset;
+    return packets;
+}
+
+/*!
+ * Decodes packets one after the other without framing them first, which is how partial packets used to be found.
+ * \return Amount of packets decoded.
+ */
+static size_t decode_unframed(struct mc_proto_codec const* codec, uint8_t const* data, size_t const size,
+                              size_t* consumed) {
+    static struct mc_proto_client_packet packet;
+    size_t packets = 0;
+    size_t offset = 0;
+    for (;;) {
+        int const length = mc_proto_decode_client_packet(codec, data + offset, size - offset, &packet);
+        if (length <= 0) {
+            break;
+        }
+        offset += (size_t) length;
+        ++packets;
+    }
+    *consumed = offset;
+    return packets;
+}
+
+/*!
+ * Processes the traffic with one of the approaches, either all at once or as it arrives in segments, keeping the
+ * partial packet at the end of a segment for the next one as the receive ring does.
+ * \param mode 0 to only scan, 1 to scan and decode, 2 to scan and view, 3 to decode without framing.
+ * \return Amount of packets processed.
+ */
+static size_t process(struct mc_proto_codec const* codec, uint8_t const* stream, size_t const size, int const mode,
+                      size_t const segment_size) {
+    static uint8_t window[STREAM_SIZE];
+    size_t packets = 0;
+    size_t pending = 0;
+    for (size_t received = 0; received < size;) {
+        size_t const segment = size - received < segment_size ? size - received : segment_size;
+        memcpy(window + pending, stream + received, segment);
+        received += segment;
+        pending += segment;
+        size_t consumed;
+        packets += mode == 3 ? decode_unframed(codec, window, pending, &consumed)
+                             : scan(codec, window, pending, mode, &consumed);
+        memmove(window, window + consumed, pending - consumed);
+        pending -= consumed;
+    }
+    return packets;
+}
+
+int main(void) {
+    static uint8_t stream[STREAM_SIZE];
+    static char const* const modes[] = {"scan", "scan and decode", "scan and view", "decode without framing"};
+    int const protocol_versions[] = {1, 14};
+    for (size_t v = 0; v < sizeof(protocol_versions) / sizeof(protocol_versions[0]); ++v) {
+        struct mc_proto_codec const* codec = mc_proto_codec_for_version(protocol_versions[v]);
+        size_t size;
+        size_t const count = generate_traffic(codec, stream, &size);
+        for (int mode = 0; mode < 4; ++mode) {
+            size_t const segment_sizes[] = {size, SEGMENT_SIZE};
+            for (size_t s = 0; s < 2; ++s) {
+                size_t packets = 0;
+                uint64_t const start = bench_now();
+                for (size_t round = 0; round < ROUNDS; ++round) {
+                    packets += process(codec, stream, size, mode, segment_sizes[s]);
+                }
+                uint64_t const elapsed = bench_now() - start;
+                if (packets != ROUNDS * count) {
+                    fprintf(stderr, "Processed %zu of %zu packets\n", packets, ROUNDS * count);
+                    return EXIT_FAILURE;
+                }
+                char name[96];
+                snprintf(name, sizeof(name), "%s, %s, %s", codec->name, modes[mode],
+                         s == 0 ? "whole" : "in segments");
+                printf("%-48s %8.1f ns/packet %10.1f MB/s\n", name, (double) elapsed / (double) packets,
+                       (double) (ROUNDS * size) * 1000.0 / (double) elapsed);
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include "obsidian/minecraft/chunk.h"
+#include "obsidian/minecraft/nbt.h"
+#include "obsidian/minecraft/region.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/// Amount of entities in the tag-dense document.
+#define ENTITY_COUNT 20000
+
+/// Bytes read or written per measurement, repeating the document as often as needed.
+#define BYTES_PER_MEASUREMENT (256u * 1024 * 1024)
+
+
+/*!
+ * Writes a document of many small tags, like the entity list of a chunk or a player file.
+ * \return Size of the document in bytes.
+ */
+static size_t write_entities(void* buffer, size_t const capacity) {
+    static uint8_t const data[16] = {0};
+    struct mc_nbt_writer writer;
+    mc_nbt_writer_init(&writer, buffer, capacity);
+    mc_nbt_write_header(&writer, MC_NBT_COMPOUND, "");
+    mc_nbt_write_list(&writer, "Entities", MC_NBT_COMPOUND, ENTITY_COUNT);
+    for (int32_t i = 0; i < ENTITY_COUNT; ++i) {
+        mc_nbt_write_string(&writer, "id", i % 3 == 0 ? "Pig" : "Skeleton");
+        mc_nbt_write_int(&writer, "x", i);
+        mc_nbt_write_int(&writer, "y", 64);
+        mc_nbt_write_int(&writer, "z", -i);
+        mc_nbt_write_short(&writer, "Health", 20);
+        mc_nbt_write_short(&writer, "Fire", -20);
+        mc_nbt_write_long(&writer, "UUIDMost", (int64_t) i << 32);
+        mc_nbt_write_byte(&writer, "OnGround", 1);
+        mc_nbt_write_byte_array(&writer, "Data", data, sizeof(data));
+        mc_nbt_write_end(&writer);
+    }
+    mc_nbt_write_end(&writer);
+    return writer.cursor;
+}
+
+/*!
+ * Visits every tag of a document, entering every compound and list and copying out every byte array, as loading does.
+ * \return Sum of the integers and lengths read, so the walk cannot be left out.
+ */
+static uint64_t walk(void const* data, size_t const size) {
+    static uint8_t copy[MC_CHUNK_BLOCKS];
+    struct mc_nbt_reader reader;
+    mc_nbt_reader_init(&reader, data, size);
+    struct mc_nbt_tag tag;
+    uint64_t sum = 0;
+    unsigned depth = 0;
+    for (;;) {
+        if (mc_nbt_next(&reader, &tag)) {
+            if (tag.type == MC_NBT_COMPOUND || tag.type == MC_NBT_LIST) {
+                depth += mc_nbt_enter(&reader);
+            }
+            else if (tag.type >= MC_NBT_BYTE && tag.type <= MC_NBT_LONG) {
+                sum += (uint64_t) mc_nbt_integer(&tag);
+            }
+            else if (tag.type == MC_NBT_BYTE_ARRAY && tag.length <= sizeof(copy)) {
+                memcpy(copy, tag.payload, tag.length);
+                sum += copy[tag.length / 2];
+            }
+            else {
+                sum += tag.length;
+            }
+        }
+        else if (reader.error || depth == 0) {
+            break;
+        }
+        else {
+            --depth;
+        }
+    }
+    if (reader.error) {
+        fprintf(stderr, "Failed to walk NBT written by the benchmark\n");
+        exit(EXIT_FAILURE);
+    }
+    return sum;
+}
+
+/*!
+ * Measures walking a document.
+ */
+static void bench_walk(char const* name, void const* data, size_t const size) {
+    size_t const rounds = BYTES_PER_MEASUREMENT / size + 1;
+    uint64_t sum = 0;
+    uint64_t const start = bench_now();
+    for (size_t i = 0; i < rounds; ++i) {
+        sum += walk(data, size);
+    }
+    bench_report_bytes(name, bench_now() - start, rounds * size);
+    bench_sink = sum;
+}
+
+int main(void) {
+    size_t const capacity = 4 * 1024 * 1024;
+    uint8_t* buffer = malloc(capacity);
+    struct mc_chunk* chunk = mc_chunk_create(3, -7);
+    if (buffer == NULL || chunk == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    // Stone below sea level and air above, like fresh terrain.
+    for (unsigned x = 0; x < MC_CHUNK_WIDTH; ++x) {
+        for (unsigned z = 0; z < MC_CHUNK_DEPTH; ++z) {
+            for (unsigned y = 0; y < 64; ++y) {
+                mc_chunk_set_block(chunk, x, y, z, 1, 0);
+            }
+        }
+    }
+
+    // A chunk is a few large byte arrays, which are copied and skipped whole.
+    size_t size = mc_region_write_chunk(chunk, 0, buffer, capacity);
+    size_t rounds = BYTES_PER_MEASUREMENT / size + 1;
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < rounds; ++i) {
+        bench_sink = mc_region_write_chunk(chunk, i, buffer, capacity);
+    }
+    bench_report_bytes("write chunk NBT", bench_now() - start, rounds * size);
+    bench_walk("walk chunk NBT", buffer, size);
+
+    // Entities are many small tags, where the cost per tag shows.
+    size = write_entities(buffer, capacity);
+    rounds = BYTES_PER_MEASUREMENT / 16 / size + 1;
+    start = bench_now();
+    for (size_t i = 0; i < rounds; ++i) {
+        bench_sink = write_entities(buffer, capacity);
+    }
+    bench_report_bytes("write entity NBT", bench_now() - start, rounds * size);
+    bench_walk("walk entity NBT", buffer, size);
+
+    mc_chunk_destroy(chunk);
+    free(buffer);
+    return EXIT_SUCCESS;
+}
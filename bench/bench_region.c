@@ -0,0 +1,198 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "terrain.h"
+
+#include "obsidian/minecraft/region.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+
+/// Size of a sector of a region file in bytes.
+#define SECTOR_SIZE 4096
+
+/// Size of the header of a region file.
+#define HEADER_SIZE (2 * SECTOR_SIZE)
+
+/// Room for the NBT of a chunk.
+#define NBT_CAPACITY (128 * 1024)
+
+/// Amount of times the region is loaded per measurement.
+#define ROUNDS 8
+
+
+/*!
+ * A region file under construction, in memory.
+ */
+struct region_image {
+    uint8_t* data;
+    size_t size;
+};
+
+static void store_u32(uint8_t* p, uint32_t const value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+/*!
+ * Appends a chunk of generated terrain to the image, zlib-compressed at the default level like the game saves it.
+ */
+static void add_chunk(struct region_image* image, int32_t const chunk_x, int32_t const chunk_z, uint8_t* nbt) {
+    struct mc_chunk* chunk = mc_chunk_create(chunk_x, chunk_z);
+    if (chunk == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    terrain_generate(chunk, 0x0BEE);
+    size_t const nbt_size = mc_region_write_chunk(chunk, 0, nbt, NBT_CAPACITY);
+    mc_chunk_destroy(chunk);
+
+    uLongf compressed_size = compressBound(nbt_size);
+    uint8_t* compressed = malloc(compressed_size);
+    if (compressed == NULL || compress(compressed, &compressed_size, nbt, nbt_size) != Z_OK) {
+        fprintf(stderr, "Failed to compress chunk %d, %d\n", chunk_x, chunk_z);
+        exit(EXIT_FAILURE);
+    }
+    size_t const sectors = (5 + compressed_size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    size_t const offset = image->size;
+    image->size += sectors * SECTOR_SIZE;
+    image->data = realloc(image->data, image->size);
+    memset(image->data + offset, 0, sectors * SECTOR_SIZE);
+    store_u32(image->data + offset, compressed_size + 1);
+    image->data[offset + 4] = 2;
+    memcpy(image->data + offset + 5, compressed, compressed_size);
+    store_u32(image->data + 4 * (chunk_x + chunk_z * MC_REGION_SIZE), (uint32_t) (offset / SECTOR_SIZE) << 8 | sectors);
+    free(compressed);
+}
+
+/*!
+ * Asks the kernel to drop the file from the page cache, so the next load reads it from the disk.
+ * \note This has no effect on file systems that live in memory, such as tmpfs.
+ */
+static void evict(char const* path) {
+    int const fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+/*!
+ * Opens the region, loads every chunk of it and closes it again, as the server does for a region it has not seen.
+ * \return Amount of chunks loaded.
+ */
+static size_t load_region(char const* path, z_stream* stream, uint8_t** scratch, size_t* scratch_size) {
+    struct mc_region* region = mc_region_open(path);
+    if (region == NULL) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    size_t loaded = 0;
+    for (int32_t z = 0; z < MC_REGION_SIZE; ++z) {
+        for (int32_t x = 0; x < MC_REGION_SIZE; ++x) {
+            struct mc_chunk* chunk = mc_region_load_chunk(region, x, z, stream, scratch, scratch_size);
+            if (chunk != NULL) {
+                bench_sink = chunk->heightmap[x];
+                mc_chunk_destroy(chunk);
+                ++loaded;
+            }
+        }
+    }
+    mc_region_close(region);
+    return loaded;
+}
+
+/*!
+ * Measures loading a region from the page cache and, where the file system allows evicting it, from the disk.
+ */
+static void bench_loads(char const* path, size_t const file_size, bool const cold) {
+    z_stream stream = {0};
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        fprintf(stderr, "Failed to initialize inflate\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t scratch_size = 0;
+    uint8_t* scratch = NULL;
+    load_region(path, &stream, &scratch, &scratch_size);
+
+    uint64_t elapsed = 0;
+    size_t chunks = 0;
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        if (cold) {
+            evict(path);
+        }
+        uint64_t const start = bench_now();
+        chunks += load_region(path, &stream, &scratch, &scratch_size);
+        elapsed += bench_now() - start;
+    }
+    char const* const name = cold ? "region, evicted from the page cache" : "region, in the page cache";
+    // Nanoseconds per byte of file are seconds per GB of world.
+    printf("%-40s %10.1f us/chunk %10.1f MB/s of file %8.2f s per GB of world\n", name,
+           (double) elapsed / 1000.0 / (double) chunks, (double) (ROUNDS * file_size) * 1000.0 / (double) elapsed,
+           (double) elapsed / (double) (ROUNDS * file_size));
+    free(scratch);
+    inflateEnd(&stream);
+}
+
+int main(int argc, char** argv) {
+    // The file goes into the directory given, by default the working directory, so it can be put on a real disk.
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/obsidian-bench-XXXXXX", argc > 1 ? argv[1] : ".");
+    int const fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+
+    struct region_image image = {.data = calloc(1, HEADER_SIZE), .size = HEADER_SIZE};
+    uint8_t* nbt = malloc(NBT_CAPACITY);
+    for (int32_t z = 0; z < MC_REGION_SIZE; ++z) {
+        for (int32_t x = 0; x < MC_REGION_SIZE; ++x) {
+            add_chunk(&image, x, z, nbt);
+        }
+    }
+    free(nbt);
+    bool const written = write(fd, image.data, image.size) == (ssize_t) image.size;
+    close(fd);
+    if (!written) {
+        perror("write");
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+    printf("%d chunks of terrain in a region file of %zu KiB\n", MC_REGION_SIZE * MC_REGION_SIZE, image.size / 1024);
+
+    uint64_t const start = bench_now();
+    for (size_t i = 0; i < 1000; ++i) {
+        mc_region_close(mc_region_open(path));
+    }
+    bench_report_ops("open and close a region", bench_now() - start, 1000);
+    bench_loads(path, image.size, false);
+    bench_loads(path, image.size, true);
+
+    unlink(path);
+    free(image.data);
+    return EXIT_SUCCESS;
+}
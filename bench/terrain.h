@@ -0,0 +1,135 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_BENCH_TERRAIN_H
+#define OBSIDIAN_BENCH_TERRAIN_H
+
+#include "obsidian/minecraft/chunk.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/// Blocks used by the generated terrain.
+enum {
+    TERRAIN_AIR = 0,
+    TERRAIN_STONE = 1,
+    TERRAIN_GRASS = 2,
+    TERRAIN_DIRT = 3,
+    TERRAIN_BEDROCK = 7,
+    TERRAIN_WATER = 9,
+    TERRAIN_SAND = 12,
+    TERRAIN_GRAVEL = 13,
+    TERRAIN_IRON_ORE = 15,
+    TERRAIN_COAL_ORE = 16,
+};
+
+/// Height of the water surface.
+#define TERRAIN_SEA_LEVEL 64
+
+
+/*!
+ * Hashes a position into 32 random bits.
+ */
+static inline uint32_t terrain_hash(uint32_t const seed, int32_t const x, int32_t const y, int32_t const z) {
+    uint32_t h = seed ^ (uint32_t) x * 0x9E3779B1u ^ (uint32_t) y * 0x85EBCA77u ^ (uint32_t) z * 0xC2B2AE3Du;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    h *= 0x297A2D39u;
+    h ^= h >> 15;
+    return h;
+}
+
+/*!
+ * Height of the ground at a column, from value noise interpolated between a grid of random heights.
+ */
+static inline int terrain_height(uint32_t const seed, int32_t const x, int32_t const z) {
+    int height = TERRAIN_SEA_LEVEL - 6;
+    // Two octaves: broad hills every 32 blocks and bumps every 8 blocks.
+    for (int32_t cell = 32, amplitude = 24; cell >= 8; cell /= 4, amplitude /= 3) {
+        int32_t const cx = x >> (cell == 32 ? 5 : 3);
+        int32_t const cz = z >> (cell == 32 ? 5 : 3);
+        int32_t const fx = x & (cell - 1);
+        int32_t const fz = z & (cell - 1);
+        int32_t const h00 = (int32_t) (terrain_hash(seed, cx, cell, cz) % (uint32_t) amplitude);
+        int32_t const h10 = (int32_t) (terrain_hash(seed, cx + 1, cell, cz) % (uint32_t) amplitude);
+        int32_t const h01 = (int32_t) (terrain_hash(seed, cx, cell, cz + 1) % (uint32_t) amplitude);
+        int32_t const h11 = (int32_t) (terrain_hash(seed, cx + 1, cell, cz + 1) % (uint32_t) amplitude);
+        int32_t const top = h00 * (cell - fx) + h10 * fx;
+        int32_t const bottom = h01 * (cell - fx) + h11 * fx;
+        height += (top * (cell - fz) + bottom * fz) / (cell * cell);
+    }
+    return height;
+}
+
+/*!
+ * Fills a chunk with terrain shaped like that of alpha worlds, so compression sees realistic data.
+ *
+ * Hills of stone are covered by dirt and grass, or by sand and water below sea level. Bedrock is mixed into the
+ * bottom layers, and ores, gravel and small caves are scattered through the stone. Sky light is full down to the
+ * ground and fades through water.
+ * \param chunk Pointer to the chunk, which must be empty.
+ * \param seed Seed of the world.
+ */
+static inline void terrain_generate(struct mc_chunk* chunk, uint32_t const seed) {
+    for (unsigned x = 0; x < MC_CHUNK_WIDTH; ++x) {
+        for (unsigned z = 0; z < MC_CHUNK_DEPTH; ++z) {
+            int32_t const world_x = chunk->x * MC_CHUNK_WIDTH + (int32_t) x;
+            int32_t const world_z = chunk->z * MC_CHUNK_DEPTH + (int32_t) z;
+            int const height = terrain_height(seed, world_x, world_z);
+            bool const shore = height <= TERRAIN_SEA_LEVEL + 1;
+            for (int y = 0; y < MC_CHUNK_HEIGHT; ++y) {
+                uint32_t const noise = terrain_hash(seed, world_x, y, world_z);
+                mc_byte type = TERRAIN_AIR;
+                if (y == 0 || (y < 5 && noise % 5 < (uint32_t) (5 - y))) {
+                    type = TERRAIN_BEDROCK;
+                }
+                else if (y < height - 3) {
+                    type = TERRAIN_STONE;
+                    if (noise % 100 == 0) {
+                        type = y < 48 ? TERRAIN_IRON_ORE : TERRAIN_COAL_ORE;
+                    }
+                    else if (noise % 100 < 3) {
+                        type = noise % 2 == 0 ? TERRAIN_GRAVEL : TERRAIN_AIR;
+                    }
+                }
+                else if (y < height) {
+                    type = shore ? TERRAIN_SAND : TERRAIN_DIRT;
+                }
+                else if (y == height) {
+                    type = shore ? TERRAIN_SAND : TERRAIN_GRASS;
+                }
+                else if (y <= TERRAIN_SEA_LEVEL) {
+                    type = TERRAIN_WATER;
+                }
+                if (type != TERRAIN_AIR) {
+                    mc_chunk_set_block(chunk, x, (unsigned) y, z, type, 0);
+                }
+                if (y > height) {
+                    int const depth = TERRAIN_SEA_LEVEL - y;
+                    uint8_t const sky = depth >= 0 ? (uint8_t) (depth * 3 > 15 ? 0 : 15 - depth * 3) : 15;
+                    mc_chunk_set_light(chunk, x, (unsigned) y, z, 0, sky);
+                }
+            }
+        }
+    }
+    mc_chunk_update(chunk);
+}
+
+#endif // !OBSIDIAN_BENCH_TERRAIN_H
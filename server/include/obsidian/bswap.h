@@ -0,0 +1,65 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_BSWAP_H
+#define OBSIDIAN_BSWAP_H
+
+#include <stddef.h>
+
+
+/*!
+ * Conversion of arrays of 16, 32 and 64-bit integers between host and big-endian (network) byte order.
+ *
+ * The same function converts in either direction. On x86-64 the arrays are swapped with SSSE3 or AVX2 byte shuffles,
+ * elsewhere one element at a time. On big-endian hosts the arrays are copied as they are. Source and destination do
+ * not need to be aligned, and may be the same array, but must not otherwise overlap.
+ */
+
+
+/*!
+ * Picks the fastest implementation of the conversions supported by the CPU.
+ * \note Until this is called the scalar implementation is used. Call it once at startup, before any other thread
+ *       converts arrays.
+ */
+void obs_bswap_init(void);
+
+/*!
+ * Converts an array of 16-bit integers between host and big-endian byte order.
+ * \param dst Destination array.
+ * \param src Source array.
+ * \param count Amount of elements in the array.
+ */
+void obs_bswap16_array(void* dst, void const* src, size_t count);
+
+/*!
+ * Converts an array of 32-bit integers between host and big-endian byte order.
+ * \param dst Destination array.
+ * \param src Source array.
+ * \param count Amount of elements in the array.
+ */
+void obs_bswap32_array(void* dst, void const* src, size_t count);
+
+/*!
+ * Converts an array of 64-bit integers between host and big-endian byte order.
+ * \param dst Destination array.
+ * \param src Source array.
+ * \param count Amount of elements in the array.
+ */
+void obs_bswap64_array(void* dst, void const* src, size_t count);
+
+#endif // !OBSIDIAN_BSWAP_H
@@ -0,0 +1,102 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_DISK_QUEUE_H
+#define OBSIDIAN_DISK_QUEUE_H
+
+#include "obsidian/server.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*!
+ * A disk operation as seen by a disk queue, embedded in whatever describes the operation.
+ */
+struct obs_disk_entry {
+    /// One of obs_disk_op.
+    enum obs_disk_op op;
+
+    /// Monotonic time in nanoseconds at which the operation was submitted.
+    uint64_t start_time;
+
+    /// Next operation waiting to be submitted.
+    struct obs_disk_entry* next;
+};
+
+/*!
+ * Keeps the amount of disk operations in flight under a limit, so disk I/O cannot take up the whole I/O ring.
+ *
+ * Operations over the limit wait first-in first-out, and each completion lets the oldest waiting operation in. The
+ * queue does not submit anything itself: it tells the caller which operations to submit, and keeps the disk counters
+ * and latency histograms of the server metrics.
+ */
+struct obs_disk_queue {
+    /// Maximum amount of operations in flight at once.
+    size_t limit;
+
+    /// Oldest waiting operation.
+    struct obs_disk_entry* head;
+
+    /// Newest waiting operation.
+    struct obs_disk_entry* tail;
+
+    /// Metrics the counters and histograms are kept in.
+    struct obs_server_metrics* metrics;
+};
+
+
+/*!
+ * Starts a queue with nothing in flight.
+ * \param queue Pointer to the queue.
+ * \param limit Maximum amount of operations in flight at once, at least one.
+ * \param metrics Metrics to keep the disk counters and latency histograms in.
+ */
+void obs_disk_queue_init(struct obs_disk_queue* queue, size_t limit, struct obs_server_metrics* metrics);
+
+/*!
+ * Finds the latency histogram bucket of an operation.
+ * \param latency Time the operation took in microseconds.
+ * \return The bucket, OBS_DISK_LATENCY_BUCKETS - 1 for everything slower than the histogram covers.
+ */
+static inline size_t obs_disk_latency_bucket(uint64_t const latency) {
+    size_t const bucket = latency > 0 ? (size_t) (64 - __builtin_clzll(latency)) : 0;
+    return bucket < OBS_DISK_LATENCY_BUCKETS ? bucket : OBS_DISK_LATENCY_BUCKETS - 1;
+}
+
+/*!
+ * Lets an operation in if the limit allows, otherwise makes it wait behind the operations already waiting.
+ * \param queue Pointer to the queue.
+ * \param entry Pointer to the operation.
+ * \param now Monotonic time in nanoseconds.
+ * \return Whether the operation is in flight and has to be submitted now.
+ */
+bool obs_disk_queue_admit(struct obs_disk_queue* queue, struct obs_disk_entry* entry, uint64_t now);
+
+/*!
+ * Records the latency of a completed operation and lets the oldest waiting operation in its place.
+ * \param queue Pointer to the queue.
+ * \param entry Pointer to the operation, which was in flight.
+ * \param now Monotonic time in nanoseconds.
+ * \return Pointer to the operation that is now in flight and has to be submitted, or NULL if none was waiting.
+ */
+struct obs_disk_entry* obs_disk_queue_complete(struct obs_disk_queue* queue, struct obs_disk_entry const* entry,
+                                               uint64_t now);
+
+#endif // !OBSIDIAN_DISK_QUEUE_H
@@ -19,7 +19,9 @@
 #ifndef OBSIDIAN_MEMORY_H
 #define OBSIDIAN_MEMORY_H
 
+#include <stdatomic.h>
 #include <stddef.h>
+#include <stdint.h>
 
 
 /*!
@@ -114,4 +116,44 @@ struct obs_ring_buffer* obs_alloc_ring_buffer(size_t size, size_t count);
  */
 void obs_free_ring_buffer(struct obs_ring_buffer* ring_buffer);
 
+
+/*!
+ * A reference counted buffer.
+ *
+ * Lets one buffer be handed to several users, e.g. the pending sends of the same data to many clients, and frees it
+ * when the last of them is done. The reference count is atomic, so references can be taken and dropped from any
+ * thread.
+ */
+struct obs_shared_buffer {
+    /// Amount of references to the buffer.
+    atomic_size_t references;
+
+    /// Size of the data in bytes.
+    size_t size;
+
+    /// The data.
+    uint8_t data[];
+};
+
+
+/*!
+ * Allocates a new shared buffer.
+ * \param size Size of the data in bytes.
+ * \return Pointer to the buffer holding a single reference, or NULL if out of memory.
+ */
+struct obs_shared_buffer* obs_shared_buffer_create(size_t size);
+
+/*!
+ * Takes another reference to a shared buffer.
+ * \param buffer Pointer to the shared buffer.
+ * \return The buffer.
+ */
+struct obs_shared_buffer* obs_shared_buffer_retain(struct obs_shared_buffer* buffer);
+
+/*!
+ * Drops a reference to a shared buffer, freeing it if this was the last one.
+ * \param buffer Pointer to the shared buffer.
+ */
+void obs_shared_buffer_release(struct obs_shared_buffer* buffer);
+
 #endif // !OBSIDIAN_MEMORY_H
@@ -0,0 +1,211 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_CHUNK_H
+#define OBSIDIAN_MINECRAFT_CHUNK_H
+
+#include "obsidian/memory.h"
+#include "obsidian/minecraft/protocol.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Width of a chunk in blocks.
+#define MC_CHUNK_WIDTH 16
+
+/// Height of a chunk in blocks.
+#define MC_CHUNK_HEIGHT 128
+
+/// Depth of a chunk in blocks.
+#define MC_CHUNK_DEPTH 16
+
+/// Amount of blocks in a chunk.
+#define MC_CHUNK_BLOCKS (MC_CHUNK_WIDTH * MC_CHUNK_HEIGHT * MC_CHUNK_DEPTH)
+
+/// Offset of the block types in the chunk data.
+#define MC_CHUNK_BLOCKS_OFFSET 0
+
+/// Offset of the nibble-packed block metadata in the chunk data.
+#define MC_CHUNK_METADATA_OFFSET (MC_CHUNK_BLOCKS_OFFSET + MC_CHUNK_BLOCKS)
+
+/// Offset of the nibble-packed block light in the chunk data.
+#define MC_CHUNK_BLOCK_LIGHT_OFFSET (MC_CHUNK_METADATA_OFFSET + MC_CHUNK_BLOCKS / 2)
+
+/// Offset of the nibble-packed sky light in the chunk data.
+#define MC_CHUNK_SKY_LIGHT_OFFSET (MC_CHUNK_BLOCK_LIGHT_OFFSET + MC_CHUNK_BLOCKS / 2)
+
+/// Size of the chunk data in bytes.
+#define MC_CHUNK_DATA_SIZE (MC_CHUNK_SKY_LIGHT_OFFSET + MC_CHUNK_BLOCKS / 2)
+
+
+/*!
+ * A 16x128x16 column of blocks.
+ *
+ * The block data is a single array in the order and format of the uncompressed data of a chunk data packet for a whole
+ * chunk: block types, then block metadata, block light and sky light packed two blocks to a byte, low nibble first.
+ * Within each part blocks are indexed by y, then z, then x, as computed by mc_chunk_index(). Compressing a chunk for
+ * the wire is a deflate of the array as it is.
+ *
+ * Every change to a block goes through the setters below, which bump the modification counter of the chunk so cached
+ * compressed data of an older state can be told apart.
+ */
+struct mc_chunk {
+    /// Block data in wire order, aligned to a cache line.
+    _Alignas(64) uint8_t data[MC_CHUNK_DATA_SIZE];
+
+    /// Height of the lowest block above which every block is air, indexed by z, then x.
+    uint8_t heightmap[MC_CHUNK_WIDTH * MC_CHUNK_DEPTH];
+
+    /// X coordinate of the chunk.
+    int32_t x;
+
+    /// Z coordinate of the chunk.
+    int32_t z;
+
+    /// Counts the changes made to the chunk.
+    uint64_t modification;
+};
+
+
+/*!
+ * Computes the index of a block within the parts of the chunk data.
+ * \param x X coordinate of the block within the chunk, from 0 to 15.
+ * \param y Y coordinate of the block, from 0 to 127.
+ * \param z Z coordinate of the block within the chunk, from 0 to 15.
+ * \return Index of the block.
+ */
+static inline size_t mc_chunk_index(unsigned const x, unsigned const y, unsigned const z) {
+    return y + z * MC_CHUNK_HEIGHT + x * MC_CHUNK_HEIGHT * MC_CHUNK_DEPTH;
+}
+
+/*!
+ * Allocates a chunk filled with air and full sky light.
+ * \param x X coordinate of the chunk.
+ * \param z Z coordinate of the chunk.
+ * \return Pointer to the chunk, or NULL if out of memory.
+ */
+struct mc_chunk* mc_chunk_create(int32_t x, int32_t z);
+
+/*!
+ * Releases a chunk.
+ * \param chunk Pointer to the chunk.
+ */
+void mc_chunk_destroy(struct mc_chunk* chunk);
+
+/*!
+ * Gets the type of a block.
+ * \param chunk Pointer to the chunk.
+ * \param x X coordinate of the block within the chunk.
+ * \param y Y coordinate of the block.
+ * \param z Z coordinate of the block within the chunk.
+ * \return Block type.
+ */
+static inline mc_byte mc_chunk_get_block(struct mc_chunk const* chunk, unsigned const x, unsigned const y,
+                                         unsigned const z) {
+    return (mc_byte) chunk->data[MC_CHUNK_BLOCKS_OFFSET + mc_chunk_index(x, y, z)];
+}
+
+/*!
+ * Gets a nibble from one of the nibble-packed parts of the chunk data.
+ * \param chunk Pointer to the chunk.
+ * \param offset Offset of the part in the chunk data.
+ * \param index Index of the block.
+ * \return The nibble.
+ */
+static inline uint8_t mc_chunk_get_nibble(struct mc_chunk const* chunk, size_t const offset, size_t const index) {
+    uint8_t const packed = chunk->data[offset + index / 2];
+    return index & 1 ? packed >> 4 : packed & 0x0F;
+}
+
+/*!
+ * Gets the metadata of a block.
+ * \see mc_chunk_get_block()
+ */
+static inline uint8_t mc_chunk_get_metadata(struct mc_chunk const* chunk, unsigned const x, unsigned const y,
+                                            unsigned const z) {
+    return mc_chunk_get_nibble(chunk, MC_CHUNK_METADATA_OFFSET, mc_chunk_index(x, y, z));
+}
+
+/*!
+ * Gets the light emitted onto a block by other blocks.
+ * \see mc_chunk_get_block()
+ */
+static inline uint8_t mc_chunk_get_block_light(struct mc_chunk const* chunk, unsigned const x, unsigned const y,
+                                               unsigned const z) {
+    return mc_chunk_get_nibble(chunk, MC_CHUNK_BLOCK_LIGHT_OFFSET, mc_chunk_index(x, y, z));
+}
+
+/*!
+ * Gets the light reaching a block from the sky.
+ * \see mc_chunk_get_block()
+ */
+static inline uint8_t mc_chunk_get_sky_light(struct mc_chunk const* chunk, unsigned const x, unsigned const y,
+                                             unsigned const z) {
+    return mc_chunk_get_nibble(chunk, MC_CHUNK_SKY_LIGHT_OFFSET, mc_chunk_index(x, y, z));
+}
+
+/*!
+ * Gets the height of the lowest block above which every block is air.
+ * \param chunk Pointer to the chunk.
+ * \param x X coordinate of the column within the chunk.
+ * \param z Z coordinate of the column within the chunk.
+ * \return The height, from 0 for an empty column to 128 for a column with a block at the top.
+ */
+static inline unsigned mc_chunk_get_height(struct mc_chunk const* chunk, unsigned const x, unsigned const z) {
+    return chunk->heightmap[x + z * MC_CHUNK_WIDTH];
+}
+
+/*!
+ * Changes the type and metadata of a block, keeping the heightmap up to date.
+ * \param chunk Pointer to the chunk.
+ * \param x X coordinate of the block within the chunk.
+ * \param y Y coordinate of the block.
+ * \param z Z coordinate of the block within the chunk.
+ * \param type Block type.
+ * \param metadata Block metadata, from 0 to 15.
+ */
+void mc_chunk_set_block(struct mc_chunk* chunk, unsigned x, unsigned y, unsigned z, mc_byte type, uint8_t metadata);
+
+/*!
+ * Changes the light levels of a block.
+ * \param chunk Pointer to the chunk.
+ * \param x X coordinate of the block within the chunk.
+ * \param y Y coordinate of the block.
+ * \param z Z coordinate of the block within the chunk.
+ * \param block_light Light emitted onto the block by other blocks, from 0 to 15.
+ * \param sky_light Light reaching the block from the sky, from 0 to 15.
+ */
+void mc_chunk_set_light(struct mc_chunk* chunk, unsigned x, unsigned y, unsigned z,
+                        uint8_t block_light, uint8_t sky_light);
+
+/*!
+ * Recomputes the whole heightmap, after the block data was replaced at once.
+ * \param chunk Pointer to the chunk.
+ * \note This bumps the modification counter.
+ */
+void mc_chunk_update(struct mc_chunk* chunk);
+
+/*!
+ * Copies the block data of a chunk for compression.
+ * \param chunk Pointer to the chunk.
+ * \return Shared buffer holding a copy of the block data, or NULL if out of memory.
+ * \see mc_chunk_job::snapshot
+ */
+struct obs_shared_buffer* mc_chunk_snapshot(struct mc_chunk const* chunk);
+
+#endif // !OBSIDIAN_MINECRAFT_CHUNK_H
@@ -0,0 +1,126 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_CHUNK_CACHE_H
+#define OBSIDIAN_MINECRAFT_CHUNK_CACHE_H
+
+#include "obsidian/memory.h"
+#include "obsidian/minecraft/protocol.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*!
+ * Cache of compressed chunk data, so a chunk loaded by many players is compressed once.
+ *
+ * Entries are keyed by chunk coordinate and protocol version, and hold the compressed data as a shared buffer so it
+ * can be sent to any amount of clients without being copied. Every entry remembers the modification counter of the
+ * chunk it was compressed from; a lookup with a newer counter drops the entry, so block changes only need to bump the
+ * counter of their chunk.
+ *
+ * The cache stays below a memory budget by evicting entries with the CLOCK algorithm: a hit marks an entry as
+ * referenced, and the clock hand evicts the first unreferenced entry it finds, clearing the marks it passes.
+ *
+ * The cache is not thread-safe.
+ */
+struct mc_chunk_cache;
+
+
+/*!
+ * Parameters passed at cache creation time.
+ */
+struct mc_chunk_cache_params {
+    /// Maximum amount of memory used by cached data in bytes.
+    size_t memory_budget;
+
+    /// Maximum amount of cached chunks.
+    size_t max_entries;
+};
+
+
+/*!
+ * Counters describing how well the cache works.
+ */
+struct mc_chunk_cache_metrics {
+    /// Lookups that found up-to-date data.
+    uint64_t hits;
+
+    /// Lookups that found nothing or out-of-date data.
+    uint64_t misses;
+
+    /// Entries dropped because the chunk was modified since it was cached.
+    uint64_t invalidations;
+
+    /// Entries dropped to make room for others.
+    uint64_t evictions;
+
+    /// Amount of cached chunks.
+    size_t entries;
+
+    /// Memory used by cached data in bytes.
+    size_t memory_used;
+};
+
+
+/*!
+ * Creates an empty cache.
+ * \param params Pointer to an mc_chunk_cache_params structure.
+ * \return Pointer to the cache, or NULL if out of memory.
+ */
+struct mc_chunk_cache* mc_chunk_cache_create(struct mc_chunk_cache_params const* params);
+
+/*!
+ * Destroys a cache and releases its references to the cached data.
+ * \param cache Pointer to the cache.
+ */
+void mc_chunk_cache_destroy(struct mc_chunk_cache* cache);
+
+/*!
+ * Looks up the compressed data of a chunk.
+ * \param cache Pointer to the cache.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param protocol_version Protocol version the data is sent with.
+ * \param modification Current modification counter of the chunk.
+ * \return A new reference to the compressed data, or NULL if there is no data for this modification of the chunk.
+ */
+struct obs_shared_buffer* mc_chunk_cache_get(struct mc_chunk_cache* cache, int32_t chunk_x, int32_t chunk_z,
+                                             mc_dword protocol_version, uint64_t modification);
+
+/*!
+ * Adds the compressed data of a chunk to the cache, replacing older data for the same chunk.
+ * \param cache Pointer to the cache.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param protocol_version Protocol version the data is sent with.
+ * \param modification Modification counter of the chunk the data was compressed from.
+ * \param data Compressed data. The cache takes a reference of its own.
+ * \note Data larger than the memory budget is not cached.
+ */
+void mc_chunk_cache_put(struct mc_chunk_cache* cache, int32_t chunk_x, int32_t chunk_z,
+                        mc_dword protocol_version, uint64_t modification, struct obs_shared_buffer* data);
+
+/*!
+ * Gets the metrics of a cache.
+ * \param cache Pointer to the cache.
+ * \return Pointer to the metrics, which stay up to date for as long as the cache exists.
+ */
+struct mc_chunk_cache_metrics const* mc_chunk_cache_get_metrics(struct mc_chunk_cache const* cache);
+
+#endif // !OBSIDIAN_MINECRAFT_CHUNK_CACHE_H
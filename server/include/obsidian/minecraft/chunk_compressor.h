@@ -0,0 +1,202 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_CHUNK_COMPRESSOR_H
+#define OBSIDIAN_MINECRAFT_CHUNK_COMPRESSOR_H
+
+#include "obsidian/memory.h"
+#include "obsidian/minecraft/protocol.h"
+#include "obsidian/minecraft/region.h"
+
+#include <stdbool.h>
+
+
+/*!
+ * Compresses chunk data for chunk data packets on a pool of worker threads.
+ *
+ * The thread that owns the compressor submits jobs holding a snapshot of the raw block data. A worker deflates the
+ * snapshot with zlib and pushes the finished job onto a lock-free completion queue, from which the owning thread
+ * collects it with mc_chunk_compressor_poll(). Only the owning thread may submit and poll; the workers never touch a
+ * job after pushing it.
+ *
+ * The same workers load chunks from region files, which is mostly inflating as well.
+ */
+struct mc_chunk_compressor;
+
+
+/*!
+ * Work done by a chunk job.
+ */
+enum mc_chunk_job_type {
+    /// Compress the snapshot.
+    MC_CHUNK_JOB_COMPRESS = 0,
+
+    /// Load a chunk from a region.
+    MC_CHUNK_JOB_LOAD = 1,
+};
+
+
+/*!
+ * A chunk waiting to be compressed or loaded, or the result of it.
+ */
+struct mc_chunk_job {
+    /// Next job in the queue the job is in. Owned by the compressor while the job is submitted.
+    struct mc_chunk_job* next;
+
+    /// One of mc_chunk_job_type.
+    int type;
+
+    /// Region to load the chunk from, which must stay open until the job has completed. Load jobs only.
+    struct mc_region const* region;
+
+    /// X coordinate of the chunk to load. Load jobs only.
+    int32_t chunk_x;
+
+    /// Z coordinate of the chunk to load. Load jobs only.
+    int32_t chunk_z;
+
+    /// The loaded chunk, owned by the submitter, or NULL if it could not be loaded. Load jobs only.
+    struct mc_chunk* chunk;
+
+    /// Raw block data to compress. The job owns a reference, which the compressor does not release.
+    struct obs_shared_buffer* snapshot;
+
+    /// Compressed data with a single reference owned by the job, or NULL if compression failed.
+    struct obs_shared_buffer* compressed;
+
+    /// Chunk data packet for the compressed data. The data and compressed_size fields are filled in on completion.
+    struct mc_proto_chunk_data packet;
+
+    /// Called by mc_chunk_compressor_poll() on the owning thread once the job has completed.
+    void (*complete)(struct mc_chunk_job* job);
+
+    /// Data for use by the submitter.
+    void* user_data;
+};
+
+
+/*!
+ * Parameters passed at compressor creation time.
+ */
+struct mc_chunk_compressor_params {
+    /// Amount of worker threads. May be zero to use one less than the amount of online processors.
+    unsigned worker_count;
+
+    /// zlib compression level from 0 (store) to 9 (best), or -1 for the zlib default.
+    int level;
+};
+
+
+/*!
+ * Live signals from which the compression level is chosen.
+ */
+struct mc_chunk_level_signals {
+    /// Fraction of the tick budget that was left over, from 0 (the tick overran) to 1 (idle).
+    double tick_headroom;
+
+    /// Jobs submitted and not yet completed, per worker.
+    double queue_depth;
+
+    /// Largest amount of bytes queued to be sent to a single session that have not been sent yet.
+    size_t outbound_backlog;
+};
+
+
+/*!
+ * Chooses the compression level from the load of the server.
+ *
+ * Lower levels cost a fraction of the CPU time of higher levels for somewhat larger output. When the tick runs out of
+ * headroom or the workers fall behind, the controller steps the level down; when clients cannot keep up with what is
+ * sent to them and there is CPU to spare, it steps the level up; otherwise it returns to the idle level. The level
+ * changes by one step per update, so a single noisy sample does not swing it across the whole range.
+ */
+struct mc_chunk_level_controller {
+    /// Current level.
+    int level;
+
+    /// Level to return to when neither the CPU nor the network is under pressure.
+    int idle_level;
+
+    /// Lowest level used under CPU pressure.
+    int min_level;
+
+    /// Highest level used under network pressure.
+    int max_level;
+};
+
+
+/*!
+ * Updates the compression level from the current signals.
+ * \param controller Pointer to the controller.
+ * \param signals Pointer to the current signals.
+ * \return The new level, which is also stored in the controller.
+ */
+int mc_chunk_level_update(struct mc_chunk_level_controller* controller, struct mc_chunk_level_signals const* signals);
+
+/*!
+ * Creates a compressor and starts its worker threads.
+ * \param params Pointer to an mc_chunk_compressor_params structure.
+ * \return Pointer to the compressor, or NULL upon error.
+ */
+struct mc_chunk_compressor* mc_chunk_compressor_create(struct mc_chunk_compressor_params const* params);
+
+/*!
+ * Stops the worker threads and destroys the compressor.
+ * \param compressor Pointer to the compressor.
+ * \note Jobs that are still queued are completed with a NULL result before this returns.
+ */
+void mc_chunk_compressor_destroy(struct mc_chunk_compressor* compressor);
+
+/*!
+ * Changes the compression level of jobs that have not been started yet.
+ * \param compressor Pointer to the compressor.
+ * \param level zlib compression level from 0 to 9, or -1 for the zlib default.
+ * \note This may be called from any thread.
+ */
+void mc_chunk_compressor_set_level(struct mc_chunk_compressor* compressor, int level);
+
+/*!
+ * Gets the amount of jobs that were submitted and not yet completed.
+ * \param compressor Pointer to the compressor.
+ * \return Amount of jobs, including those that are finished but have not been polled yet.
+ */
+size_t mc_chunk_compressor_pending(struct mc_chunk_compressor const* compressor);
+
+/*!
+ * Gets the amount of worker threads of a compressor.
+ * \param compressor Pointer to the compressor.
+ * \return Amount of worker threads.
+ */
+unsigned mc_chunk_compressor_worker_count(struct mc_chunk_compressor const* compressor);
+
+/*!
+ * Queues a chunk to be compressed or loaded.
+ * \param compressor Pointer to the compressor.
+ * \param job Pointer to the job. It must stay alive until it has been completed.
+ */
+void mc_chunk_compressor_submit(struct mc_chunk_compressor* compressor, struct mc_chunk_job* job);
+
+/*!
+ * Completes every job the workers have finished, in the order they finished in.
+ * \param compressor Pointer to the compressor.
+ * \return Amount of completed jobs.
+ * \note This never blocks.
+ */
+size_t mc_chunk_compressor_poll(struct mc_chunk_compressor* compressor);
+
+#endif // !OBSIDIAN_MINECRAFT_CHUNK_COMPRESSOR_H
@@ -0,0 +1,113 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_CHUNK_MAP_H
+#define OBSIDIAN_MINECRAFT_CHUNK_MAP_H
+
+#include "obsidian/minecraft/chunk.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*!
+ * Hash map from chunk coordinates to loaded chunks.
+ *
+ * The map uses open addressing over groups of 16 slots. Every slot has a control byte holding 7 bits of the hash of
+ * its key, or a marker for an empty or deleted slot, so a whole group is matched against a key with one SSE2 compare
+ * and only the slots whose control byte matches are looked at.
+ *
+ * A single thread, the owner, inserts and removes chunks. Any amount of other threads may look chunks up concurrently
+ * without locking. Readers see either the old or the new state of a slot that changes underneath them. When the map
+ * grows, the old table is retired rather than freed, because readers may still be probing it; the owner frees retired
+ * tables with mc_chunk_map_reclaim() once no reader can still be using them. Likewise, a removed chunk must not be
+ * destroyed before then.
+ */
+struct mc_chunk_map;
+
+
+/*!
+ * Packs chunk coordinates into a map key.
+ * \param x X coordinate of the chunk.
+ * \param z Z coordinate of the chunk.
+ * \return The key.
+ */
+static inline uint64_t mc_chunk_key(int32_t const x, int32_t const z) {
+    return (uint64_t) (uint32_t) x << 32 | (uint32_t) z;
+}
+
+/*!
+ * Creates an empty map.
+ * \param capacity Amount of chunks the map can hold before it has to grow.
+ * \return Pointer to the map, or NULL if out of memory.
+ */
+struct mc_chunk_map* mc_chunk_map_create(size_t capacity);
+
+/*!
+ * Destroys a map. The chunks in it are not destroyed.
+ * \param map Pointer to the map.
+ */
+void mc_chunk_map_destroy(struct mc_chunk_map* map);
+
+/*!
+ * Looks up a chunk. May be called from any thread.
+ * \param map Pointer to the map.
+ * \param key Key of the chunk, as returned by mc_chunk_key().
+ * \return Pointer to the chunk, or NULL if it is not in the map.
+ */
+struct mc_chunk* mc_chunk_map_get(struct mc_chunk_map const* map, uint64_t key);
+
+/*!
+ * Adds a chunk to the map, replacing the chunk with the same coordinates. Owner only.
+ * \param map Pointer to the map.
+ * \param chunk Pointer to the chunk. Its coordinates are the key.
+ * \return The replaced chunk, NULL if there was none, or the chunk itself if the map could not grow.
+ */
+struct mc_chunk* mc_chunk_map_put(struct mc_chunk_map* map, struct mc_chunk* chunk);
+
+/*!
+ * Removes a chunk from the map. Owner only.
+ * \param map Pointer to the map.
+ * \param key Key of the chunk, as returned by mc_chunk_key().
+ * \return The removed chunk, or NULL if it was not in the map.
+ */
+struct mc_chunk* mc_chunk_map_remove(struct mc_chunk_map* map, uint64_t key);
+
+/*!
+ * Iterates over the chunks in the map. Owner only, the map must not be changed during the iteration.
+ * \param map Pointer to the map.
+ * \param cursor Position of the iteration, start at 0.
+ * \return The next chunk, or NULL at the end.
+ */
+struct mc_chunk* mc_chunk_map_next(struct mc_chunk_map const* map, size_t* cursor);
+
+/*!
+ * Gets the amount of chunks in the map. Owner only.
+ * \param map Pointer to the map.
+ * \return Amount of chunks.
+ */
+size_t mc_chunk_map_size(struct mc_chunk_map const* map);
+
+/*!
+ * Frees the tables retired by the map growing. Owner only.
+ * \param map Pointer to the map.
+ * \note Only call this when no other thread is looking chunks up, such as between ticks.
+ */
+void mc_chunk_map_reclaim(struct mc_chunk_map* map);
+
+#endif // !OBSIDIAN_MINECRAFT_CHUNK_MAP_H
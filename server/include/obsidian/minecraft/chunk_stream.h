@@ -0,0 +1,169 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_CHUNK_STREAM_H
+#define OBSIDIAN_MINECRAFT_CHUNK_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Largest view radius in chunks a stream can have.
+#define MC_CHUNK_STREAM_MAX_RADIUS 16
+
+
+/*!
+ * Decides which chunks to send to a single player, and in which order.
+ *
+ * The stream covers the square of chunks within the view radius around the chunk the player is in. Chunks are handed
+ * out nearest-first from a table of offsets sorted by distance, so the ground under the player arrives before the
+ * horizon. A chunk handed out is pending until the sender resolves it as sent, skipped (the world does not have it)
+ * or unsent again (try it later); the stream only keeps the order and state, pacing is left to the sender.
+ *
+ * The state of the view is kept in bit planes of a grid that wraps around at the width of the view: the chunk at (x, z)
+ * is bit x mod width of row z mod width. When the player moves to another chunk, only the strips of chunks that left
+ * the view are cleared, and their cells are reused for the strips that entered it, so a move costs time in the order of
+ * the view radius instead of the view area. The chunks that were sent from the strips that left are reported for
+ * unloading, and the stream starts over at the nearest chunk that was not sent yet.
+ */
+struct mc_chunk_stream;
+
+
+/*!
+ * State of a chunk within the view of a stream.
+ */
+enum mc_chunk_stream_state {
+    /// The chunk still has to be sent.
+    MC_CHUNK_STREAM_UNSENT = 0,
+
+    /// The chunk was handed out and is waiting to be resolved.
+    MC_CHUNK_STREAM_PENDING = 1,
+
+    /// The chunk was sent to the client.
+    MC_CHUNK_STREAM_SENT = 2,
+
+    /// The world does not have the chunk.
+    MC_CHUNK_STREAM_SKIPPED = 3,
+};
+
+
+/*!
+ * A rectangle of chunks, bounds inclusive.
+ */
+struct mc_chunk_rect {
+    int32_t min_x;
+    int32_t min_z;
+    int32_t max_x;
+    int32_t max_z;
+};
+
+
+/*!
+ * Computes the chunks of a square view that are not in the same view around another chunk.
+ *
+ * For a move of the view from one chunk to another, this gives the strips that leave the view; with the chunks
+ * swapped, it gives the strips that enter it.
+ * \param from_x X coordinate of the center of the view.
+ * \param from_z Z coordinate of the center of the view.
+ * \param to_x X coordinate of the center of the other view.
+ * \param to_z Z coordinate of the center of the other view.
+ * \param radius View radius in chunks.
+ * \param rects Receives up to two disjoint rectangles.
+ * \return Amount of rectangles.
+ */
+size_t mc_chunk_view_difference(int32_t from_x, int32_t from_z, int32_t to_x, int32_t to_z, unsigned radius,
+                                struct mc_chunk_rect rects[2]);
+
+/*!
+ * Builds the table of offsets sorted by distance.
+ * \note Call this once at startup, before any stream is created.
+ */
+void mc_chunk_stream_init(void);
+
+/*!
+ * Creates a stream with nothing sent yet.
+ * \param radius View radius in chunks, at most MC_CHUNK_STREAM_MAX_RADIUS.
+ * \param chunk_x X coordinate of the chunk the player is in.
+ * \param chunk_z Z coordinate of the chunk the player is in.
+ * \return Pointer to the stream, or NULL if out of memory.
+ */
+struct mc_chunk_stream* mc_chunk_stream_create(unsigned radius, int32_t chunk_x, int32_t chunk_z);
+
+/*!
+ * Destroys a stream.
+ * \param stream Pointer to the stream.
+ */
+void mc_chunk_stream_destroy(struct mc_chunk_stream* stream);
+
+/*!
+ * Hands out the nearest chunk that still has to be sent, and marks it as pending.
+ * \param stream Pointer to the stream.
+ * \param chunk_x Receives the X coordinate of the chunk.
+ * \param chunk_z Receives the Z coordinate of the chunk.
+ * \return Whether there was a chunk left to send.
+ */
+bool mc_chunk_stream_next(struct mc_chunk_stream* stream, int32_t* chunk_x, int32_t* chunk_z);
+
+/*!
+ * Resolves a pending chunk.
+ * \param stream Pointer to the stream.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param state One of mc_chunk_stream_state. Unsent chunks are handed out again.
+ * \return Whether the chunk was pending. If not, the player moved away from it and it should not be sent.
+ */
+bool mc_chunk_stream_resolve(struct mc_chunk_stream* stream, int32_t chunk_x, int32_t chunk_z,
+                             enum mc_chunk_stream_state state);
+
+/*!
+ * Moves the center of the stream to the chunk the player is in.
+ * \param stream Pointer to the stream.
+ * \param chunk_x X coordinate of the chunk the player is in.
+ * \param chunk_z Z coordinate of the chunk the player is in.
+ * \param unload Called for every sent chunk that is no longer in view.
+ * \param user_data Passed to the callback.
+ */
+void mc_chunk_stream_move(struct mc_chunk_stream* stream, int32_t chunk_x, int32_t chunk_z,
+                          void (*unload)(void* user_data, int32_t chunk_x, int32_t chunk_z), void* user_data);
+
+/*!
+ * Checks whether a chunk was sent to the client and not unloaded since.
+ * \param stream Pointer to the stream.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \return Whether the client has the chunk.
+ */
+bool mc_chunk_stream_knows(struct mc_chunk_stream const* stream, int32_t chunk_x, int32_t chunk_z);
+
+/*!
+ * Checks whether a chunk was handed out and not resolved yet.
+ * \param stream Pointer to the stream.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \return Whether the chunk is pending, so it can still be resolved.
+ */
+bool mc_chunk_stream_pending(struct mc_chunk_stream const* stream, int32_t chunk_x, int32_t chunk_z);
+
+/*!
+ * Checks whether every chunk in view has been resolved.
+ * \param stream Pointer to the stream.
+ * \return Whether there is nothing left to send and nothing pending.
+ */
+bool mc_chunk_stream_done(struct mc_chunk_stream const* stream);
+
+#endif // !OBSIDIAN_MINECRAFT_CHUNK_STREAM_H
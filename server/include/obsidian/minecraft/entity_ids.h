@@ -0,0 +1,109 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_ENTITY_IDS_H
+#define OBSIDIAN_MINECRAFT_ENTITY_IDS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Amount of low bits of an entity ID that hold the slot, plus one.
+#define MC_ENTITY_SLOT_BITS 20
+
+/// Largest amount of slots an allocator can have.
+#define MC_ENTITY_MAX_SLOTS ((1u << MC_ENTITY_SLOT_BITS) - 1)
+
+/// Amount of bits of an entity ID above the slot that hold the generation, keeping entity IDs positive.
+#define MC_ENTITY_GENERATION_BITS (31 - MC_ENTITY_SLOT_BITS)
+
+/// Returned by mc_entity_ids_allocate() when every slot is in use.
+#define MC_ENTITY_NO_SLOT UINT32_MAX
+
+
+/*!
+ * Hands out entity slots, numbered from zero up to the capacity, and the entity IDs naming them.
+ *
+ * The lowest free slot is always handed out next, so the slots in use stay dense and structures indexed by slot stay
+ * small. An entity ID holds the slot plus one in its low bits, so it is never zero,
+ * and the generation of the slot above them. Releasing a slot moves it to the next generation, so an entity ID kept
+ * around after its entity is gone no longer resolves, even when the slot is in use again.
+ */
+struct mc_entity_ids;
+
+
+/*!
+ * Gets the slot named by an entity ID, without checking whether the entity still exists.
+ * \param entity_id The entity ID.
+ * \return The slot, MC_ENTITY_NO_SLOT for entity ID zero.
+ */
+static inline uint32_t mc_entity_slot(int32_t const entity_id) {
+    return ((uint32_t) entity_id & MC_ENTITY_MAX_SLOTS) - 1;
+}
+
+/*!
+ * Creates an allocator with every slot free.
+ * \param capacity Amount of slots, at most MC_ENTITY_MAX_SLOTS.
+ * \return Pointer to the allocator, or NULL if out of memory.
+ */
+struct mc_entity_ids* mc_entity_ids_create(uint32_t capacity);
+
+/*!
+ * Destroys an allocator.
+ * \param ids Pointer to the allocator.
+ */
+void mc_entity_ids_destroy(struct mc_entity_ids* ids);
+
+/*!
+ * Takes a free slot.
+ * \param ids Pointer to the allocator.
+ * \return The slot, or MC_ENTITY_NO_SLOT if every slot is in use.
+ */
+uint32_t mc_entity_ids_allocate(struct mc_entity_ids* ids);
+
+/*!
+ * Gives back a slot, ending the generation of the entity ID naming it.
+ * \param ids Pointer to the allocator.
+ * \param slot The slot, which must be in use.
+ * \note Only release the slot of an entity once no client can still know the entity by its ID.
+ */
+void mc_entity_ids_release(struct mc_entity_ids* ids, uint32_t slot);
+
+/*!
+ * Gets the entity ID naming a slot in its current generation.
+ * \param ids Pointer to the allocator.
+ * \param slot The slot.
+ * \return The entity ID.
+ */
+int32_t mc_entity_ids_id(struct mc_entity_ids const* ids, uint32_t slot);
+
+/*!
+ * Finds the slot of an entity ID.
+ * \param ids Pointer to the allocator.
+ * \param entity_id The entity ID.
+ * \return The slot, or MC_ENTITY_NO_SLOT if the entity ID does not name a slot in use in its current generation.
+ */
+uint32_t mc_entity_ids_resolve(struct mc_entity_ids const* ids, int32_t entity_id);
+
+/*!
+ * Gets the amount of slots below which every slot in use lies.
+ * \param ids Pointer to the allocator.
+ * \return One more than the highest slot in use, or zero if no slot is in use.
+ */
+uint32_t mc_entity_ids_bound(struct mc_entity_ids const* ids);
+
+#endif // !OBSIDIAN_MINECRAFT_ENTITY_IDS_H
@@ -0,0 +1,271 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_ENTITY_STORE_H
+#define OBSIDIAN_MINECRAFT_ENTITY_STORE_H
+
+#include "obsidian/minecraft/entity_ids.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*!
+ * Kinds of entities, each spawned on the client with its own packet.
+ */
+enum mc_entity_type {
+    /// A player, moved by its client instead of by the server.
+    MC_ENTITY_PLAYER = 0,
+
+    /// A dropped item stack. The variant is the item ID, the data its damage.
+    MC_ENTITY_ITEM = 1,
+
+    /// A block of sand or gravel falling down. The variant is the object type.
+    MC_ENTITY_FALLING_BLOCK = 2,
+
+    /// A flying arrow. The variant is the object type.
+    MC_ENTITY_ARROW = 3,
+
+    /// A mob. The variant is the mob type.
+    MC_ENTITY_MOB = 4,
+
+    /// Amount of entity types.
+    MC_ENTITY_TYPE_COUNT,
+};
+
+
+/*!
+ * Flags of an entity.
+ */
+enum mc_entity_flags {
+    /// The slot holds an entity.
+    MC_ENTITY_ALIVE = 1 << 0,
+
+    /// The entity is standing on the ground.
+    MC_ENTITY_GROUNDED = 1 << 1,
+};
+
+
+/*!
+ * Movement of an entity since it was last relayed to clients.
+ */
+struct mc_entity_move {
+    /// Slot of the entity.
+    uint32_t slot;
+
+    /// X coordinate in absolute integer coordinates.
+    int32_t x;
+
+    /// Y coordinate in absolute integer coordinates.
+    int32_t y;
+
+    /// Z coordinate in absolute integer coordinates.
+    int32_t z;
+
+    /// Change of the X coordinate since it was last relayed.
+    int64_t dx;
+
+    /// Change of the Y coordinate since it was last relayed.
+    int64_t dy;
+
+    /// Change of the Z coordinate since it was last relayed.
+    int64_t dz;
+
+    /// Yaw as a fraction of 256.
+    uint8_t yaw;
+
+    /// Pitch as a fraction of 256.
+    uint8_t pitch;
+
+    /// Whether the position changed.
+    bool moved;
+
+    /// Whether the yaw or pitch changed.
+    bool rotated;
+};
+
+
+/*!
+ * Every entity in the world, indexed by entity slot.
+ *
+ * Each property of the entities is kept in an array of its own, so a pass over one property only reads the memory of
+ * that property, and the loops of the passes are simple enough for the compiler to vectorize. Slots are handed out
+ * by the entity ID allocator of the store, lowest first, so the entities are dense below the bound of the allocator
+ * and the passes only run up to it. Free slots below the bound have no velocity, gravity or flags, so the passes can
+ * run over them without checking.
+ *
+ * The arrays may be read and written directly, at slots that hold an entity.
+ */
+struct mc_entity_store {
+    /// Allocator of the entity slots, and the entity IDs naming them.
+    struct mc_entity_ids* ids;
+
+    /// Amount of slots.
+    uint32_t capacity;
+
+    /// X coordinate of every entity in blocks.
+    double* x;
+
+    /// Y coordinate of the feet of every entity in blocks.
+    double* y;
+
+    /// Z coordinate of every entity in blocks.
+    double* z;
+
+    /// Velocity along the X axis in blocks per tick.
+    double* velocity_x;
+
+    /// Velocity along the Y axis in blocks per tick.
+    double* velocity_y;
+
+    /// Velocity along the Z axis in blocks per tick.
+    double* velocity_z;
+
+    /// Velocity in blocks per tick gained downwards every tick.
+    double* gravity;
+
+    /// Share of the velocity kept every tick.
+    double* drag;
+
+    /// Rotation around the vertical axis in degrees, less than a billion degrees either way.
+    float* yaw;
+
+    /// Rotation of the head in degrees, less than a billion degrees either way.
+    float* pitch;
+
+    /// Width and depth of the bounding box in blocks.
+    float* width;
+
+    /// Height of the bounding box in blocks.
+    float* height;
+
+    /// One of mc_entity_type.
+    uint8_t* type;
+
+    /// Any of mc_entity_flags.
+    uint8_t* flags;
+
+    /// Item, object or mob type, depending on the entity type.
+    uint16_t* variant;
+
+    /// Damage of an item.
+    uint16_t* data;
+
+    /// Amount of items in an item stack.
+    uint8_t* count;
+
+    /// X coordinate last relayed to clients in absolute integer coordinates (32 units per block).
+    int32_t* relayed_x;
+
+    /// Y coordinate last relayed to clients in absolute integer coordinates.
+    int32_t* relayed_y;
+
+    /// Z coordinate last relayed to clients in absolute integer coordinates.
+    int32_t* relayed_z;
+
+    /// Yaw last relayed to clients as a fraction of 256.
+    uint8_t* relayed_yaw;
+
+    /// Pitch last relayed to clients as a fraction of 256.
+    uint8_t* relayed_pitch;
+
+    /// Scratch space of the movement pass, the X coordinate in absolute integer coordinates.
+    int32_t* absolute_x;
+
+    /// Scratch space of the movement pass, the Y coordinate in absolute integer coordinates.
+    int32_t* absolute_y;
+
+    /// Scratch space of the movement pass, the Z coordinate in absolute integer coordinates.
+    int32_t* absolute_z;
+
+    /// Scratch space of the movement pass, the yaw as a fraction of 256.
+    uint8_t* absolute_yaw;
+
+    /// Scratch space of the movement pass, the pitch as a fraction of 256.
+    uint8_t* absolute_pitch;
+};
+
+
+/*!
+ * Converts a coordinate in blocks to absolute integer coordinates, 32 units per block.
+ * \param blocks Coordinate in blocks, within the world.
+ * \return The coordinate rounded down to a unit.
+ */
+static inline int32_t mc_entity_absolute(double const blocks) {
+    double const units = blocks * 32.0;
+    int32_t const truncated = (int32_t) units;
+    return truncated - (truncated > units);
+}
+
+/*!
+ * Converts an angle in degrees to a fraction of 256.
+ * \param degrees Angle in degrees, less than a billion degrees either way.
+ * \return The angle as a fraction of 256.
+ */
+static inline uint8_t mc_entity_angle(float const degrees) {
+    // Clients keep adding up the yaw as the player turns, only the fraction of a turn matters.
+    return (uint8_t) ((int32_t) (degrees * (256.0f / 360.0f)) & 0xFF);
+}
+
+/*!
+ * Creates a store without entities.
+ * \param capacity Amount of entity slots, at most MC_ENTITY_MAX_SLOTS.
+ * \return Pointer to the store, or NULL if out of memory.
+ */
+struct mc_entity_store* mc_entity_store_create(uint32_t capacity);
+
+/*!
+ * Destroys a store.
+ * \param store Pointer to the store.
+ */
+void mc_entity_store_destroy(struct mc_entity_store* store);
+
+/*!
+ * Adds an entity standing still, with the physics and bounding box of its type. It counts as relayed where it is.
+ * \param store Pointer to the store.
+ * \param type One of mc_entity_type.
+ * \param x X coordinate in blocks.
+ * \param y Y coordinate of the feet in blocks.
+ * \param z Z coordinate in blocks.
+ * \return Slot of the entity, or MC_ENTITY_NO_SLOT if every slot is in use.
+ */
+uint32_t mc_entity_store_spawn(struct mc_entity_store* store, enum mc_entity_type type, double x, double y, double z);
+
+/*!
+ * Removes an entity and releases its slot, ending the generation of its entity ID.
+ * \param store Pointer to the store.
+ * \param slot Slot of the entity.
+ */
+void mc_entity_store_remove(struct mc_entity_store* store, uint32_t slot);
+
+/*!
+ * Applies gravity to every entity, moves it along its velocity for one tick, then applies drag.
+ * \param store Pointer to the store.
+ */
+void mc_entity_store_step(struct mc_entity_store* store);
+
+/*!
+ * Lists the entities whose position or rotation as relayed to clients changed, and takes the changes as relayed.
+ * \param store Pointer to the store.
+ * \param moves Receives the movement of every entity that moved, room for as many entities as there are slots.
+ * \return Amount of entities that moved.
+ */
+size_t mc_entity_store_collect_moves(struct mc_entity_store* store, struct mc_entity_move* moves);
+
+#endif // !OBSIDIAN_MINECRAFT_ENTITY_STORE_H
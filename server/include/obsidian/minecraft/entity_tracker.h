@@ -0,0 +1,91 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_ENTITY_TRACKER_H
+#define OBSIDIAN_MINECRAFT_ENTITY_TRACKER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*!
+ * Keeps track of which entities a single client has been told about.
+ *
+ * The tracker holds two bit sets indexed by entity slot: the entities the client knows, and the entities it should
+ * know. Once per tick the sender clears the second set, marks every entity near the client in it, and updates the
+ * tracker: the entities to spawn and to destroy fall out of the two sets a word of 64 entities at a time, and only
+ * the set bits are visited. Afterwards the client knows exactly the entities it should, except for those it could not
+ * be told about, which are tried again on the next update.
+ */
+struct mc_entity_tracker;
+
+
+/*!
+ * Called for every entity a client has to be told about or told to forget.
+ * \param user_data User data passed to mc_entity_tracker_update().
+ * \param slot Slot of the entity.
+ * \return Whether the client was told.
+ */
+typedef bool (*mc_entity_tracker_callback)(void* user_data, uint32_t slot);
+
+/*!
+ * Creates a tracker of a client that knows no entities.
+ * \param capacity Amount of entity slots.
+ * \return Pointer to the tracker, or NULL if out of memory.
+ */
+struct mc_entity_tracker* mc_entity_tracker_create(uint32_t capacity);
+
+/*!
+ * Destroys a tracker.
+ * \param tracker Pointer to the tracker.
+ */
+void mc_entity_tracker_destroy(struct mc_entity_tracker* tracker);
+
+/*!
+ * Clears the entities the client should know, to be marked again with mc_entity_tracker_want().
+ * \param tracker Pointer to the tracker.
+ */
+void mc_entity_tracker_clear(struct mc_entity_tracker* tracker);
+
+/*!
+ * Marks an entity the client should know.
+ * \param tracker Pointer to the tracker.
+ * \param slot Slot of the entity.
+ */
+void mc_entity_tracker_want(struct mc_entity_tracker* tracker, uint32_t slot);
+
+/*!
+ * Checks whether the client knows an entity.
+ * \param tracker Pointer to the tracker.
+ * \param slot Slot of the entity.
+ * \return Whether the client was told about the entity and not told to forget it since.
+ */
+bool mc_entity_tracker_knows(struct mc_entity_tracker const* tracker, uint32_t slot);
+
+/*!
+ * Makes the client know the entities it should, destroying the others first. An entity the client could not be told
+ * about keeps its state until the next update.
+ * \param tracker Pointer to the tracker.
+ * \param spawn Called for every entity the client should know but does not.
+ * \param destroy Called for every entity the client knows but should not.
+ * \param user_data Passed to the callbacks.
+ */
+void mc_entity_tracker_update(struct mc_entity_tracker* tracker, mc_entity_tracker_callback spawn,
+                              mc_entity_tracker_callback destroy, void* user_data);
+
+#endif // !OBSIDIAN_MINECRAFT_ENTITY_TRACKER_H
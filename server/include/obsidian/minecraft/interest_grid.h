@@ -0,0 +1,110 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_INTEREST_GRID_H
+#define OBSIDIAN_MINECRAFT_INTEREST_GRID_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Base 2 logarithm of the width of a cell in chunks.
+#define MC_INTEREST_CELL_SHIFT 2
+
+
+/*!
+ * Tracks which members, such as players or entities, are in which cell of the world, to find the members near a cell.
+ *
+ * Cells are squares of chunks, and only cells that have members take up space: they are kept in a hash table keyed by
+ * the coordinates of the cell, and each holds a doubly linked list of its members threaded through arrays indexed by
+ * member. Inserting, removing and moving a member to another cell take constant time. A query visits the cells within
+ * a radius and lists their members, so its cost follows the amount of members nearby rather than the amount in the
+ * world.
+ */
+struct mc_interest_grid;
+
+
+/*!
+ * Gets the coordinate of the cell a chunk is in.
+ * \param chunk X or Z coordinate of the chunk.
+ * \return The same coordinate of the cell.
+ */
+static inline int32_t mc_interest_cell(int32_t const chunk) {
+    return chunk >> MC_INTEREST_CELL_SHIFT;
+}
+
+/*!
+ * Creates an empty grid.
+ * \param capacity Amount of members the grid can hold, members are numbered from zero up to this amount.
+ * \return Pointer to the grid, or NULL if out of memory.
+ */
+struct mc_interest_grid* mc_interest_grid_create(uint32_t capacity);
+
+/*!
+ * Destroys a grid.
+ * \param grid Pointer to the grid.
+ */
+void mc_interest_grid_destroy(struct mc_interest_grid* grid);
+
+/*!
+ * Adds a member to a cell.
+ * \param grid Pointer to the grid.
+ * \param member Number of the member, which must not be in the grid.
+ * \param cell_x X coordinate of the cell.
+ * \param cell_z Z coordinate of the cell.
+ */
+void mc_interest_grid_insert(struct mc_interest_grid* grid, uint32_t member, int32_t cell_x, int32_t cell_z);
+
+/*!
+ * Removes a member from its cell.
+ * \param grid Pointer to the grid.
+ * \param member Number of the member, which must be in the grid.
+ */
+void mc_interest_grid_remove(struct mc_interest_grid* grid, uint32_t member);
+
+/*!
+ * Moves a member to another cell.
+ * \param grid Pointer to the grid.
+ * \param member Number of the member, which must be in the grid.
+ * \param cell_x X coordinate of the cell.
+ * \param cell_z Z coordinate of the cell.
+ */
+void mc_interest_grid_move(struct mc_interest_grid* grid, uint32_t member, int32_t cell_x, int32_t cell_z);
+
+/*!
+ * Checks whether a member is in the grid.
+ * \param grid Pointer to the grid.
+ * \param member Number of the member.
+ * \return Whether the member is in the grid.
+ */
+bool mc_interest_grid_contains(struct mc_interest_grid const* grid, uint32_t member);
+
+/*!
+ * Lists the members in the square of cells within a radius around a cell.
+ * \param grid Pointer to the grid.
+ * \param cell_x X coordinate of the cell at the center.
+ * \param cell_z Z coordinate of the cell at the center.
+ * \param radius Radius in cells, zero for only the cell itself.
+ * \param members Receives the numbers of the members.
+ * \param capacity Amount of numbers the array can hold, listing stops when it is full.
+ * \return Amount of members listed.
+ */
+size_t mc_interest_grid_query(struct mc_interest_grid const* grid, int32_t cell_x, int32_t cell_z, unsigned radius,
+                              uint32_t* members, size_t capacity);
+
+#endif // !OBSIDIAN_MINECRAFT_INTEREST_GRID_H
@@ -0,0 +1,269 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_NBT_H
+#define OBSIDIAN_MINECRAFT_NBT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Deepest nesting of compounds and lists the reader follows.
+#define MC_NBT_MAX_DEPTH 32
+
+
+/*!
+ * NBT tag types.
+ */
+enum mc_nbt_type {
+    MC_NBT_END = 0,
+    MC_NBT_BYTE = 1,
+    MC_NBT_SHORT = 2,
+    MC_NBT_INT = 3,
+    MC_NBT_LONG = 4,
+    MC_NBT_FLOAT = 5,
+    MC_NBT_DOUBLE = 6,
+    MC_NBT_BYTE_ARRAY = 7,
+    MC_NBT_STRING = 8,
+    MC_NBT_LIST = 9,
+    MC_NBT_COMPOUND = 10,
+};
+
+
+/*!
+ * A tag as seen by the reader. Everything points into the buffer being read.
+ */
+struct mc_nbt_tag {
+    /// One of mc_nbt_type.
+    uint8_t type;
+
+    /// Length of the name in bytes.
+    uint16_t name_length;
+
+    /// Modified UTF-8 name, not NUL-terminated. Empty for list elements.
+    char const* name;
+
+    /// Start of the payload.
+    uint8_t const* payload;
+
+    /// Element type of a list.
+    uint8_t element_type;
+
+    /// Length of a string in bytes, or amount of elements of an array or list.
+    uint32_t length;
+};
+
+
+/*!
+ * Streaming reader over a buffer of uncompressed NBT.
+ *
+ * The reader never allocates: it hands out tags that point into the buffer, and keeps a cursor and a stack of the
+ * compounds and lists it is inside of. Tags are visited in order with mc_nbt_next(); a compound or list is only
+ * walked when it is entered with mc_nbt_enter(), otherwise mc_nbt_next() skips over it. Every length is checked
+ * against the buffer, so malformed data sets the error flag instead of reading out of bounds.
+ */
+struct mc_nbt_reader {
+    /// The buffer.
+    uint8_t const* data;
+
+    /// Size of the buffer in bytes.
+    size_t size;
+
+    /// Offset of the next byte to read.
+    size_t cursor;
+
+    /// Whether the payload of the last tag returned by mc_nbt_next() still has to be skipped.
+    bool pending;
+
+    /// The last tag returned by mc_nbt_next().
+    struct mc_nbt_tag current;
+
+    /// Amount of compounds and lists the reader is inside of.
+    unsigned depth;
+
+    /// Elements left in every list the reader is inside of, or -1 for compounds.
+    int64_t remaining[MC_NBT_MAX_DEPTH];
+
+    /// Element type of every list the reader is inside of.
+    uint8_t element_types[MC_NBT_MAX_DEPTH];
+
+    /// Whether the data was malformed. Once set, every read fails.
+    bool error;
+};
+
+
+/*!
+ * Starts reading a buffer, which holds a single named root tag.
+ * \param reader Pointer to the reader.
+ * \param data Uncompressed NBT.
+ * \param size Size of the data in bytes.
+ */
+void mc_nbt_reader_init(struct mc_nbt_reader* reader, void const* data, size_t size);
+
+/*!
+ * Reads the next tag of the compound or list the reader is in, skipping the payload of the previous tag unless it was
+ * entered.
+ * \param reader Pointer to the reader.
+ * \param tag Receives the tag.
+ * \return Whether there was a tag. At the end of a compound or list the reader leaves it and returns false, as it does
+ *         when the data is malformed.
+ */
+bool mc_nbt_next(struct mc_nbt_reader* reader, struct mc_nbt_tag* tag);
+
+/*!
+ * Enters the compound or list last returned by mc_nbt_next(), so that the next calls return its children.
+ * \param reader Pointer to the reader.
+ * \return Whether the tag could be entered.
+ */
+bool mc_nbt_enter(struct mc_nbt_reader* reader);
+
+/*!
+ * Reads tags of the current compound until one with the name and type is found.
+ * \param reader Pointer to the reader.
+ * \param name NUL-terminated name to look for.
+ * \param type Type to look for.
+ * \param tag Receives the tag.
+ * \return Whether the tag was found. If not, the reader has left the compound.
+ */
+bool mc_nbt_find(struct mc_nbt_reader* reader, char const* name, uint8_t type, struct mc_nbt_tag* tag);
+
+/*!
+ * Checks whether a tag has a name.
+ * \param tag Pointer to the tag.
+ * \param name NUL-terminated name.
+ * \return Whether the tag has that name.
+ */
+bool mc_nbt_is_named(struct mc_nbt_tag const* tag, char const* name);
+
+/*!
+ * Reads the payload of a byte, short, int or long tag.
+ * \param tag Pointer to the tag.
+ * \return The value, sign-extended.
+ */
+int64_t mc_nbt_integer(struct mc_nbt_tag const* tag);
+
+/*!
+ * Reads the payload of a float or double tag.
+ * \param tag Pointer to the tag.
+ * \return The value.
+ */
+double mc_nbt_real(struct mc_nbt_tag const* tag);
+
+
+/*!
+ * Streaming writer of NBT into a caller-provided buffer.
+ *
+ * The writer never allocates. When the buffer is too small it keeps counting, so the size that would have been needed
+ * can be read from the cursor afterwards and the write retried with a larger buffer.
+ */
+struct mc_nbt_writer {
+    /// The buffer.
+    uint8_t* data;
+
+    /// Size of the buffer in bytes.
+    size_t capacity;
+
+    /// Offset of the next byte to write, which may be past the capacity.
+    size_t cursor;
+};
+
+
+/*!
+ * Starts writing into a buffer.
+ * \param writer Pointer to the writer.
+ * \param data Destination buffer.
+ * \param capacity Size of the buffer in bytes.
+ */
+void mc_nbt_writer_init(struct mc_nbt_writer* writer, void* data, size_t capacity);
+
+/*!
+ * Checks whether everything written so far fit in the buffer.
+ * \param writer Pointer to the writer.
+ * \return Whether the buffer was large enough.
+ */
+static inline bool mc_nbt_writer_ok(struct mc_nbt_writer const* writer) {
+    return writer->cursor <= writer->capacity;
+}
+
+/*!
+ * Writes the type and name of a tag, after which its payload must be written.
+ * \param writer Pointer to the writer.
+ * \param type One of mc_nbt_type.
+ * \param name NUL-terminated name.
+ */
+void mc_nbt_write_header(struct mc_nbt_writer* writer, uint8_t type, char const* name);
+
+/*!
+ * Writes the end of a compound.
+ * \param writer Pointer to the writer.
+ */
+void mc_nbt_write_end(struct mc_nbt_writer* writer);
+
+/*!
+ * Writes a byte tag.
+ * \param writer Pointer to the writer.
+ * \param name NUL-terminated name.
+ * \param value The value.
+ */
+void mc_nbt_write_byte(struct mc_nbt_writer* writer, char const* name, int8_t value);
+
+/*!
+ * Writes a short tag.
+ * \see mc_nbt_write_byte()
+ */
+void mc_nbt_write_short(struct mc_nbt_writer* writer, char const* name, int16_t value);
+
+/*!
+ * Writes an int tag.
+ * \see mc_nbt_write_byte()
+ */
+void mc_nbt_write_int(struct mc_nbt_writer* writer, char const* name, int32_t value);
+
+/*!
+ * Writes a long tag.
+ * \see mc_nbt_write_byte()
+ */
+void mc_nbt_write_long(struct mc_nbt_writer* writer, char const* name, int64_t value);
+
+/*!
+ * Writes a string tag.
+ * \param writer Pointer to the writer.
+ * \param name NUL-terminated name.
+ * \param value NUL-terminated value.
+ */
+void mc_nbt_write_string(struct mc_nbt_writer* writer, char const* name, char const* value);
+
+/*!
+ * Writes a byte array tag.
+ * \param writer Pointer to the writer.
+ * \param name NUL-terminated name.
+ * \param data The bytes, copied as they are.
+ * \param length Amount of bytes.
+ */
+void mc_nbt_write_byte_array(struct mc_nbt_writer* writer, char const* name, void const* data, uint32_t length);
+
+/*!
+ * Writes the start of a list tag, after which exactly count payloads of the element type must be written.
+ * \param writer Pointer to the writer.
+ * \param name NUL-terminated name.
+ * \param element_type One of mc_nbt_type.
+ * \param count Amount of elements.
+ */
+void mc_nbt_write_list(struct mc_nbt_writer* writer, char const* name, uint8_t element_type, uint32_t count);
+
+#endif // !OBSIDIAN_MINECRAFT_NBT_H
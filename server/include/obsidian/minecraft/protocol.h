@@ -21,9 +21,25 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/uio.h>
 
 #define MINECRAFT_USERNAME_LENGTH 16
 
+/// Maximum length of a chat message in characters.
+#define MINECRAFT_CHAT_LENGTH 119
+
+/// Maximum length of a disconnect reason in characters.
+#define MINECRAFT_KICK_LENGTH 119
+
+/// Maximum length of a line of text on a sign in characters.
+#define MINECRAFT_SIGN_LENGTH 15
+
+/// Maximum amount of bytes needed to store a single UCS-2 character as UTF-8.
+#define MC_UTF8_PER_UCS2 3
+
+/// Amount of slots in the largest inventory section (the main inventory).
+#define MINECRAFT_INVENTORY_SLOTS 36
+
 #define MC_TRUE 0x01
 #define MC_FALSE 0x00
 
@@ -48,8 +64,8 @@ typedef double mc_double;
 /// UTF-8 character string.
 typedef char mc_utf8_char;
 
-/// UCS-2 character string.
-typedef wchar_t mc_ucs2_char;
+/// UCS-2 character, big-endian on the wire.
+typedef uint16_t mc_ucs2_char;
 
 /// Boolean value which can either be MC_TRUE or MC_FALSE.
 typedef int8_t mc_bool;
@@ -59,16 +75,60 @@ typedef int8_t mc_bool;
  * Minecraft protocol packet IDs.
  */
 enum mc_proto_packet_type {
-    MC_PACKET_HEARTBEAT        = 0x00,
-    MC_PACKET_AUTHENTICATION   = 0x01,
-    MC_PACKET_HANDSHAKE        = 0x02,
-    MC_PACKET_TIME             = 0x04,
-    MC_PACKET_PLAYER_GROUNDED  = 0x0A,
-    MC_PACKET_PLAYER_POSITION  = 0x0B,
-    MC_PACKET_PLAYER_ROTATION  = 0x0C,
-    MC_PACKET_PLAYER_TRANSFORM = 0x0D,
-    MC_PACKET_CHUNK            = 0x32,
-    MC_PACKET_CHUNK_DATA       = 0x33,
+    MC_PACKET_HEARTBEAT            = 0x00,
+    MC_PACKET_AUTHENTICATION       = 0x01,
+    MC_PACKET_HANDSHAKE            = 0x02,
+    MC_PACKET_CHAT                 = 0x03,
+    MC_PACKET_TIME                 = 0x04,
+    MC_PACKET_INVENTORY            = 0x05,
+    MC_PACKET_SPAWN_POSITION       = 0x06,
+    MC_PACKET_USE_ENTITY           = 0x07,
+    MC_PACKET_HEALTH               = 0x08,
+    MC_PACKET_RESPAWN              = 0x09,
+    MC_PACKET_PLAYER_GROUNDED      = 0x0A,
+    MC_PACKET_PLAYER_POSITION      = 0x0B,
+    MC_PACKET_PLAYER_ROTATION      = 0x0C,
+    MC_PACKET_PLAYER_TRANSFORM     = 0x0D,
+    MC_PACKET_PLAYER_DIG           = 0x0E,
+    MC_PACKET_PLAYER_PLACE         = 0x0F,
+    MC_PACKET_HOLDING              = 0x10,
+    MC_PACKET_INVENTORY_ADD        = 0x11,
+    MC_PACKET_ANIMATION            = 0x12,
+    MC_PACKET_ENTITY_ACTION        = 0x13,
+    MC_PACKET_PLAYER_SPAWN         = 0x14,
+    MC_PACKET_PICKUP_SPAWN         = 0x15,
+    MC_PACKET_COLLECT              = 0x16,
+    MC_PACKET_OBJECT_SPAWN         = 0x17,
+    MC_PACKET_MOB_SPAWN            = 0x18,
+    MC_PACKET_ENTITY_DESTROY       = 0x1D,
+    MC_PACKET_ENTITY               = 0x1E,
+    MC_PACKET_ENTITY_MOVE          = 0x1F,
+    MC_PACKET_ENTITY_ROTATE        = 0x20,
+    MC_PACKET_ENTITY_MOVE_ROTATE   = 0x21,
+    MC_PACKET_ENTITY_TELEPORT      = 0x22,
+    MC_PACKET_CHUNK                = 0x32,
+    MC_PACKET_CHUNK_DATA           = 0x33,
+    MC_PACKET_MULTI_BLOCK_CHANGE   = 0x34,
+    MC_PACKET_BLOCK_CHANGE         = 0x35,
+    MC_PACKET_COMPLEX_ENTITY       = 0x3B,
+    MC_PACKET_EXPLOSION            = 0x3C,
+    MC_PACKET_WINDOW_CLOSE         = 0x65,
+    MC_PACKET_WINDOW_CLICK         = 0x66,
+    MC_PACKET_TRANSACTION          = 0x6A,
+    MC_PACKET_SIGN_UPDATE          = 0x82,
+    MC_PACKET_KICK                 = 0xFF,
+};
+
+
+/*!
+ * Encodings used for strings on the wire.
+ */
+enum mc_proto_string_encoding {
+    /// Strings are UTF-8, prefixed by their length in bytes. Used by alpha versions.
+    MC_PROTO_STRINGS_UTF8,
+
+    /// Strings are UCS-2 big endian, prefixed by their length in characters. Used by beta and later versions.
+    MC_PROTO_STRINGS_UCS2,
 };
 
 
@@ -81,11 +141,6 @@ enum mc_proto_packet_type {
 struct mc_proto_heartbeat {};
 
 
-int mc_proto_encode_heartbeat(void* buffer, size_t buffer_size, struct mc_proto_heartbeat const* heartbeat);
-
-int mc_proto_decode_heartbeat(void const* buffer, size_t buffer_size, struct mc_proto_heartbeat* heartbeat);
-
-
 /*!
  * Second packet sent by the client to finalize the handshaking process.
  *
@@ -97,15 +152,13 @@ struct mc_proto_authentication_request {
     mc_utf8_char username[MINECRAFT_USERNAME_LENGTH];
     mc_word password_length;
     mc_utf8_char password[32];
-};
 
+    /// World seed, always 0. Beta and later only.
+    mc_qword map_seed;
 
-/*!
- * Decodes a buffer into an authentication request packet.
- * \see mc_proto_decode_client_packet()
- */
-int mc_proto_decode_authentication_request(void const* buffer, size_t buffer_size,
-                                           struct mc_proto_authentication_request* request);
+    /// Dimension, always 0. Beta and later only.
+    mc_byte dimension;
+};
 
 
 /*!
@@ -121,22 +174,20 @@ struct mc_proto_authentication_response {
     mc_word unknown0_length;
 
     /// Unknown. The official server sends an empty string.
-    mc_utf8_char* unknown0;
+    mc_utf8_char const* unknown0;
 
     /// Length of unknown1.
     mc_word unknown1_length;
 
     /// Unknown. The official server sends an empty string.
-    mc_utf8_char* unknown1;
-};
+    mc_utf8_char const* unknown1;
 
+    /// World seed, used by the client to predict terrain features. Beta and later only.
+    mc_qword map_seed;
 
-/*!
- * Encodes an authentication response into a buffer.
- * \see mc_proto_encode_server_packet()
- */
-int mc_proto_encode_authentication_response(void* buffer, size_t buffer_size,
-                                            struct mc_proto_authentication_response const* response);
+    /// Dimension the player spawns in, 0 for the overworld and -1 for the nether. Beta and later only.
+    mc_byte dimension;
+};
 
 
 /*!
@@ -153,14 +204,6 @@ struct mc_proto_handshake_request {
 };
 
 
-/*!
- * Decodes a buffer into a handshake request packet.
- * \see mc_proto_decode_client_packet()
- */
-int mc_proto_decode_handshake_request(void const* buffer, size_t buffer_size,
-                                      struct mc_proto_handshake_request* request);
-
-
 /*!
  * Packet sent by the server to respond to a handshake request.
  *
@@ -171,16 +214,22 @@ struct mc_proto_handshake_response {
     mc_word unknown_length;
 
     /// Seems to always be "-" in offline mode. Unknown what this is.
-    mc_utf8_char* unknown;
+    mc_utf8_char const* unknown;
 };
 
 
 /*!
- * Encodes a handshake response into a buffer.
- * \see mc_proto_encode_server_packet()
+ * A chat message. Clients send the message as typed, the server sends the message as it should be displayed.
+ *
+ * \note Sent by both the client and the server.
  */
-int mc_proto_encode_handshake_response(void* buffer, size_t buffer_size,
-                                       struct mc_proto_handshake_response const* response);
+struct mc_proto_chat {
+    /// Length of the message in bytes.
+    mc_word message_length;
+
+    /// Message string.
+    mc_utf8_char message[MINECRAFT_CHAT_LENGTH * MC_UTF8_PER_UCS2];
+};
 
 
 /*!
@@ -195,10 +244,87 @@ struct mc_proto_time {
 
 
 /*!
- * Encodes a time packet into a buffer.
- * \see mc_proto_encode_server_packet()
+ * A single inventory slot.
+ */
+struct mc_proto_slot {
+    /// Item or block ID, -1 if the slot is empty. The remaining fields are only on the wire when the slot is not empty.
+    mc_word id;
+
+    /// Amount of items in the slot.
+    mc_byte count;
+
+    /// Damage the item has taken.
+    mc_word damage;
+};
+
+
+/*!
+ * Full contents of one section of the player's inventory.
+ *
+ * \note Sent by both the client and the server.
+ */
+struct mc_proto_inventory {
+    /// Inventory section; -1 for the main inventory, -2 for armor and -3 for the crafting grid.
+    mc_dword type;
+
+    /// Amount of slots that follow.
+    mc_word count;
+
+    /// Slots in the section.
+    struct mc_proto_slot slots[MINECRAFT_INVENTORY_SLOTS];
+};
+
+
+/*!
+ * Tells the client where the world spawn is, used by the compass.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_spawn_position {
+    mc_dword x;
+    mc_dword y;
+    mc_dword z;
+};
+
+
+/*!
+ * Sent when the player attacks or right-clicks an entity.
+ *
+ * \note Sent by the client only.
+ */
+struct mc_proto_use_entity {
+    /// Entity ID of the player.
+    mc_dword user_id;
+
+    /// Entity ID of the entity that was clicked.
+    mc_dword target_id;
+
+    /// MC_TRUE if the entity was left-clicked (attacked).
+    mc_bool left_click;
+};
+
+
+/*!
+ * Updates the health bar of the player.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_health {
+    /// Health in half hearts, 0 means the player is dead. Sent as a byte by alpha versions.
+    mc_word health;
+};
+
+
+/*!
+ * Sent by the client when the player clicks respawn, and echoed by the server once the player has respawned.
+ *
+ * \note Sent by both the client and the server.
  */
-int mc_proto_encode_time(void* buffer, size_t buffer_size, struct mc_proto_time const* time);
+struct mc_proto_respawn {
+    /// Dimension to respawn in. Beta and later only.
+    mc_byte dimension;
+};
+
 
 /*!
  * Message containing information about whether player is on the ground or falling.
@@ -210,14 +336,6 @@ struct mc_proto_player_grounded {
 };
 
 
-/*!
- * Decodes a transform packet.
- * \see mc_proto_decode_client_packet()
- */
-int mc_proto_decode_player_grounded(void const* buffer, size_t buffer_size,
-                                    struct mc_proto_player_grounded* grounded);
-
-
 struct mc_proto_player_position {
     /// X coordinate of the player in world space.
     mc_double x;
@@ -236,9 +354,6 @@ struct mc_proto_player_position {
 };
 
 
-int mc_proto_decode_player_position(void const* buffer, size_t buffer_size,
-                                    struct mc_proto_player_position* position);
-
 struct mc_proto_player_rotation {
     /// Rotation of the player's character.
     mc_float yaw;
@@ -250,13 +365,10 @@ struct mc_proto_player_rotation {
     mc_bool grounded;
 };
 
-int mc_proto_decode_player_rotation(void const* buffer, size_t buffer_size,
-                                    struct mc_proto_player_rotation* rotation);
-
 
 /*!
  * Message containing a full update on the player's position.
- * \note Sent by the client.
+ * \note Sent by both the client and the server.
  */
 struct mc_proto_player_transform {
     /// X coordinate of the player in world space.
@@ -283,116 +395,1029 @@ struct mc_proto_player_transform {
 
 
 /*!
- * Decodes a transform packet.
- * \see mc_proto_decode_client_packet()
+ * Sent while the player is digging a block.
+ *
+ * \note Sent by the client only.
  */
-int mc_proto_decode_player_transform(void const* buffer, size_t buffer_size,
-                                     struct mc_proto_player_transform* transform);
+struct mc_proto_player_dig {
+    /// 0 when digging starts, 1 while digging, 2 when digging stops and 3 when the block is broken.
+    mc_byte status;
+
+    /// X block coordinate.
+    mc_dword x;
 
+    /// Y block coordinate.
+    mc_byte y;
 
-struct mc_proto_chunk {
+    /// Z block coordinate.
+    mc_dword z;
+
+    /// Face of the block that is being dug.
+    mc_byte face;
+};
+
+
+/*!
+ * Sent when the player places a block or uses an item.
+ *
+ * \note Sent by the client only.
+ */
+struct mc_proto_player_place {
+    /// Block or item in the player's hand. Alpha versions only send the ID.
+    struct mc_proto_slot item;
+
+    /// X block coordinate.
     mc_dword x;
+
+    /// Y block coordinate.
+    mc_byte y;
+
+    /// Z block coordinate.
     mc_dword z;
-    mc_bool initialize;
+
+    /// Face of the block that was clicked.
+    mc_byte direction;
 };
 
 
-int mc_proto_encode_chunk(void* buffer, size_t buffer_size, struct mc_proto_chunk const* chunk);
+/*!
+ * Changes the item a player is holding.
+ *
+ * \note Sent by both the client and the server.
+ */
+struct mc_proto_holding {
+    /// Entity ID of the player. Alpha only.
+    mc_dword entity_id;
+
+    /// Item ID of the held item. Alpha only.
+    mc_word item_id;
+
+    /// Selected slot of the hotbar. Beta and later only.
+    mc_word slot;
+};
 
 
-struct mc_proto_chunk_data {
-    /// X block coordinate from which to start the data.
+/*!
+ * Adds an item to the player's inventory, for example when picking it up.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_inventory_add {
+    /// Item ID.
+    mc_word item_id;
+
+    /// Amount of items.
+    mc_byte count;
+
+    /// Damage the item has taken.
+    mc_word damage;
+};
+
+
+/*!
+ * Plays an animation on an entity, for example swinging an arm.
+ *
+ * \note Sent by both the client and the server.
+ */
+struct mc_proto_animation {
+    /// Entity ID of the animated entity.
+    mc_dword entity_id;
+
+    /// Animation to play.
+    mc_byte animation;
+};
+
+
+/*!
+ * Sent when the player crouches or leaves a bed.
+ *
+ * \note Sent by the client only. Beta and later only.
+ */
+struct mc_proto_entity_action {
+    /// Entity ID of the player.
+    mc_dword entity_id;
+
+    /// 1 to crouch, 2 to stand up and 3 to leave a bed.
+    mc_byte action;
+};
+
+
+/*!
+ * Spawns another player for the client.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_player_spawn {
+    /// Entity ID of the player.
+    mc_dword entity_id;
+
+    /// Length of the name.
+    mc_word name_length;
+
+    /// Name of the player.
+    mc_utf8_char const* name;
+
+    /// X position in absolute integer (32 units per block) coordinates.
     mc_dword x;
 
-    /// Y block coordinate from which to start the data.
-    mc_word y;
+    /// Y position in absolute integer coordinates.
+    mc_dword y;
 
-    /// Z block coordinate from which to start the data.
+    /// Z position in absolute integer coordinates.
     mc_dword z;
 
-    /// Width of the block data.
-    mc_byte x_size;
+    /// Yaw as a fraction of 256.
+    mc_byte yaw;
 
-    /// Height of the block data.
-    mc_byte y_size;
+    /// Pitch as a fraction of 256.
+    mc_byte pitch;
 
-    /// Depth of the block data.
-    mc_byte z_size;
+    /// Item ID of the held item, 0 for none.
+    mc_word item_id;
+};
 
-    /// Size of the compressed chunk data in bytes.
-    mc_dword compressed_size;
 
-    /// Compressed chunk data.
-    mc_byte const* data;
+/*!
+ * Spawns a dropped item. The client sends this when the player drops an item.
+ *
+ * \note Sent by both the client and the server.
+ */
+struct mc_proto_pickup_spawn {
+    /// Entity ID of the item.
+    mc_dword entity_id;
+
+    /// Item ID.
+    mc_word item_id;
+
+    /// Amount of items.
+    mc_byte count;
+
+    /// Damage the item has taken. Beta and later only.
+    mc_word damage;
+
+    /// X position in absolute integer coordinates.
+    mc_dword x;
+
+    /// Y position in absolute integer coordinates.
+    mc_dword y;
+
+    /// Z position in absolute integer coordinates.
+    mc_dword z;
+
+    /// Rotation as a fraction of 256.
+    mc_byte yaw;
+
+    /// Pitch as a fraction of 256.
+    mc_byte pitch;
+
+    /// Roll as a fraction of 256.
+    mc_byte roll;
 };
 
 
-int mc_proto_encode_chunk_data(void* buffer, size_t buffer_size, struct mc_proto_chunk_data const* chunk_data);
+/*!
+ * Plays the pickup animation of an item entity and destroys it.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_collect {
+    /// Entity ID of the collected item.
+    mc_dword collected_id;
+
+    /// Entity ID of the entity that picked up the item.
+    mc_dword collector_id;
+};
+
 
 /*!
- * Struct containing all packets the client can send to the server.
+ * Spawns an object or vehicle.
+ *
+ * \note Sent by the server only.
  */
-struct mc_proto_client_packet {
-    /// Packet identifier, refer to mc_proto_packet_type.
+struct mc_proto_object_spawn {
+    /// Entity ID of the object.
+    mc_dword entity_id;
+
+    /// Type of object.
+    mc_byte type;
+
+    /// X position in absolute integer coordinates.
+    mc_dword x;
+
+    /// Y position in absolute integer coordinates.
+    mc_dword y;
+
+    /// Z position in absolute integer coordinates.
+    mc_dword z;
+
+    /// Entity ID of the entity that threw the object, or 0 if none. Since beta.
+    mc_dword thrower_id;
+
+    /// Velocity along the X, Y and Z axes, only sent if the object has a thrower. Since beta.
+    mc_word const* velocity;
+};
+
+
+/*!
+ * Spawns a mob.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_mob_spawn {
+    /// Entity ID of the mob.
+    mc_dword entity_id;
+
+    /// Type of mob.
     mc_byte type;
 
+    /// X position in absolute integer coordinates.
+    mc_dword x;
 
-    /// Anonymous union of packet data.
-    union {
-        struct mc_proto_heartbeat heartbeat;
-        struct mc_proto_authentication_request authentication;
-        struct mc_proto_handshake_request handshake;
-        struct mc_proto_player_grounded grounded;
-        struct mc_proto_player_position position;
-        struct mc_proto_player_rotation rotation;
-        struct mc_proto_player_transform transform;
-    };
+    /// Y position in absolute integer coordinates.
+    mc_dword y;
+
+    /// Z position in absolute integer coordinates.
+    mc_dword z;
+
+    /// Yaw as a fraction of 256.
+    mc_byte yaw;
+
+    /// Pitch as a fraction of 256.
+    mc_byte pitch;
+
+    /// Size of the entity metadata in bytes. Since beta.
+    mc_dword metadata_size;
+
+    /// Entity metadata, terminated by a 0x7F byte. Since beta.
+    mc_byte const* metadata;
 };
 
 
 /*!
- * Decodes a packet received from the Minecraft client.
- * \param[in] buffer The buffer containing data to be decoded.
- * \param[in] buffer_size Size of the buffer in bytes.
- * \param[out] packet Pointer to a client packet structure to which the result is written.
- * \return The function can return one of the following:
- *         - <0 indicates the data is incomplete; the value represents how many more bytes are needed.
- *         - =0 indicates there was an error decoding the data.
- *         - >0 indicates the data was successfully read and decoded; the value represents the amount of bytes read.
- * \note The buffer is assumed to be network byte order.
+ * Removes an entity from the client.
+ *
+ * \note Sent by the server only.
  */
-int mc_proto_decode_client_packet(void const* buffer, size_t buffer_size, struct mc_proto_client_packet* packet);
+struct mc_proto_entity_destroy {
+    mc_dword entity_id;
+};
 
 
-struct mc_proto_server_packet {
-    /// Packet identifier, refer to mc_packet_type.
-    mc_byte type;
+/*!
+ * Tells the client an entity exists without changing anything about it.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_entity {
+    mc_dword entity_id;
+};
 
 
-    /// Anonymous union of packet data.
-    union {
-        struct mc_proto_heartbeat heartbeat;
-        struct mc_proto_authentication_response authentication;
-        struct mc_proto_handshake_response handshake;
-        struct mc_proto_time time;
-        struct mc_proto_player_transform transform;
-        struct mc_proto_chunk chunk;
-        struct mc_proto_chunk_data chunk_data;
-    };
+/*!
+ * Moves an entity by less than four blocks.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_entity_move {
+    mc_dword entity_id;
+
+    /// X offset in absolute integer coordinates.
+    mc_byte dx;
+
+    /// Y offset in absolute integer coordinates.
+    mc_byte dy;
+
+    /// Z offset in absolute integer coordinates.
+    mc_byte dz;
 };
 
 
 /*!
- * Encodes a handshake response into a buffer.
- * \param[out] buffer Destination buffer to write the result to.
- * \param[in] buffer_size Size of the buffer in bytes.
- * \param[in] packet Pointer to a handshake response packet to encode.
- * \return The function can return one of the following:
- *         - <0 means that the buffer was too small; the value will be the needed buffer size.
- *         - =0 indicates an error.
- *         - >0 returns how many bytes were written to the buffer.
- * \note The resulting buffer will be in network byte order.
+ * Rotates an entity.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_entity_rotate {
+    mc_dword entity_id;
+
+    /// Yaw as a fraction of 256.
+    mc_byte yaw;
+
+    /// Pitch as a fraction of 256.
+    mc_byte pitch;
+};
+
+
+/*!
+ * Moves an entity by less than four blocks and rotates it.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_entity_move_rotate {
+    mc_dword entity_id;
+
+    /// X offset in absolute integer coordinates.
+    mc_byte dx;
+
+    /// Y offset in absolute integer coordinates.
+    mc_byte dy;
+
+    /// Z offset in absolute integer coordinates.
+    mc_byte dz;
+
+    /// Yaw as a fraction of 256.
+    mc_byte yaw;
+
+    /// Pitch as a fraction of 256.
+    mc_byte pitch;
+};
+
+
+/*!
+ * Moves an entity to an absolute position.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_entity_teleport {
+    mc_dword entity_id;
+
+    /// X position in absolute integer coordinates.
+    mc_dword x;
+
+    /// Y position in absolute integer coordinates.
+    mc_dword y;
+
+    /// Z position in absolute integer coordinates.
+    mc_dword z;
+
+    /// Yaw as a fraction of 256.
+    mc_byte yaw;
+
+    /// Pitch as a fraction of 256.
+    mc_byte pitch;
+};
+
+
+struct mc_proto_chunk {
+    mc_dword x;
+    mc_dword z;
+    mc_bool initialize;
+};
+
+
+struct mc_proto_chunk_data {
+    /// X block coordinate from which to start the data.
+    mc_dword x;
+
+    /// Y block coordinate from which to start the data.
+    mc_word y;
+
+    /// Z block coordinate from which to start the data.
+    mc_dword z;
+
+    /// Width of the block data.
+    mc_byte x_size;
+
+    /// Height of the block data.
+    mc_byte y_size;
+
+    /// Depth of the block data.
+    mc_byte z_size;
+
+    /// Size of the compressed chunk data in bytes.
+    mc_dword compressed_size;
+
+    /// Compressed chunk data.
+    mc_byte const* data;
+};
+
+
+/*!
+ * Changes several blocks within a single chunk.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_multi_block_change {
+    /// X chunk coordinate.
+    mc_dword chunk_x;
+
+    /// Z chunk coordinate.
+    mc_dword chunk_z;
+
+    /// Amount of changed blocks.
+    mc_word count;
+
+    /// Chunk-local coordinates of each block, packed as <code>x << 12 | z << 8 | y</code>.
+    mc_word const* coordinates;
+
+    /// New block type of each block.
+    mc_byte const* types;
+
+    /// New block metadata of each block.
+    mc_byte const* metadata;
+};
+
+
+/*!
+ * Changes a single block.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_block_change {
+    /// X block coordinate.
+    mc_dword x;
+
+    /// Y block coordinate.
+    mc_byte y;
+
+    /// Z block coordinate.
+    mc_dword z;
+
+    /// New block type.
+    mc_byte type;
+
+    /// New block metadata.
+    mc_byte metadata;
+};
+
+
+/*!
+ * Carries the NBT data of a tile entity, such as a chest or a sign.
+ *
+ * \note Sent by both the client and the server.
+ */
+struct mc_proto_complex_entity {
+    /// X block coordinate.
+    mc_dword x;
+
+    /// Y block coordinate.
+    mc_word y;
+
+    /// Z block coordinate.
+    mc_dword z;
+
+    /// Size of the NBT data in bytes.
+    mc_word size;
+
+    /// GZip compressed NBT data. When decoded, this points into the decoded buffer.
+    mc_byte const* data;
+};
+
+
+/*!
+ * An explosion, along with every block it destroyed.
+ *
+ * \note Sent by the server only.
+ */
+struct mc_proto_explosion {
+    /// X coordinate of the center in world space.
+    mc_double x;
+
+    /// Y coordinate of the center in world space.
+    mc_double y;
+
+    /// Z coordinate of the center in world space.
+    mc_double z;
+
+    /// Radius of the explosion.
+    mc_float radius;
+
+    /// Amount of destroyed blocks.
+    mc_dword record_count;
+
+    /// Offsets of every destroyed block relative to the center, three bytes (x, y, z) per block.
+    mc_byte const* records;
+};
+
+
+/*!
+ * Disconnects the client. The client sends this when the player quits.
+ *
+ * \note Sent by both the client and the server.
+ */
+struct mc_proto_kick {
+    /// Length of the reason in bytes.
+    mc_word reason_length;
+
+    /// Reason for the disconnect.
+    mc_utf8_char reason[MINECRAFT_KICK_LENGTH * MC_UTF8_PER_UCS2];
+};
+
+
+/*!
+ * Closes an inventory window.
+ *
+ * \note Sent by both the client and the server. Beta and later only.
+ */
+struct mc_proto_window_close {
+    /// ID of the window, 0 for the player's inventory.
+    mc_byte window_id;
+};
+
+
+/*!
+ * Sent when the player clicks a slot in an inventory window.
+ *
+ * \note Sent by the client only. Beta and later only.
+ */
+struct mc_proto_window_click {
+    /// ID of the window, 0 for the player's inventory.
+    mc_byte window_id;
+
+    /// Index of the clicked slot.
+    mc_word slot;
+
+    /// MC_TRUE if the slot was right-clicked.
+    mc_byte right_click;
+
+    /// Number identifying this click, the server confirms it with a transaction packet.
+    mc_word action;
+
+    /// MC_TRUE if shift was held.
+    mc_bool shift;
+
+    /// Contents of the slot as seen by the client.
+    struct mc_proto_slot item;
+};
+
+
+/*!
+ * Accepts or rejects a window click.
+ *
+ * \note Sent by both the client and the server. Beta and later only.
+ */
+struct mc_proto_transaction {
+    /// ID of the window.
+    mc_byte window_id;
+
+    /// Number of the click this is a response to.
+    mc_word action;
+
+    /// MC_TRUE if the click was accepted.
+    mc_bool accepted;
+};
+
+
+/*!
+ * Sets the text on a sign.
+ *
+ * \note Sent by both the client and the server. Beta and later only.
+ */
+struct mc_proto_sign_update {
+    /// X block coordinate.
+    mc_dword x;
+
+    /// Y block coordinate.
+    mc_word y;
+
+    /// Z block coordinate.
+    mc_dword z;
+
+    mc_word line0_length;
+    mc_utf8_char line0[MINECRAFT_SIGN_LENGTH * MC_UTF8_PER_UCS2];
+    mc_word line1_length;
+    mc_utf8_char line1[MINECRAFT_SIGN_LENGTH * MC_UTF8_PER_UCS2];
+    mc_word line2_length;
+    mc_utf8_char line2[MINECRAFT_SIGN_LENGTH * MC_UTF8_PER_UCS2];
+    mc_word line3_length;
+    mc_utf8_char line3[MINECRAFT_SIGN_LENGTH * MC_UTF8_PER_UCS2];
+};
+
+
+/*!
+ * A string that was not copied out of the buffer it was received in.
+ *
+ * The characters are left as the client sent them; use mc_proto_string_view_to_utf8() to convert them.
+ */
+struct mc_proto_string_view {
+    /// Encoding of the characters, one of mc_proto_string_encoding.
+    int encoding;
+
+    /// Length of the string in code units: bytes for UTF-8, 16-bit big-endian characters for UCS-2.
+    mc_word length;
+
+    /// Characters of the string, inside the receive buffer.
+    void const* data;
+};
+
+
+/*!
+ * View of mc_proto_authentication_request.
+ */
+struct mc_proto_authentication_request_view {
+    mc_dword protocol_version;
+    struct mc_proto_string_view username;
+    struct mc_proto_string_view password;
+    mc_qword map_seed;
+    mc_byte dimension;
+};
+
+
+/*!
+ * View of mc_proto_handshake_request.
+ */
+struct mc_proto_handshake_request_view {
+    struct mc_proto_string_view name;
+};
+
+
+/*!
+ * View of mc_proto_chat.
+ */
+struct mc_proto_chat_view {
+    struct mc_proto_string_view message;
+};
+
+
+/*!
+ * View of mc_proto_inventory. Slots differ in size, use mc_proto_read_slot() to walk them.
+ */
+struct mc_proto_inventory_view {
+    mc_dword type;
+    mc_word count;
+
+    /// First slot on the wire, inside the receive buffer.
+    mc_byte const* slots;
+};
+
+
+/*!
+ * View of mc_proto_sign_update.
+ */
+struct mc_proto_sign_update_view {
+    mc_dword x;
+    mc_word y;
+    mc_dword z;
+    struct mc_proto_string_view line0;
+    struct mc_proto_string_view line1;
+    struct mc_proto_string_view line2;
+    struct mc_proto_string_view line3;
+};
+
+
+/*!
+ * View of mc_proto_kick.
+ */
+struct mc_proto_kick_view {
+    struct mc_proto_string_view reason;
+};
+
+
+/*!
+ * Every packet the client can send to the server, as <code>X(type, name, member)</code>. The name is the suffix of
+ * the packet's structure and codec functions, and member is its name in struct mc_proto_client_packet.
+ */
+#define MC_PROTO_CLIENT_PACKETS(X) \
+    X(MC_PACKET_HEARTBEAT,        heartbeat,              heartbeat)      \
+    X(MC_PACKET_AUTHENTICATION,   authentication_request, authentication) \
+    X(MC_PACKET_HANDSHAKE,        handshake_request,      handshake)      \
+    X(MC_PACKET_CHAT,             chat,                   chat)           \
+    X(MC_PACKET_INVENTORY,        inventory,              inventory)      \
+    X(MC_PACKET_USE_ENTITY,       use_entity,             use_entity)     \
+    X(MC_PACKET_RESPAWN,          respawn,                respawn)        \
+    X(MC_PACKET_PLAYER_GROUNDED,  player_grounded,        grounded)       \
+    X(MC_PACKET_PLAYER_POSITION,  player_position,        position)       \
+    X(MC_PACKET_PLAYER_ROTATION,  player_rotation,        rotation)       \
+    X(MC_PACKET_PLAYER_TRANSFORM, player_transform,       transform)      \
+    X(MC_PACKET_PLAYER_DIG,       player_dig,             dig)            \
+    X(MC_PACKET_PLAYER_PLACE,     player_place,           place)          \
+    X(MC_PACKET_HOLDING,          holding,                holding)        \
+    X(MC_PACKET_ANIMATION,        animation,              animation)      \
+    X(MC_PACKET_ENTITY_ACTION,    entity_action,          entity_action)  \
+    X(MC_PACKET_PICKUP_SPAWN,     pickup_spawn,           pickup_spawn)   \
+    X(MC_PACKET_COMPLEX_ENTITY,   complex_entity,         complex_entity) \
+    X(MC_PACKET_WINDOW_CLOSE,     window_close,           window_close)   \
+    X(MC_PACKET_WINDOW_CLICK,     window_click,           window_click)   \
+    X(MC_PACKET_TRANSACTION,      transaction,            transaction)    \
+    X(MC_PACKET_SIGN_UPDATE,      sign_update,            sign_update)    \
+    X(MC_PACKET_KICK,             kick,                   kick)
+
+/*!
+ * Every packet the client can send to the server as it is viewed, as <code>X(type, view, member)</code>. The view is
+ * the suffix of the structure used for the packet in struct mc_proto_client_view. Packets without strings or copied
+ * arrays are viewed as their decoded structure.
+ * \see MC_PROTO_CLIENT_PACKETS
+ */
+#define MC_PROTO_CLIENT_VIEWS(X) \
+    X(MC_PACKET_HEARTBEAT,        heartbeat,                   heartbeat)      \
+    X(MC_PACKET_AUTHENTICATION,   authentication_request_view, authentication) \
+    X(MC_PACKET_HANDSHAKE,        handshake_request_view,      handshake)      \
+    X(MC_PACKET_CHAT,             chat_view,                   chat)           \
+    X(MC_PACKET_INVENTORY,        inventory_view,              inventory)      \
+    X(MC_PACKET_USE_ENTITY,       use_entity,                  use_entity)     \
+    X(MC_PACKET_RESPAWN,          respawn,                     respawn)        \
+    X(MC_PACKET_PLAYER_GROUNDED,  player_grounded,             grounded)       \
+    X(MC_PACKET_PLAYER_POSITION,  player_position,             position)       \
+    X(MC_PACKET_PLAYER_ROTATION,  player_rotation,             rotation)       \
+    X(MC_PACKET_PLAYER_TRANSFORM, player_transform,            transform)      \
+    X(MC_PACKET_PLAYER_DIG,       player_dig,                  dig)            \
+    X(MC_PACKET_PLAYER_PLACE,     player_place,                place)          \
+    X(MC_PACKET_HOLDING,          holding,                     holding)        \
+    X(MC_PACKET_ANIMATION,        animation,                   animation)      \
+    X(MC_PACKET_ENTITY_ACTION,    entity_action,               entity_action)  \
+    X(MC_PACKET_PICKUP_SPAWN,     pickup_spawn,                pickup_spawn)   \
+    X(MC_PACKET_COMPLEX_ENTITY,   complex_entity,              complex_entity) \
+    X(MC_PACKET_WINDOW_CLOSE,     window_close,                window_close)   \
+    X(MC_PACKET_WINDOW_CLICK,     window_click,                window_click)   \
+    X(MC_PACKET_TRANSACTION,      transaction,                 transaction)    \
+    X(MC_PACKET_SIGN_UPDATE,      sign_update_view,            sign_update)    \
+    X(MC_PACKET_KICK,             kick_view,                   kick)
+
+/*!
+ * Every packet the server can send to the client, as <code>X(type, name, member)</code>.
+ * \see MC_PROTO_CLIENT_PACKETS
+ */
+#define MC_PROTO_SERVER_PACKETS(X) \
+    X(MC_PACKET_HEARTBEAT,          heartbeat,               heartbeat)          \
+    X(MC_PACKET_AUTHENTICATION,     authentication_response, authentication)     \
+    X(MC_PACKET_HANDSHAKE,          handshake_response,      handshake)          \
+    X(MC_PACKET_CHAT,               chat,                    chat)               \
+    X(MC_PACKET_TIME,               time,                    time)               \
+    X(MC_PACKET_INVENTORY,          inventory,               inventory)          \
+    X(MC_PACKET_SPAWN_POSITION,     spawn_position,          spawn_position)     \
+    X(MC_PACKET_HEALTH,             health,                  health)             \
+    X(MC_PACKET_RESPAWN,            respawn,                 respawn)            \
+    X(MC_PACKET_PLAYER_TRANSFORM,   player_transform,        transform)          \
+    X(MC_PACKET_HOLDING,            holding,                 holding)            \
+    X(MC_PACKET_INVENTORY_ADD,      inventory_add,           inventory_add)      \
+    X(MC_PACKET_ANIMATION,          animation,               animation)          \
+    X(MC_PACKET_PLAYER_SPAWN,       player_spawn,            player_spawn)       \
+    X(MC_PACKET_PICKUP_SPAWN,       pickup_spawn,            pickup_spawn)       \
+    X(MC_PACKET_COLLECT,            collect,                 collect)            \
+    X(MC_PACKET_OBJECT_SPAWN,       object_spawn,            object_spawn)       \
+    X(MC_PACKET_MOB_SPAWN,          mob_spawn,               mob_spawn)          \
+    X(MC_PACKET_ENTITY_DESTROY,     entity_destroy,          entity_destroy)     \
+    X(MC_PACKET_ENTITY,             entity,                  entity)             \
+    X(MC_PACKET_ENTITY_MOVE,        entity_move,             entity_move)        \
+    X(MC_PACKET_ENTITY_ROTATE,      entity_rotate,           entity_rotate)      \
+    X(MC_PACKET_ENTITY_MOVE_ROTATE, entity_move_rotate,      entity_move_rotate) \
+    X(MC_PACKET_ENTITY_TELEPORT,    entity_teleport,         entity_teleport)    \
+    X(MC_PACKET_CHUNK,              chunk,                   chunk)              \
+    X(MC_PACKET_CHUNK_DATA,         chunk_data,              chunk_data)         \
+    X(MC_PACKET_MULTI_BLOCK_CHANGE, multi_block_change,      multi_block_change) \
+    X(MC_PACKET_BLOCK_CHANGE,       block_change,            block_change)       \
+    X(MC_PACKET_COMPLEX_ENTITY,     complex_entity,          complex_entity)     \
+    X(MC_PACKET_EXPLOSION,          explosion,               explosion)          \
+    X(MC_PACKET_WINDOW_CLOSE,       window_close,            window_close)       \
+    X(MC_PACKET_TRANSACTION,        transaction,             transaction)        \
+    X(MC_PACKET_SIGN_UPDATE,        sign_update,             sign_update)        \
+    X(MC_PACKET_KICK,               kick,                    kick)
+
+
+struct mc_proto_client_packet;
+struct mc_proto_client_view;
+struct mc_proto_server_packet;
+
+
+/*!
+ * Encoder and decoder tables for a single version of the protocol.
+ *
+ * Each version lays out its packets differently, but all versions decode into and encode from the same packet
+ * structures. A session binds to a codec once and every packet is then dispatched through its tables, so there is
+ * no branching on the protocol version when decoding or encoding a packet.
+ */
+struct mc_proto_codec {
+    /// Name of the game version, for logging.
+    char const* name;
+
+    /// Protocol version sent by the client in the authentication request.
+    mc_dword protocol_version;
+
+    /// Encoding of strings on the wire, one of mc_proto_string_encoding.
+    int string_encoding;
+
+    /// Framers for client packets, indexed by packet type. NULL for packets this version does not have.
+    int (*framers[256])(uint8_t const* buffer, size_t buffer_size);
+
+    /// Decoders for client packets, indexed by packet type. NULL for packets this version does not have.
+    int (*decoders[256])(uint8_t const* buffer, size_t buffer_size, struct mc_proto_client_packet* packet);
+
+    /// Viewers for client packets, indexed by packet type. NULL for packets this version does not have.
+    int (*viewers[256])(uint8_t const* buffer, size_t buffer_size, struct mc_proto_client_view* view);
+
+    /// Encoders for server packets, indexed by packet type. NULL for packets this version does not have.
+    int (*encoders[256])(void* buffer, size_t buffer_size, struct mc_proto_server_packet const* packet);
+
+    /// Vectored encoders for server packets, indexed by packet type. NULL for packets this version does not have.
+    int (*iov_encoders[256])(void* buffer, size_t buffer_size, struct mc_proto_server_packet const* packet,
+                             struct iovec iov[2]);
+
+    /// Maximum encoded size of server packets, indexed by packet type. NULL for packets this version does not have.
+    size_t (*sizers[256])(struct mc_proto_server_packet const* packet);
+
+    /// Encoded size of server packets that always have the same size, indexed by packet type. 0 for other packets.
+    size_t fixed_sizes[256];
+};
+
+
+/*!
+ * Finds the codec for a protocol version.
+ *
+ * Only alpha protocol version 1 and beta 1.7.3, protocol version 14, are supported.
+ * \param protocol_version Protocol version sent by the client in the authentication request.
+ * \return Pointer to the codec, or NULL if the version is not supported.
+ */
+struct mc_proto_codec const* mc_proto_codec_for_version(mc_dword protocol_version);
+
+/*!
+ * Picks a codec based on the first packet the client sends, which must be a handshake request.
+ *
+ * The client only sends its protocol version after the handshake. Until then, the encoding of the username in the
+ * handshake is used to tell alpha clients from beta clients. The chosen codec is the default of that family and is
+ * meant to be replaced by mc_proto_codec_for_version() once the authentication request arrives.
+ * \param[in] buffer The buffer containing the start of the handshake request.
+ * \param[in] buffer_size Size of the buffer in bytes.
+ * \param[out] codec Written with a pointer to the codec when successful.
+ * \return The function can return one of the following:
+ *         - <0 indicates the data is incomplete; the value represents how many more bytes are needed.
+ *         - =0 indicates the data is not a handshake request.
+ *         - >0 indicates a codec was picked; the value represents the amount of bytes examined.
+ * \note No data is consumed, the handshake request must still be decoded.
+ */
+int mc_proto_detect_codec(void const* buffer, size_t buffer_size, struct mc_proto_codec const** codec);
+
+
+/*!
+ * Struct containing all packets the client can send to the server.
+ */
+struct mc_proto_client_packet {
+    /// Packet identifier, refer to mc_proto_packet_type.
+    mc_byte type;
+
+
+    /// Anonymous union of packet data.
+    union {
+#define MC_PROTO_CLIENT_MEMBER(type, name, member) struct mc_proto_##name member;
+        MC_PROTO_CLIENT_PACKETS(MC_PROTO_CLIENT_MEMBER)
+#undef MC_PROTO_CLIENT_MEMBER
+    };
+};
+
+
+/*!
+ * Computes the length of a packet received from the Minecraft client without decoding it.
+ *
+ * Only the type byte and the length prefixes of strings and arrays are read, nothing is copied or converted.
+ * \param[in] codec Codec of the protocol version spoken by the client.
+ * \param[in] buffer The buffer containing the start of the packet.
+ * \param[in] buffer_size Size of the buffer in bytes.
+ * \return The function can return one of the following:
+ *         - <0 indicates the data is incomplete; the value represents how many more bytes are needed.
+ *         - =0 indicates the data is not a valid packet.
+ *         - >0 indicates the packet is complete; the value represents its length in bytes.
+ * \note A packet that frames correctly can still fail to decode, e.g. when a string exceeds its maximum length.
+ */
+int mc_proto_frame_client_packet(struct mc_proto_codec const* codec, void const* buffer, size_t buffer_size);
+
+/*!
+ * Finds every complete packet at the start of a buffer received from the Minecraft client.
+ *
+ * Packets are framed one after the other with mc_proto_frame_client_packet() until the data runs out, a packet is
+ * invalid or the lengths array is full.
+ * \param[in] codec Codec of the protocol version spoken by the client.
+ * \param[in] buffer The buffer containing the received data.
+ * \param[in] buffer_size Size of the buffer in bytes.
+ * \param[out] lengths Written with the length in bytes of each complete packet, in order.
+ * \param[in] max_packets Capacity of the lengths array.
+ * \param[out] status Written with the result of framing the data following the last complete packet, see
+ *                    mc_proto_frame_client_packet(). When all data is consumed this is -1.
+ * \return The amount of complete packets found.
+ */
+size_t mc_proto_scan_client_packets(struct mc_proto_codec const* codec, void const* buffer, size_t buffer_size,
+                                    size_t* lengths, size_t max_packets, int* status);
+
+/*!
+ * Decodes a packet received from the Minecraft client.
+ * \param[in] codec Codec of the protocol version spoken by the client.
+ * \param[in] buffer The buffer containing data to be decoded.
+ * \param[in] buffer_size Size of the buffer in bytes.
+ * \param[out] packet Pointer to a client packet structure to which the result is written.
+ * \return The function can return one of the following:
+ *         - <0 indicates the data is incomplete; the value represents how many more bytes are needed.
+ *         - =0 indicates there was an error decoding the data.
+ *         - >0 indicates the data was successfully read and decoded; the value represents the amount of bytes read.
+ * \note The buffer is assumed to be network byte order.
+ */
+int mc_proto_decode_client_packet(struct mc_proto_codec const* codec, void const* buffer, size_t buffer_size,
+                                  struct mc_proto_client_packet* packet);
+
+
+/*!
+ * Struct containing a view of any packet the client can send to the server.
+ *
+ * Strings and arrays are not copied, they point into the buffer the packet was viewed from and are only valid for as
+ * long as that buffer is.
+ */
+struct mc_proto_client_view {
+    /// Packet identifier, refer to mc_proto_packet_type.
+    mc_byte type;
+
+
+    /// Anonymous union of packet views.
+    union {
+#define MC_PROTO_CLIENT_VIEW_MEMBER(type, view, member) struct mc_proto_##view member;
+        MC_PROTO_CLIENT_VIEWS(MC_PROTO_CLIENT_VIEW_MEMBER)
+#undef MC_PROTO_CLIENT_VIEW_MEMBER
+    };
+};
+
+
+/*!
+ * Decodes a packet received from the Minecraft client without copying its strings and arrays.
+ *
+ * This performs the same checks as mc_proto_decode_client_packet(), except that UCS-2 strings are only checked once
+ * they are converted.
+ * \param[in] codec Codec of the protocol version spoken by the client.
+ * \param[in] buffer The buffer containing data to be decoded. Must outlive the view.
+ * \param[in] buffer_size Size of the buffer in bytes.
+ * \param[out] view Pointer to a client view structure to which the result is written.
+ * \return The function can return one of the following:
+ *         - <0 indicates the data is incomplete; the value represents how many more bytes are needed.
+ *         - =0 indicates there was an error decoding the data.
+ *         - >0 indicates the data was successfully read and decoded; the value represents the amount of bytes read.
+ */
+int mc_proto_view_client_packet(struct mc_proto_codec const* codec, void const* buffer, size_t buffer_size,
+                                struct mc_proto_client_view* view);
+
+/*!
+ * Converts a string view to UTF-8.
+ * \param[in] view Pointer to the string view.
+ * \param[out] dst Destination buffer for the UTF-8 characters. Not NUL-terminated.
+ * \param[in] capacity Size of the destination buffer in bytes.
+ * \return Length of the UTF-8 string in bytes, or -1 if it does not fit in the destination buffer.
+ */
+int mc_proto_string_view_to_utf8(struct mc_proto_string_view const* view, mc_utf8_char* dst, size_t capacity);
+
+/*!
+ * Reads a slot from a slot array view.
+ * \param[in] data Pointer to the slot on the wire, e.g. mc_proto_inventory_view::slots.
+ * \param[out] slot Written with the decoded slot.
+ * \return Pointer to the next slot on the wire.
+ * \note The slot array must have been viewed successfully, the data is not checked again.
+ */
+mc_byte const* mc_proto_read_slot(mc_byte const* data, struct mc_proto_slot* slot);
+
+
+struct mc_proto_server_packet {
+    /// Packet identifier, refer to mc_packet_type.
+    mc_byte type;
+
+
+    /// Anonymous union of packet data.
+    union {
+#define MC_PROTO_SERVER_MEMBER(type, name, member) struct mc_proto_##name member;
+        MC_PROTO_SERVER_PACKETS(MC_PROTO_SERVER_MEMBER)
+#undef MC_PROTO_SERVER_MEMBER
+    };
+};
+
+
+/*!
+ * Computes the buffer size needed to encode a packet to be sent to the Minecraft client, in constant time.
+ *
+ * This is the exact size of the packet, unless it contains slots or UCS-2 strings which can turn out shorter.
+ * \param[in] codec Codec of the protocol version spoken by the client.
+ * \param[in] packet Pointer to a server packet structure to encode.
+ * \return The buffer size in bytes, or 0 if the codec does not have the packet.
+ * \see mc_proto_codec::fixed_sizes for packets whose size is known up front.
+ */
+size_t mc_proto_server_packet_size(struct mc_proto_codec const* codec, struct mc_proto_server_packet const* packet);
+
+/*!
+ * Encodes a packet to be sent to the Minecraft client.
+ * \param[in] codec Codec of the protocol version spoken by the client.
+ * \param[out] buffer Destination buffer to write the result to.
+ * \param[in] buffer_size Size of the buffer in bytes.
+ * \param[in] packet Pointer to a server packet structure to encode.
+ * \return The function can return one of the following:
+ *         - <0 means that the buffer was too small; the value will be how many bytes it is short of the size
+ *           returned by mc_proto_server_packet_size().
+ *         - =0 indicates an error.
+ *         - >0 returns how many bytes were written to the buffer.
+ * \note The resulting buffer will be in network byte order. The buffer size is checked once, then the packet is
+ *       written in a single pass.
+ */
+int mc_proto_encode_server_packet(struct mc_proto_codec const* codec, void* buffer, size_t buffer_size,
+                                  struct mc_proto_server_packet const* packet);
+
+/*!
+ * Encodes a packet to be sent to the Minecraft client without copying its payload.
+ *
+ * Everything but the payload is written to the buffer. The payload is the trailing data of packets such as chunk data
+ * and complex entities, and is referenced where it already is. The two parts are returned as an I/O vector that can be
+ * passed to sendmsg() or writev().
+ * \param[in] codec Codec of the protocol version spoken by the client.
+ * \param[out] buffer Destination buffer to write everything but the payload to.
+ * \param[in] buffer_size Size of the buffer in bytes.
+ * \param[in] packet Pointer to a server packet structure to encode.
+ * \param[out] iov The encoded packet; the first entry points to the buffer, the second one to the payload or is empty
+ *                 if the packet has none. The payload must stay alive until the packet has been sent.
+ * \return The function can return one of the following:
+ *         - <0 means that the buffer was too small; the value will be how many bytes it is short.
+ *         - =0 indicates an error.
+ *         - >0 returns the size of the whole packet in bytes, including the payload.
  */
-int mc_proto_encode_server_packet(void* buffer, size_t buffer_size, struct mc_proto_server_packet const* packet);
+int mc_proto_encode_server_packet_iov(struct mc_proto_codec const* codec, void* buffer, size_t buffer_size,
+                                      struct mc_proto_server_packet const* packet, struct iovec iov[2]);
 
 #endif // !OBSIDIAN_MINECRAFT_PROTOCOL_H
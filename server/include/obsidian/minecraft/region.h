@@ -0,0 +1,106 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_REGION_H
+#define OBSIDIAN_MINECRAFT_REGION_H
+
+#include "obsidian/minecraft/chunk.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+/// Width and depth of a region in chunks.
+#define MC_REGION_SIZE 32
+
+
+/*!
+ * A McRegion (.mcr) file of 32x32 chunks, mapped into memory.
+ *
+ * The file is mapped read-only once and its offset table is parsed when it is opened. Chunks are inflated straight
+ * from the mapped pages, so loading a chunk needs no system calls and no copy of the compressed data. A region can be
+ * read from any amount of threads at once.
+ */
+struct mc_region;
+
+
+/*!
+ * Computes the coordinate of the region holding a chunk.
+ * \param chunk Chunk coordinate.
+ * \return Region coordinate.
+ */
+static inline int32_t mc_region_coordinate(int32_t const chunk) {
+    return chunk >> 5;
+}
+
+/*!
+ * Opens and maps a region file.
+ * \param path Path to the region file.
+ * \return Pointer to the region, or NULL if the file does not exist or is not a region file.
+ */
+struct mc_region* mc_region_open(char const* path);
+
+/*!
+ * Maps a region file that is already open, such as one opened through the I/O ring.
+ * \param fd Descriptor of the file, opened for reading. It is closed whether or not the region could be mapped.
+ * \param path Path to the region file, for logging.
+ * \return Pointer to the region, or NULL if the file is not a region file.
+ */
+struct mc_region* mc_region_map(int fd, char const* path);
+
+/*!
+ * Unmaps a region file.
+ * \param region Pointer to the region.
+ */
+void mc_region_close(struct mc_region* region);
+
+/*!
+ * Checks whether a region holds a chunk.
+ * \param region Pointer to the region.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \return Whether the chunk was saved to the region.
+ */
+bool mc_region_has_chunk(struct mc_region const* region, int32_t chunk_x, int32_t chunk_z);
+
+/*!
+ * Loads a chunk from a region.
+ * \param region Pointer to the region.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param stream Inflate stream initialized for zlib and gzip data, reused between calls.
+ * \param scratch Buffer the chunk NBT is inflated into, grown as needed.
+ * \param scratch_size Size of the scratch buffer in bytes.
+ * \return Pointer to the loaded chunk, or NULL if the region does not hold the chunk or it is corrupt.
+ */
+struct mc_chunk* mc_region_load_chunk(struct mc_region const* region, int32_t chunk_x, int32_t chunk_z,
+                                      z_stream* stream, uint8_t** scratch, size_t* scratch_size);
+
+/*!
+ * Serializes a chunk to the uncompressed NBT stored for it in a region file.
+ * \param chunk Pointer to the chunk.
+ * \param time World time of the save, stored as LastUpdate.
+ * \param buffer Destination buffer.
+ * \param capacity Size of the buffer in bytes.
+ * \return Size of the NBT in bytes. If it is larger than the capacity, the buffer was too small and holds nothing
+ *         usable.
+ */
+size_t mc_region_write_chunk(struct mc_chunk const* chunk, uint64_t time, void* buffer, size_t capacity);
+
+#endif // !OBSIDIAN_MINECRAFT_REGION_H
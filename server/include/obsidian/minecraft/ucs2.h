@@ -0,0 +1,72 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_MINECRAFT_UCS2_H
+#define OBSIDIAN_MINECRAFT_UCS2_H
+
+#include "obsidian/minecraft/protocol.h"
+
+#include <stddef.h>
+
+
+/*!
+ * Conversion between UTF-8 and the UCS-2 big-endian strings of the beta protocol.
+ *
+ * Code points outside of the basic multilingual plane are written as surrogate pairs, and surrogate pairs are joined
+ * when reading. Invalid UTF-8 sequences are read as a single '?' character.
+ *
+ * Every conversion has a scalar implementation and, on x86-64, SSE2 and AVX2 implementations that convert runs of
+ * ASCII characters a vector at a time. The implementation is picked by mc_ucs2_init().
+ */
+
+
+/*!
+ * Picks the fastest implementation of the conversions supported by the CPU.
+ * \note Until this is called the scalar implementation is used. Call it once at startup, before any other thread
+ *       converts strings.
+ */
+void mc_ucs2_init(void);
+
+/*!
+ * Counts the UCS-2 characters needed to represent a UTF-8 string.
+ * \param src UTF-8 string.
+ * \param length Length of the UTF-8 string in bytes.
+ * \return Amount of UCS-2 characters.
+ */
+size_t mc_ucs2_length(mc_utf8_char const* src, size_t length);
+
+/*!
+ * Converts a UTF-8 string to UCS-2 big-endian.
+ * \param dst Destination buffer, must have room for mc_ucs2_length() characters. Does not need to be aligned.
+ * \param src UTF-8 string.
+ * \param length Length of the UTF-8 string in bytes.
+ * \return Amount of UCS-2 characters written.
+ */
+size_t mc_ucs2_from_utf8(void* dst, mc_utf8_char const* src, size_t length);
+
+/*!
+ * Converts a UCS-2 big-endian string to UTF-8.
+ * \param dst Destination buffer for the UTF-8 string. Not NUL-terminated.
+ * \param capacity Size of the destination buffer in bytes.
+ * \param src UCS-2 big-endian string. Does not need to be aligned.
+ * \param units Length of the UCS-2 string in characters.
+ * \return Length of the UTF-8 string in bytes, or -1 if it does not fit in the destination buffer.
+ */
+int mc_ucs2_to_utf8(mc_utf8_char* dst, size_t capacity, void const* src, size_t units);
+
+#endif // !OBSIDIAN_MINECRAFT_UCS2_H
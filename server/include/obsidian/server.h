@@ -19,6 +19,7 @@
 #ifndef OBSIDIAN_SERVER_H
 #define OBSIDIAN_SERVER_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -34,6 +35,151 @@ struct obs_server_params {
 
     /// Size of the frame pool in bytes. May be zero to let the server decide.
     size_t frame_pool_size;
+
+    /// Amount of chunk compression threads. May be zero to let the server decide.
+    unsigned compression_workers;
+
+    /// zlib compression level for chunk data when the server is not under load, from 1 (fast) to 9 (best).
+    int compression_level;
+
+    /// Maximum amount of memory used by cached compressed chunks in bytes.
+    size_t chunk_cache_size;
+
+    /// Maximum amount of cached compressed chunks.
+    size_t chunk_cache_entries;
+
+    /// Amount of loaded chunks the server has room for before the chunk map has to grow.
+    size_t loaded_chunks;
+
+    /// Directory of the world to serve, holding a region directory of McRegion files. May be NULL.
+    char const* world_path;
+
+    /// Maximum amount of disk operations in flight at once. May be zero to let the server decide.
+    unsigned max_disk_ops;
+
+    /// Radius in chunks of the square of chunks sent around each player. May be zero to let the server decide.
+    unsigned view_radius;
+
+    /// Amount of chunk data in bytes sent to all players together per tick. May be zero to let the server decide.
+    size_t chunk_stream_budget;
+
+    /// Maximum amount of entities, players included. May be zero to let the server decide.
+    uint32_t max_entities;
+};
+
+
+/*!
+ * Disk operations the server performs through its I/O ring.
+ */
+enum obs_disk_op {
+    /// openat() of a file.
+    OBS_DISK_OPEN = 0,
+
+    /// read() at an offset.
+    OBS_DISK_READ = 1,
+
+    /// write() at an offset.
+    OBS_DISK_WRITE = 2,
+
+    /// fsync() of a file.
+    OBS_DISK_FSYNC = 3,
+
+    /// Amount of disk operations.
+    OBS_DISK_OP_COUNT,
+};
+
+/// Amount of buckets of the disk latency histograms. Bucket i counts operations that took less than 2^i microseconds.
+#define OBS_DISK_LATENCY_BUCKETS 24
+
+
+/*!
+ * Reasons for the server to close a client session.
+ */
+enum obs_disconnect_reason {
+    /// The client sent a packet type that does not exist in its protocol version.
+    OBS_DISCONNECT_UNKNOWN_PACKET = 0,
+
+    /// The client sent a packet that could not be decoded.
+    OBS_DISCONNECT_MALFORMED_PACKET = 1,
+
+    /// The client sent a packet too large to fit in its receive buffer.
+    OBS_DISCONNECT_OVERSIZED_PACKET = 2,
+
+    /// The client sent a packet that is not allowed in the current state of its session.
+    OBS_DISCONNECT_UNEXPECTED_PACKET = 3,
+
+    /// The client speaks a protocol version that is not supported.
+    OBS_DISCONNECT_INCOMPATIBLE_VERSION = 4,
+
+    /// The client sent a username that cannot be used.
+    OBS_DISCONNECT_INVALID_USERNAME = 5,
+
+    /// The server has no entity ID left for the player.
+    OBS_DISCONNECT_SERVER_FULL = 6,
+
+    /// Sending to or receiving from the client failed.
+    OBS_DISCONNECT_CONNECTION_ERROR = 7,
+
+    /// The client closed the connection.
+    OBS_DISCONNECT_CONNECTION_CLOSED = 8,
+
+    /// Amount of disconnect reasons.
+    OBS_DISCONNECT_REASON_COUNT,
+};
+
+
+/*!
+ * Counters describing what the server has been doing since it was created.
+ */
+struct obs_server_metrics {
+    /// Amount of sessions closed by the server, indexed by obs_disconnect_reason.
+    uint64_t disconnects[OBS_DISCONNECT_REASON_COUNT];
+
+    /// Current chunk compression level.
+    int compression_level;
+
+    /// Amount of times the chunk compression level was raised because clients were short on bandwidth.
+    uint64_t compression_level_raises;
+
+    /// Amount of times the chunk compression level was lowered because the server was short on CPU time.
+    uint64_t compression_level_drops;
+
+    /// Time disk operations took from being submitted to completing, indexed by obs_disk_op. The last bucket also
+    /// counts everything slower.
+    uint64_t disk_latency[OBS_DISK_OP_COUNT][OBS_DISK_LATENCY_BUCKETS];
+
+    /// Amount of disk operations submitted to the kernel that have not completed yet.
+    size_t disk_ops_in_flight;
+
+    /// Amount of disk operations that waited for others to complete before they were submitted.
+    uint64_t disk_ops_deferred;
+
+    /// Amount of times the I/O queue was submitted early because it was full.
+    uint64_t early_submits;
+
+    /// Amount of chunks streamed to players.
+    uint64_t chunks_streamed;
+
+    /// Amount of chunks players were told to unload because they moved away from them.
+    uint64_t chunks_unloaded;
+
+    /// Amount of times a client was told about an entity near it.
+    uint64_t entities_spawned;
+
+    /// Amount of times a client was told to forget about an entity that left its surroundings.
+    uint64_t entities_destroyed;
+
+    /// Amount of movement packets received from players.
+    uint64_t movement_updates;
+
+    /// Amount of movement packets relayed to players.
+    uint64_t movement_packets_sent;
+
+    /// Amount of movement packets that were not relayed because the movements of a player within a tick were combined.
+    uint64_t movement_packets_saved;
+
+    /// Amount of movement packets saved in the last tick.
+    uint64_t movement_packets_saved_last_tick;
 };
 
 
@@ -43,15 +189,46 @@ struct obs_server_params {
 struct obs_session;
 
 
+/*!
+ * A chunk to be compressed.
+ * \see obsidian/minecraft/chunk_compressor.h
+ */
+struct mc_chunk_job;
+
+
+/*!
+ * Counters of the compressed chunk cache.
+ * \see obsidian/minecraft/chunk_cache.h
+ */
+struct mc_chunk_cache_metrics;
+
+
+/*!
+ * A reference counted buffer.
+ * \see obsidian/memory.h
+ */
+struct obs_shared_buffer;
+
+
 /*!
  * \brief Asynchronous server that implements the Minecraft multiplayer protocol.
  *
  * obs_sever is an implementation of the Minecraft multiplayer protocol, internally it uses io_uring to asynchronously
- * process network calls. The server does not keep track of the world at all, but instead forwards processed packets.
+ * process network and disk calls. The server keeps the loaded chunks of the world in memory, and compresses and caches
+ * them for sending to clients. Chunks are streamed to every player nearest-first, paced by a budget of bytes per tick.
  */
 struct obs_server;
 
 
+/*!
+ * Called on the I/O thread when a disk operation completes.
+ * \param server Pointer to the server structure.
+ * \param result Result of the operation: a file descriptor, an amount of bytes or 0 on success, or a negated errno.
+ * \param user_data User data passed along with the operation.
+ */
+typedef void (*obs_disk_callback)(struct obs_server* server, int result, void* user_data);
+
+
 /*!
  * Creates a new server.
  * \param params Pointer to an obs_server_params structure.
@@ -78,6 +255,126 @@ void obs_server_listen(struct obs_server* server, uint16_t port);
  */
 void obs_server_close(struct obs_server* server);
 
+/*!
+ * Gets the metrics of the server.
+ * \param server Pointer to the server structure.
+ * \return Pointer to the metrics, which stay up to date for as long as the server exists.
+ */
+struct obs_server_metrics const* obs_server_get_metrics(struct obs_server const* server);
+
+/*!
+ * Gets the metrics of the compressed chunk cache of the server.
+ * \param server Pointer to the server structure.
+ * \return Pointer to the metrics, which stay up to date for as long as the server exists.
+ */
+struct mc_chunk_cache_metrics const* obs_server_get_chunk_cache_metrics(struct obs_server const* server);
+
+/*!
+ * Queues a chunk to be compressed off the I/O thread.
+ * \param server Pointer to the server structure.
+ * \param job Pointer to the job, which is completed from obs_server_poll().
+ */
+void obs_server_compress_chunk(struct obs_server* server, struct mc_chunk_job* job);
+
+/*!
+ * Sends a chunk to a client if its compressed data is cached.
+ * \param server Pointer to the server structure.
+ * \param session Pointer to the client session.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param modification Current modification counter of the chunk.
+ * \return Whether the chunk was queued to be sent. If not, it was not cached or could not be queued; a chunk that is
+ *         not cached has to be compressed and sent with obs_server_send_chunk().
+ */
+bool obs_server_send_cached_chunk(struct obs_server* server, struct obs_session* session,
+                                  int32_t chunk_x, int32_t chunk_z, uint64_t modification);
+
+/*!
+ * Sends freshly compressed chunk data to a client and caches it for other clients.
+ * \param server Pointer to the server structure.
+ * \param session Pointer to the client session.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param modification Modification counter of the chunk the data was compressed from.
+ * \param compressed Compressed data. The cache and the send take references of their own.
+ * \return Whether the chunk was queued to be sent. It is cached either way.
+ */
+bool obs_server_send_chunk(struct obs_server* server, struct obs_session* session,
+                           int32_t chunk_x, int32_t chunk_z, uint64_t modification,
+                           struct obs_shared_buffer* compressed);
+
+/*!
+ * Loads a chunk from the region files of the world off the I/O thread.
+ * \param server Pointer to the server structure.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \return Whether the world may have the chunk. If so it is added to the loaded chunks from obs_server_poll(), or
+ *         resolved as skipped for every session if its region file turns out not to hold it once it is opened.
+ * \note Loading a chunk that is already being loaded does nothing.
+ */
+bool obs_server_load_chunk(struct obs_server* server, int32_t chunk_x, int32_t chunk_z);
+
+/*!
+ * Opens a file through the I/O ring.
+ * \param server Pointer to the server structure.
+ * \param path Path of the file, which has to stay valid until the operation completes.
+ * \param flags Flags to pass to openat().
+ * \param mode Mode of the file if it is created.
+ * \param callback Called with the file descriptor once the file is open.
+ * \param user_data Passed to the callback.
+ * \note Disk operations beyond the limit of the server wait for earlier ones to complete, so that they never take up
+ *       the I/O ring needed for network operations.
+ */
+void obs_server_disk_open(struct obs_server* server, char const* path, int flags, unsigned mode,
+                          obs_disk_callback callback, void* user_data);
+
+/*!
+ * Reads from a file through the I/O ring.
+ * \param server Pointer to the server structure.
+ * \param fd File descriptor.
+ * \param buffer Buffer to read into, which has to stay valid until the operation completes.
+ * \param size Amount of bytes to read.
+ * \param offset Offset in the file to read at.
+ * \param callback Called with the amount of bytes read, which may be less than requested.
+ * \param user_data Passed to the callback.
+ * \see obs_server_disk_open()
+ */
+void obs_server_disk_read(struct obs_server* server, int fd, void* buffer, size_t size, uint64_t offset,
+                          obs_disk_callback callback, void* user_data);
+
+/*!
+ * Writes to a file through the I/O ring.
+ * \param server Pointer to the server structure.
+ * \param fd File descriptor.
+ * \param buffer Buffer to write, which has to stay valid until the operation completes.
+ * \param size Amount of bytes to write.
+ * \param offset Offset in the file to write at.
+ * \param callback Called with the amount of bytes written, which may be less than requested.
+ * \param user_data Passed to the callback.
+ * \see obs_server_disk_open()
+ */
+void obs_server_disk_write(struct obs_server* server, int fd, void const* buffer, size_t size, uint64_t offset,
+                           obs_disk_callback callback, void* user_data);
+
+/*!
+ * Flushes a file to disk through the I/O ring.
+ * \param server Pointer to the server structure.
+ * \param fd File descriptor.
+ * \param callback Called with 0 once the file is on disk.
+ * \param user_data Passed to the callback.
+ * \see obs_server_disk_open()
+ */
+void obs_server_disk_fsync(struct obs_server* server, int fd, obs_disk_callback callback, void* user_data);
+
+/*!
+ * Reports how long the last tick took, which the server uses to pick how hard to compress chunks.
+ * obs_server_poll() reports the ticks it runs itself.
+ * \param server Pointer to the server structure.
+ * \param tick_time Time the tick took in nanoseconds.
+ * \param tick_budget Time a tick may take in nanoseconds.
+ */
+void obs_server_report_tick(struct obs_server* server, uint64_t tick_time, uint64_t tick_budget);
+
 /*!
  * Polls the server for any new connections or data and processes it.
  * \param server Pointer to the server structure.
@@ -0,0 +1,176 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/bswap.h"
+#include "obsidian/log.h"
+
+#include <endian.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+/*!
+ * One implementation of the conversions.
+ */
+struct obs_bswap_kernels {
+    /// Name of the implementation, for logging.
+    char const* name;
+
+    void (*swap16)(uint8_t* dst, uint8_t const* src, size_t count);
+    void (*swap32)(uint8_t* dst, uint8_t const* src, size_t count);
+    void (*swap64)(uint8_t* dst, uint8_t const* src, size_t count);
+};
+
+
+/*
+ * Scalar implementation. Also used for the elements that do not fill a whole vector.
+ */
+
+static inline void scalar_swap16(uint8_t* dst, uint8_t const* src, size_t const count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint16_t x;
+        memcpy(&x, src + i * sizeof(x), sizeof(x));
+        x = htobe16(x);
+        memcpy(dst + i * sizeof(x), &x, sizeof(x));
+    }
+}
+
+static inline void scalar_swap32(uint8_t* dst, uint8_t const* src, size_t const count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t x;
+        memcpy(&x, src + i * sizeof(x), sizeof(x));
+        x = htobe32(x);
+        memcpy(dst + i * sizeof(x), &x, sizeof(x));
+    }
+}
+
+static inline void scalar_swap64(uint8_t* dst, uint8_t const* src, size_t const count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t x;
+        memcpy(&x, src + i * sizeof(x), sizeof(x));
+        x = htobe64(x);
+        memcpy(dst + i * sizeof(x), &x, sizeof(x));
+    }
+}
+
+static struct obs_bswap_kernels const scalar_kernels = {
+    .name = "scalar",
+    .swap16 = scalar_swap16,
+    .swap32 = scalar_swap32,
+    .swap64 = scalar_swap64,
+};
+
+
+#if defined(__x86_64__) && __BYTE_ORDER == __LITTLE_ENDIAN
+
+/*
+ * Vector implementations. Every vector is reversed per element with a single byte shuffle.
+ */
+
+/// Shuffle reversing the bytes of every 16-bit element of a 128-bit lane.
+#define SHUFFLE16_LANE 14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1
+
+/// Shuffle reversing the bytes of every 32-bit element of a 128-bit lane.
+#define SHUFFLE32_LANE 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3
+
+/// Shuffle reversing the bytes of every 64-bit element of a 128-bit lane.
+#define SHUFFLE64_LANE 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7
+
+#define DEFINE_SSSE3_SWAP(bits) \
+    __attribute__((target("ssse3"))) \
+    static void ssse3_swap##bits(uint8_t* dst, uint8_t const* src, size_t const count) { \
+        __m128i const shuffle = _mm_set_epi8(SHUFFLE##bits##_LANE); \
+        size_t const per_vector = sizeof(__m128i) / sizeof(uint##bits##_t); \
+        size_t i = 0; \
+        for (; i + per_vector <= count; i += per_vector) { \
+            __m128i const v = _mm_loadu_si128((__m128i const*) (src + i * sizeof(uint##bits##_t))); \
+            _mm_storeu_si128((__m128i*) (dst + i * sizeof(uint##bits##_t)), _mm_shuffle_epi8(v, shuffle)); \
+        } \
+        scalar_swap##bits(dst + i * sizeof(uint##bits##_t), src + i * sizeof(uint##bits##_t), count - i); \
+    }
+
+#define DEFINE_AVX2_SWAP(bits) \
+    __attribute__((target("avx2"))) \
+    static void avx2_swap##bits(uint8_t* dst, uint8_t const* src, size_t const count) { \
+        __m256i const shuffle = _mm256_set_epi8(SHUFFLE##bits##_LANE, SHUFFLE##bits##_LANE); \
+        size_t const per_vector = sizeof(__m256i) / sizeof(uint##bits##_t); \
+        size_t i = 0; \
+        for (; i + per_vector <= count; i += per_vector) { \
+            __m256i const v = _mm256_loadu_si256((__m256i const*) (src + i * sizeof(uint##bits##_t))); \
+            _mm256_storeu_si256((__m256i*) (dst + i * sizeof(uint##bits##_t)), _mm256_shuffle_epi8(v, shuffle)); \
+        } \
+        scalar_swap##bits(dst + i * sizeof(uint##bits##_t), src + i * sizeof(uint##bits##_t), count - i); \
+    }
+
+DEFINE_SSSE3_SWAP(16)
+DEFINE_SSSE3_SWAP(32)
+DEFINE_SSSE3_SWAP(64)
+
+DEFINE_AVX2_SWAP(16)
+DEFINE_AVX2_SWAP(32)
+DEFINE_AVX2_SWAP(64)
+
+static struct obs_bswap_kernels const ssse3_kernels = {
+    .name = "SSSE3",
+    .swap16 = ssse3_swap16,
+    .swap32 = ssse3_swap32,
+    .swap64 = ssse3_swap64,
+};
+
+static struct obs_bswap_kernels const avx2_kernels = {
+    .name = "AVX2",
+    .swap16 = avx2_swap16,
+    .swap32 = avx2_swap32,
+    .swap64 = avx2_swap64,
+};
+
+#endif // __x86_64__ && __LITTLE_ENDIAN
+
+
+/// Implementation in use, picked by obs_bswap_init().
+static struct obs_bswap_kernels const* kernels = &scalar_kernels;
+
+
+void obs_bswap_init(void) {
+#if defined(__x86_64__) && __BYTE_ORDER == __LITTLE_ENDIAN
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels = &avx2_kernels;
+    }
+    else if (__builtin_cpu_supports("ssse3")) {
+        kernels = &ssse3_kernels;
+    }
+#endif
+    OBS_LOG_DEBUG("bswap", "Using %s byte swapping", kernels->name);
+}
+
+void obs_bswap16_array(void* dst, void const* src, size_t const count) {
+    kernels->swap16(dst, src, count);
+}
+
+void obs_bswap32_array(void* dst, void const* src, size_t const count) {
+    kernels->swap32(dst, src, count);
+}
+
+void obs_bswap64_array(void* dst, void const* src, size_t const count) {
+    kernels->swap64(dst, src, count);
+}
@@ -0,0 +1,67 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/disk_queue.h"
+
+#include <assert.h>
+
+
+void obs_disk_queue_init(struct obs_disk_queue* queue, size_t const limit, struct obs_server_metrics* metrics) {
+    assert(limit > 0);
+    queue->limit = limit;
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->metrics = metrics;
+}
+
+bool obs_disk_queue_admit(struct obs_disk_queue* queue, struct obs_disk_entry* entry, uint64_t const now) {
+    if (queue->metrics->disk_ops_in_flight >= queue->limit) {
+        entry->next = NULL;
+        if (queue->tail != NULL) {
+            queue->tail->next = entry;
+        }
+        else {
+            queue->head = entry;
+        }
+        queue->tail = entry;
+        ++queue->metrics->disk_ops_deferred;
+        return false;
+    }
+    entry->start_time = now;
+    ++queue->metrics->disk_ops_in_flight;
+    return true;
+}
+
+struct obs_disk_entry* obs_disk_queue_complete(struct obs_disk_queue* queue, struct obs_disk_entry const* entry,
+                                               uint64_t const now) {
+    assert(queue->metrics->disk_ops_in_flight > 0);
+    uint64_t const latency = (now - entry->start_time) / 1000;
+    ++queue->metrics->disk_latency[entry->op][obs_disk_latency_bucket(latency)];
+    struct obs_disk_entry* next = queue->head;
+    if (next == NULL) {
+        --queue->metrics->disk_ops_in_flight;
+        return NULL;
+    }
+    // The waiting operation takes the place of the completed one, so the amount in flight stays the same.
+    queue->head = next->next;
+    if (queue->head == NULL) {
+        queue->tail = NULL;
+    }
+    next->start_time = now;
+    return next;
+}
@@ -16,18 +16,28 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "obsidian/bswap.h"
 #include "obsidian/log.h"
 #include "obsidian/server.h"
+#include "obsidian/minecraft/chunk_stream.h"
+#include "obsidian/minecraft/ucs2.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <time.h>
 
 int main() {
+    obs_bswap_init();
+    mc_ucs2_init();
+    mc_chunk_stream_init();
     struct obs_server* server = obs_server_create(&(struct obs_server_params){
         .queue_depth = 32,
         .max_connections = 1024,
         .frame_pool_size = 2048 * 32,
+        .compression_level = 6,
+        .chunk_cache_size = 64 * 1024 * 1024,
+        .chunk_cache_entries = 8192,
+        .loaded_chunks = 4096,
     });
     obs_server_listen(server, 25565);
     OBS_LOG_INFO("server", "Listening on port %d", 25565);
@@ -0,0 +1,43 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/memory.h"
+
+#include <stdlib.h>
+
+struct obs_shared_buffer* obs_shared_buffer_create(size_t const size) {
+    struct obs_shared_buffer* buffer = malloc(sizeof(struct obs_shared_buffer) + size);
+    if (buffer == NULL) {
+        return NULL;
+    }
+    atomic_init(&buffer->references, 1);
+    buffer->size = size;
+    return buffer;
+}
+
+struct obs_shared_buffer* obs_shared_buffer_retain(struct obs_shared_buffer* buffer) {
+    atomic_fetch_add_explicit(&buffer->references, 1, memory_order_relaxed);
+    return buffer;
+}
+
+void obs_shared_buffer_release(struct obs_shared_buffer* buffer) {
+    // The last owner must see every write the others made before it frees the buffer.
+    if (atomic_fetch_sub_explicit(&buffer->references, 1, memory_order_acq_rel) == 1) {
+        free(buffer);
+    }
+}
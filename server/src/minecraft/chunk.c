@@ -0,0 +1,110 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/chunk.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*!
+ * Changes a nibble in one of the nibble-packed parts of the chunk data.
+ */
+static inline void set_nibble(struct mc_chunk* chunk, size_t const offset, size_t const index, uint8_t const value) {
+    uint8_t* packed = &chunk->data[offset + index / 2];
+    if (index & 1) {
+        *packed = (*packed & 0x0F) | (uint8_t) (value << 4);
+    }
+    else {
+        *packed = (*packed & 0xF0) | (value & 0x0F);
+    }
+}
+
+/*!
+ * Computes the height of a column by scanning it from the top.
+ */
+static uint8_t column_height(struct mc_chunk const* chunk, unsigned const x, unsigned const z) {
+    // A column is contiguous in the block types, so this scans at most 128 consecutive bytes.
+    uint8_t const* column = &chunk->data[MC_CHUNK_BLOCKS_OFFSET + mc_chunk_index(x, 0, z)];
+    unsigned y = MC_CHUNK_HEIGHT;
+    while (y > 0 && column[y - 1] == 0) {
+        --y;
+    }
+    return (uint8_t) y;
+}
+
+struct mc_chunk* mc_chunk_create(int32_t const x, int32_t const z) {
+    struct mc_chunk* chunk = aligned_alloc(_Alignof(struct mc_chunk), sizeof(struct mc_chunk));
+    if (chunk == NULL) {
+        return NULL;
+    }
+    memset(chunk->data, 0, MC_CHUNK_SKY_LIGHT_OFFSET);
+    memset(chunk->data + MC_CHUNK_SKY_LIGHT_OFFSET, 0xFF, MC_CHUNK_DATA_SIZE - MC_CHUNK_SKY_LIGHT_OFFSET);
+    memset(chunk->heightmap, 0, sizeof(chunk->heightmap));
+    chunk->x = x;
+    chunk->z = z;
+    chunk->modification = 0;
+    return chunk;
+}
+
+void mc_chunk_destroy(struct mc_chunk* chunk) {
+    free(chunk);
+}
+
+void mc_chunk_set_block(struct mc_chunk* chunk, unsigned const x, unsigned const y, unsigned const z,
+                        mc_byte const type, uint8_t const metadata) {
+    assert(x < MC_CHUNK_WIDTH && y < MC_CHUNK_HEIGHT && z < MC_CHUNK_DEPTH);
+    size_t const index = mc_chunk_index(x, y, z);
+    chunk->data[MC_CHUNK_BLOCKS_OFFSET + index] = (uint8_t) type;
+    set_nibble(chunk, MC_CHUNK_METADATA_OFFSET, index, metadata);
+    uint8_t* height = &chunk->heightmap[x + z * MC_CHUNK_WIDTH];
+    if (type != 0 && y >= *height) {
+        *height = (uint8_t) (y + 1);
+    }
+    else if (type == 0 && y + 1 == *height) {
+        *height = column_height(chunk, x, z);
+    }
+    ++chunk->modification;
+}
+
+void mc_chunk_set_light(struct mc_chunk* chunk, unsigned const x, unsigned const y, unsigned const z,
+                        uint8_t const block_light, uint8_t const sky_light) {
+    assert(x < MC_CHUNK_WIDTH && y < MC_CHUNK_HEIGHT && z < MC_CHUNK_DEPTH);
+    size_t const index = mc_chunk_index(x, y, z);
+    set_nibble(chunk, MC_CHUNK_BLOCK_LIGHT_OFFSET, index, block_light);
+    set_nibble(chunk, MC_CHUNK_SKY_LIGHT_OFFSET, index, sky_light);
+    ++chunk->modification;
+}
+
+void mc_chunk_update(struct mc_chunk* chunk) {
+    for (unsigned z = 0; z < MC_CHUNK_DEPTH; ++z) {
+        for (unsigned x = 0; x < MC_CHUNK_WIDTH; ++x) {
+            chunk->heightmap[x + z * MC_CHUNK_WIDTH] = column_height(chunk, x, z);
+        }
+    }
+    ++chunk->modification;
+}
+
+struct obs_shared_buffer* mc_chunk_snapshot(struct mc_chunk const* chunk) {
+    struct obs_shared_buffer* snapshot = obs_shared_buffer_create(MC_CHUNK_DATA_SIZE);
+    if (snapshot != NULL) {
+        memcpy(snapshot->data, chunk->data, MC_CHUNK_DATA_SIZE);
+    }
+    return snapshot;
+}
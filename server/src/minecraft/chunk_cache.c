@@ -0,0 +1,272 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/chunk_cache.h"
+#include "obsidian/log.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+
+/// Marks an empty slot of the index.
+#define EMPTY_SLOT UINT32_MAX
+
+
+/*!
+ * A cached chunk.
+ */
+struct mc_chunk_cache_entry {
+    /// X coordinate of the chunk.
+    int32_t chunk_x;
+
+    /// Z coordinate of the chunk.
+    int32_t chunk_z;
+
+    /// Protocol version the data is sent with.
+    mc_dword protocol_version;
+
+    /// Whether the entry was hit since the clock hand last passed it.
+    bool referenced;
+
+    /// Modification counter of the chunk the data was compressed from.
+    uint64_t modification;
+
+    /// Compressed data, or NULL if the entry is unused.
+    struct obs_shared_buffer* data;
+};
+
+struct mc_chunk_cache {
+    /// Maximum amount of memory used by cached data in bytes.
+    size_t memory_budget;
+
+    /// Cached chunks. The clock hand goes round this array.
+    struct mc_chunk_cache_entry* entries;
+
+    /// Size of the entry array.
+    size_t max_entries;
+
+    /// Unused entries, as a stack of indices into the entry array.
+    uint32_t* free_entries;
+
+    /// Amount of unused entries.
+    size_t free_count;
+
+    /// Index of the entry the clock hand points at.
+    size_t hand;
+
+    /// Hash table from key to entry index with linear probing. Empty slots hold EMPTY_SLOT.
+    uint32_t* index;
+
+    /// Size of the hash table minus one, the size is a power of two.
+    size_t index_mask;
+
+    /// Counters exposed through mc_chunk_cache_get_metrics().
+    struct mc_chunk_cache_metrics metrics;
+};
+
+
+/*!
+ * Hashes a key into a hash table slot.
+ */
+static size_t hash_key(struct mc_chunk_cache const* cache, int32_t const chunk_x, int32_t const chunk_z,
+                       mc_dword const protocol_version) {
+    uint64_t h = ((uint64_t) (uint32_t) chunk_x << 32 | (uint32_t) chunk_z) ^ (uint64_t) protocol_version << 17;
+    // Finalizer of MurmurHash3, spreads neighbouring chunks over the whole table.
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h & cache->index_mask;
+}
+
+/*!
+ * Finds the hash table slot of a key.
+ * \return The slot holding the entry with the key, or the empty slot where it would go.
+ */
+static size_t find_slot(struct mc_chunk_cache const* cache, int32_t const chunk_x, int32_t const chunk_z,
+                        mc_dword const protocol_version) {
+    size_t slot = hash_key(cache, chunk_x, chunk_z, protocol_version);
+    while (cache->index[slot] != EMPTY_SLOT) {
+        struct mc_chunk_cache_entry const* entry = &cache->entries[cache->index[slot]];
+        if (entry->chunk_x == chunk_x && entry->chunk_z == chunk_z && entry->protocol_version == protocol_version) {
+            break;
+        }
+        slot = (slot + 1) & cache->index_mask;
+    }
+    return slot;
+}
+
+/*!
+ * Removes the entry in a hash table slot from the cache.
+ */
+static void remove_slot(struct mc_chunk_cache* cache, size_t slot) {
+    uint32_t const entry_index = cache->index[slot];
+    struct mc_chunk_cache_entry* entry = &cache->entries[entry_index];
+    cache->metrics.memory_used -= entry->data->size;
+    --cache->metrics.entries;
+    obs_shared_buffer_release(entry->data);
+    entry->data = NULL;
+    cache->free_entries[cache->free_count++] = entry_index;
+
+    // Shift later entries of the probe sequence back, so lookups do not need tombstones.
+    size_t next = slot;
+    while (true) {
+        next = (next + 1) & cache->index_mask;
+        if (cache->index[next] == EMPTY_SLOT) {
+            break;
+        }
+        struct mc_chunk_cache_entry const* moved = &cache->entries[cache->index[next]];
+        size_t const home = hash_key(cache, moved->chunk_x, moved->chunk_z, moved->protocol_version);
+        // Only move entries whose home slot is not between the hole and their current slot.
+        if (((next - home) & cache->index_mask) >= ((next - slot) & cache->index_mask)) {
+            cache->index[slot] = cache->index[next];
+            slot = next;
+        }
+    }
+    cache->index[slot] = EMPTY_SLOT;
+}
+
+/*!
+ * Evicts the first unreferenced entry from the clock hand onwards.
+ */
+static void evict_one(struct mc_chunk_cache* cache) {
+    assert(cache->metrics.entries > 0);
+    while (true) {
+        struct mc_chunk_cache_entry* entry = &cache->entries[cache->hand];
+        cache->hand = (cache->hand + 1) % cache->max_entries;
+        if (entry->data == NULL) {
+            continue;
+        }
+        if (entry->referenced) {
+            entry->referenced = false;
+            continue;
+        }
+        remove_slot(cache, find_slot(cache, entry->chunk_x, entry->chunk_z, entry->protocol_version));
+        ++cache->metrics.evictions;
+        return;
+    }
+}
+
+struct mc_chunk_cache* mc_chunk_cache_create(struct mc_chunk_cache_params const* params) {
+    assert(params->max_entries > 0 && params->max_entries < EMPTY_SLOT);
+    OBS_LOG_TRACE("chunk_cache", "Creating chunk cache of %llu entries within %llu KB",
+                  params->max_entries, params->memory_budget / 1024);
+    struct mc_chunk_cache* cache = calloc(1, sizeof(struct mc_chunk_cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    // Keep the table at most half full so probe sequences stay short.
+    size_t index_size = 1;
+    while (index_size < 2 * params->max_entries) {
+        index_size <<= 1;
+    }
+    cache->memory_budget = params->memory_budget;
+    cache->max_entries = params->max_entries;
+    cache->index_mask = index_size - 1;
+    cache->entries = calloc(params->max_entries, sizeof(struct mc_chunk_cache_entry));
+    cache->free_entries = malloc(params->max_entries * sizeof(uint32_t));
+    cache->index = malloc(index_size * sizeof(uint32_t));
+    if (cache->entries == NULL || cache->free_entries == NULL || cache->index == NULL) {
+        mc_chunk_cache_destroy(cache);
+        return NULL;
+    }
+    for (size_t i = 0; i < params->max_entries; ++i) {
+        cache->free_entries[i] = params->max_entries - 1 - i;
+    }
+    cache->free_count = params->max_entries;
+    for (size_t i = 0; i < index_size; ++i) {
+        cache->index[i] = EMPTY_SLOT;
+    }
+    return cache;
+}
+
+void mc_chunk_cache_destroy(struct mc_chunk_cache* cache) {
+    if (cache->entries != NULL) {
+        for (size_t i = 0; i < cache->max_entries; ++i) {
+            if (cache->entries[i].data != NULL) {
+                obs_shared_buffer_release(cache->entries[i].data);
+            }
+        }
+    }
+    free(cache->index);
+    free(cache->free_entries);
+    free(cache->entries);
+    free(cache);
+}
+
+struct obs_shared_buffer* mc_chunk_cache_get(struct mc_chunk_cache* cache, int32_t const chunk_x,
+                                             int32_t const chunk_z, mc_dword const protocol_version,
+                                             uint64_t const modification) {
+    size_t const slot = find_slot(cache, chunk_x, chunk_z, protocol_version);
+    if (cache->index[slot] == EMPTY_SLOT) {
+        ++cache->metrics.misses;
+        return NULL;
+    }
+    struct mc_chunk_cache_entry* entry = &cache->entries[cache->index[slot]];
+    if (entry->modification != modification) {
+        // Lazy invalidation, the chunk was changed after it was compressed.
+        remove_slot(cache, slot);
+        ++cache->metrics.invalidations;
+        ++cache->metrics.misses;
+        return NULL;
+    }
+    ++cache->metrics.hits;
+    entry->referenced = true;
+    return obs_shared_buffer_retain(entry->data);
+}
+
+void mc_chunk_cache_put(struct mc_chunk_cache* cache, int32_t const chunk_x, int32_t const chunk_z,
+                        mc_dword const protocol_version, uint64_t const modification,
+                        struct obs_shared_buffer* data) {
+    assert(data != NULL);
+    if (data->size > cache->memory_budget) {
+        return;
+    }
+    size_t const existing = find_slot(cache, chunk_x, chunk_z, protocol_version);
+    if (cache->index[existing] != EMPTY_SLOT) {
+        struct mc_chunk_cache_entry const* entry = &cache->entries[cache->index[existing]];
+        if (entry->modification > modification) {
+            // A compression of an older version of the chunk finished late.
+            return;
+        }
+        remove_slot(cache, existing);
+    }
+    while (cache->free_count == 0 || cache->metrics.memory_used + data->size > cache->memory_budget) {
+        evict_one(cache);
+    }
+    // Removals shift entries around, so only look for the free slot once they are done.
+    size_t const slot = find_slot(cache, chunk_x, chunk_z, protocol_version);
+    uint32_t const entry_index = cache->free_entries[--cache->free_count];
+    cache->entries[entry_index] = (struct mc_chunk_cache_entry) {
+        .chunk_x = chunk_x,
+        .chunk_z = chunk_z,
+        .protocol_version = protocol_version,
+        .referenced = false,
+        .modification = modification,
+        .data = obs_shared_buffer_retain(data),
+    };
+    cache->index[slot] = entry_index;
+    ++cache->metrics.entries;
+    cache->metrics.memory_used += data->size;
+}
+
+struct mc_chunk_cache_metrics const* mc_chunk_cache_get_metrics(struct mc_chunk_cache const* cache) {
+    return &cache->metrics;
+}
@@ -0,0 +1,385 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/chunk_compressor.h"
+#include "obsidian/log.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+
+/// Tick headroom below which the CPU is under pressure.
+#define LOW_TICK_HEADROOM 0.2
+
+/// Tick headroom above which there is CPU to spare for better compression.
+#define HIGH_TICK_HEADROOM 0.5
+
+/// Queue depth per worker above which the workers are falling behind.
+#define HIGH_QUEUE_DEPTH 4.0
+
+/// Queue depth per worker below which the workers have time to spare.
+#define LOW_QUEUE_DEPTH 1.0
+
+/// Outbound backlog of a session in bytes above which the network is under pressure.
+#define HIGH_OUTBOUND_BACKLOG (256 * 1024)
+
+
+/*!
+ * A worker thread and the zlib state it keeps between jobs.
+ */
+struct mc_chunk_worker {
+    /// Compressor the worker belongs to.
+    struct mc_chunk_compressor* compressor;
+
+    /// The thread.
+    pthread_t thread;
+
+    /// Deflate stream, reset for every job instead of being set up again.
+    z_stream stream;
+
+    /// Level the stream is set to.
+    int level;
+
+    /// Buffer the worker compresses into before the result is copied into a buffer of the exact size.
+    uint8_t* scratch;
+
+    /// Size of the scratch buffer in bytes.
+    size_t scratch_size;
+
+    /// Inflate stream for loading chunks, set up by the first load job.
+    z_stream inflater;
+
+    /// Whether the inflate stream has been set up.
+    bool has_inflater;
+
+    /// Buffer chunks are inflated into when they are loaded.
+    uint8_t* nbt;
+
+    /// Size of the NBT buffer in bytes.
+    size_t nbt_size;
+};
+
+struct mc_chunk_compressor {
+    /// Protects the job queue and the stop flag.
+    pthread_mutex_t lock;
+
+    /// Signalled when a job is queued or the workers should stop.
+    pthread_cond_t available;
+
+    /// Oldest submitted job that no worker has taken yet.
+    struct mc_chunk_job* queue_head;
+
+    /// Newest submitted job that no worker has taken yet.
+    struct mc_chunk_job* queue_tail;
+
+    /// Whether the workers should stop.
+    bool stop;
+
+    /// Finished jobs, newest first. Workers push with a compare-and-swap, the owning thread takes the whole list.
+    _Atomic(struct mc_chunk_job*) completed;
+
+    /// Compression level for new jobs.
+    atomic_int level;
+
+    /// Jobs submitted and not yet completed. Only used by the owning thread.
+    size_t pending;
+
+    /// Amount of workers.
+    unsigned worker_count;
+
+    /// The workers.
+    struct mc_chunk_worker workers[];
+};
+
+
+int mc_chunk_level_update(struct mc_chunk_level_controller* controller, struct mc_chunk_level_signals const* signals) {
+    bool const cpu_pressure = signals->tick_headroom < LOW_TICK_HEADROOM || signals->queue_depth > HIGH_QUEUE_DEPTH;
+    bool const cpu_spare = signals->tick_headroom > HIGH_TICK_HEADROOM && signals->queue_depth < LOW_QUEUE_DEPTH;
+    int target = controller->idle_level;
+    if (cpu_pressure) {
+        // Falling behind on ticks or chunks hurts every player, spend fewer cycles even if more bytes go out.
+        target = controller->min_level;
+    }
+    else if (signals->outbound_backlog > HIGH_OUTBOUND_BACKLOG) {
+        // Only trade CPU for bandwidth when there is CPU to trade, otherwise hold the current level.
+        target = cpu_spare ? controller->max_level : controller->level;
+    }
+    if (target > controller->level) {
+        ++controller->level;
+    }
+    else if (target < controller->level) {
+        --controller->level;
+    }
+    return controller->level;
+}
+
+/*!
+ * Pushes a finished job onto the completion queue.
+ */
+static void push_completed(struct mc_chunk_compressor* compressor, struct mc_chunk_job* job) {
+    struct mc_chunk_job* head = atomic_load_explicit(&compressor->completed, memory_order_relaxed);
+    do {
+        job->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&compressor->completed, &head, job,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+/*!
+ * Compresses the snapshot of a job.
+ * \return The compressed data, or NULL upon error.
+ */
+static struct obs_shared_buffer* compress_snapshot(struct mc_chunk_worker* worker,
+                                                   struct obs_shared_buffer const* snapshot) {
+    int const level = atomic_load_explicit(&worker->compressor->level, memory_order_relaxed);
+    if (deflateReset(&worker->stream) != Z_OK) {
+        return NULL;
+    }
+    if (level != worker->level) {
+        // The stream was just reset, so there is nothing to flush and the new level applies to the whole job.
+        if (deflateParams(&worker->stream, level, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return NULL;
+        }
+        worker->level = level;
+    }
+    size_t const bound = deflateBound(&worker->stream, snapshot->size);
+    if (bound > worker->scratch_size) {
+        uint8_t* scratch = realloc(worker->scratch, bound);
+        if (scratch == NULL) {
+            return NULL;
+        }
+        worker->scratch = scratch;
+        worker->scratch_size = bound;
+    }
+    worker->stream.next_in = (Bytef*) snapshot->data;
+    worker->stream.avail_in = snapshot->size;
+    worker->stream.next_out = worker->scratch;
+    worker->stream.avail_out = worker->scratch_size;
+    if (deflate(&worker->stream, Z_FINISH) != Z_STREAM_END) {
+        return NULL;
+    }
+    // Copy out to a buffer of the exact size, compressed chunks can be kept around for a long time.
+    struct obs_shared_buffer* compressed = obs_shared_buffer_create(worker->stream.total_out);
+    if (compressed != NULL) {
+        memcpy(compressed->data, worker->scratch, worker->stream.total_out);
+    }
+    return compressed;
+}
+
+/*!
+ * Loads the chunk of a job from its region.
+ * \return The chunk, or NULL if it could not be loaded.
+ */
+static struct mc_chunk* load_chunk(struct mc_chunk_worker* worker, struct mc_chunk_job const* job) {
+    if (!worker->has_inflater) {
+        worker->inflater = (z_stream) {0};
+        if (inflateInit2(&worker->inflater, 15 + 32) != Z_OK) {
+            return NULL;
+        }
+        worker->has_inflater = true;
+    }
+    return mc_region_load_chunk(job->region, job->chunk_x, job->chunk_z,
+                                &worker->inflater, &worker->nbt, &worker->nbt_size);
+}
+
+/*!
+ * Main function of a worker thread.
+ */
+static void* run_worker(void* arg) {
+    struct mc_chunk_worker* worker = arg;
+    struct mc_chunk_compressor* compressor = worker->compressor;
+    while (true) {
+        pthread_mutex_lock(&compressor->lock);
+        while (compressor->queue_head == NULL && !compressor->stop) {
+            pthread_cond_wait(&compressor->available, &compressor->lock);
+        }
+        if (compressor->stop) {
+            pthread_mutex_unlock(&compressor->lock);
+            return NULL;
+        }
+        struct mc_chunk_job* job = compressor->queue_head;
+        compressor->queue_head = job->next;
+        if (compressor->queue_head == NULL) {
+            compressor->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&compressor->lock);
+
+        if (job->type == MC_CHUNK_JOB_LOAD) {
+            job->chunk = load_chunk(worker, job);
+        }
+        else {
+            job->compressed = compress_snapshot(worker, job->snapshot);
+            if (job->compressed == NULL) {
+                OBS_LOG_ERROR("compressor", "Failed to compress chunk at %d, %d, %d",
+                              job->packet.x, job->packet.y, job->packet.z);
+            }
+        }
+        push_completed(compressor, job);
+    }
+}
+
+/*!
+ * Stops the first count worker threads.
+ */
+static void stop_workers(struct mc_chunk_compressor* compressor, unsigned const count) {
+    pthread_mutex_lock(&compressor->lock);
+    compressor->stop = true;
+    pthread_cond_broadcast(&compressor->available);
+    pthread_mutex_unlock(&compressor->lock);
+    for (unsigned i = 0; i < count; ++i) {
+        pthread_join(compressor->workers[i].thread, NULL);
+    }
+}
+
+/*!
+ * Releases the zlib state of the first count workers.
+ */
+static void destroy_workers(struct mc_chunk_compressor* compressor, unsigned const count) {
+    for (unsigned i = 0; i < count; ++i) {
+        deflateEnd(&compressor->workers[i].stream);
+        free(compressor->workers[i].scratch);
+        if (compressor->workers[i].has_inflater) {
+            inflateEnd(&compressor->workers[i].inflater);
+        }
+        free(compressor->workers[i].nbt);
+    }
+}
+
+struct mc_chunk_compressor* mc_chunk_compressor_create(struct mc_chunk_compressor_params const* params) {
+    unsigned worker_count = params->worker_count;
+    if (worker_count == 0) {
+        // Leave a processor for the I/O thread.
+        long const processors = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = processors > 1 ? (unsigned) processors - 1 : 1;
+    }
+    OBS_LOG_TRACE("compressor", "Creating chunk compressor with %u workers at level %d", worker_count, params->level);
+    struct mc_chunk_compressor* compressor = calloc(1, sizeof(struct mc_chunk_compressor) +
+                                                      worker_count * sizeof(struct mc_chunk_worker));
+    if (compressor == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&compressor->lock, NULL);
+    pthread_cond_init(&compressor->available, NULL);
+    atomic_init(&compressor->completed, NULL);
+    atomic_init(&compressor->level, params->level);
+    for (unsigned i = 0; i < worker_count; ++i) {
+        struct mc_chunk_worker* worker = &compressor->workers[i];
+        worker->compressor = compressor;
+        worker->level = params->level;
+        if (deflateInit(&worker->stream, params->level) != Z_OK) {
+            OBS_LOG_ERROR("compressor", "Failed to initialize zlib");
+            destroy_workers(compressor, i);
+            free(compressor);
+            return NULL;
+        }
+    }
+    for (unsigned i = 0; i < worker_count; ++i) {
+        int const result = pthread_create(&compressor->workers[i].thread, NULL, run_worker, &compressor->workers[i]);
+        if (result != 0) {
+            OBS_LOG_ERROR("compressor", "Failed to start worker thread: %s", strerror(result));
+            stop_workers(compressor, i);
+            destroy_workers(compressor, worker_count);
+            pthread_cond_destroy(&compressor->available);
+            pthread_mutex_destroy(&compressor->lock);
+            free(compressor);
+            return NULL;
+        }
+    }
+    compressor->worker_count = worker_count;
+    return compressor;
+}
+
+void mc_chunk_compressor_destroy(struct mc_chunk_compressor* compressor) {
+    stop_workers(compressor, compressor->worker_count);
+    // Nothing is running anymore, fail whatever was left so the submitters get their jobs back.
+    while (compressor->queue_head != NULL) {
+        struct mc_chunk_job* job = compressor->queue_head;
+        compressor->queue_head = job->next;
+        job->compressed = NULL;
+        push_completed(compressor, job);
+    }
+    mc_chunk_compressor_poll(compressor);
+    destroy_workers(compressor, compressor->worker_count);
+    pthread_cond_destroy(&compressor->available);
+    pthread_mutex_destroy(&compressor->lock);
+    free(compressor);
+}
+
+void mc_chunk_compressor_set_level(struct mc_chunk_compressor* compressor, int const level) {
+    assert(level >= Z_DEFAULT_COMPRESSION && level <= Z_BEST_COMPRESSION);
+    atomic_store_explicit(&compressor->level, level, memory_order_relaxed);
+}
+
+size_t mc_chunk_compressor_pending(struct mc_chunk_compressor const* compressor) {
+    return compressor->pending;
+}
+
+unsigned mc_chunk_compressor_worker_count(struct mc_chunk_compressor const* compressor) {
+    return compressor->worker_count;
+}
+
+void mc_chunk_compressor_submit(struct mc_chunk_compressor* compressor, struct mc_chunk_job* job) {
+    assert(job != NULL);
+    assert(job->type == MC_CHUNK_JOB_LOAD ? job->region != NULL : job->snapshot != NULL);
+    job->next = NULL;
+    job->compressed = NULL;
+    job->chunk = NULL;
+    ++compressor->pending;
+    pthread_mutex_lock(&compressor->lock);
+    if (compressor->queue_tail == NULL) {
+        compressor->queue_head = job;
+    }
+    else {
+        compressor->queue_tail->next = job;
+    }
+    compressor->queue_tail = job;
+    pthread_cond_signal(&compressor->available);
+    pthread_mutex_unlock(&compressor->lock);
+}
+
+size_t mc_chunk_compressor_poll(struct mc_chunk_compressor* compressor) {
+    if (atomic_load_explicit(&compressor->completed, memory_order_relaxed) == NULL) {
+        return 0;
+    }
+    struct mc_chunk_job* job = atomic_exchange_explicit(&compressor->completed, NULL, memory_order_acquire);
+    // The list is newest first, reverse it to complete jobs in the order they finished in.
+    struct mc_chunk_job* ordered = NULL;
+    while (job != NULL) {
+        struct mc_chunk_job* next = job->next;
+        job->next = ordered;
+        ordered = job;
+        job = next;
+    }
+    size_t count = 0;
+    while (ordered != NULL) {
+        job = ordered;
+        ordered = job->next;
+        job->next = NULL;
+        if (job->type == MC_CHUNK_JOB_COMPRESS) {
+            job->packet.compressed_size = job->compressed != NULL ? job->compressed->size : 0;
+            job->packet.data = job->compressed != NULL ? (mc_byte const*) job->compressed->data : NULL;
+        }
+        --compressor->pending;
+        job->complete(job);
+        ++count;
+    }
+    return count;
+}
@@ -0,0 +1,347 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/chunk_map.h"
+#include "obsidian/log.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/// Amount of slots matched at once.
+#define GROUP_SIZE 16
+
+/// Control byte of a slot that was never used. Ends a probe sequence.
+#define CONTROL_EMPTY 0x80
+
+/// Control byte of a slot whose chunk was removed. Does not end a probe sequence.
+#define CONTROL_DELETED 0xFE
+
+
+/*!
+ * One generation of the slots of a map.
+ */
+struct mc_chunk_table {
+    /// Next older table that was retired, owned by the map.
+    struct mc_chunk_table* retired;
+
+    /// Amount of groups minus one, the amount is a power of two.
+    size_t group_mask;
+
+    /// Amount of slots that are not empty, including deleted ones.
+    size_t used;
+
+    /// Control byte of every slot, aligned for vector loads. Written by the owner with release stores.
+    uint8_t* control;
+
+    /// Key of every slot. Deleted slots keep their key until they are reused.
+    _Atomic uint64_t* keys;
+
+    /// Chunk of every slot, NULL for deleted slots.
+    _Atomic(struct mc_chunk*)* values;
+};
+
+struct mc_chunk_map {
+    /// Current table, swapped out when the map grows.
+    _Atomic(struct mc_chunk_table*) table;
+
+    /// Amount of chunks in the map.
+    size_t count;
+};
+
+
+/*!
+ * Hashes a key. The low 7 bits go into the control byte, the rest picks the first group to probe.
+ */
+static inline uint64_t hash_key(uint64_t h) {
+    // Finalizer of MurmurHash3, neighbouring chunks differ in only a few bits.
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/*!
+ * Matches the control bytes of a group against a value.
+ * \return Bit mask with a bit set for every slot of the group whose control byte is the value.
+ */
+static inline uint32_t match_group(uint8_t const* control, uint8_t const value) {
+#if defined(__SSE2__)
+    // The owner may be changing control bytes during the load; a stale byte only costs a wasted or missed probe of a
+    // slot that is changing anyway, and the key and chunk are read atomically afterwards.
+    __m128i const group = _mm_load_si128((__m128i const*) control);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) value)));
+#else
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < GROUP_SIZE; ++i) {
+        if (__atomic_load_n(&control[i], __ATOMIC_RELAXED) == value) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/*!
+ * Allocates a table with every slot empty.
+ * \param group_count Amount of groups, a power of two.
+ */
+static struct mc_chunk_table* create_table(size_t const group_count) {
+    size_t const slots = group_count * GROUP_SIZE;
+    struct mc_chunk_table* table = malloc(sizeof(struct mc_chunk_table));
+    if (table == NULL) {
+        return NULL;
+    }
+    table->retired = NULL;
+    table->group_mask = group_count - 1;
+    table->used = 0;
+    table->control = aligned_alloc(GROUP_SIZE, slots);
+    table->keys = malloc(slots * sizeof(uint64_t));
+    table->values = malloc(slots * sizeof(struct mc_chunk*));
+    if (table->control == NULL || table->keys == NULL || table->values == NULL) {
+        free(table->values);
+        free(table->keys);
+        free(table->control);
+        free(table);
+        return NULL;
+    }
+    memset(table->control, CONTROL_EMPTY, slots);
+    for (size_t i = 0; i < slots; ++i) {
+        atomic_init(&table->keys[i], 0);
+        atomic_init(&table->values[i], NULL);
+    }
+    return table;
+}
+
+static void destroy_table(struct mc_chunk_table* table) {
+    free(table->values);
+    free(table->keys);
+    free(table->control);
+    free(table);
+}
+
+/*!
+ * Finds the slot of a key, or the slot where it should go. Owner only.
+ * \param[out] found Whether the key is in the returned slot.
+ * \return Index of the slot, or SIZE_MAX if the key is not in the table and there is no room for it.
+ */
+static size_t find_slot(struct mc_chunk_table const* table, uint64_t const key, bool* found) {
+    uint64_t const hash = hash_key(key);
+    uint8_t const tag = hash & 0x7F;
+    size_t group = (hash >> 7) & table->group_mask;
+    size_t free_slot = SIZE_MAX;
+    for (size_t probe = 0; probe <= table->group_mask; ++probe) {
+        uint8_t const* control = &table->control[group * GROUP_SIZE];
+        for (uint32_t bits = match_group(control, tag); bits != 0; bits &= bits - 1) {
+            size_t const slot = group * GROUP_SIZE + __builtin_ctz(bits);
+            if (atomic_load_explicit(&table->keys[slot], memory_order_relaxed) == key) {
+                *found = true;
+                return slot;
+            }
+        }
+        if (free_slot == SIZE_MAX) {
+            uint32_t const deleted = match_group(control, CONTROL_DELETED);
+            if (deleted != 0) {
+                free_slot = group * GROUP_SIZE + __builtin_ctz(deleted);
+            }
+        }
+        uint32_t const empty = match_group(control, CONTROL_EMPTY);
+        if (empty != 0) {
+            *found = false;
+            return free_slot != SIZE_MAX ? free_slot : group * GROUP_SIZE + __builtin_ctz(empty);
+        }
+        group = (group + 1) & table->group_mask;
+    }
+    *found = false;
+    return free_slot;
+}
+
+/*!
+ * Stores a chunk in a free slot. Owner only.
+ */
+static void fill_slot(struct mc_chunk_table* table, size_t const slot, uint64_t const key, struct mc_chunk* chunk) {
+    if (table->control[slot] == CONTROL_EMPTY) {
+        ++table->used;
+    }
+    // A reader that still sees the old key must not pair it with the new chunk. It reads the chunk with acquire and
+    // then checks the key again, which it is then guaranteed to see changed.
+    atomic_store_explicit(&table->keys[slot], key, memory_order_relaxed);
+    atomic_store_explicit(&table->values[slot], chunk, memory_order_release);
+    __atomic_store_n(&table->control[slot], (uint8_t) (hash_key(key) & 0x7F), __ATOMIC_RELEASE);
+}
+
+/*!
+ * Replaces the table with one that has room for more chunks, and no deleted slots. Owner only.
+ * \return Whether the table was replaced.
+ */
+static bool grow(struct mc_chunk_map* map) {
+    struct mc_chunk_table* table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    size_t group_count = table->group_mask + 1;
+    // Only grow if the table is mostly full of chunks, otherwise dropping the deleted slots makes enough room.
+    if (map->count * 2 >= group_count * GROUP_SIZE) {
+        group_count *= 2;
+    }
+    OBS_LOG_TRACE("chunk_map", "Rehashing %llu chunks into %llu slots", map->count, group_count * GROUP_SIZE);
+    struct mc_chunk_table* larger = create_table(group_count);
+    if (larger == NULL) {
+        return false;
+    }
+    size_t const slots = (table->group_mask + 1) * GROUP_SIZE;
+    for (size_t slot = 0; slot < slots; ++slot) {
+        struct mc_chunk* chunk = atomic_load_explicit(&table->values[slot], memory_order_relaxed);
+        if (chunk != NULL) {
+            uint64_t const key = atomic_load_explicit(&table->keys[slot], memory_order_relaxed);
+            bool found;
+            fill_slot(larger, find_slot(larger, key, &found), key, chunk);
+        }
+    }
+    // Readers may still be probing the old table, keep it until mc_chunk_map_reclaim().
+    larger->retired = table;
+    atomic_store_explicit(&map->table, larger, memory_order_release);
+    return true;
+}
+
+struct mc_chunk_map* mc_chunk_map_create(size_t const capacity) {
+    // Keep the table at most 7/8 full.
+    size_t group_count = 1;
+    while (group_count * GROUP_SIZE * 7 / 8 < capacity) {
+        group_count <<= 1;
+    }
+    struct mc_chunk_map* map = malloc(sizeof(struct mc_chunk_map));
+    if (map == NULL) {
+        return NULL;
+    }
+    struct mc_chunk_table* table = create_table(group_count);
+    if (table == NULL) {
+        free(map);
+        return NULL;
+    }
+    atomic_init(&map->table, table);
+    map->count = 0;
+    return map;
+}
+
+void mc_chunk_map_destroy(struct mc_chunk_map* map) {
+    struct mc_chunk_table* table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    while (table != NULL) {
+        struct mc_chunk_table* retired = table->retired;
+        destroy_table(table);
+        table = retired;
+    }
+    free(map);
+}
+
+struct mc_chunk* mc_chunk_map_get(struct mc_chunk_map const* map, uint64_t const key) {
+    struct mc_chunk_table const* table = atomic_load_explicit(&map->table, memory_order_acquire);
+    uint64_t const hash = hash_key(key);
+    uint8_t const tag = hash & 0x7F;
+    size_t group = (hash >> 7) & table->group_mask;
+    for (size_t probe = 0; probe <= table->group_mask; ++probe) {
+        uint8_t const* control = &table->control[group * GROUP_SIZE];
+        for (uint32_t bits = match_group(control, tag); bits != 0; bits &= bits - 1) {
+            size_t const slot = group * GROUP_SIZE + __builtin_ctz(bits);
+            if (atomic_load_explicit(&table->keys[slot], memory_order_acquire) != key) {
+                continue;
+            }
+            struct mc_chunk* chunk = atomic_load_explicit(&table->values[slot], memory_order_acquire);
+            // The slot may have been reused for another chunk between reading the key and the chunk.
+            if (atomic_load_explicit(&table->keys[slot], memory_order_acquire) == key) {
+                return chunk;
+            }
+        }
+        if (match_group(control, CONTROL_EMPTY) != 0) {
+            return NULL;
+        }
+        group = (group + 1) & table->group_mask;
+    }
+    return NULL;
+}
+
+struct mc_chunk* mc_chunk_map_put(struct mc_chunk_map* map, struct mc_chunk* chunk) {
+    assert(chunk != NULL);
+    uint64_t const key = mc_chunk_key(chunk->x, chunk->z);
+    struct mc_chunk_table* table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    bool found;
+    size_t slot = find_slot(table, key, &found);
+    if (found) {
+        struct mc_chunk* replaced = atomic_load_explicit(&table->values[slot], memory_order_relaxed);
+        atomic_store_explicit(&table->values[slot], chunk, memory_order_release);
+        return replaced;
+    }
+    size_t const slots = (table->group_mask + 1) * GROUP_SIZE;
+    if (slot == SIZE_MAX || (table->control[slot] == CONTROL_EMPTY && (table->used + 1) * 8 > slots * 7)) {
+        if (!grow(map)) {
+            OBS_LOG_ERROR("chunk_map", "Out of memory growing the chunk map");
+            return chunk;
+        }
+        table = atomic_load_explicit(&map->table, memory_order_relaxed);
+        slot = find_slot(table, key, &found);
+    }
+    fill_slot(table, slot, key, chunk);
+    ++map->count;
+    return NULL;
+}
+
+struct mc_chunk* mc_chunk_map_remove(struct mc_chunk_map* map, uint64_t const key) {
+    struct mc_chunk_table* table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    bool found;
+    size_t const slot = find_slot(table, key, &found);
+    if (!found) {
+        return NULL;
+    }
+    struct mc_chunk* removed = atomic_load_explicit(&table->values[slot], memory_order_relaxed);
+    atomic_store_explicit(&table->values[slot], NULL, memory_order_release);
+    __atomic_store_n(&table->control[slot], CONTROL_DELETED, __ATOMIC_RELEASE);
+    --map->count;
+    return removed;
+}
+
+struct mc_chunk* mc_chunk_map_next(struct mc_chunk_map const* map, size_t* cursor) {
+    struct mc_chunk_table const* table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    size_t const slots = (table->group_mask + 1) * GROUP_SIZE;
+    while (*cursor < slots) {
+        struct mc_chunk* chunk = atomic_load_explicit(&table->values[(*cursor)++], memory_order_relaxed);
+        if (chunk != NULL) {
+            return chunk;
+        }
+    }
+    return NULL;
+}
+
+size_t mc_chunk_map_size(struct mc_chunk_map const* map) {
+    return map->count;
+}
+
+void mc_chunk_map_reclaim(struct mc_chunk_map* map) {
+    struct mc_chunk_table* table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    struct mc_chunk_table* retired = table->retired;
+    table->retired = NULL;
+    while (retired != NULL) {
+        struct mc_chunk_table* next = retired->retired;
+        destroy_table(retired);
+        retired = next;
+    }
+}
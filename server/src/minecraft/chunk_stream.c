@@ -0,0 +1,357 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/chunk_stream.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/// Width of the square of the largest view.
+#define TABLE_SIDE (2 * MC_CHUNK_STREAM_MAX_RADIUS + 1)
+
+/// Amount of offsets in the square of the largest view.
+#define TABLE_SIZE (TABLE_SIDE * TABLE_SIDE)
+
+/// Largest squared distance of an offset from the center of the largest view.
+#define MAX_DISTANCE (2 * MC_CHUNK_STREAM_MAX_RADIUS * MC_CHUNK_STREAM_MAX_RADIUS)
+
+// Every row of the view grid is a single word.
+static_assert(TABLE_SIDE <= 64, "The view grid does not fit in a word per row");
+
+struct mc_chunk_stream {
+    /// X coordinate of the chunk the player is in.
+    int32_t center_x;
+
+    /// Z coordinate of the chunk the player is in.
+    int32_t center_z;
+
+    /// View radius in chunks.
+    int radius;
+
+    /// Width of the view square.
+    int side;
+
+    /// Position in the offset table before which no chunk is unsent.
+    size_t cursor;
+
+    /// Amount of pending chunks.
+    size_t pending;
+
+    /// Chunks known to the client, a row of the view grid per word.
+    uint64_t sent[TABLE_SIDE];
+
+    /// Chunks handed out and not resolved yet.
+    uint64_t pending_cells[TABLE_SIDE];
+
+    /// Chunks the world does not have.
+    uint64_t skipped[TABLE_SIDE];
+};
+
+
+/*!
+ * An offset from the center of a view.
+ */
+struct offset {
+    int8_t x;
+    int8_t z;
+};
+
+/// Offsets of the largest view, nearest first.
+static struct offset offsets[TABLE_SIZE];
+
+/// Position of every offset in the offsets table, indexed by (x + MAX_RADIUS) + (z + MAX_RADIUS) * TABLE_SIDE.
+static uint16_t ranks[TABLE_SIZE];
+
+/// Position of the first offset in the offsets table at least a squared distance from the center.
+static uint16_t distance_ranks[MAX_DISTANCE + 1];
+
+
+static int compare_offsets(void const* a, void const* b) {
+    struct offset const* lhs = a;
+    struct offset const* rhs = b;
+    int const lhs_distance = lhs->x * lhs->x + lhs->z * lhs->z;
+    int const rhs_distance = rhs->x * rhs->x + rhs->z * rhs->z;
+    if (lhs_distance != rhs_distance) {
+        return lhs_distance - rhs_distance;
+    }
+    // Ties are broken by position so the order does not depend on qsort().
+    return lhs->z != rhs->z ? lhs->z - rhs->z : lhs->x - rhs->x;
+}
+
+void mc_chunk_stream_init(void) {
+    size_t n = 0;
+    for (int z = -MC_CHUNK_STREAM_MAX_RADIUS; z <= MC_CHUNK_STREAM_MAX_RADIUS; ++z) {
+        for (int x = -MC_CHUNK_STREAM_MAX_RADIUS; x <= MC_CHUNK_STREAM_MAX_RADIUS; ++x) {
+            offsets[n++] = (struct offset) {.x = x, .z = z};
+        }
+    }
+    qsort(offsets, TABLE_SIZE, sizeof(struct offset), compare_offsets);
+    for (size_t i = 0; i < TABLE_SIZE; ++i) {
+        int const x = offsets[i].x + MC_CHUNK_STREAM_MAX_RADIUS;
+        int const z = offsets[i].z + MC_CHUNK_STREAM_MAX_RADIUS;
+        ranks[x + z * TABLE_SIDE] = i;
+    }
+    size_t rank = 0;
+    for (int distance = 0; distance <= MAX_DISTANCE; ++distance) {
+        while (offsets[rank].x * offsets[rank].x + offsets[rank].z * offsets[rank].z < distance) {
+            ++rank;
+        }
+        distance_ranks[distance] = rank;
+    }
+}
+
+/*!
+ * Gets the position of an offset in the offsets table.
+ */
+static inline size_t rank_of(int64_t const x, int64_t const z) {
+    return ranks[(x + MC_CHUNK_STREAM_MAX_RADIUS) + (z + MC_CHUNK_STREAM_MAX_RADIUS) * TABLE_SIDE];
+}
+
+/*!
+ * Maps a coordinate to its column or row in a view grid of a width.
+ */
+static inline int wrap(int32_t const coordinate, int const side) {
+    int const cell = coordinate % side;
+    return cell < 0 ? cell + side : cell;
+}
+
+/*!
+ * Builds the mask of the columns of a grid row that hold a run of chunks.
+ * \param first Column of the first chunk.
+ * \param count Amount of chunks, at most the width of the grid.
+ * \param side Width of the grid.
+ */
+static inline uint64_t column_mask(int const first, int const count, int const side) {
+    uint64_t const run = count >= 64 ? ~0ull : (1ull << count) - 1;
+    uint64_t const row = side >= 64 ? ~0ull : (1ull << side) - 1;
+    // The run wraps around to the start of the row when it passes the end.
+    return ((run << first) | (run >> (side - first))) & row;
+}
+
+static inline bool in_view(struct mc_chunk_stream const* stream, int32_t const chunk_x, int32_t const chunk_z) {
+    return llabs((int64_t) chunk_x - stream->center_x) <= stream->radius &&
+           llabs((int64_t) chunk_z - stream->center_z) <= stream->radius;
+}
+
+/*!
+ * Finds the differences of two views along one axis.
+ * \param from Center of the view along the axis.
+ * \param to Center of the other view along the axis.
+ * \param min Receives the first chunk of the view that is not in the other.
+ * \param max Receives the last chunk of the view that is not in the other.
+ * \return Whether there is any.
+ */
+static bool axis_difference(int64_t const from, int64_t const to, int64_t const radius, int64_t* min, int64_t* max) {
+    if (to > from) {
+        *min = from - radius;
+        *max = (to - radius - 1 < from + radius ? to - radius - 1 : from + radius);
+    }
+    else if (to < from) {
+        *min = (to + radius + 1 > from - radius ? to + radius + 1 : from - radius);
+        *max = from + radius;
+    }
+    return to != from;
+}
+
+size_t mc_chunk_view_difference(int32_t const from_x, int32_t const from_z, int32_t const to_x, int32_t const to_z,
+                                unsigned const radius, struct mc_chunk_rect rects[2]) {
+    int64_t const r = radius;
+    size_t count = 0;
+    int64_t min;
+    int64_t max;
+    // A strip of whole columns, then the part of the remaining columns in rows the other view does not have.
+    if (axis_difference(from_x, to_x, r, &min, &max)) {
+        rects[count++] = (struct mc_chunk_rect) {
+            .min_x = (int32_t) min,
+            .min_z = (int32_t) (from_z - r),
+            .max_x = (int32_t) max,
+            .max_z = (int32_t) (from_z + r),
+        };
+    }
+    int64_t const shared_min_x = (from_x > to_x ? from_x : to_x) - r;
+    int64_t const shared_max_x = (from_x < to_x ? from_x : to_x) + r;
+    if (shared_min_x <= shared_max_x && axis_difference(from_z, to_z, r, &min, &max)) {
+        rects[count++] = (struct mc_chunk_rect) {
+            .min_x = (int32_t) shared_min_x,
+            .min_z = (int32_t) min,
+            .max_x = (int32_t) shared_max_x,
+            .max_z = (int32_t) max,
+        };
+    }
+    return count;
+}
+
+struct mc_chunk_stream* mc_chunk_stream_create(unsigned const radius, int32_t const chunk_x, int32_t const chunk_z) {
+    assert(radius <= MC_CHUNK_STREAM_MAX_RADIUS);
+    struct mc_chunk_stream* stream = calloc(1, sizeof(struct mc_chunk_stream));
+    if (stream == NULL) {
+        return NULL;
+    }
+    stream->center_x = chunk_x;
+    stream->center_z = chunk_z;
+    stream->radius = (int) radius;
+    stream->side = (int) (2 * radius + 1);
+    return stream;
+}
+
+void mc_chunk_stream_destroy(struct mc_chunk_stream* stream) {
+    free(stream);
+}
+
+bool mc_chunk_stream_next(struct mc_chunk_stream* stream, int32_t* chunk_x, int32_t* chunk_z) {
+    int const radius = stream->radius;
+    for (; stream->cursor < TABLE_SIZE; ++stream->cursor) {
+        struct offset const offset = offsets[stream->cursor];
+        // Everything past the corners of a smaller view is out of it as well.
+        if (offset.x < -radius || offset.x > radius || offset.z < -radius || offset.z > radius) {
+            continue;
+        }
+        int32_t const x = stream->center_x + offset.x;
+        int32_t const z = stream->center_z + offset.z;
+        int const row = wrap(z, stream->side);
+        uint64_t const bit = 1ull << wrap(x, stream->side);
+        if (((stream->sent[row] | stream->pending_cells[row] | stream->skipped[row]) & bit) == 0) {
+            stream->pending_cells[row] |= bit;
+            ++stream->pending;
+            ++stream->cursor;
+            *chunk_x = x;
+            *chunk_z = z;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool mc_chunk_stream_resolve(struct mc_chunk_stream* stream, int32_t const chunk_x, int32_t const chunk_z,
+                             enum mc_chunk_stream_state const state) {
+    int const row = wrap(chunk_z, stream->side);
+    uint64_t const bit = 1ull << wrap(chunk_x, stream->side);
+    if (!in_view(stream, chunk_x, chunk_z) || (stream->pending_cells[row] & bit) == 0 ||
+        state == MC_CHUNK_STREAM_PENDING) {
+        return false;
+    }
+    stream->pending_cells[row] &= ~bit;
+    --stream->pending;
+    if (state == MC_CHUNK_STREAM_SENT) {
+        stream->sent[row] |= bit;
+    }
+    else if (state == MC_CHUNK_STREAM_SKIPPED) {
+        stream->skipped[row] |= bit;
+    }
+    else {
+        // Rewind so the chunk is handed out again in its turn.
+        size_t const rank = rank_of(chunk_x - stream->center_x, chunk_z - stream->center_z);
+        if (rank < stream->cursor) {
+            stream->cursor = rank;
+        }
+    }
+    return true;
+}
+
+/*!
+ * Finds where the offsets table has to be scanned from after the view moves, without scanning it.
+ *
+ * The chunks that are unsent after the move are those of the strips entering the view, and those that were unsent
+ * before it and stay in view. The nearest chunk of a strip is the one the new center clamps to. A chunk unsent before
+ * the move was no nearer than the offset at the cursor, so it is now no nearer than that less the length of the move.
+ * \param stream Pointer to the stream, still around its old center.
+ * \param chunk_x X coordinate of the new center.
+ * \param chunk_z Z coordinate of the new center.
+ * \return Position in the offset table before which no chunk is unsent around the new center.
+ */
+static size_t restart_rank(struct mc_chunk_stream const* stream, int32_t const chunk_x, int32_t const chunk_z) {
+    struct mc_chunk_rect entering[2];
+    size_t const count = mc_chunk_view_difference(chunk_x, chunk_z, stream->center_x, stream->center_z,
+                                                  stream->radius, entering);
+    size_t restart = TABLE_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        struct mc_chunk_rect const* rect = &entering[i];
+        int32_t const x = chunk_x < rect->min_x ? rect->min_x : chunk_x > rect->max_x ? rect->max_x : chunk_x;
+        int32_t const z = chunk_z < rect->min_z ? rect->min_z : chunk_z > rect->max_z ? rect->max_z : chunk_z;
+        size_t const rank = rank_of((int64_t) x - chunk_x, (int64_t) z - chunk_z);
+        if (rank < restart) {
+            restart = rank;
+        }
+    }
+    if (stream->cursor == TABLE_SIZE) {
+        // Nothing was left unsent around the old center.
+        return restart;
+    }
+    int64_t const dx = (int64_t) chunk_x - stream->center_x;
+    int64_t const dz = (int64_t) chunk_z - stream->center_z;
+    // Round the distance at the cursor down and the length of the move up, so the bound stays on the safe side.
+    struct offset const offset = offsets[stream->cursor];
+    int const distance = offset.x * offset.x + offset.z * offset.z;
+    int64_t const length = dx * dx + dz * dz;
+    int nearest = 0;
+    while ((nearest + 1) * (nearest + 1) <= distance) {
+        ++nearest;
+    }
+    for (int64_t step = 0; nearest > 0 && step * step < length; ++step) {
+        --nearest;
+    }
+    size_t const unsent = distance_ranks[nearest * nearest];
+    return unsent < restart ? unsent : restart;
+}
+
+void mc_chunk_stream_move(struct mc_chunk_stream* stream, int32_t const chunk_x, int32_t const chunk_z,
+                          void (*unload)(void* user_data, int32_t chunk_x, int32_t chunk_z), void* user_data) {
+    if (chunk_x == stream->center_x && chunk_z == stream->center_z) {
+        return;
+    }
+    int const side = stream->side;
+    struct mc_chunk_rect leaving[2];
+    size_t const count = mc_chunk_view_difference(stream->center_x, stream->center_z, chunk_x, chunk_z,
+                                                  stream->radius, leaving);
+    // Clear the strips that leave the view; their cells are the ones of the strips that enter it.
+    for (size_t i = 0; i < count; ++i) {
+        struct mc_chunk_rect const* rect = &leaving[i];
+        int const first = wrap(rect->min_x, side);
+        uint64_t const mask = column_mask(first, rect->max_x - rect->min_x + 1, side);
+        for (int32_t z = rect->min_z; z <= rect->max_z; ++z) {
+            int const row = wrap(z, side);
+            uint64_t sent = stream->sent[row] & mask;
+            while (sent != 0) {
+                int const column = __builtin_ctzll(sent);
+                sent &= sent - 1;
+                unload(user_data, rect->min_x + wrap(column - first, side), z);
+            }
+            stream->pending -= __builtin_popcountll(stream->pending_cells[row] & mask);
+            stream->sent[row] &= ~mask;
+            stream->pending_cells[row] &= ~mask;
+            stream->skipped[row] &= ~mask;
+        }
+    }
+    stream->cursor = restart_rank(stream, chunk_x, chunk_z);
+    stream->center_x = chunk_x;
+    stream->center_z = chunk_z;
+}
+
+bool mc_chunk_stream_knows(struct mc_chunk_stream const* stream, int32_t const chunk_x, int32_t const chunk_z) {
+    return in_view(stream, chunk_x, chunk_z) &&
+           (stream->sent[wrap(chunk_z, stream->side)] & (1ull << wrap(chunk_x, stream->side))) != 0;
+}
+
+bool mc_chunk_stream_pending(struct mc_chunk_stream const* stream, int32_t const chunk_x, int32_t const chunk_z) {
+    return in_view(stream, chunk_x, chunk_z) &&
+           (stream->pending_cells[wrap(chunk_z, stream->side)] & (1ull << wrap(chunk_x, stream->side))) != 0;
+}
+
+bool mc_chunk_stream_done(struct mc_chunk_stream const* stream) {
+    return stream->cursor == TABLE_SIZE && stream->pending == 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/entity_ids.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/// Mask of the generation of a slot.
+#define GENERATION_MASK ((1u << MC_ENTITY_GENERATION_BITS) - 1)
+
+struct mc_entity_ids {
+    /// Amount of slots.
+    uint32_t capacity;
+
+    /// Amount of free slots.
+    uint32_t free_count;
+
+    /// One more than the highest slot in use.
+    uint32_t bound;
+
+    /// Binary min-heap of the free slots, so the lowest free slot is the next one handed out.
+    uint32_t* free_slots;
+
+    /// Current generation of every slot.
+    uint16_t* generations;
+
+    /// Whether every slot is in use.
+    bool* used;
+};
+
+
+struct mc_entity_ids* mc_entity_ids_create(uint32_t const capacity) {
+    assert(capacity <= MC_ENTITY_MAX_SLOTS);
+    struct mc_entity_ids* ids = malloc(sizeof(struct mc_entity_ids));
+    if (ids == NULL) {
+        return NULL;
+    }
+    ids->free_slots = malloc(capacity * sizeof(uint32_t));
+    ids->generations = calloc(capacity, sizeof(uint16_t));
+    ids->used = calloc(capacity, sizeof(bool));
+    if (ids->free_slots == NULL || ids->generations == NULL || ids->used == NULL) {
+        mc_entity_ids_destroy(ids);
+        return NULL;
+    }
+    ids->capacity = capacity;
+    ids->free_count = capacity;
+    ids->bound = 0;
+    // Slots in ascending order already form a heap.
+    for (uint32_t i = 0; i < capacity; ++i) {
+        ids->free_slots[i] = i;
+    }
+    return ids;
+}
+
+void mc_entity_ids_destroy(struct mc_entity_ids* ids) {
+    free(ids->free_slots);
+    free(ids->generations);
+    free(ids->used);
+    free(ids);
+}
+
+uint32_t mc_entity_ids_allocate(struct mc_entity_ids* ids) {
+    if (ids->free_count == 0) {
+        return MC_ENTITY_NO_SLOT;
+    }
+    uint32_t* heap = ids->free_slots;
+    uint32_t const slot = heap[0];
+    // Sift the last free slot down from the root.
+    uint32_t const last = heap[--ids->free_count];
+    uint32_t i = 0;
+    for (uint32_t child = 1; child < ids->free_count; child = 2 * i + 1) {
+        if (child + 1 < ids->free_count && heap[child + 1] < heap[child]) {
+            ++child;
+        }
+        if (last < heap[child]) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    ids->used[slot] = true;
+    if (slot >= ids->bound) {
+        ids->bound = slot + 1;
+    }
+    return slot;
+}
+
+void mc_entity_ids_release(struct mc_entity_ids* ids, uint32_t const slot) {
+    assert(slot < ids->capacity && ids->used[slot]);
+    ids->used[slot] = false;
+    ids->generations[slot] = (uint16_t) ((ids->generations[slot] + 1) & GENERATION_MASK);
+    // Sift the slot up from the end of the heap.
+    uint32_t* heap = ids->free_slots;
+    uint32_t i = ids->free_count++;
+    while (i > 0 && slot < heap[(i - 1) / 2]) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = slot;
+    // Every slot is lowered past at most once per time it raised the bound, so this stays cheap.
+    while (ids->bound > 0 && !ids->used[ids->bound - 1]) {
+        --ids->bound;
+    }
+}
+
+int32_t mc_entity_ids_id(struct mc_entity_ids const* ids, uint32_t const slot) {
+    assert(slot < ids->capacity);
+    return (int32_t) ((uint32_t) ids->generations[slot] << MC_ENTITY_SLOT_BITS | (slot + 1));
+}
+
+uint32_t mc_entity_ids_resolve(struct mc_entity_ids const* ids, int32_t const entity_id) {
+    uint32_t const slot = mc_entity_slot(entity_id);
+    if (slot >= ids->capacity || !ids->used[slot] || mc_entity_ids_id(ids, slot) != entity_id) {
+        return MC_ENTITY_NO_SLOT;
+    }
+    return slot;
+}
+
+uint32_t mc_entity_ids_bound(struct mc_entity_ids const* ids) {
+    return ids->bound;
+}
@@ -0,0 +1,266 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/entity_store.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+ * Physics and bounding box every entity of a type starts out with.
+ */
+struct entity_type_info {
+    double gravity;
+    double drag;
+    float width;
+    float height;
+};
+
+/// Physics and bounding box of every entity type, players are moved by their clients.
+static struct entity_type_info const entity_types[MC_ENTITY_TYPE_COUNT] = {
+    [MC_ENTITY_PLAYER]        = {.gravity = 0.0,  .drag = 1.0,  .width = 0.6f,  .height = 1.8f},
+    [MC_ENTITY_ITEM]          = {.gravity = 0.04, .drag = 0.98, .width = 0.25f, .height = 0.25f},
+    [MC_ENTITY_FALLING_BLOCK] = {.gravity = 0.04, .drag = 0.98, .width = 0.98f, .height = 0.98f},
+    [MC_ENTITY_ARROW]         = {.gravity = 0.03, .drag = 0.99, .width = 0.5f,  .height = 0.5f},
+    [MC_ENTITY_MOB]           = {.gravity = 0.08, .drag = 0.98, .width = 0.6f,  .height = 1.8f},
+};
+
+
+/*!
+ * Allocates a zeroed array for every slot of a store.
+ */
+static void* allocate_array(uint32_t const capacity, size_t const element_size, bool* failed) {
+    void* array = calloc(capacity > 0 ? capacity : 1, element_size);
+    if (array == NULL) {
+        *failed = true;
+    }
+    return array;
+}
+
+/*!
+ * Applies gravity to the velocity of every slot.
+ */
+static void apply_gravity(size_t const count, double* restrict velocity, double const* restrict gravity) {
+    for (size_t i = 0; i < count; ++i) {
+        velocity[i] -= gravity[i];
+    }
+}
+
+/*!
+ * Moves every slot along its velocity on one axis, then applies drag to the velocity.
+ */
+static void integrate_axis(size_t const count, double* restrict position, double* restrict velocity,
+                           double const* restrict drag) {
+    for (size_t i = 0; i < count; ++i) {
+        position[i] += velocity[i];
+        velocity[i] *= drag[i];
+    }
+}
+
+/*!
+ * Converts a coordinate of every slot to absolute integer coordinates.
+ */
+static void convert_coordinates(size_t const count, int32_t* restrict absolute, double const* restrict blocks) {
+    for (size_t i = 0; i < count; ++i) {
+        absolute[i] = mc_entity_absolute(blocks[i]);
+    }
+}
+
+/*!
+ * Converts an angle of every slot to a fraction of 256.
+ */
+static void convert_angles(size_t const count, uint8_t* restrict fractions, float const* restrict degrees) {
+    for (size_t i = 0; i < count; ++i) {
+        fractions[i] = mc_entity_angle(degrees[i]);
+    }
+}
+
+struct mc_entity_store* mc_entity_store_create(uint32_t const capacity) {
+    struct mc_entity_store* store = calloc(1, sizeof(struct mc_entity_store));
+    if (store == NULL) {
+        return NULL;
+    }
+    bool failed = false;
+    store->capacity = capacity;
+    store->ids = mc_entity_ids_create(capacity);
+    failed |= store->ids == NULL;
+    store->x = allocate_array(capacity, sizeof(double), &failed);
+    store->y = allocate_array(capacity, sizeof(double), &failed);
+    store->z = allocate_array(capacity, sizeof(double), &failed);
+    store->velocity_x = allocate_array(capacity, sizeof(double), &failed);
+    store->velocity_y = allocate_array(capacity, sizeof(double), &failed);
+    store->velocity_z = allocate_array(capacity, sizeof(double), &failed);
+    store->gravity = allocate_array(capacity, sizeof(double), &failed);
+    store->drag = allocate_array(capacity, sizeof(double), &failed);
+    store->yaw = allocate_array(capacity, sizeof(float), &failed);
+    store->pitch = allocate_array(capacity, sizeof(float), &failed);
+    store->width = allocate_array(capacity, sizeof(float), &failed);
+    store->height = allocate_array(capacity, sizeof(float), &failed);
+    store->type = allocate_array(capacity, sizeof(uint8_t), &failed);
+    store->flags = allocate_array(capacity, sizeof(uint8_t), &failed);
+    store->variant = allocate_array(capacity, sizeof(uint16_t), &failed);
+    store->data = allocate_array(capacity, sizeof(uint16_t), &failed);
+    store->count = allocate_array(capacity, sizeof(uint8_t), &failed);
+    store->relayed_x = allocate_array(capacity, sizeof(int32_t), &failed);
+    store->relayed_y = allocate_array(capacity, sizeof(int32_t), &failed);
+    store->relayed_z = allocate_array(capacity, sizeof(int32_t), &failed);
+    store->relayed_yaw = allocate_array(capacity, sizeof(uint8_t), &failed);
+    store->relayed_pitch = allocate_array(capacity, sizeof(uint8_t), &failed);
+    store->absolute_x = allocate_array(capacity, sizeof(int32_t), &failed);
+    store->absolute_y = allocate_array(capacity, sizeof(int32_t), &failed);
+    store->absolute_z = allocate_array(capacity, sizeof(int32_t), &failed);
+    store->absolute_yaw = allocate_array(capacity, sizeof(uint8_t), &failed);
+    store->absolute_pitch = allocate_array(capacity, sizeof(uint8_t), &failed);
+    if (failed) {
+        mc_entity_store_destroy(store);
+        return NULL;
+    }
+    return store;
+}
+
+void mc_entity_store_destroy(struct mc_entity_store* store) {
+    if (store->ids != NULL) {
+        mc_entity_ids_destroy(store->ids);
+    }
+    free(store->x);
+    free(store->y);
+    free(store->z);
+    free(store->velocity_x);
+    free(store->velocity_y);
+    free(store->velocity_z);
+    free(store->gravity);
+    free(store->drag);
+    free(store->yaw);
+    free(store->pitch);
+    free(store->width);
+    free(store->height);
+    free(store->type);
+    free(store->flags);
+    free(store->variant);
+    free(store->data);
+    free(store->count);
+    free(store->relayed_x);
+    free(store->relayed_y);
+    free(store->relayed_z);
+    free(store->relayed_yaw);
+    free(store->relayed_pitch);
+    free(store->absolute_x);
+    free(store->absolute_y);
+    free(store->absolute_z);
+    free(store->absolute_yaw);
+    free(store->absolute_pitch);
+    free(store);
+}
+
+uint32_t mc_entity_store_spawn(struct mc_entity_store* store, enum mc_entity_type const type,
+                               double const x, double const y, double const z) {
+    assert(type < MC_ENTITY_TYPE_COUNT);
+    uint32_t const slot = mc_entity_ids_allocate(store->ids);
+    if (slot == MC_ENTITY_NO_SLOT) {
+        return MC_ENTITY_NO_SLOT;
+    }
+    struct entity_type_info const* info = &entity_types[type];
+    store->x[slot] = x;
+    store->y[slot] = y;
+    store->z[slot] = z;
+    store->velocity_x[slot] = 0.0;
+    store->velocity_y[slot] = 0.0;
+    store->velocity_z[slot] = 0.0;
+    store->gravity[slot] = info->gravity;
+    store->drag[slot] = info->drag;
+    store->yaw[slot] = 0.0f;
+    store->pitch[slot] = 0.0f;
+    store->width[slot] = info->width;
+    store->height[slot] = info->height;
+    store->type[slot] = (uint8_t) type;
+    store->flags[slot] = MC_ENTITY_ALIVE;
+    store->variant[slot] = 0;
+    store->data[slot] = 0;
+    store->count[slot] = 0;
+    store->relayed_x[slot] = mc_entity_absolute(x);
+    store->relayed_y[slot] = mc_entity_absolute(y);
+    store->relayed_z[slot] = mc_entity_absolute(z);
+    store->relayed_yaw[slot] = 0;
+    store->relayed_pitch[slot] = 0;
+    return slot;
+}
+
+void mc_entity_store_remove(struct mc_entity_store* store, uint32_t const slot) {
+    assert(slot < store->capacity && (store->flags[slot] & MC_ENTITY_ALIVE) != 0);
+    // The passes keep running over the slot, it must stay where it is.
+    store->velocity_x[slot] = 0.0;
+    store->velocity_y[slot] = 0.0;
+    store->velocity_z[slot] = 0.0;
+    store->gravity[slot] = 0.0;
+    store->flags[slot] = 0;
+    mc_entity_ids_release(store->ids, slot);
+}
+
+void mc_entity_store_step(struct mc_entity_store* store) {
+    size_t const bound = mc_entity_ids_bound(store->ids);
+    apply_gravity(bound, store->velocity_y, store->gravity);
+    integrate_axis(bound, store->x, store->velocity_x, store->drag);
+    integrate_axis(bound, store->y, store->velocity_y, store->drag);
+    integrate_axis(bound, store->z, store->velocity_z, store->drag);
+}
+
+size_t mc_entity_store_collect_moves(struct mc_entity_store* store, struct mc_entity_move* moves) {
+    size_t const bound = mc_entity_ids_bound(store->ids);
+    // Converting is the expensive part and has no branches, it is done for all slots in one go.
+    convert_coordinates(bound, store->absolute_x, store->x);
+    convert_coordinates(bound, store->absolute_y, store->y);
+    convert_coordinates(bound, store->absolute_z, store->z);
+    convert_angles(bound, store->absolute_yaw, store->yaw);
+    convert_angles(bound, store->absolute_pitch, store->pitch);
+    int32_t const* absolute_x = store->absolute_x;
+    int32_t const* absolute_y = store->absolute_y;
+    int32_t const* absolute_z = store->absolute_z;
+    uint8_t const* absolute_yaw = store->absolute_yaw;
+    uint8_t const* absolute_pitch = store->absolute_pitch;
+    size_t count = 0;
+    for (size_t i = 0; i < bound; ++i) {
+        int64_t const dx = (int64_t) absolute_x[i] - store->relayed_x[i];
+        int64_t const dy = (int64_t) absolute_y[i] - store->relayed_y[i];
+        int64_t const dz = (int64_t) absolute_z[i] - store->relayed_z[i];
+        bool const moved = (dx | dy | dz) != 0;
+        bool const rotated = absolute_yaw[i] != store->relayed_yaw[i] || absolute_pitch[i] != store->relayed_pitch[i];
+        if ((!moved && !rotated) || (store->flags[i] & MC_ENTITY_ALIVE) == 0) {
+            continue;
+        }
+        moves[count++] = (struct mc_entity_move) {
+            .slot = (uint32_t) i,
+            .x = absolute_x[i],
+            .y = absolute_y[i],
+            .z = absolute_z[i],
+            .dx = dx,
+            .dy = dy,
+            .dz = dz,
+            .yaw = absolute_yaw[i],
+            .pitch = absolute_pitch[i],
+            .moved = moved,
+            .rotated = rotated,
+        };
+        store->relayed_x[i] = absolute_x[i];
+        store->relayed_y[i] = absolute_y[i];
+        store->relayed_z[i] = absolute_z[i];
+        store->relayed_yaw[i] = absolute_yaw[i];
+        store->relayed_pitch[i] = absolute_pitch[i];
+    }
+    return count;
+}
@@ -0,0 +1,108 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/entity_tracker.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct mc_entity_tracker {
+    /// Amount of slots.
+    uint32_t capacity;
+
+    /// Amount of words of each bit set.
+    size_t word_count;
+
+    /// Entities the client knows, bit i of word j for slot 64 * j + i.
+    uint64_t* known;
+
+    /// Entities the client should know.
+    uint64_t* wanted;
+};
+
+
+/*!
+ * Calls a callback for every set bit of a word.
+ * \return The bits the callback succeeded for.
+ */
+static inline uint64_t visit_bits(uint64_t bits, uint32_t const base, mc_entity_tracker_callback const callback,
+                                  void* user_data) {
+    uint64_t visited = 0;
+    while (bits != 0) {
+        int const bit = __builtin_ctzll(bits);
+        if (callback(user_data, base + (uint32_t) bit)) {
+            visited |= (uint64_t) 1 << bit;
+        }
+        bits &= bits - 1;
+    }
+    return visited;
+}
+
+struct mc_entity_tracker* mc_entity_tracker_create(uint32_t const capacity) {
+    struct mc_entity_tracker* tracker = malloc(sizeof(struct mc_entity_tracker));
+    if (tracker == NULL) {
+        return NULL;
+    }
+    tracker->capacity = capacity;
+    tracker->word_count = (capacity + 63) / 64;
+    tracker->known = calloc(tracker->word_count, sizeof(uint64_t));
+    tracker->wanted = calloc(tracker->word_count, sizeof(uint64_t));
+    if (tracker->known == NULL || tracker->wanted == NULL) {
+        mc_entity_tracker_destroy(tracker);
+        return NULL;
+    }
+    return tracker;
+}
+
+void mc_entity_tracker_destroy(struct mc_entity_tracker* tracker) {
+    free(tracker->known);
+    free(tracker->wanted);
+    free(tracker);
+}
+
+void mc_entity_tracker_clear(struct mc_entity_tracker* tracker) {
+    memset(tracker->wanted, 0, tracker->word_count * sizeof(uint64_t));
+}
+
+void mc_entity_tracker_want(struct mc_entity_tracker* tracker, uint32_t const slot) {
+    assert(slot < tracker->capacity);
+    tracker->wanted[slot / 64] |= (uint64_t) 1 << (slot % 64);
+}
+
+bool mc_entity_tracker_knows(struct mc_entity_tracker const* tracker, uint32_t const slot) {
+    return slot < tracker->capacity && (tracker->known[slot / 64] >> (slot % 64) & 1) != 0;
+}
+
+void mc_entity_tracker_update(struct mc_entity_tracker* tracker, mc_entity_tracker_callback const spawn,
+                              mc_entity_tracker_callback const destroy, void* user_data) {
+    // Destroys go first, so a client is never told about more entities at once than it should know.
+    for (size_t i = 0; i < tracker->word_count; ++i) {
+        uint64_t const leaving = tracker->known[i] & ~tracker->wanted[i];
+        if (leaving != 0) {
+            tracker->known[i] &= ~visit_bits(leaving, (uint32_t) (i * 64), destroy, user_data);
+        }
+    }
+    for (size_t i = 0; i < tracker->word_count; ++i) {
+        uint64_t const entering = tracker->wanted[i] & ~tracker->known[i];
+        if (entering != 0) {
+            tracker->known[i] |= visit_bits(entering, (uint32_t) (i * 64), spawn, user_data);
+        }
+    }
+}
@@ -0,0 +1,225 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/interest_grid.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/// Marks the end of a list of members, and a slot of the cell table without a cell.
+#define NO_MEMBER UINT32_MAX
+
+
+struct mc_interest_grid {
+    /// Amount of slots of the cell table minus one, the amount is a power of two.
+    size_t slot_mask;
+
+    /// Key of the cell in every slot of the cell table.
+    uint64_t* cell_keys;
+
+    /// First member of the cell in every slot of the cell table, NO_MEMBER for slots without a cell.
+    uint32_t* cell_heads;
+
+    /// Amount of members the grid can hold.
+    uint32_t capacity;
+
+    /// Key of the cell of every member.
+    uint64_t* member_keys;
+
+    /// Next member in the same cell, NO_MEMBER for the last one.
+    uint32_t* next;
+
+    /// Previous member in the same cell, NO_MEMBER for the first one.
+    uint32_t* previous;
+
+    /// Whether every member is in the grid.
+    bool* present;
+};
+
+
+/*!
+ * Packs the coordinates of a cell into a key.
+ */
+static inline uint64_t cell_key(int32_t const cell_x, int32_t const cell_z) {
+    return (uint64_t) (uint32_t) cell_x << 32 | (uint32_t) cell_z;
+}
+
+/*!
+ * Hashes a key, neighbouring cells differ in only a few bits.
+ */
+static inline uint64_t hash_key(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/*!
+ * Finds the slot of a cell, or the slot without a cell where it would go.
+ */
+static size_t find_slot(struct mc_interest_grid const* grid, uint64_t const key) {
+    size_t slot = hash_key(key) & grid->slot_mask;
+    while (grid->cell_heads[slot] != NO_MEMBER && grid->cell_keys[slot] != key) {
+        slot = (slot + 1) & grid->slot_mask;
+    }
+    return slot;
+}
+
+/*!
+ * Empties a slot of the cell table, moving back the cells after it that would no longer be found.
+ */
+static void clear_slot(struct mc_interest_grid* grid, size_t slot) {
+    size_t next = slot;
+    while (true) {
+        next = (next + 1) & grid->slot_mask;
+        if (grid->cell_heads[next] == NO_MEMBER) {
+            break;
+        }
+        // A cell can fill the hole if the hole lies between its home slot and its current slot.
+        size_t const home = hash_key(grid->cell_keys[next]) & grid->slot_mask;
+        if (((next - home) & grid->slot_mask) >= ((next - slot) & grid->slot_mask)) {
+            grid->cell_keys[slot] = grid->cell_keys[next];
+            grid->cell_heads[slot] = grid->cell_heads[next];
+            slot = next;
+        }
+    }
+    grid->cell_heads[slot] = NO_MEMBER;
+}
+
+/*!
+ * Links a member into the list of a cell, creating the cell if it has no members yet.
+ */
+static void link_member(struct mc_interest_grid* grid, uint32_t const member, uint64_t const key) {
+    size_t const slot = find_slot(grid, key);
+    grid->cell_keys[slot] = key;
+    grid->member_keys[member] = key;
+    grid->previous[member] = NO_MEMBER;
+    grid->next[member] = grid->cell_heads[slot];
+    if (grid->cell_heads[slot] != NO_MEMBER) {
+        grid->previous[grid->cell_heads[slot]] = member;
+    }
+    grid->cell_heads[slot] = member;
+}
+
+/*!
+ * Unlinks a member from the list of its cell, removing the cell if it has no members left.
+ */
+static void unlink_member(struct mc_interest_grid* grid, uint32_t const member) {
+    uint32_t const previous = grid->previous[member];
+    uint32_t const next = grid->next[member];
+    if (next != NO_MEMBER) {
+        grid->previous[next] = previous;
+    }
+    if (previous != NO_MEMBER) {
+        grid->next[previous] = next;
+        return;
+    }
+    size_t const slot = find_slot(grid, grid->member_keys[member]);
+    assert(grid->cell_heads[slot] == member);
+    if (next != NO_MEMBER) {
+        grid->cell_heads[slot] = next;
+    }
+    else {
+        clear_slot(grid, slot);
+    }
+}
+
+struct mc_interest_grid* mc_interest_grid_create(uint32_t const capacity) {
+    // There are never more cells than members, keep the table at most half full.
+    size_t slot_count = 16;
+    while (slot_count < (size_t) capacity * 2) {
+        slot_count <<= 1;
+    }
+    struct mc_interest_grid* grid = malloc(sizeof(struct mc_interest_grid));
+    if (grid == NULL) {
+        return NULL;
+    }
+    grid->slot_mask = slot_count - 1;
+    grid->capacity = capacity;
+    grid->cell_keys = malloc(slot_count * sizeof(uint64_t));
+    grid->cell_heads = malloc(slot_count * sizeof(uint32_t));
+    grid->member_keys = malloc(capacity * sizeof(uint64_t));
+    grid->next = malloc(capacity * sizeof(uint32_t));
+    grid->previous = malloc(capacity * sizeof(uint32_t));
+    grid->present = calloc(capacity, sizeof(bool));
+    if (grid->cell_keys == NULL || grid->cell_heads == NULL || grid->member_keys == NULL || grid->next == NULL ||
+        grid->previous == NULL || grid->present == NULL) {
+        mc_interest_grid_destroy(grid);
+        return NULL;
+    }
+    for (size_t i = 0; i < slot_count; ++i) {
+        grid->cell_heads[i] = NO_MEMBER;
+    }
+    return grid;
+}
+
+void mc_interest_grid_destroy(struct mc_interest_grid* grid) {
+    free(grid->cell_keys);
+    free(grid->cell_heads);
+    free(grid->member_keys);
+    free(grid->next);
+    free(grid->previous);
+    free(grid->present);
+    free(grid);
+}
+
+void mc_interest_grid_insert(struct mc_interest_grid* grid, uint32_t const member,
+                             int32_t const cell_x, int32_t const cell_z) {
+    assert(member < grid->capacity && !grid->present[member]);
+    link_member(grid, member, cell_key(cell_x, cell_z));
+    grid->present[member] = true;
+}
+
+void mc_interest_grid_remove(struct mc_interest_grid* grid, uint32_t const member) {
+    assert(member < grid->capacity && grid->present[member]);
+    unlink_member(grid, member);
+    grid->present[member] = false;
+}
+
+void mc_interest_grid_move(struct mc_interest_grid* grid, uint32_t const member,
+                           int32_t const cell_x, int32_t const cell_z) {
+    assert(member < grid->capacity && grid->present[member]);
+    uint64_t const key = cell_key(cell_x, cell_z);
+    if (grid->member_keys[member] != key) {
+        unlink_member(grid, member);
+        link_member(grid, member, key);
+    }
+}
+
+bool mc_interest_grid_contains(struct mc_interest_grid const* grid, uint32_t const member) {
+    return member < grid->capacity && grid->present[member];
+}
+
+size_t mc_interest_grid_query(struct mc_interest_grid const* grid, int32_t const cell_x, int32_t const cell_z,
+                              unsigned const radius, uint32_t* members, size_t const capacity) {
+    size_t count = 0;
+    for (int64_t z = (int64_t) cell_z - radius; z <= (int64_t) cell_z + radius; ++z) {
+        for (int64_t x = (int64_t) cell_x - radius; x <= (int64_t) cell_x + radius; ++x) {
+            size_t const slot = find_slot(grid, cell_key((int32_t) x, (int32_t) z));
+            for (uint32_t member = grid->cell_heads[slot]; member != NO_MEMBER; member = grid->next[member]) {
+                if (count == capacity) {
+                    return count;
+                }
+                members[count++] = member;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,400 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/nbt.h"
+
+#include <assert.h>
+#include <endian.h>
+#include <string.h>
+
+/// Element type of the frame around the root tag, whose single element is named.
+#define ROOT_FRAME 0xFF
+
+
+/*
+ * Reader.
+ */
+
+static inline uint16_t load_u16(uint8_t const* p) {
+    uint16_t value;
+    memcpy(&value, p, sizeof(value));
+    return be16toh(value);
+}
+
+static inline uint32_t load_u32(uint8_t const* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return be32toh(value);
+}
+
+static inline uint64_t load_u64(uint8_t const* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return be64toh(value);
+}
+
+/*!
+ * Size of the payload of scalar types, 0 for the others.
+ */
+static size_t scalar_width(uint8_t const type) {
+    switch (type) {
+        case MC_NBT_BYTE:
+            return 1;
+        case MC_NBT_SHORT:
+            return 2;
+        case MC_NBT_INT:
+        case MC_NBT_FLOAT:
+            return 4;
+        case MC_NBT_LONG:
+        case MC_NBT_DOUBLE:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+static inline bool fail(struct mc_nbt_reader* reader) {
+    reader->error = true;
+    return false;
+}
+
+/*!
+ * Reads the fixed part of a payload at the cursor into a tag, checking that strings and arrays fit in the buffer.
+ * The cursor is left at the start of the payload.
+ */
+static bool read_payload_header(struct mc_nbt_reader* reader, uint8_t const type, struct mc_nbt_tag* tag) {
+    size_t const left = reader->size - reader->cursor;
+    tag->type = type;
+    tag->payload = reader->data + reader->cursor;
+    tag->element_type = MC_NBT_END;
+    tag->length = 0;
+    switch (type) {
+        case MC_NBT_BYTE:
+        case MC_NBT_SHORT:
+        case MC_NBT_INT:
+        case MC_NBT_LONG:
+        case MC_NBT_FLOAT:
+        case MC_NBT_DOUBLE:
+            return left >= scalar_width(type) || fail(reader);
+        case MC_NBT_BYTE_ARRAY:
+            if (left < 4) {
+                return fail(reader);
+            }
+            tag->length = load_u32(tag->payload);
+            return left - 4 >= tag->length || fail(reader);
+        case MC_NBT_STRING:
+            if (left < 2) {
+                return fail(reader);
+            }
+            tag->length = load_u16(tag->payload);
+            return left - 2 >= tag->length || fail(reader);
+        case MC_NBT_LIST:
+            if (left < 5) {
+                return fail(reader);
+            }
+            tag->element_type = tag->payload[0];
+            tag->length = load_u32(tag->payload + 1);
+            // Negative counts are invalid, and a non-empty list of nothing would take no bytes to claim any length.
+            if ((int32_t) tag->length < 0 || (tag->element_type == MC_NBT_END && tag->length > 0)) {
+                return fail(reader);
+            }
+            return tag->element_type <= MC_NBT_COMPOUND || fail(reader);
+        case MC_NBT_COMPOUND:
+            return true;
+        default:
+            return fail(reader);
+    }
+}
+
+/*!
+ * Skips a compound or list by walking its children.
+ */
+static void skip_container(struct mc_nbt_reader* reader) {
+    unsigned const depth = reader->depth;
+    if (!mc_nbt_enter(reader)) {
+        return;
+    }
+    struct mc_nbt_tag child;
+    while (reader->depth > depth && !reader->error) {
+        mc_nbt_next(reader, &child);
+    }
+}
+
+/*!
+ * Skips the payload of the current tag.
+ */
+static void skip_current(struct mc_nbt_reader* reader) {
+    struct mc_nbt_tag const* tag = &reader->current;
+    switch (tag->type) {
+        case MC_NBT_BYTE_ARRAY:
+            reader->cursor += 4 + (size_t) tag->length;
+            return;
+        case MC_NBT_STRING:
+            reader->cursor += 2 + (size_t) tag->length;
+            return;
+        case MC_NBT_LIST:
+            if (scalar_width(tag->element_type) != 0) {
+                // Lists of numbers are skipped in one step.
+                size_t const size = 5 + scalar_width(tag->element_type) * (size_t) tag->length;
+                if (size > reader->size - reader->cursor) {
+                    fail(reader);
+                    return;
+                }
+                reader->cursor += size;
+                return;
+            }
+            skip_container(reader);
+            return;
+        case MC_NBT_COMPOUND:
+            skip_container(reader);
+            return;
+        default:
+            reader->cursor += scalar_width(tag->type);
+            return;
+    }
+}
+
+/*!
+ * Leaves the compound or list the reader is in.
+ */
+static bool leave(struct mc_nbt_reader* reader) {
+    if (reader->depth > 1) {
+        --reader->depth;
+    }
+    return false;
+}
+
+void mc_nbt_reader_init(struct mc_nbt_reader* reader, void const* data, size_t const size) {
+    reader->data = data;
+    reader->size = size;
+    reader->cursor = 0;
+    reader->pending = false;
+    reader->depth = 1;
+    reader->remaining[0] = 1;
+    reader->element_types[0] = ROOT_FRAME;
+    reader->error = false;
+}
+
+bool mc_nbt_next(struct mc_nbt_reader* reader, struct mc_nbt_tag* tag) {
+    if (reader->error) {
+        return false;
+    }
+    if (reader->pending) {
+        skip_current(reader);
+        reader->pending = false;
+        if (reader->error) {
+            return false;
+        }
+    }
+    unsigned const frame = reader->depth - 1;
+    uint8_t type;
+    tag->name = NULL;
+    tag->name_length = 0;
+    if (reader->remaining[frame] >= 0) {
+        if (reader->remaining[frame] == 0) {
+            return leave(reader);
+        }
+        --reader->remaining[frame];
+        type = reader->element_types[frame];
+    }
+    if (reader->remaining[frame] < 0 || reader->element_types[frame] == ROOT_FRAME) {
+        // Compound children and the root are named.
+        if (reader->cursor >= reader->size) {
+            return fail(reader);
+        }
+        type = reader->data[reader->cursor++];
+        if (type == MC_NBT_END) {
+            return reader->element_types[frame] == ROOT_FRAME ? fail(reader) : leave(reader);
+        }
+        if (reader->size - reader->cursor < 2) {
+            return fail(reader);
+        }
+        tag->name_length = load_u16(reader->data + reader->cursor);
+        tag->name = (char const*) reader->data + reader->cursor + 2;
+        if (reader->size - reader->cursor - 2 < tag->name_length) {
+            return fail(reader);
+        }
+        reader->cursor += 2 + (size_t) tag->name_length;
+    }
+    if (!read_payload_header(reader, type, tag)) {
+        return false;
+    }
+    reader->current = *tag;
+    reader->pending = true;
+    return true;
+}
+
+bool mc_nbt_enter(struct mc_nbt_reader* reader) {
+    struct mc_nbt_tag const* tag = &reader->current;
+    if (reader->error || !reader->pending || (tag->type != MC_NBT_COMPOUND && tag->type != MC_NBT_LIST)) {
+        return false;
+    }
+    if (reader->depth == MC_NBT_MAX_DEPTH) {
+        return fail(reader);
+    }
+    reader->pending = false;
+    if (tag->type == MC_NBT_LIST) {
+        reader->remaining[reader->depth] = tag->length;
+        reader->element_types[reader->depth] = tag->element_type;
+        reader->cursor += 5;
+    }
+    else {
+        reader->remaining[reader->depth] = -1;
+        reader->element_types[reader->depth] = MC_NBT_END;
+    }
+    ++reader->depth;
+    return true;
+}
+
+bool mc_nbt_is_named(struct mc_nbt_tag const* tag, char const* name) {
+    size_t const length = strlen(name);
+    return tag->name_length == length && memcmp(tag->name, name, length) == 0;
+}
+
+bool mc_nbt_find(struct mc_nbt_reader* reader, char const* name, uint8_t const type, struct mc_nbt_tag* tag) {
+    while (mc_nbt_next(reader, tag)) {
+        if (tag->type == type && mc_nbt_is_named(tag, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int64_t mc_nbt_integer(struct mc_nbt_tag const* tag) {
+    switch (tag->type) {
+        case MC_NBT_BYTE:
+            return (int8_t) tag->payload[0];
+        case MC_NBT_SHORT:
+            return (int16_t) load_u16(tag->payload);
+        case MC_NBT_INT:
+            return (int32_t) load_u32(tag->payload);
+        case MC_NBT_LONG:
+            return (int64_t) load_u64(tag->payload);
+        default:
+            return 0;
+    }
+}
+
+double mc_nbt_real(struct mc_nbt_tag const* tag) {
+    switch (tag->type) {
+        case MC_NBT_FLOAT: {
+            uint32_t const bits = load_u32(tag->payload);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        case MC_NBT_DOUBLE: {
+            uint64_t const bits = load_u64(tag->payload);
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        default:
+            return 0.0;
+    }
+}
+
+
+/*
+ * Writer.
+ */
+
+static void put(struct mc_nbt_writer* writer, void const* data, size_t const size) {
+    if (writer->cursor <= writer->capacity && size <= writer->capacity - writer->cursor) {
+        memcpy(writer->data + writer->cursor, data, size);
+    }
+    writer->cursor += size;
+}
+
+static void put_u8(struct mc_nbt_writer* writer, uint8_t const value) {
+    put(writer, &value, sizeof(value));
+}
+
+static void put_u16(struct mc_nbt_writer* writer, uint16_t const value) {
+    uint16_t const be = htobe16(value);
+    put(writer, &be, sizeof(be));
+}
+
+static void put_u32(struct mc_nbt_writer* writer, uint32_t const value) {
+    uint32_t const be = htobe32(value);
+    put(writer, &be, sizeof(be));
+}
+
+static void put_u64(struct mc_nbt_writer* writer, uint64_t const value) {
+    uint64_t const be = htobe64(value);
+    put(writer, &be, sizeof(be));
+}
+
+void mc_nbt_writer_init(struct mc_nbt_writer* writer, void* data, size_t const capacity) {
+    writer->data = data;
+    writer->capacity = capacity;
+    writer->cursor = 0;
+}
+
+void mc_nbt_write_header(struct mc_nbt_writer* writer, uint8_t const type, char const* name) {
+    size_t const length = strlen(name);
+    assert(length <= UINT16_MAX);
+    put_u8(writer, type);
+    put_u16(writer, (uint16_t) length);
+    put(writer, name, length);
+}
+
+void mc_nbt_write_end(struct mc_nbt_writer* writer) {
+    put_u8(writer, MC_NBT_END);
+}
+
+void mc_nbt_write_byte(struct mc_nbt_writer* writer, char const* name, int8_t const value) {
+    mc_nbt_write_header(writer, MC_NBT_BYTE, name);
+    put_u8(writer, (uint8_t) value);
+}
+
+void mc_nbt_write_short(struct mc_nbt_writer* writer, char const* name, int16_t const value) {
+    mc_nbt_write_header(writer, MC_NBT_SHORT, name);
+    put_u16(writer, (uint16_t) value);
+}
+
+void mc_nbt_write_int(struct mc_nbt_writer* writer, char const* name, int32_t const value) {
+    mc_nbt_write_header(writer, MC_NBT_INT, name);
+    put_u32(writer, (uint32_t) value);
+}
+
+void mc_nbt_write_long(struct mc_nbt_writer* writer, char const* name, int64_t const value) {
+    mc_nbt_write_header(writer, MC_NBT_LONG, name);
+    put_u64(writer, (uint64_t) value);
+}
+
+void mc_nbt_write_string(struct mc_nbt_writer* writer, char const* name, char const* value) {
+    size_t const length = strlen(value);
+    assert(length <= UINT16_MAX);
+    mc_nbt_write_header(writer, MC_NBT_STRING, name);
+    put_u16(writer, (uint16_t) length);
+    put(writer, value, length);
+}
+
+void mc_nbt_write_byte_array(struct mc_nbt_writer* writer, char const* name, void const* data, uint32_t const length) {
+    mc_nbt_write_header(writer, MC_NBT_BYTE_ARRAY, name);
+    put_u32(writer, length);
+    put(writer, data, length);
+}
+
+void mc_nbt_write_list(struct mc_nbt_writer* writer, char const* name, uint8_t const element_type,
+                       uint32_t const count) {
+    mc_nbt_write_header(writer, MC_NBT_LIST, name);
+    put_u8(writer, element_type);
+    put_u32(writer, count);
+}
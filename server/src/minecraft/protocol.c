@@ -17,6 +17,8 @@
  */
 
 #include "obsidian/minecraft/protocol.h"
+#include "obsidian/minecraft/ucs2.h"
+#include "obsidian/bswap.h"
 #include "obsidian/log.h"
 
 #include <assert.h>
@@ -45,9 +47,10 @@ static inline void encode_word(uint8_t* buf, mc_word x, size_t* cursor) {
 }
 
 static inline mc_word decode_word(uint8_t const* buf, size_t* cursor) {
-    mc_word const x = be16toh(*(const uint16_t*)(buf + *cursor));
+    uint16_t x;
+    memcpy(&x, buf + *cursor, sizeof(x));
     *cursor += sizeof(mc_word);
-    return x;
+    return (mc_word) be16toh(x);
 }
 
 static inline void encode_dword(uint8_t* buf, mc_dword x, size_t* cursor) {
@@ -57,9 +60,10 @@ static inline void encode_dword(uint8_t* buf, mc_dword x, size_t* cursor) {
 }
 
 static inline mc_dword decode_dword(uint8_t const* buf, size_t* cursor) {
-    mc_dword const x = be32toh(*(const uint32_t*)(buf + *cursor));
+    uint32_t x;
+    memcpy(&x, buf + *cursor, sizeof(x));
     *cursor += sizeof(mc_dword);
-    return x;
+    return (mc_dword) be32toh(x);
 }
 
 static inline void encode_qword(uint8_t* buf, mc_qword x, size_t* cursor) {
@@ -69,9 +73,10 @@ static inline void encode_qword(uint8_t* buf, mc_qword x, size_t* cursor) {
 }
 
 static inline mc_qword decode_qword(uint8_t const* buf, size_t* cursor) {
-    mc_qword const x = be64toh(*(const uint64_t*)(buf + *cursor));
+    uint64_t x;
+    memcpy(&x, buf + *cursor, sizeof(x));
     *cursor += sizeof(mc_qword);
-    return x;
+    return (mc_qword) be64toh(x);
 }
 
 static inline void encode_float(uint8_t* buf, mc_float const x, size_t* cursor) {
@@ -102,7 +107,10 @@ static inline mc_double decode_double(uint8_t const* buf, size_t* cursor) {
 
 static inline void encode_utf8_string(uint8_t* dst, mc_utf8_char const* str, uint16_t const len, size_t* cursor) {
     encode_word(dst, len, cursor);
-    memcpy(dst + *cursor, str, len);
+    // An empty string may come without any characters to point at.
+    if (len > 0) {
+        memcpy(dst + *cursor, str, len);
+    }
     *cursor += len;
 }
 
@@ -113,304 +121,1037 @@ decode_utf8_string(mc_utf8_char* dst, uint8_t const* buf, size_t const len, size
     return dst;
 }
 
-static inline void encode_byte_array(uint8_t* dst, mc_byte const* str, uint16_t const len, size_t* cursor) {
-    memcpy(dst + *cursor, str, len);
+static inline void encode_byte_array(uint8_t* dst, mc_byte const* str, size_t const len, size_t* cursor) {
+    if (len > 0) {
+        memcpy(dst + *cursor, str, len);
+    }
     *cursor += len;
 }
 
-int mc_proto_encode_heartbeat(void* buffer, size_t buffer_size, struct mc_proto_heartbeat const* heartbeat) {
-    assert(heartbeat != NULL);
-    size_t const needed = sizeof(mc_byte);
-    ASSERT_BUFFER_SIZE(buffer_size, needed);
-    assert(buffer != NULL);
-    size_t cursor = 0;
-    encode_byte(buffer, MC_PACKET_HEARTBEAT, &cursor);
-    return cursor;
+static inline void encode_word_array(uint8_t* dst, mc_word const* words, size_t const len, size_t* cursor) {
+    obs_bswap16_array(dst + *cursor, words, len);
+    *cursor += sizeof(mc_word) * len;
 }
 
-int mc_proto_decode_heartbeat(void const* buffer, size_t const buffer_size, struct mc_proto_heartbeat* heartbeat) {
-    assert(buffer != NULL);
-    assert(heartbeat != NULL);
-    ASSERT_BUFFER_SIZE(buffer_size, 1);
-    size_t cursor = 0;
-    mc_byte const type = decode_byte(buffer, &cursor);
-    if (type != MC_PACKET_HEARTBEAT) {
-        return 0;
+static inline void encode_slot(uint8_t* dst, struct mc_proto_slot const* slot, size_t* cursor) {
+    encode_word(dst, slot->id, cursor);
+    if (slot->id >= 0) {
+        encode_byte(dst, slot->count, cursor);
+        encode_word(dst, slot->damage, cursor);
     }
-    return cursor;
 }
 
-int mc_proto_decode_authentication_request(void const* buffer, size_t buffer_size,
-                                           struct mc_proto_authentication_request* request) {
-    assert(buffer != NULL);
-    assert(request != NULL);
-    ASSERT_BUFFER_SIZE(buffer_size, 7);
-    size_t cursor = 0;
-    mc_byte const type = decode_byte(buffer, &cursor);
-    if (type != MC_PACKET_AUTHENTICATION) {
-        return 0;
+
+static inline void encode_ucs2_string(uint8_t* dst, mc_utf8_char const* str, size_t const len, size_t* cursor) {
+    // The length is in characters, which is only known after converting.
+    size_t const units = mc_ucs2_from_utf8(dst + *cursor + sizeof(mc_word), str, len);
+    encode_word(dst, units, cursor);
+    *cursor += sizeof(mc_word) * units;
+}
+
+/*!
+ * Decodes a UCS-2 string into UTF-8.
+ * \return Length of the UTF-8 string in bytes, or -1 if it does not fit in the destination.
+ */
+static inline int decode_ucs2_string(mc_utf8_char* dst, size_t const capacity, uint8_t const* buf, size_t const units,
+                                     size_t* cursor) {
+    int const length = mc_ucs2_to_utf8(dst, capacity, buf + *cursor, units);
+    *cursor += sizeof(mc_word) * units;
+    return length;
+}
+
+/*
+ * Packet layouts.
+ *
+ * Every packet is described once per protocol version by a layout macro taking two arguments, F and A. A layout
+ * invokes F(kind, field) for each scalar or string field and A(kind, field, count) for each array field, in wire
+ * order. The count of an array is an expression of the packet pointer p. The codec functions below are generated from
+ * these layouts, so adding a packet means adding its structure to protocol.h, its entry to the packet list there and
+ * its layout to the packet list of every version that has it. Versions reuse the layouts of older versions for packets
+ * that did not change.
+ *
+ * Scalar kinds are byte, bool, word, dword, qword, float and double. The slot kind is an inventory slot, which is
+ * shorter on the wire when empty. The zero and empty kinds are not on the wire at all, they clear scalar and string
+ * fields respectively that a version does not send. String kinds store their contents in the fields <field>_length and
+ * <field>; string8 is a UTF-8 string prefixed by its length in bytes, string16 is a UCS-2 string prefixed by its length
+ * in characters and is converted to and from UTF-8. Array kinds are bytes (decoded in place, pointing into the source
+ * buffer), words (encode only) and slots (decoded into a fixed-size array). The payload kind is a bytes array that must
+ * be the last field of its layout; it is coded like bytes, except that the vectored encoder references it in place
+ * instead of copying it.
+ */
+
+#define ALPHA_HEARTBEAT(F, A)
+
+#define ALPHA_AUTHENTICATION_REQUEST(F, A) \
+    F(dword, protocol_version) F(string8, username) F(string8, password) F(zero, map_seed) F(zero, dimension)
+
+#define ALPHA_AUTHENTICATION_RESPONSE(F, A) \
+    F(dword, entity_id) F(string8, unknown0) F(string8, unknown1)
+
+#define ALPHA_HANDSHAKE_REQUEST(F, A) \
+    F(string8, name)
+
+#define ALPHA_HANDSHAKE_RESPONSE(F, A) \
+    F(string8, unknown)
+
+#define ALPHA_CHAT(F, A) \
+    F(string8, message)
+
+#define ALPHA_TIME(F, A) \
+    F(qword, time)
+
+#define ALPHA_INVENTORY(F, A) \
+    F(dword, type) F(word, count) A(slots, slots, p->count)
+
+#define ALPHA_SPAWN_POSITION(F, A) \
+    F(dword, x) F(dword, y) F(dword, z)
+
+#define ALPHA_USE_ENTITY(F, A) \
+    F(dword, user_id) F(dword, target_id) F(bool, left_click)
+
+#define ALPHA_HEALTH(F, A) \
+    F(byte, health)
+
+#define ALPHA_RESPAWN(F, A) \
+    F(zero, dimension)
+
+#define ALPHA_PLAYER_GROUNDED(F, A) \
+    F(bool, grounded)
+
+#define ALPHA_PLAYER_POSITION(F, A) \
+    F(double, x) F(double, y) F(double, head_y) F(double, z) F(bool, grounded)
+
+#define ALPHA_PLAYER_ROTATION(F, A) \
+    F(float, yaw) F(float, pitch) F(bool, grounded)
+
+#define ALPHA_PLAYER_TRANSFORM(F, A) \
+    F(double, x) F(double, y) F(double, head_y) F(double, z) F(float, yaw) F(float, pitch) F(bool, grounded)
+
+// Order for y and head_y is inverted when sending to client.
+#define ALPHA_PLAYER_TRANSFORM_RESPONSE(F, A) \
+    F(double, x) F(double, head_y) F(double, y) F(double, z) F(float, yaw) F(float, pitch) F(bool, grounded)
+
+#define ALPHA_PLAYER_DIG(F, A) \
+    F(byte, status) F(dword, x) F(byte, y) F(dword, z) F(byte, face)
+
+#define ALPHA_PLAYER_PLACE(F, A) \
+    F(word, item.id) F(dword, x) F(byte, y) F(dword, z) F(byte, direction) F(zero, item.count) F(zero, item.damage)
+
+#define ALPHA_HOLDING(F, A) \
+    F(dword, entity_id) F(word, item_id) F(zero, slot)
+
+#define ALPHA_INVENTORY_ADD(F, A) \
+    F(word, item_id) F(byte, count) F(word, damage)
+
+#define ALPHA_ANIMATION(F, A) \
+    F(dword, entity_id) F(byte, animation)
+
+#define ALPHA_PLAYER_SPAWN(F, A) \
+    F(dword, entity_id) F(string8, name) F(dword, x) F(dword, y) F(dword, z) F(byte, yaw) F(byte, pitch) \
+    F(word, item_id)
+
+#define ALPHA_PICKUP_SPAWN(F, A) \
+    F(dword, entity_id) F(word, item_id) F(byte, count) F(zero, damage) F(dword, x) F(dword, y) F(dword, z) \
+    F(byte, yaw) F(byte, pitch) F(byte, roll)
+
+#define ALPHA_COLLECT(F, A) \
+    F(dword, collected_id) F(dword, collector_id)
+
+#define ALPHA_OBJECT_SPAWN(F, A) \
+    F(dword, entity_id) F(byte, type) F(dword, x) F(dword, y) F(dword, z)
+
+#define ALPHA_MOB_SPAWN(F, A) \
+    F(dword, entity_id) F(byte, type) F(dword, x) F(dword, y) F(dword, z) F(byte, yaw) F(byte, pitch)
+
+#define ALPHA_ENTITY_DESTROY(F, A) \
+    F(dword, entity_id)
+
+#define ALPHA_ENTITY(F, A) \
+    F(dword, entity_id)
+
+#define ALPHA_ENTITY_MOVE(F, A) \
+    F(dword, entity_id) F(byte, dx) F(byte, dy) F(byte, dz)
+
+#define ALPHA_ENTITY_ROTATE(F, A) \
+    F(dword, entity_id) F(byte, yaw) F(byte, pitch)
+
+#define ALPHA_ENTITY_MOVE_ROTATE(F, A) \
+    F(dword, entity_id) F(byte, dx) F(byte, dy) F(byte, dz) F(byte, yaw) F(byte, pitch)
+
+#define ALPHA_ENTITY_TELEPORT(F, A) \
+    F(dword, entity_id) F(dword, x) F(dword, y) F(dword, z) F(byte, yaw) F(byte, pitch)
+
+#define ALPHA_CHUNK(F, A) \
+    F(dword, x) F(dword, z) F(bool, initialize)
+
+#define ALPHA_CHUNK_DATA(F, A) \
+    F(dword, x) F(word, y) F(dword, z) F(byte, x_size) F(byte, y_size) F(byte, z_size) F(dword, compressed_size) \
+    A(payload, data, p->compressed_size)
+
+#define ALPHA_MULTI_BLOCK_CHANGE(F, A) \
+    F(dword, chunk_x) F(dword, chunk_z) F(word, count) \
+    A(words, coordinates, p->count) A(bytes, types, p->count) A(bytes, metadata, p->count)
+
+#define ALPHA_BLOCK_CHANGE(F, A) \
+    F(dword, x) F(byte, y) F(dword, z) F(byte, type) F(byte, metadata)
+
+#define ALPHA_COMPLEX_ENTITY(F, A) \
+    F(dword, x) F(word, y) F(dword, z) F(word, size) A(payload, data, p->size)
+
+#define ALPHA_EXPLOSION(F, A) \
+    F(double, x) F(double, y) F(double, z) F(float, radius) F(dword, record_count) \
+    A(bytes, records, 3 * (mc_qword) p->record_count)
+
+#define ALPHA_KICK(F, A) \
+    F(string8, reason)
+
+#define BETA_AUTHENTICATION_REQUEST(F, A) \
+    F(dword, protocol_version) F(string16, username) F(empty, password) F(qword, map_seed) F(byte, dimension)
+
+#define BETA_AUTHENTICATION_RESPONSE(F, A) \
+    F(dword, entity_id) F(string16, unknown0) F(qword, map_seed) F(byte, dimension)
+
+#define BETA_HANDSHAKE_REQUEST(F, A) \
+    F(string16, name)
+
+#define BETA_HANDSHAKE_RESPONSE(F, A) \
+    F(string16, unknown)
+
+#define BETA_CHAT(F, A) \
+    F(string16, message)
+
+#define BETA_HEALTH(F, A) \
+    F(word, health)
+
+#define BETA_RESPAWN(F, A) \
+    F(byte, dimension)
+
+#define BETA_PLAYER_PLACE(F, A) \
+    F(dword, x) F(byte, y) F(dword, z) F(byte, direction) F(slot, item)
+
+#define BETA_HOLDING(F, A) \
+    F(word, slot) F(zero, entity_id) F(zero, item_id)
+
+#define BETA_ENTITY_ACTION(F, A) \
+    F(dword, entity_id) F(byte, action)
+
+#define BETA_PLAYER_SPAWN(F, A) \
+    F(dword, entity_id) F(string16, name) F(dword, x) F(dword, y) F(dword, z) F(byte, yaw) F(byte, pitch) \
+    F(word, item_id)
+
+#define BETA_OBJECT_SPAWN(F, A) \
+    F(dword, entity_id) F(byte, type) F(dword, x) F(dword, y) F(dword, z) F(dword, thrower_id) \
+    A(words, velocity, p->thrower_id > 0 ? 3 : 0)
+
+#define BETA_MOB_SPAWN(F, A) \
+    F(dword, entity_id) F(byte, type) F(dword, x) F(dword, y) F(dword, z) F(byte, yaw) F(byte, pitch) \
+    A(bytes, metadata, p->metadata_size)
+
+#define BETA_PICKUP_SPAWN(F, A) \
+    F(dword, entity_id) F(word, item_id) F(byte, count) F(word, damage) F(dword, x) F(dword, y) F(dword, z) \
+    F(byte, yaw) F(byte, pitch) F(byte, roll)
+
+#define BETA_WINDOW_CLOSE(F, A) \
+    F(byte, window_id)
+
+#define BETA_WINDOW_CLICK(F, A) \
+    F(byte, window_id) F(word, slot) F(byte, right_click) F(word, action) F(bool, shift) F(slot, item)
+
+#define BETA_TRANSACTION(F, A) \
+    F(byte, window_id) F(word, action) F(bool, accepted)
+
+#define BETA_SIGN_UPDATE(F, A) \
+    F(dword, x) F(word, y) F(dword, z) F(string16, line0) F(string16, line1) F(string16, line2) F(string16, line3)
+
+#define BETA_KICK(F, A) \
+    F(string16, reason)
+
+
+/*
+ * Packets of each version, as X(type, name, member, layout). The name and member match the packet lists in protocol.h.
+ */
+
+#define ALPHA_CLIENT_PACKETS(X) \
+    X(MC_PACKET_HEARTBEAT,        heartbeat,              heartbeat,      ALPHA_HEARTBEAT)              \
+    X(MC_PACKET_AUTHENTICATION,   authentication_request, authentication, ALPHA_AUTHENTICATION_REQUEST) \
+    X(MC_PACKET_HANDSHAKE,        handshake_request,      handshake,      ALPHA_HANDSHAKE_REQUEST)      \
+    X(MC_PACKET_CHAT,             chat,                   chat,           ALPHA_CHAT)                   \
+    X(MC_PACKET_INVENTORY,        inventory,              inventory,      ALPHA_INVENTORY)              \
+    X(MC_PACKET_USE_ENTITY,       use_entity,             use_entity,     ALPHA_USE_ENTITY)             \
+    X(MC_PACKET_RESPAWN,          respawn,                respawn,        ALPHA_RESPAWN)                \
+    X(MC_PACKET_PLAYER_GROUNDED,  player_grounded,        grounded,       ALPHA_PLAYER_GROUNDED)        \
+    X(MC_PACKET_PLAYER_POSITION,  player_position,        position,       ALPHA_PLAYER_POSITION)        \
+    X(MC_PACKET_PLAYER_ROTATION,  player_rotation,        rotation,       ALPHA_PLAYER_ROTATION)        \
+    X(MC_PACKET_PLAYER_TRANSFORM, player_transform,       transform,      ALPHA_PLAYER_TRANSFORM)       \
+    X(MC_PACKET_PLAYER_DIG,       player_dig,             dig,            ALPHA_PLAYER_DIG)             \
+    X(MC_PACKET_PLAYER_PLACE,     player_place,           place,          ALPHA_PLAYER_PLACE)           \
+    X(MC_PACKET_HOLDING,          holding,                holding,        ALPHA_HOLDING)                \
+    X(MC_PACKET_ANIMATION,        animation,              animation,      ALPHA_ANIMATION)              \
+    X(MC_PACKET_PICKUP_SPAWN,     pickup_spawn,           pickup_spawn,   ALPHA_PICKUP_SPAWN)           \
+    X(MC_PACKET_COMPLEX_ENTITY,   complex_entity,         complex_entity, ALPHA_COMPLEX_ENTITY)         \
+    X(MC_PACKET_KICK,             kick,                   kick,           ALPHA_KICK)
+
+#define ALPHA_SERVER_PACKETS(X) \
+    X(MC_PACKET_HEARTBEAT,          heartbeat,               heartbeat,          ALPHA_HEARTBEAT)                 \
+    X(MC_PACKET_AUTHENTICATION,     authentication_response, authentication,     ALPHA_AUTHENTICATION_RESPONSE)   \
+    X(MC_PACKET_HANDSHAKE,          handshake_response,      handshake,          ALPHA_HANDSHAKE_RESPONSE)        \
+    X(MC_PACKET_CHAT,               chat,                    chat,               ALPHA_CHAT)                      \
+    X(MC_PACKET_TIME,               time,                    time,               ALPHA_TIME)                      \
+    X(MC_PACKET_INVENTORY,          inventory,               inventory,          ALPHA_INVENTORY)                 \
+    X(MC_PACKET_SPAWN_POSITION,     spawn_position,          spawn_position,     ALPHA_SPAWN_POSITION)            \
+    X(MC_PACKET_HEALTH,             health,                  health,             ALPHA_HEALTH)                    \
+    X(MC_PACKET_RESPAWN,            respawn,                 respawn,            ALPHA_RESPAWN)                   \
+    X(MC_PACKET_PLAYER_TRANSFORM,   player_transform,        transform,          ALPHA_PLAYER_TRANSFORM_RESPONSE) \
+    X(MC_PACKET_HOLDING,            holding,                 holding,            ALPHA_HOLDING)                   \
+    X(MC_PACKET_INVENTORY_ADD,      inventory_add,           inventory_add,      ALPHA_INVENTORY_ADD)             \
+    X(MC_PACKET_ANIMATION,          animation,               animation,          ALPHA_ANIMATION)                 \
+    X(MC_PACKET_PLAYER_SPAWN,       player_spawn,            player_spawn,       ALPHA_PLAYER_SPAWN)              \
+    X(MC_PACKET_PICKUP_SPAWN,       pickup_spawn,            pickup_spawn,       ALPHA_PICKUP_SPAWN)              \
+    X(MC_PACKET_COLLECT,            collect,                 collect,            ALPHA_COLLECT)                   \
+    X(MC_PACKET_OBJECT_SPAWN,       object_spawn,            object_spawn,       ALPHA_OBJECT_SPAWN)              \
+    X(MC_PACKET_MOB_SPAWN,          mob_spawn,               mob_spawn,          ALPHA_MOB_SPAWN)                 \
+    X(MC_PACKET_ENTITY_DESTROY,     entity_destroy,          entity_destroy,     ALPHA_ENTITY_DESTROY)            \
+    X(MC_PACKET_ENTITY,             entity,                  entity,             ALPHA_ENTITY)                    \
+    X(MC_PACKET_ENTITY_MOVE,        entity_move,             entity_move,        ALPHA_ENTITY_MOVE)               \
+    X(MC_PACKET_ENTITY_ROTATE,      entity_rotate,           entity_rotate,      ALPHA_ENTITY_ROTATE)             \
+    X(MC_PACKET_ENTITY_MOVE_ROTATE, entity_move_rotate,      entity_move_rotate, ALPHA_ENTITY_MOVE_ROTATE)        \
+    X(MC_PACKET_ENTITY_TELEPORT,    entity_teleport,         entity_teleport,    ALPHA_ENTITY_TELEPORT)           \
+    X(MC_PACKET_CHUNK,              chunk,                   chunk,              ALPHA_CHUNK)                     \
+    X(MC_PACKET_CHUNK_DATA,         chunk_data,              chunk_data,         ALPHA_CHUNK_DATA)                \
+    X(MC_PACKET_MULTI_BLOCK_CHANGE, multi_block_change,      multi_block_change, ALPHA_MULTI_BLOCK_CHANGE)        \
+    X(MC_PACKET_BLOCK_CHANGE,       block_change,            block_change,       ALPHA_BLOCK_CHANGE)              \
+    X(MC_PACKET_COMPLEX_ENTITY,     complex_entity,          complex_entity,     ALPHA_COMPLEX_ENTITY)            \
+    X(MC_PACKET_EXPLOSION,          explosion,               explosion,          ALPHA_EXPLOSION)                 \
+    X(MC_PACKET_KICK,               kick,                    kick,               ALPHA_KICK)
+
+#define BETA_CLIENT_PACKETS(X) \
+    X(MC_PACKET_HEARTBEAT,        heartbeat,              heartbeat,      ALPHA_HEARTBEAT)             \
+    X(MC_PACKET_AUTHENTICATION,   authentication_request, authentication, BETA_AUTHENTICATION_REQUEST) \
+    X(MC_PACKET_HANDSHAKE,        handshake_request,      handshake,      BETA_HANDSHAKE_REQUEST)      \
+    X(MC_PACKET_CHAT,             chat,                   chat,           BETA_CHAT)                   \
+    X(MC_PACKET_USE_ENTITY,       use_entity,             use_entity,     ALPHA_USE_ENTITY)            \
+    X(MC_PACKET_RESPAWN,          respawn,                respawn,        BETA_RESPAWN)                \
+    X(MC_PACKET_PLAYER_GROUNDED,  player_grounded,        grounded,       ALPHA_PLAYER_GROUNDED)       \
+    X(MC_PACKET_PLAYER_POSITION,  player_position,        position,       ALPHA_PLAYER_POSITION)       \
+    X(MC_PACKET_PLAYER_ROTATION,  player_rotation,        rotation,       ALPHA_PLAYER_ROTATION)       \
+    X(MC_PACKET_PLAYER_TRANSFORM, player_transform,       transform,      ALPHA_PLAYER_TRANSFORM)      \
+    X(MC_PACKET_PLAYER_DIG,       player_dig,             dig,            ALPHA_PLAYER_DIG)            \
+    X(MC_PACKET_PLAYER_PLACE,     player_place,           place,          BETA_PLAYER_PLACE)           \
+    X(MC_PACKET_HOLDING,          holding,                holding,        BETA_HOLDING)                \
+    X(MC_PACKET_ANIMATION,        animation,              animation,      ALPHA_ANIMATION)             \
+    X(MC_PACKET_ENTITY_ACTION,    entity_action,          entity_action,  BETA_ENTITY_ACTION)          \
+    X(MC_PACKET_WINDOW_CLOSE,     window_close,           window_close,   BETA_WINDOW_CLOSE)           \
+    X(MC_PACKET_WINDOW_CLICK,     window_click,           window_click,   BETA_WINDOW_CLICK)           \
+    X(MC_PACKET_TRANSACTION,      transaction,            transaction,    BETA_TRANSACTION)            \
+    X(MC_PACKET_SIGN_UPDATE,      sign_update,            sign_update,    BETA_SIGN_UPDATE)            \
+    X(MC_PACKET_KICK,             kick,                   kick,           BETA_KICK)
+
+#define BETA_SERVER_PACKETS(X) \
+    X(MC_PACKET_HEARTBEAT,          heartbeat,               heartbeat,          ALPHA_HEARTBEAT)                 \
+    X(MC_PACKET_AUTHENTICATION,     authentication_response, authentication,     BETA_AUTHENTICATION_RESPONSE)    \
+    X(MC_PACKET_HANDSHAKE,          handshake_response,      handshake,          BETA_HANDSHAKE_RESPONSE)         \
+    X(MC_PACKET_CHAT,               chat,                    chat,               BETA_CHAT)                       \
+    X(MC_PACKET_TIME,               time,                    time,               ALPHA_TIME)                      \
+    X(MC_PACKET_SPAWN_POSITION,     spawn_position,          spawn_position,     ALPHA_SPAWN_POSITION)            \
+    X(MC_PACKET_HEALTH,             health,                  health,             BETA_HEALTH)                     \
+    X(MC_PACKET_RESPAWN,            respawn,                 respawn,            BETA_RESPAWN)                    \
+    X(MC_PACKET_PLAYER_TRANSFORM,   player_transform,        transform,          ALPHA_PLAYER_TRANSFORM_RESPONSE) \
+    X(MC_PACKET_ANIMATION,          animation,               animation,          ALPHA_ANIMATION)                 \
+    X(MC_PACKET_PLAYER_SPAWN,       player_spawn,            player_spawn,       BETA_PLAYER_SPAWN)               \
+    X(MC_PACKET_PICKUP_SPAWN,       pickup_spawn,            pickup_spawn,       BETA_PICKUP_SPAWN)               \
+    X(MC_PACKET_COLLECT,            collect,                 collect,            ALPHA_COLLECT)                   \
+    X(MC_PACKET_OBJECT_SPAWN,       object_spawn,            object_spawn,       BETA_OBJECT_SPAWN)               \
+    X(MC_PACKET_MOB_SPAWN,          mob_spawn,               mob_spawn,          BETA_MOB_SPAWN)                  \
+    X(MC_PACKET_ENTITY_DESTROY,     entity_destroy,          entity_destroy,     ALPHA_ENTITY_DESTROY)            \
+    X(MC_PACKET_ENTITY,             entity,                  entity,             ALPHA_ENTITY)                    \
+    X(MC_PACKET_ENTITY_MOVE,        entity_move,             entity_move,        ALPHA_ENTITY_MOVE)               \
+    X(MC_PACKET_ENTITY_ROTATE,      entity_rotate,           entity_rotate,      ALPHA_ENTITY_ROTATE)             \
+    X(MC_PACKET_ENTITY_MOVE_ROTATE, entity_move_rotate,      entity_move_rotate, ALPHA_ENTITY_MOVE_ROTATE)        \
+    X(MC_PACKET_ENTITY_TELEPORT,    entity_teleport,         entity_teleport,    ALPHA_ENTITY_TELEPORT)           \
+    X(MC_PACKET_CHUNK,              chunk,                   chunk,              ALPHA_CHUNK)                     \
+    X(MC_PACKET_CHUNK_DATA,         chunk_data,              chunk_data,         ALPHA_CHUNK_DATA)                \
+    X(MC_PACKET_MULTI_BLOCK_CHANGE, multi_block_change,      multi_block_change, ALPHA_MULTI_BLOCK_CHANGE)        \
+    X(MC_PACKET_BLOCK_CHANGE,       block_change,            block_change,       ALPHA_BLOCK_CHANGE)              \
+    X(MC_PACKET_EXPLOSION,          explosion,               explosion,          ALPHA_EXPLOSION)                 \
+    X(MC_PACKET_WINDOW_CLOSE,       window_close,            window_close,       BETA_WINDOW_CLOSE)               \
+    X(MC_PACKET_TRANSACTION,        transaction,             transaction,        BETA_TRANSACTION)                \
+    X(MC_PACKET_SIGN_UPDATE,        sign_update,             sign_update,        BETA_SIGN_UPDATE)                \
+    X(MC_PACKET_KICK,               kick,                    kick,               BETA_KICK)
+
+
+/*
+ * Field kinds.
+ *
+ * WIDTH_<kind> is the amount of bytes a field always takes up on the wire; for strings this is the length prefix.
+ * FIXED_<kind> is 1 if that is also the exact size of the field.
+ */
+
+#define WIDTH_byte     sizeof(mc_byte)
+#define WIDTH_bool     sizeof(mc_bool)
+#define WIDTH_word     sizeof(mc_word)
+#define WIDTH_dword    sizeof(mc_dword)
+#define WIDTH_qword    sizeof(mc_qword)
+#define WIDTH_float    sizeof(mc_float)
+#define WIDTH_double   sizeof(mc_double)
+#define WIDTH_zero     0
+#define WIDTH_empty    0
+#define WIDTH_slot     sizeof(mc_word)
+#define WIDTH_string8  sizeof(mc_word)
+#define WIDTH_string16 sizeof(mc_word)
+
+#define FIXED_byte     1
+#define FIXED_bool     1
+#define FIXED_word     1
+#define FIXED_dword    1
+#define FIXED_qword    1
+#define FIXED_float    1
+#define FIXED_double   1
+#define FIXED_zero     1
+#define FIXED_empty    1
+#define FIXED_slot     0
+#define FIXED_string8  0
+#define FIXED_string16 0
+
+#define MIN_SIZE_FIELD(kind, field) + WIDTH_##kind
+#define MIN_SIZE_ARRAY(kind, field, elements)
+#define IS_FIXED_FIELD(kind, field) && FIXED_##kind
+#define IS_FIXED_ARRAY(kind, field, elements) && 0
+
+/// Smallest possible size of a packet on the wire, including the type byte.
+#define LAYOUT_MIN_SIZE(layout) (sizeof(mc_byte) layout(MIN_SIZE_FIELD, MIN_SIZE_ARRAY))
+
+/// Whether every packet with this layout has the same size.
+#define LAYOUT_IS_FIXED(layout) (1 layout(IS_FIXED_FIELD, IS_FIXED_ARRAY))
+
+
+/*
+ * Encoders.
+ *
+ * The maximum size of a packet is computed in constant time from its fields, after which every field is written
+ * without further checks. The maximum is exact for packets without slots or UCS-2 strings; an empty slot is shorter
+ * than a full one, and a UCS-2 string has at most as many characters as its UTF-8 form has bytes. Fixed-size packets
+ * have their size known at compile time.
+ */
+
+#define MAX_SIZE_byte(p, field)     WIDTH_byte
+#define MAX_SIZE_bool(p, field)     WIDTH_bool
+#define MAX_SIZE_word(p, field)     WIDTH_word
+#define MAX_SIZE_dword(p, field)    WIDTH_dword
+#define MAX_SIZE_qword(p, field)    WIDTH_qword
+#define MAX_SIZE_float(p, field)    WIDTH_float
+#define MAX_SIZE_double(p, field)   WIDTH_double
+#define MAX_SIZE_zero(p, field)     WIDTH_zero
+#define MAX_SIZE_empty(p, field)    WIDTH_empty
+#define MAX_SIZE_slot(p, field)     SLOT_MAX_SIZE
+#define MAX_SIZE_string8(p, field)  (WIDTH_string8 + sizeof(mc_utf8_char) * (size_t) (p)->field##_length)
+#define MAX_SIZE_string16(p, field) (WIDTH_string16 + sizeof(mc_word) * (size_t) (p)->field##_length)
+
+#define MAX_SIZE_ARRAY_bytes(p, field, elements) (sizeof(mc_byte) * (size_t) (elements))
+#define MAX_SIZE_ARRAY_words(p, field, elements) (sizeof(mc_word) * (size_t) (elements))
+#define MAX_SIZE_ARRAY_slots(p, field, elements) (SLOT_MAX_SIZE * (size_t) (elements))
+#define MAX_SIZE_ARRAY_payload(p, field, elements) MAX_SIZE_ARRAY_bytes(p, field, elements)
+
+/// Size of a slot that is not empty.
+#define SLOT_MAX_SIZE (sizeof(mc_word) + sizeof(mc_byte) + sizeof(mc_word))
+
+#define MAX_SIZE_FIELD(kind, field) + MAX_SIZE_##kind(p, field)
+#define MAX_SIZE_ARRAY(kind, field, elements) + MAX_SIZE_ARRAY_##kind(p, field, elements)
+
+/// Largest size a packet with this layout can have on the wire, including the type byte.
+#define LAYOUT_MAX_SIZE(layout) (sizeof(mc_byte) layout(MAX_SIZE_FIELD, MAX_SIZE_ARRAY))
+
+#define HEADER_SIZE_ARRAY(kind, field, elements) + HEADER_SIZE_ARRAY_##kind(p, field, elements)
+#define HEADER_SIZE_ARRAY_bytes(p, field, elements) MAX_SIZE_ARRAY_bytes(p, field, elements)
+#define HEADER_SIZE_ARRAY_words(p, field, elements) MAX_SIZE_ARRAY_words(p, field, elements)
+#define HEADER_SIZE_ARRAY_slots(p, field, elements) MAX_SIZE_ARRAY_slots(p, field, elements)
+#define HEADER_SIZE_ARRAY_payload(p, field, elements) 0
+
+/// Like LAYOUT_MAX_SIZE, but without the payload.
+#define LAYOUT_HEADER_SIZE(layout) (sizeof(mc_byte) layout(MAX_SIZE_FIELD, HEADER_SIZE_ARRAY))
+
+/// Size of every packet with this layout if that is a constant, otherwise 0.
+#define LAYOUT_FIXED_SIZE(layout) (LAYOUT_IS_FIXED(layout) ? LAYOUT_MIN_SIZE(layout) : 0)
+
+#define ENCODE_byte(p, field)     encode_byte(buf, (p)->field, &cursor)
+#define ENCODE_bool(p, field)     encode_byte(buf, (p)->field, &cursor)
+#define ENCODE_word(p, field)     encode_word(buf, (p)->field, &cursor)
+#define ENCODE_dword(p, field)    encode_dword(buf, (p)->field, &cursor)
+#define ENCODE_qword(p, field)    encode_qword(buf, (p)->field, &cursor)
+#define ENCODE_float(p, field)    encode_float(buf, (p)->field, &cursor)
+#define ENCODE_double(p, field)   encode_double(buf, (p)->field, &cursor)
+#define ENCODE_zero(p, field)     (void) 0
+#define ENCODE_empty(p, field)    (void) 0
+#define ENCODE_slot(p, field)     encode_slot(buf, &(p)->field, &cursor)
+#define ENCODE_string8(p, field)  encode_utf8_string(buf, (p)->field, (p)->field##_length, &cursor)
+#define ENCODE_string16(p, field) encode_ucs2_string(buf, (p)->field, (p)->field##_length, &cursor)
+
+#define ENCODE_ARRAY_bytes(p, field, elements) encode_byte_array(buf, (p)->field, elements, &cursor)
+#define ENCODE_ARRAY_words(p, field, elements) encode_word_array(buf, (p)->field, elements, &cursor)
+#define ENCODE_ARRAY_slots(p, field, elements) \
+    for (size_t i = 0; i < (size_t) (elements); ++i) { \
+        encode_slot(buf, &(p)->field[i], &cursor); \
     }
-    // Read and sanitize the username length.
-    request->protocol_version = decode_dword(buffer, &cursor);
-    request->username_length = decode_word(buffer, &cursor);
-    if (request->username_length > MINECRAFT_USERNAME_LENGTH) {
-        OBS_LOG_WARN("protocol", "Received username length > 16. This is invalid data!");
-        return 0;
+#define ENCODE_ARRAY_payload(p, field, elements) ENCODE_ARRAY_bytes(p, field, elements)
+
+#define ENCODE_FIELD(kind, field) ENCODE_##kind(p, field);
+#define ENCODE_ARRAY(kind, field, elements) ENCODE_ARRAY_##kind(p, field, elements);
+
+#define DEFINE_ENCODER(version, type, name, member, layout) \
+    static int version##_encode_##name(void* buffer, size_t const buffer_size, \
+                                       struct mc_proto_server_packet const* packet) { \
+        struct mc_proto_##name const* p = &packet->member; \
+        (void) p; \
+        ASSERT_BUFFER_SIZE(buffer_size, LAYOUT_MAX_SIZE(layout)); \
+        assert(buffer != NULL); \
+        uint8_t* buf = buffer; \
+        size_t cursor = 0; \
+        encode_byte(buf, type, &cursor); \
+        layout(ENCODE_FIELD, ENCODE_ARRAY) \
+        return cursor; \
     }
-    ASSERT_BUFFER_SIZE(buffer_size, cursor + request->username_length + sizeof(mc_word));
-    decode_utf8_string(request->username, buffer, request->username_length, &cursor);
-    request->password_length = decode_word(buffer, &cursor);
-    if (request->password_length > 32) {
-        OBS_LOG_WARN("protocol", "Received password length > 32. This is invalid data!");
-        return 0;
+
+#define IOV_ENCODE_ARRAY(kind, field, elements) IOV_ENCODE_ARRAY_##kind(p, field, elements);
+#define IOV_ENCODE_ARRAY_bytes(p, field, elements) ENCODE_ARRAY_bytes(p, field, elements)
+#define IOV_ENCODE_ARRAY_words(p, field, elements) ENCODE_ARRAY_words(p, field, elements)
+#define IOV_ENCODE_ARRAY_slots(p, field, elements) ENCODE_ARRAY_slots(p, field, elements)
+#define IOV_ENCODE_ARRAY_payload(p, field, elements) \
+    iov[1] = (struct iovec) {.iov_base = (void*) (p)->field, .iov_len = sizeof(mc_byte) * (size_t) (elements)}
+
+/*
+ * The vectored encoder writes everything but the payload to the buffer and leaves the payload where it is, so large
+ * payloads shared between clients are not copied for each of them.
+ */
+#define DEFINE_IOV_ENCODER(version, type, name, member, layout) \
+    static int version##_encode_iov_##name(void* buffer, size_t const buffer_size, \
+                                           struct mc_proto_server_packet const* packet, struct iovec iov[2]) { \
+        struct mc_proto_##name const* p = &packet->member; \
+        (void) p; \
+        ASSERT_BUFFER_SIZE(buffer_size, LAYOUT_HEADER_SIZE(layout)); \
+        assert(buffer != NULL); \
+        uint8_t* buf = buffer; \
+        size_t cursor = 0; \
+        iov[1] = (struct iovec) {0}; \
+        encode_byte(buf, type, &cursor); \
+        layout(ENCODE_FIELD, IOV_ENCODE_ARRAY) \
+        iov[0] = (struct iovec) {.iov_base = buffer, .iov_len = cursor}; \
+        return cursor + iov[1].iov_len; \
     }
-    decode_utf8_string(request->password, buffer, request->password_length, &cursor);
-    return cursor;
-}
 
-int mc_proto_encode_authentication_response(void* buffer, size_t buffer_size,
-                                            struct mc_proto_authentication_response const* response) {
-    assert(response != NULL);
-    size_t const needed = sizeof(mc_byte)
-                          + sizeof(mc_dword)
-                          + sizeof(mc_word) + sizeof(mc_utf8_char) * response->unknown0_length
-                          + sizeof(mc_word) + sizeof(mc_utf8_char) * response->unknown1_length;
-    ASSERT_BUFFER_SIZE(buffer_size, needed);
-    assert(buffer != NULL);
-    size_t cursor = 0;
-    encode_byte(buffer, MC_PACKET_AUTHENTICATION, &cursor);
-    encode_dword(buffer, response->entity_id, &cursor);
-    encode_word(buffer, response->unknown0_length, &cursor);
-    encode_utf8_string(buffer, response->unknown0, response->unknown0_length, &cursor);
-    encode_word(buffer, response->unknown1_length, &cursor);
-    encode_utf8_string(buffer, response->unknown1, response->unknown1_length, &cursor);
-    return cursor;
-}
+#define DEFINE_SIZER(version, type, name, member, layout) \
+    static size_t version##_size_##name(struct mc_proto_server_packet const* packet) { \
+        struct mc_proto_##name const* p = &packet->member; \
+        (void) p; \
+        return LAYOUT_MAX_SIZE(layout); \
+    }
 
-int mc_proto_decode_handshake_request(void const* buffer, size_t const buffer_size,
-                                      struct mc_proto_handshake_request* request) {
-    assert(buffer != NULL);
-    assert(request != NULL);
-    ASSERT_BUFFER_SIZE(buffer_size, 3);
-    size_t cursor = 0;
-    mc_byte const type = decode_byte(buffer, &cursor);
-    if (type != MC_PACKET_HANDSHAKE) {
-        return 0;
+
+/*
+ * Decoders.
+ *
+ * A decoder first checks that the buffer holds the minimum size of the packet, which covers every fixed-size field
+ * and every length prefix. Fixed-size fields are read without further checks. Once the length of a string or array is
+ * known, the required size grows by that amount and is checked again. For fixed-size packets this leaves a single
+ * check against a compile-time constant. The type byte is skipped, the caller has already read it.
+ */
+
+#define DECODE_byte(p, field)   (p)->field = decode_byte(buf, &cursor)
+#define DECODE_bool(p, field)   (p)->field = decode_byte(buf, &cursor)
+#define DECODE_word(p, field)   (p)->field = decode_word(buf, &cursor)
+#define DECODE_dword(p, field)  (p)->field = decode_dword(buf, &cursor)
+#define DECODE_qword(p, field)  (p)->field = decode_qword(buf, &cursor)
+#define DECODE_float(p, field)  (p)->field = decode_float(buf, &cursor)
+#define DECODE_double(p, field) (p)->field = decode_double(buf, &cursor)
+#define DECODE_zero(p, field)   (p)->field = 0
+#define DECODE_empty(p, field)  (p)->field##_length = 0
+
+#define DECODE_slot(p, field) \
+    (p)->field.id = decode_word(buf, &cursor); \
+    if ((p)->field.id >= 0) { \
+        needed += sizeof(mc_byte) + sizeof(mc_word); \
+        ASSERT_BUFFER_SIZE(buffer_size, needed); \
+        (p)->field.count = decode_byte(buf, &cursor); \
+        (p)->field.damage = decode_word(buf, &cursor); \
     }
-    // Read the username length, but sanitize this value.
-    request->name_length = decode_word(buffer, &cursor);
-    if (request->name_length > MINECRAFT_USERNAME_LENGTH) {
-        OBS_LOG_WARN("protocol", "Received name length > 16. This is invalid data!");
-        return 0;
+
+#define IS_ARRAY(x) (!__builtin_types_compatible_p(typeof(x), typeof(&(x)[0])))
+
+#define DECODE_string8(p, field) \
+    _Static_assert(IS_ARRAY((p)->field), #field " must be an array to be decoded"); \
+    (p)->field##_length = decode_word(buf, &cursor); \
+    if ((p)->field##_length < 0 || (size_t) (p)->field##_length > sizeof((p)->field)) { \
+        OBS_LOG_WARN("protocol", "Received " #field " length %d > %zu. This is invalid data!", \
+                     (p)->field##_length, sizeof((p)->field)); \
+        return 0; \
+    } \
+    needed += sizeof(mc_utf8_char) * (p)->field##_length; \
+    ASSERT_BUFFER_SIZE(buffer_size, needed); \
+    decode_utf8_string((p)->field, buf, (p)->field##_length, &cursor)
+
+#define DECODE_string16(p, field) \
+    _Static_assert(IS_ARRAY((p)->field), #field " must be an array to be decoded"); \
+    { \
+        mc_word const units = decode_word(buf, &cursor); \
+        if (units < 0) { \
+            OBS_LOG_WARN("protocol", "Received negative " #field " length %d. This is invalid data!", units); \
+            return 0; \
+        } \
+        needed += sizeof(mc_word) * units; \
+        ASSERT_BUFFER_SIZE(buffer_size, needed); \
+        int const length = decode_ucs2_string((p)->field, sizeof((p)->field), buf, units, &cursor); \
+        if (length < 0) { \
+            OBS_LOG_WARN("protocol", "Received " #field " of %d characters that does not fit in %zu bytes. " \
+                         "This is invalid data!", units, sizeof((p)->field)); \
+            return 0; \
+        } \
+        (p)->field##_length = length; \
     }
-    ASSERT_BUFFER_SIZE(buffer_size, cursor + request->name_length);
-    decode_utf8_string(request->name, buffer, request->name_length, &cursor);
-    return cursor;
-}
 
-int mc_proto_encode_handshake_response(void* buffer, size_t const buffer_size,
-                                       struct mc_proto_handshake_response const* response) {
-    assert(response != NULL);
-    size_t const needed = sizeof(mc_byte) + sizeof(mc_word) + sizeof(mc_utf8_char) * response->unknown_length;
-    ASSERT_BUFFER_SIZE(buffer_size, needed);
-    assert(buffer != NULL);
-    size_t cursor = 0;
-    encode_byte(buffer, MC_PACKET_HANDSHAKE, &cursor);
-    encode_utf8_string(buffer, response->unknown, response->unknown_length, &cursor);
-    return cursor;
-}
+#define DECODE_ARRAY_bytes(p, field, elements) \
+    if ((elements) < 0) { \
+        OBS_LOG_WARN("protocol", "Received negative " #field " size %d. This is invalid data!", (int) (elements)); \
+        return 0; \
+    } \
+    needed += sizeof(mc_byte) * (size_t) (elements); \
+    ASSERT_BUFFER_SIZE(buffer_size, needed); \
+    (p)->field = (mc_byte const*) buf + cursor; \
+    cursor += (size_t) (elements)
 
-int mc_proto_encode_time(void* buffer, size_t buffer_size, struct mc_proto_time const* time) {
-    assert(time != NULL);
-    size_t const needed = sizeof(mc_byte) + sizeof(mc_qword);
-    ASSERT_BUFFER_SIZE(buffer_size, needed);
-    assert(buffer != NULL);
-    size_t cursor = 0;
-    encode_byte(buffer, MC_PACKET_TIME, &cursor);
-    encode_qword(buffer, time->time, &cursor);
-    return cursor;
+#define DECODE_ARRAY_slots(p, field, elements) \
+    _Static_assert(IS_ARRAY((p)->field), #field " must be an array to be decoded"); \
+    if ((elements) < 0 || (size_t) (elements) > sizeof((p)->field) / sizeof((p)->field[0])) { \
+        OBS_LOG_WARN("protocol", "Received " #field " count %d > %zu. This is invalid data!", \
+                     (int) (elements), sizeof((p)->field) / sizeof((p)->field[0])); \
+        return 0; \
+    } \
+    needed += sizeof(mc_word) * (size_t) (elements); \
+    ASSERT_BUFFER_SIZE(buffer_size, needed); \
+    for (size_t i = 0; i < (size_t) (elements); ++i) { \
+        DECODE_slot(p, field[i]) \
+    }
+#define DECODE_ARRAY_payload(p, field, elements) DECODE_ARRAY_bytes(p, field, elements)
+
+#define DECODE_FIELD(kind, field) DECODE_##kind(p, field);
+#define DECODE_ARRAY(kind, field, elements) DECODE_ARRAY_##kind(p, field, elements);
+
+#define DEFINE_DECODER(version, type, name, member, layout) \
+    static int version##_decode_##name(uint8_t const* buf, size_t const buffer_size, \
+                                       struct mc_proto_client_packet* packet) { \
+        struct mc_proto_##name* p = &packet->member; \
+        (void) p; \
+        /* Fixed-size packets without fields never read the buffer. */ \
+        (void) buf; \
+        size_t needed = LAYOUT_MIN_SIZE(layout); \
+        ASSERT_BUFFER_SIZE(buffer_size, needed); \
+        size_t cursor = sizeof(mc_byte); \
+        layout(DECODE_FIELD, DECODE_ARRAY) \
+        return cursor; \
+    }
+
+
+/*
+ * Framers.
+ *
+ * A framer walks a packet the same way its decoder does but only reads what is needed to find the end of the packet:
+ * the values array counts are taken from and the length prefixes. Scalars are read into a scratch structure so the
+ * count expressions of the layout can be reused as they are. Fixed-size packets are framed by a single check.
+ */
+
+#define FRAME_byte(p, field)   DECODE_byte(p, field)
+#define FRAME_bool(p, field)   DECODE_bool(p, field)
+#define FRAME_word(p, field)   DECODE_word(p, field)
+#define FRAME_dword(p, field)  DECODE_dword(p, field)
+#define FRAME_qword(p, field)  DECODE_qword(p, field)
+#define FRAME_float(p, field)  DECODE_float(p, field)
+#define FRAME_double(p, field) DECODE_double(p, field)
+#define FRAME_zero(p, field)   (void) 0
+#define FRAME_empty(p, field)  (void) 0
+
+#define FRAME_slot(p, field) \
+    if (decode_word(buf, &cursor) >= 0) { \
+        needed += sizeof(mc_byte) + sizeof(mc_word); \
+        ASSERT_BUFFER_SIZE(buffer_size, needed); \
+        cursor += sizeof(mc_byte) + sizeof(mc_word); \
+    }
+
+#define FRAME_STRING(p, field, char_size) \
+    { \
+        mc_word const length = decode_word(buf, &cursor); \
+        if (length < 0) { \
+            OBS_LOG_WARN("protocol", "Received negative " #field " length %d. This is invalid data!", length); \
+            return 0; \
+        } \
+        needed += (char_size) * length; \
+        ASSERT_BUFFER_SIZE(buffer_size, needed); \
+        cursor += (char_size) * length; \
+    }
+
+#define FRAME_string8(p, field)  FRAME_STRING(p, field, sizeof(mc_utf8_char))
+#define FRAME_string16(p, field) FRAME_STRING(p, field, sizeof(mc_word))
+
+#define FRAME_ARRAY_SIZED(p, field, elements, element_size) \
+    if ((elements) < 0) { \
+        OBS_LOG_WARN("protocol", "Received negative " #field " size %d. This is invalid data!", (int) (elements)); \
+        return 0; \
+    } \
+    needed += (element_size) * (size_t) (elements); \
+    ASSERT_BUFFER_SIZE(buffer_size, needed); \
+    cursor += (element_size) * (size_t) (elements)
+
+#define FRAME_ARRAY_bytes(p, field, elements) FRAME_ARRAY_SIZED(p, field, elements, sizeof(mc_byte))
+#define FRAME_ARRAY_words(p, field, elements) FRAME_ARRAY_SIZED(p, field, elements, sizeof(mc_word))
+#define FRAME_ARRAY_payload(p, field, elements) FRAME_ARRAY_bytes(p, field, elements)
+
+#define FRAME_ARRAY_slots(p, field, elements) \
+    if ((elements) < 0) { \
+        OBS_LOG_WARN("protocol", "Received negative " #field " count %d. This is invalid data!", (int) (elements)); \
+        return 0; \
+    } \
+    needed += sizeof(mc_word) * (size_t) (elements); \
+    ASSERT_BUFFER_SIZE(buffer_size, needed); \
+    for (size_t i = 0; i < (size_t) (elements); ++i) { \
+        FRAME_slot(p, field[i]) \
+    }
+
+#define FRAME_FIELD(kind, field) FRAME_##kind(p, field);
+#define FRAME_ARRAY(kind, field, elements) FRAME_ARRAY_##kind(p, field, elements);
+
+#define DEFINE_FRAMER(version, type, name, member, layout) \
+    static int version##_frame_##name(uint8_t const* buf, size_t const buffer_size) { \
+        size_t needed = LAYOUT_MIN_SIZE(layout); \
+        ASSERT_BUFFER_SIZE(buffer_size, needed); \
+        if (LAYOUT_IS_FIXED(layout)) { \
+            (void) buf; \
+            return needed; \
+        } \
+        struct mc_proto_##name scratch; \
+        struct mc_proto_##name* p = &scratch; \
+        (void) p; \
+        size_t cursor = sizeof(mc_byte); \
+        layout(FRAME_FIELD, FRAME_ARRAY) \
+        return cursor; \
+    }
+
+/*
+ * Viewers.
+ *
+ * A viewer performs the same checks as its decoder, but strings and arrays are left in the source buffer. Strings are
+ * limited to as many code units as the decoded packet has room for bytes; a UCS-2 string can still turn out too long
+ * once it is converted. Slot arrays are walked to find their end.
+ */
+
+#define VIEW_byte(p, field)   DECODE_byte(p, field)
+#define VIEW_bool(p, field)   DECODE_bool(p, field)
+#define VIEW_word(p, field)   DECODE_word(p, field)
+#define VIEW_dword(p, field)  DECODE_dword(p, field)
+#define VIEW_qword(p, field)  DECODE_qword(p, field)
+#define VIEW_float(p, field)  DECODE_float(p, field)
+#define VIEW_double(p, field) DECODE_double(p, field)
+#define VIEW_zero(p, field)   DECODE_zero(p, field)
+#define VIEW_slot(p, field)   DECODE_slot(p, field)
+#define VIEW_empty(p, field)  (p)->field = (struct mc_proto_string_view) {.encoding = MC_PROTO_STRINGS_UTF8}
+
+#define VIEW_STRING(p, field, char_size, string_encoding) \
+    { \
+        mc_word const length = decode_word(buf, &cursor); \
+        if (length < 0 || (size_t) length > sizeof(decoded->field)) { \
+            OBS_LOG_WARN("protocol", "Received " #field " length %d > %zu. This is invalid data!", \
+                         length, sizeof(decoded->field)); \
+            return 0; \
+        } \
+        needed += (char_size) * length; \
+        ASSERT_BUFFER_SIZE(buffer_size, needed); \
+        (p)->field = (struct mc_proto_string_view) { \
+            .encoding = string_encoding, \
+            .length = length, \
+            .data = buf + cursor, \
+        }; \
+        cursor += (char_size) * length; \
+    }
+
+#define VIEW_string8(p, field)  VIEW_STRING(p, field, sizeof(mc_utf8_char), MC_PROTO_STRINGS_UTF8)
+#define VIEW_string16(p, field) VIEW_STRING(p, field, sizeof(mc_word), MC_PROTO_STRINGS_UCS2)
+
+#define VIEW_ARRAY_bytes(p, field, elements) DECODE_ARRAY_bytes(p, field, elements)
+#define VIEW_ARRAY_payload(p, field, elements) DECODE_ARRAY_bytes(p, field, elements)
+
+#define VIEW_ARRAY_slots(p, field, elements) \
+    if ((elements) < 0 || (size_t) (elements) > sizeof(decoded->field) / sizeof(decoded->field[0])) { \
+        OBS_LOG_WARN("protocol", "Received " #field " count %d > %zu. This is invalid data!", \
+                     (int) (elements), sizeof(decoded->field) / sizeof(decoded->field[0])); \
+        return 0; \
+    } \
+    needed += sizeof(mc_word) * (size_t) (elements); \
+    ASSERT_BUFFER_SIZE(buffer_size, needed); \
+    (p)->field = (mc_byte const*) buf + cursor; \
+    for (size_t i = 0; i < (size_t) (elements); ++i) { \
+        FRAME_slot(p, field[i]) \
+    }
+
+#define VIEW_FIELD(kind, field) VIEW_##kind(p, field);
+#define VIEW_ARRAY(kind, field, elements) VIEW_ARRAY_##kind(p, field, elements);
+
+#define DEFINE_VIEWER(version, type, name, member, layout) \
+    static int version##_view_##name(uint8_t const* buf, size_t const buffer_size, \
+                                     struct mc_proto_client_view* view) { \
+        typeof(view->member)* p = &view->member; \
+        (void) p; \
+        /* Fixed-size packets without fields never read the buffer. */ \
+        (void) buf; \
+        /* Only used to size strings and arrays like the decoder does. */ \
+        struct mc_proto_##name const* const decoded = NULL; \
+        (void) decoded; \
+        size_t needed = LAYOUT_MIN_SIZE(layout); \
+        ASSERT_BUFFER_SIZE(buffer_size, needed); \
+        size_t cursor = sizeof(mc_byte); \
+        layout(VIEW_FIELD, VIEW_ARRAY) \
+        return cursor; \
+    }
+
+
+/*
+ * Codecs. Every version gets its own copy of the generated functions and a dispatch table indexed by packet type.
+ */
+
+#define FRAMER_ENTRY(version, type, name, member, layout) [(uint8_t) type] = version##_frame_##name,
+#define VIEWER_ENTRY(version, type, name, member, layout) [(uint8_t) type] = version##_view_##name,
+#define DECODER_ENTRY(version, type, name, member, layout) [(uint8_t) type] = version##_decode_##name,
+#define ENCODER_ENTRY(version, type, name, member, layout) [(uint8_t) type] = version##_encode_##name,
+#define IOV_ENCODER_ENTRY(version, type, name, member, layout) [(uint8_t) type] = version##_encode_iov_##name,
+#define SIZER_ENTRY(version, type, name, member, layout) [(uint8_t) type] = version##_size_##name,
+#define FIXED_SIZE_ENTRY(version, type, name, member, layout) [(uint8_t) type] = LAYOUT_FIXED_SIZE(layout),
+
+#define ALPHA_DEFINE_FRAMER(...) DEFINE_FRAMER(alpha, __VA_ARGS__)
+#define ALPHA_DEFINE_DECODER(...) DEFINE_DECODER(alpha, __VA_ARGS__)
+#define ALPHA_DEFINE_VIEWER(...) DEFINE_VIEWER(alpha, __VA_ARGS__)
+#define ALPHA_DEFINE_ENCODER(...) DEFINE_ENCODER(alpha, __VA_ARGS__)
+#define ALPHA_DEFINE_IOV_ENCODER(...) DEFINE_IOV_ENCODER(alpha, __VA_ARGS__)
+#define ALPHA_DEFINE_SIZER(...) DEFINE_SIZER(alpha, __VA_ARGS__)
+#define ALPHA_FRAMER_ENTRY(...) FRAMER_ENTRY(alpha, __VA_ARGS__)
+#define ALPHA_DECODER_ENTRY(...) DECODER_ENTRY(alpha, __VA_ARGS__)
+#define ALPHA_VIEWER_ENTRY(...) VIEWER_ENTRY(alpha, __VA_ARGS__)
+#define ALPHA_ENCODER_ENTRY(...) ENCODER_ENTRY(alpha, __VA_ARGS__)
+#define ALPHA_IOV_ENCODER_ENTRY(...) IOV_ENCODER_ENTRY(alpha, __VA_ARGS__)
+#define ALPHA_SIZER_ENTRY(...) SIZER_ENTRY(alpha, __VA_ARGS__)
+#define ALPHA_FIXED_SIZE_ENTRY(...) FIXED_SIZE_ENTRY(alpha, __VA_ARGS__)
+
+ALPHA_CLIENT_PACKETS(ALPHA_DEFINE_FRAMER)
+ALPHA_CLIENT_PACKETS(ALPHA_DEFINE_DECODER)
+ALPHA_CLIENT_PACKETS(ALPHA_DEFINE_VIEWER)
+ALPHA_SERVER_PACKETS(ALPHA_DEFINE_ENCODER)
+ALPHA_SERVER_PACKETS(ALPHA_DEFINE_IOV_ENCODER)
+ALPHA_SERVER_PACKETS(ALPHA_DEFINE_SIZER)
+
+static struct mc_proto_codec const alpha_codec = {
+    .name = "alpha",
+    .protocol_version = 1,
+    .string_encoding = MC_PROTO_STRINGS_UTF8,
+    .framers = {ALPHA_CLIENT_PACKETS(ALPHA_FRAMER_ENTRY)},
+    .decoders = {ALPHA_CLIENT_PACKETS(ALPHA_DECODER_ENTRY)},
+    .viewers = {ALPHA_CLIENT_PACKETS(ALPHA_VIEWER_ENTRY)},
+    .encoders = {ALPHA_SERVER_PACKETS(ALPHA_ENCODER_ENTRY)},
+    .iov_encoders = {ALPHA_SERVER_PACKETS(ALPHA_IOV_ENCODER_ENTRY)},
+    .sizers = {ALPHA_SERVER_PACKETS(ALPHA_SIZER_ENTRY)},
+    .fixed_sizes = {ALPHA_SERVER_PACKETS(ALPHA_FIXED_SIZE_ENTRY)},
+};
+
+#define BETA_DEFINE_FRAMER(...) DEFINE_FRAMER(beta, __VA_ARGS__)
+#define BETA_DEFINE_DECODER(...) DEFINE_DECODER(beta, __VA_ARGS__)
+#define BETA_DEFINE_VIEWER(...) DEFINE_VIEWER(beta, __VA_ARGS__)
+#define BETA_DEFINE_ENCODER(...) DEFINE_ENCODER(beta, __VA_ARGS__)
+#define BETA_DEFINE_IOV_ENCODER(...) DEFINE_IOV_ENCODER(beta, __VA_ARGS__)
+#define BETA_DEFINE_SIZER(...) DEFINE_SIZER(beta, __VA_ARGS__)
+#define BETA_FRAMER_ENTRY(...) FRAMER_ENTRY(beta, __VA_ARGS__)
+#define BETA_DECODER_ENTRY(...) DECODER_ENTRY(beta, __VA_ARGS__)
+#define BETA_VIEWER_ENTRY(...) VIEWER_ENTRY(beta, __VA_ARGS__)
+#define BETA_ENCODER_ENTRY(...) ENCODER_ENTRY(beta, __VA_ARGS__)
+#define BETA_IOV_ENCODER_ENTRY(...) IOV_ENCODER_ENTRY(beta, __VA_ARGS__)
+#define BETA_SIZER_ENTRY(...) SIZER_ENTRY(beta, __VA_ARGS__)
+#define BETA_FIXED_SIZE_ENTRY(...) FIXED_SIZE_ENTRY(beta, __VA_ARGS__)
+
+BETA_CLIENT_PACKETS(BETA_DEFINE_FRAMER)
+BETA_CLIENT_PACKETS(BETA_DEFINE_DECODER)
+BETA_CLIENT_PACKETS(BETA_DEFINE_VIEWER)
+BETA_SERVER_PACKETS(BETA_DEFINE_ENCODER)
+BETA_SERVER_PACKETS(BETA_DEFINE_IOV_ENCODER)
+BETA_SERVER_PACKETS(BETA_DEFINE_SIZER)
+
+static struct mc_proto_codec const beta_codec = {
+    .name = "beta 1.7.3",
+    .protocol_version = 14,
+    .string_encoding = MC_PROTO_STRINGS_UCS2,
+    .framers = {BETA_CLIENT_PACKETS(BETA_FRAMER_ENTRY)},
+    .decoders = {BETA_CLIENT_PACKETS(BETA_DECODER_ENTRY)},
+    .viewers = {BETA_CLIENT_PACKETS(BETA_VIEWER_ENTRY)},
+    .encoders = {BETA_SERVER_PACKETS(BETA_ENCODER_ENTRY)},
+    .iov_encoders = {BETA_SERVER_PACKETS(BETA_IOV_ENCODER_ENTRY)},
+    .sizers = {BETA_SERVER_PACKETS(BETA_SIZER_ENTRY)},
+    .fixed_sizes = {BETA_SERVER_PACKETS(BETA_FIXED_SIZE_ENTRY)},
+};
+
+/// Every supported protocol version. Clients of versions that are not listed here are disconnected on login.
+static struct mc_proto_codec const* const codecs[] = {
+    &alpha_codec,
+    &beta_codec,
+};
+
+
+struct mc_proto_codec const* mc_proto_codec_for_version(mc_dword const protocol_version) {
+    for (size_t i = 0; i < sizeof(codecs) / sizeof(codecs[0]); ++i) {
+        if (codecs[i]->protocol_version == protocol_version) {
+            return codecs[i];
+        }
+    }
+    return NULL;
 }
 
-int mc_proto_decode_player_grounded(void const* buffer, size_t const buffer_size,
-                                    struct mc_proto_player_grounded* grounded) {
+int mc_proto_detect_codec(void const* buffer, size_t const buffer_size, struct mc_proto_codec const** codec) {
     assert(buffer != NULL);
-    assert(grounded != NULL);
-    ASSERT_BUFFER_SIZE(buffer_size, sizeof(mc_byte) + sizeof(mc_bool));
+    assert(codec != NULL);
+    ASSERT_BUFFER_SIZE(buffer_size, sizeof(mc_byte) + sizeof(mc_word));
+    uint8_t const* buf = buffer;
     size_t cursor = 0;
-    mc_byte const type = decode_byte(buffer, &cursor);
-    if (type != MC_PACKET_PLAYER_GROUNDED) {
+    if (decode_byte(buf, &cursor) != MC_PACKET_HANDSHAKE) {
         return 0;
     }
-    grounded->grounded = decode_byte(buffer, &cursor);
-    return cursor;
+    if (decode_word(buf, &cursor) <= 0) {
+        // Nothing to go by, assume the oldest version.
+        *codec = &alpha_codec;
+        return cursor;
+    }
+    ASSERT_BUFFER_SIZE(buffer_size, cursor + 1);
+    // Usernames are plain ASCII. The first byte of a UCS-2 username is the high byte of its first character, which is
+    // always zero, whereas the first byte of a UTF-8 username never is.
+    *codec = buf[cursor] == 0 ? &beta_codec : &alpha_codec;
+    return cursor + 1;
 }
 
-int mc_proto_decode_player_position(void const* buffer, size_t const buffer_size,
-                                    struct mc_proto_player_position* position) {
+int mc_proto_frame_client_packet(struct mc_proto_codec const* codec, void const* buffer, size_t const buffer_size) {
+    assert(codec != NULL);
     assert(buffer != NULL);
-    assert(position != NULL);
-    ASSERT_BUFFER_SIZE(buffer_size, sizeof(mc_byte) + sizeof(mc_double) * 4 + sizeof(mc_bool));
-    size_t cursor = 0;
-    mc_byte const type = decode_byte(buffer, &cursor);
-    if (type != MC_PACKET_PLAYER_POSITION) {
+    ASSERT_BUFFER_SIZE(buffer_size, 1);
+    mc_byte const type = *(mc_byte const*) buffer;
+    int (*framer)(uint8_t const*, size_t) = codec->framers[(uint8_t) type];
+    if (framer == NULL) {
+        OBS_LOG_WARN("protocol", "Cannot frame packet with unknown type 0x%02X for %s", (uint8_t) type, codec->name);
         return 0;
     }
-    position->x = decode_double(buffer, &cursor);
-    position->y = decode_double(buffer, &cursor);
-    position->head_y = decode_double(buffer, &cursor);
-    position->z = decode_double(buffer, &cursor);
-    position->grounded = decode_byte(buffer, &cursor);
-    return cursor;
+    return framer(buffer, buffer_size);
 }
 
-int mc_proto_decode_player_rotation(void const* buffer, size_t const buffer_size,
-    struct mc_proto_player_rotation* rotation) {
-    assert(buffer != NULL);
-    assert(rotation != NULL);
-    ASSERT_BUFFER_SIZE(buffer_size, sizeof(mc_byte) + sizeof(mc_float) * 2 + sizeof(mc_bool));
+size_t mc_proto_scan_client_packets(struct mc_proto_codec const* codec, void const* buffer, size_t const buffer_size,
+                                    size_t* lengths, size_t const max_packets, int* status) {
+    assert(lengths != NULL);
+    assert(status != NULL);
+    uint8_t const* buf = buffer;
     size_t cursor = 0;
-    mc_byte const type = decode_byte(buffer, &cursor);
-    if (type != MC_PACKET_PLAYER_ROTATION) {
-        return 0;
+    size_t count = 0;
+    for (;;) {
+        *status = mc_proto_frame_client_packet(codec, buf + cursor, buffer_size - cursor);
+        if (*status <= 0 || count == max_packets) {
+            return count;
+        }
+        lengths[count++] = *status;
+        cursor += *status;
     }
-    rotation->yaw = decode_float(buffer, &cursor);
-    rotation->pitch = decode_float(buffer, &cursor);
-    rotation->grounded = decode_byte(buffer, &cursor);
-    return cursor;
 }
 
-int mc_proto_encode_player_transform(void* buffer, size_t const buffer_size, struct mc_proto_player_transform const* transform) {
-    assert(transform != NULL);
-    size_t const needed = sizeof(mc_byte) + sizeof(mc_double) * 4 + sizeof(mc_float) * 2 + sizeof(mc_bool);
-    ASSERT_BUFFER_SIZE(buffer_size, needed);
+int mc_proto_decode_client_packet(struct mc_proto_codec const* codec, void const* buffer, size_t const buffer_size,
+                                  struct mc_proto_client_packet* packet) {
+    assert(codec != NULL);
     assert(buffer != NULL);
-    size_t cursor = 0;
-    encode_byte(buffer, MC_PACKET_PLAYER_TRANSFORM, &cursor);
-    encode_double(buffer, transform->x, &cursor);
-    // Order for y and head_y is inverted when sending to client.
-    encode_double(buffer, transform->head_y, &cursor);
-    encode_double(buffer, transform->y, &cursor);
-    encode_double(buffer, transform->z, &cursor);
-    encode_float(buffer, transform->yaw, &cursor);
-    encode_float(buffer, transform->pitch, &cursor);
-    encode_byte(buffer, transform->grounded, &cursor);
-    return cursor;
+    assert(packet != NULL);
+    ASSERT_BUFFER_SIZE(buffer_size, 1);
+    packet->type = *(mc_byte const*) buffer;
+    int (*decoder)(uint8_t const*, size_t, struct mc_proto_client_packet*) = codec->decoders[(uint8_t) packet->type];
+    if (decoder == NULL) {
+        OBS_LOG_WARN("protocol", "Cannot decode packet with unknown type 0x%02X for %s",
+                     (uint8_t) packet->type, codec->name);
+        return 0;
+    }
+    return decoder(buffer, buffer_size, packet);
 }
 
-int mc_proto_decode_player_transform(void const* buffer, size_t buffer_size,
-                                     struct mc_proto_player_transform* transform) {
+int mc_proto_view_client_packet(struct mc_proto_codec const* codec, void const* buffer, size_t const buffer_size,
+                                struct mc_proto_client_view* view) {
+    assert(codec != NULL);
     assert(buffer != NULL);
-    assert(transform != NULL);
-    ASSERT_BUFFER_SIZE(buffer_size, sizeof(mc_byte) + sizeof(mc_double) * 4 + sizeof(mc_float) * 2 + sizeof(mc_bool));
-    size_t cursor = 0;
-    mc_byte const type = decode_byte(buffer, &cursor);
-    if (type != MC_PACKET_PLAYER_TRANSFORM) {
+    assert(view != NULL);
+    ASSERT_BUFFER_SIZE(buffer_size, 1);
+    view->type = *(mc_byte const*) buffer;
+    int (*viewer)(uint8_t const*, size_t, struct mc_proto_client_view*) = codec->viewers[(uint8_t) view->type];
+    if (viewer == NULL) {
+        OBS_LOG_WARN("protocol", "Cannot view packet with unknown type 0x%02X for %s",
+                     (uint8_t) view->type, codec->name);
         return 0;
     }
-    transform->x = decode_double(buffer, &cursor);
-    transform->y = decode_double(buffer, &cursor);
-    transform->head_y = decode_double(buffer, &cursor);
-    transform->z = decode_double(buffer, &cursor);
-    transform->yaw = decode_float(buffer, &cursor);
-    transform->pitch = decode_float(buffer, &cursor);
-    transform->grounded = decode_byte(buffer, &cursor);
-    return cursor;
+    return viewer(buffer, buffer_size, view);
 }
 
-int mc_proto_encode_chunk(void* buffer, size_t buffer_size, struct mc_proto_chunk const* chunk) {
-    assert(chunk != NULL);
-    size_t const needed = sizeof(mc_byte) + sizeof(mc_dword) * 2 + sizeof(mc_bool);
-    ASSERT_BUFFER_SIZE(buffer_size, needed);
-    assert(buffer != NULL);
-    size_t cursor = 0;
-    encode_byte(buffer, MC_PACKET_CHUNK, &cursor);
-    encode_dword(buffer, chunk->x, &cursor);
-    encode_dword(buffer, chunk->z, &cursor);
-    encode_byte(buffer, chunk->initialize, &cursor);
-    return cursor;
+int mc_proto_string_view_to_utf8(struct mc_proto_string_view const* view, mc_utf8_char* dst, size_t const capacity) {
+    assert(view != NULL);
+    assert(dst != NULL);
+    if (view->encoding == MC_PROTO_STRINGS_UCS2) {
+        size_t cursor = 0;
+        return decode_ucs2_string(dst, capacity, view->data, view->length, &cursor);
+    }
+    if ((size_t) view->length > capacity) {
+        return -1;
+    }
+    memcpy(dst, view->data, view->length);
+    return view->length;
 }
 
-int mc_proto_encode_chunk_data(void* buffer, size_t buffer_size, struct mc_proto_chunk_data const* chunk_data) {
-    assert(chunk_data != NULL);
-    size_t const needed = sizeof(mc_byte) * 4 + sizeof(mc_dword) * 3 + sizeof(mc_word)
-                          + sizeof(mc_byte) * chunk_data->compressed_size;
-    ASSERT_BUFFER_SIZE(buffer_size, needed);
-    assert(buffer != NULL);
+mc_byte const* mc_proto_read_slot(mc_byte const* data, struct mc_proto_slot* slot) {
+    assert(data != NULL);
+    assert(slot != NULL);
+    uint8_t const* buf = (uint8_t const*) data;
     size_t cursor = 0;
-    encode_byte(buffer, MC_PACKET_CHUNK_DATA, &cursor);
-    encode_dword(buffer, chunk_data->x, &cursor);
-    encode_word(buffer, chunk_data->y, &cursor);
-    encode_dword(buffer, chunk_data->z, &cursor);
-    encode_byte(buffer, chunk_data->x_size, &cursor);
-    encode_byte(buffer, chunk_data->y_size, &cursor);
-    encode_byte(buffer, chunk_data->z_size, &cursor);
-    encode_dword(buffer, chunk_data->compressed_size, &cursor);
-    encode_byte_array(buffer, chunk_data->data, chunk_data->compressed_size, &cursor);
-    return cursor;
+    slot->id = decode_word(buf, &cursor);
+    slot->count = 0;
+    slot->damage = 0;
+    if (slot->id >= 0) {
+        slot->count = decode_byte(buf, &cursor);
+        slot->damage = decode_word(buf, &cursor);
+    }
+    return data + cursor;
 }
 
-int mc_proto_decode_client_packet(void const* buffer, size_t const buffer_size, struct mc_proto_client_packet* packet) {
-    assert(buffer != NULL);
+size_t mc_proto_server_packet_size(struct mc_proto_codec const* codec, struct mc_proto_server_packet const* packet) {
+    assert(codec != NULL);
     assert(packet != NULL);
-    ASSERT_BUFFER_SIZE(buffer_size, 1);
-    size_t cursor = 0;
-    packet->type = decode_byte(buffer, &cursor);
-
-    switch (packet->type) {
-        case MC_PACKET_HEARTBEAT:
-            return mc_proto_decode_heartbeat(buffer, buffer_size, &packet->heartbeat);
-
-        case MC_PACKET_AUTHENTICATION:
-            return mc_proto_decode_authentication_request(buffer, buffer_size, &packet->authentication);
-
-        case MC_PACKET_HANDSHAKE:
-            return mc_proto_decode_handshake_request(buffer, buffer_size, &packet->handshake);
-
-        case MC_PACKET_PLAYER_GROUNDED:
-            return mc_proto_decode_player_grounded(buffer, buffer_size, &packet->grounded);
-
-        case MC_PACKET_PLAYER_POSITION:
-            return mc_proto_decode_player_position(buffer, buffer_size, &packet->position);
-
-        case MC_PACKET_PLAYER_ROTATION:
-            return mc_proto_decode_player_rotation(buffer, buffer_size, &packet->rotation);
-
-        case MC_PACKET_PLAYER_TRANSFORM:
-            return mc_proto_decode_player_transform(buffer, buffer_size, &packet->transform);
-
-        default:
-            OBS_LOG_WARN("protocol", "Cannot decode packet with unknown type 0x%02X", packet->type);
-            return 0;
+    size_t (*sizer)(struct mc_proto_server_packet const*) = codec->sizers[(uint8_t) packet->type];
+    if (sizer == NULL) {
+        OBS_LOG_WARN("protocol", "Cannot size packet with unknown type 0x%02X for %s",
+                     (uint8_t) packet->type, codec->name);
+        return 0;
     }
+    return sizer(packet);
 }
 
-int mc_proto_encode_server_packet(void* buffer, size_t const buffer_size, struct mc_proto_server_packet const* packet) {
+int mc_proto_encode_server_packet(struct mc_proto_codec const* codec, void* buffer, size_t const buffer_size,
+                                  struct mc_proto_server_packet const* packet) {
+    assert(codec != NULL);
     assert(packet != NULL);
+    int (*encoder)(void*, size_t, struct mc_proto_server_packet const*) = codec->encoders[(uint8_t) packet->type];
+    if (encoder == NULL) {
+        OBS_LOG_WARN("protocol", "Cannot encode packet with unknown type 0x%02X for %s",
+                     (uint8_t) packet->type, codec->name);
+        return 0;
+    }
+    return encoder(buffer, buffer_size, packet);
+}
 
-    switch (packet->type) {
-        case MC_PACKET_HEARTBEAT:
-            return mc_proto_encode_heartbeat(buffer, buffer_size, &packet->heartbeat);
-
-        case MC_PACKET_AUTHENTICATION:
-            return mc_proto_encode_authentication_response(buffer, buffer_size, &packet->authentication);
-
-        case MC_PACKET_HANDSHAKE:
-            return mc_proto_encode_handshake_response(buffer, buffer_size, &packet->handshake);
-
-        case MC_PACKET_TIME:
-            return mc_proto_encode_time(buffer, buffer_size, &packet->time);
-
-        case MC_PACKET_PLAYER_TRANSFORM:
-            return mc_proto_encode_player_transform(buffer, buffer_size, &packet->transform);
-
-        case MC_PACKET_CHUNK:
-            return mc_proto_encode_chunk(buffer, buffer_size, &packet->chunk);
-
-        case MC_PACKET_CHUNK_DATA:
-            return mc_proto_encode_chunk_data(buffer, buffer_size, &packet->chunk_data);
-
-        default:
-            OBS_LOG_WARN("protocol", "Cannot encode packet with unknown type 0x%02X", packet->type);
-            return 0;
+int mc_proto_encode_server_packet_iov(struct mc_proto_codec const* codec, void* buffer, size_t const buffer_size,
+                                      struct mc_proto_server_packet const* packet, struct iovec iov[2]) {
+    assert(codec != NULL);
+    assert(packet != NULL);
+    assert(iov != NULL);
+    int (*encoder)(void*, size_t, struct mc_proto_server_packet const*, struct iovec*) =
+        codec->iov_encoders[(uint8_t) packet->type];
+    if (encoder == NULL) {
+        OBS_LOG_WARN("protocol", "Cannot encode packet with unknown type 0x%02X for %s",
+                     (uint8_t) packet->type, codec->name);
+        return 0;
     }
+    return encoder(buffer, buffer_size, packet, iov);
 }
@@ -0,0 +1,275 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/region.h"
+#include "obsidian/minecraft/nbt.h"
+#include "obsidian/log.h"
+
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/// Size of a sector of a region file in bytes.
+#define SECTOR_SIZE 4096
+
+/// Amount of chunks in a region.
+#define REGION_CHUNKS (MC_REGION_SIZE * MC_REGION_SIZE)
+
+/// Size of the header of a region file, the offset table followed by the timestamp table.
+#define HEADER_SIZE (2 * SECTOR_SIZE)
+
+/// Initial size of the buffer chunk NBT is inflated into, enough for most chunks.
+#define INITIAL_SCRATCH_SIZE (128 * 1024)
+
+/// Largest buffer chunk NBT is inflated into. Saved chunks are far smaller, anything larger is not a chunk.
+#define MAX_SCRATCH_SIZE (4 * 1024 * 1024)
+
+struct mc_region {
+    /// The mapped file.
+    uint8_t const* data;
+
+    /// Size of the file in bytes.
+    size_t size;
+
+    /// Location of every chunk: the sector offset in the upper 24 bits and the sector count in the lower 8 bits.
+    uint32_t locations[REGION_CHUNKS];
+};
+
+
+/*!
+ * Reads a big-endian integer from an unaligned address.
+ */
+static inline uint32_t read_u32(uint8_t const* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return be32toh(value);
+}
+
+/*!
+ * The parts of the Level compound of a chunk that are loaded.
+ */
+struct chunk_tags {
+    int32_t x;
+    int32_t z;
+    uint8_t const* blocks;
+    uint8_t const* metadata;
+    uint8_t const* block_light;
+    uint8_t const* sky_light;
+    uint8_t const* heightmap;
+};
+
+/*!
+ * Finds the parts of a chunk that are loaded in its inflated NBT.
+ * \return Whether the chunk is well-formed and has block data.
+ */
+static bool find_chunk_tags(uint8_t const* buf, size_t const size, struct chunk_tags* tags) {
+    // The root is an unnamed compound holding the Level compound.
+    struct mc_nbt_reader reader;
+    struct mc_nbt_tag tag;
+    mc_nbt_reader_init(&reader, buf, size);
+    if (!mc_nbt_next(&reader, &tag) || tag.type != MC_NBT_COMPOUND || !mc_nbt_enter(&reader) ||
+        !mc_nbt_find(&reader, "Level", MC_NBT_COMPOUND, &tag) || !mc_nbt_enter(&reader)) {
+        return false;
+    }
+    *tags = (struct chunk_tags) {0};
+    while (mc_nbt_next(&reader, &tag)) {
+        if (tag.type == MC_NBT_INT && mc_nbt_is_named(&tag, "xPos")) {
+            tags->x = (int32_t) mc_nbt_integer(&tag);
+        }
+        else if (tag.type == MC_NBT_INT && mc_nbt_is_named(&tag, "zPos")) {
+            tags->z = (int32_t) mc_nbt_integer(&tag);
+        }
+        else if (tag.type == MC_NBT_BYTE_ARRAY) {
+            uint8_t const* data = tag.payload + 4;
+#define MATCH_ARRAY(tag_name, field, expected) \
+            if (mc_nbt_is_named(&tag, tag_name)) { \
+                if (tag.length != (expected)) { \
+                    return false; \
+                } \
+                tags->field = data; \
+            }
+            MATCH_ARRAY("Blocks", blocks, MC_CHUNK_BLOCKS)
+            MATCH_ARRAY("Data", metadata, MC_CHUNK_BLOCKS / 2)
+            MATCH_ARRAY("BlockLight", block_light, MC_CHUNK_BLOCKS / 2)
+            MATCH_ARRAY("SkyLight", sky_light, MC_CHUNK_BLOCKS / 2)
+            MATCH_ARRAY("HeightMap", heightmap, MC_CHUNK_WIDTH * MC_CHUNK_DEPTH)
+#undef MATCH_ARRAY
+        }
+    }
+    return !reader.error && tags->blocks != NULL && tags->metadata != NULL;
+}
+
+struct mc_region* mc_region_open(char const* path) {
+    int const fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    return mc_region_map(fd, path);
+}
+
+struct mc_region* mc_region_map(int const fd, char const* path) {
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < HEADER_SIZE) {
+        OBS_LOG_WARN("region", "%s is not a region file", path);
+        close(fd);
+        return NULL;
+    }
+    // The mapping keeps the file alive, the descriptor is not needed past this point.
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        OBS_LOG_PERROR("region", "mmap");
+        return NULL;
+    }
+    struct mc_region* region = malloc(sizeof(struct mc_region));
+    if (region == NULL) {
+        munmap(data, st.st_size);
+        return NULL;
+    }
+    region->data = data;
+    region->size = st.st_size;
+    for (size_t i = 0; i < REGION_CHUNKS; ++i) {
+        region->locations[i] = read_u32(region->data + i * sizeof(uint32_t));
+    }
+    OBS_LOG_TRACE("region", "Mapped %s (%llu KB)", path, region->size / 1024);
+    return region;
+}
+
+void mc_region_close(struct mc_region* region) {
+    munmap((void*) region->data, region->size);
+    free(region);
+}
+
+bool mc_region_has_chunk(struct mc_region const* region, int32_t const chunk_x, int32_t const chunk_z) {
+    return region->locations[(chunk_x & 31) + (chunk_z & 31) * MC_REGION_SIZE] != 0;
+}
+
+struct mc_chunk* mc_region_load_chunk(struct mc_region const* region, int32_t const chunk_x, int32_t const chunk_z,
+                                      z_stream* stream, uint8_t** scratch, size_t* scratch_size) {
+    uint32_t const location = region->locations[(chunk_x & 31) + (chunk_z & 31) * MC_REGION_SIZE];
+    if (location == 0) {
+        return NULL;
+    }
+    size_t const offset = (size_t) (location >> 8) * SECTOR_SIZE;
+    size_t const capacity = (size_t) (location & 0xFF) * SECTOR_SIZE;
+    if (offset < HEADER_SIZE || offset + 5 > region->size) {
+        OBS_LOG_WARN("region", "Chunk %d, %d points outside of its region", chunk_x, chunk_z);
+        return NULL;
+    }
+    size_t const length = read_u32(region->data + offset);
+    if (length < 1 || length + 4 > capacity || offset + 4 + length > region->size) {
+        OBS_LOG_WARN("region", "Chunk %d, %d has an invalid length of %llu bytes", chunk_x, chunk_z, length);
+        return NULL;
+    }
+
+    // Both gzip (type 1) and zlib (type 2) data are detected from their header.
+    if (inflateReset2(stream, 15 + 32) != Z_OK) {
+        return NULL;
+    }
+    if (*scratch == NULL) {
+        *scratch = malloc(INITIAL_SCRATCH_SIZE);
+        if (*scratch == NULL) {
+            *scratch_size = 0;
+            return NULL;
+        }
+        *scratch_size = INITIAL_SCRATCH_SIZE;
+    }
+    stream->next_in = (Bytef*) region->data + offset + 5;
+    stream->avail_in = length - 1;
+    stream->next_out = *scratch;
+    stream->avail_out = *scratch_size;
+    int result;
+    while ((result = inflate(stream, Z_NO_FLUSH)) == Z_OK || (result == Z_BUF_ERROR && stream->avail_out == 0)) {
+        if (stream->avail_out == 0) {
+            if (*scratch_size >= MAX_SCRATCH_SIZE) {
+                OBS_LOG_WARN("region", "Chunk %d, %d inflates to more than %d KB", chunk_x, chunk_z,
+                             MAX_SCRATCH_SIZE / 1024);
+                return NULL;
+            }
+            uint8_t* larger = realloc(*scratch, *scratch_size * 2);
+            if (larger == NULL) {
+                return NULL;
+            }
+            *scratch = larger;
+            stream->next_out = larger + *scratch_size;
+            stream->avail_out = *scratch_size;
+            *scratch_size *= 2;
+        }
+    }
+    if (result != Z_STREAM_END) {
+        OBS_LOG_WARN("region", "Chunk %d, %d could not be inflated: %s", chunk_x, chunk_z, stream->msg);
+        return NULL;
+    }
+
+    struct chunk_tags tags;
+    if (!find_chunk_tags(*scratch, stream->total_out, &tags)) {
+        OBS_LOG_WARN("region", "Chunk %d, %d is missing block data", chunk_x, chunk_z);
+        return NULL;
+    }
+    if (tags.x != chunk_x || tags.z != chunk_z) {
+        OBS_LOG_WARN("region", "Chunk %d, %d claims to be at %d, %d", chunk_x, chunk_z, tags.x, tags.z);
+    }
+    struct mc_chunk* chunk = mc_chunk_create(chunk_x, chunk_z);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    // The saved arrays have the same layout as the chunk data, each is a single copy.
+    memcpy(chunk->data + MC_CHUNK_BLOCKS_OFFSET, tags.blocks, MC_CHUNK_BLOCKS);
+    memcpy(chunk->data + MC_CHUNK_METADATA_OFFSET, tags.metadata, MC_CHUNK_BLOCKS / 2);
+    if (tags.block_light != NULL) {
+        memcpy(chunk->data + MC_CHUNK_BLOCK_LIGHT_OFFSET, tags.block_light, MC_CHUNK_BLOCKS / 2);
+    }
+    if (tags.sky_light != NULL) {
+        memcpy(chunk->data + MC_CHUNK_SKY_LIGHT_OFFSET, tags.sky_light, MC_CHUNK_BLOCKS / 2);
+    }
+    if (tags.heightmap != NULL) {
+        memcpy(chunk->heightmap, tags.heightmap, sizeof(chunk->heightmap));
+    }
+    else {
+        mc_chunk_update(chunk);
+        chunk->modification = 0;
+    }
+    return chunk;
+}
+
+size_t mc_region_write_chunk(struct mc_chunk const* chunk, uint64_t const time, void* buffer, size_t const capacity) {
+    struct mc_nbt_writer writer;
+    mc_nbt_writer_init(&writer, buffer, capacity);
+    mc_nbt_write_header(&writer, MC_NBT_COMPOUND, "");
+    mc_nbt_write_header(&writer, MC_NBT_COMPOUND, "Level");
+    mc_nbt_write_int(&writer, "xPos", chunk->x);
+    mc_nbt_write_int(&writer, "zPos", chunk->z);
+    mc_nbt_write_long(&writer, "LastUpdate", (int64_t) time);
+    mc_nbt_write_byte(&writer, "TerrainPopulated", 1);
+    // The arrays are written straight from the chunk data, which has the layout they are saved in.
+    mc_nbt_write_byte_array(&writer, "Blocks", chunk->data + MC_CHUNK_BLOCKS_OFFSET, MC_CHUNK_BLOCKS);
+    mc_nbt_write_byte_array(&writer, "Data", chunk->data + MC_CHUNK_METADATA_OFFSET, MC_CHUNK_BLOCKS / 2);
+    mc_nbt_write_byte_array(&writer, "BlockLight", chunk->data + MC_CHUNK_BLOCK_LIGHT_OFFSET, MC_CHUNK_BLOCKS / 2);
+    mc_nbt_write_byte_array(&writer, "SkyLight", chunk->data + MC_CHUNK_SKY_LIGHT_OFFSET, MC_CHUNK_BLOCKS / 2);
+    mc_nbt_write_byte_array(&writer, "HeightMap", chunk->heightmap, sizeof(chunk->heightmap));
+    mc_nbt_write_list(&writer, "Entities", MC_NBT_COMPOUND, 0);
+    mc_nbt_write_list(&writer, "TileEntities", MC_NBT_COMPOUND, 0);
+    mc_nbt_write_end(&writer);
+    mc_nbt_write_end(&writer);
+    return writer.cursor;
+}
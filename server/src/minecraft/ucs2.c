@@ -0,0 +1,401 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "obsidian/minecraft/ucs2.h"
+#include "obsidian/log.h"
+
+#include <endian.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+/*!
+ * One implementation of the conversions.
+ */
+struct mc_ucs2_kernels {
+    /// Name of the implementation, for logging.
+    char const* name;
+
+    size_t (*length)(mc_utf8_char const* src, size_t length);
+    size_t (*from_utf8)(uint8_t* dst, mc_utf8_char const* src, size_t length);
+    int (*to_utf8)(mc_utf8_char* dst, size_t capacity, uint8_t const* src, size_t units);
+};
+
+
+/*
+ * Single character steps. The vector implementations fall back to these for anything that is not ASCII.
+ */
+
+/*!
+ * Reads a single code point from a UTF-8 string. Invalid sequences are read as a single '?' character.
+ */
+static inline uint32_t utf8_next(mc_utf8_char const* str, size_t const len, size_t* i) {
+    uint8_t const lead = str[*i];
+    if (lead < 0x80) {
+        ++*i;
+        return lead;
+    }
+    size_t trail;
+    uint32_t cp;
+    if ((lead & 0xE0) == 0xC0) {
+        trail = 1;
+        cp = lead & 0x1F;
+    }
+    else if ((lead & 0xF0) == 0xE0) {
+        trail = 2;
+        cp = lead & 0x0F;
+    }
+    else if ((lead & 0xF8) == 0xF0) {
+        trail = 3;
+        cp = lead & 0x07;
+    }
+    else {
+        ++*i;
+        return '?';
+    }
+    if (*i + trail >= len) {
+        ++*i;
+        return '?';
+    }
+    for (size_t k = 1; k <= trail; ++k) {
+        uint8_t const c = str[*i + k];
+        if ((c & 0xC0) != 0x80) {
+            ++*i;
+            return '?';
+        }
+        cp = cp << 6 | (c & 0x3F);
+    }
+    *i += trail + 1;
+    return cp <= 0x10FFFF ? cp : '?';
+}
+
+static inline void store_ucs2(uint8_t* dst, uint16_t x) {
+    x = htobe16(x);
+    memcpy(dst, &x, sizeof(x));
+}
+
+static inline uint16_t load_ucs2(uint8_t const* src) {
+    uint16_t x;
+    memcpy(&x, src, sizeof(x));
+    return be16toh(x);
+}
+
+/*!
+ * Counts the UCS-2 characters of the code point at index i and moves past it.
+ */
+static inline size_t length_step(mc_utf8_char const* src, size_t const length, size_t* i) {
+    return utf8_next(src, length, i) >= 0x10000 ? 2 : 1;
+}
+
+/*!
+ * Converts the code point at index i to UCS-2 and moves past it.
+ * \return Amount of UCS-2 characters written.
+ */
+static inline size_t from_utf8_step(uint8_t* dst, mc_utf8_char const* src, size_t const length, size_t* i) {
+    uint32_t const cp = utf8_next(src, length, i);
+    if (cp >= 0x10000) {
+        store_ucs2(dst, 0xD800 | (cp - 0x10000) >> 10);
+        store_ucs2(dst + sizeof(uint16_t), 0xDC00 | (cp & 0x3FF));
+        return 2;
+    }
+    store_ucs2(dst, cp);
+    return 1;
+}
+
+/*!
+ * Converts the UCS-2 character at index i to UTF-8 and moves past it, joining surrogate pairs.
+ * \return false if the character does not fit in the destination.
+ */
+static inline bool to_utf8_step(mc_utf8_char* dst, size_t const capacity, size_t* out,
+                                uint8_t const* src, size_t const units, size_t* i) {
+    uint32_t cp = load_ucs2(src + *i * sizeof(uint16_t));
+    ++*i;
+    // Lone surrogates are kept as they are.
+    if (cp >= 0xD800 && cp < 0xDC00 && *i < units) {
+        uint16_t const low = load_ucs2(src + *i * sizeof(uint16_t));
+        if (low >= 0xDC00 && low < 0xE000) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            ++*i;
+        }
+    }
+    size_t const width = cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+    if (*out + width > capacity) {
+        return false;
+    }
+    mc_utf8_char* p = dst + *out;
+    switch (width) {
+        case 1:
+            p[0] = cp;
+            break;
+        case 2:
+            p[0] = 0xC0 | cp >> 6;
+            p[1] = 0x80 | (cp & 0x3F);
+            break;
+        case 3:
+            p[0] = 0xE0 | cp >> 12;
+            p[1] = 0x80 | (cp >> 6 & 0x3F);
+            p[2] = 0x80 | (cp & 0x3F);
+            break;
+        default:
+            p[0] = 0xF0 | cp >> 18;
+            p[1] = 0x80 | (cp >> 12 & 0x3F);
+            p[2] = 0x80 | (cp >> 6 & 0x3F);
+            p[3] = 0x80 | (cp & 0x3F);
+            break;
+    }
+    *out += width;
+    return true;
+}
+
+
+/*
+ * Scalar implementation.
+ */
+
+static size_t scalar_length(mc_utf8_char const* src, size_t const length) {
+    size_t units = 0;
+    for (size_t i = 0; i < length;) {
+        units += length_step(src, length, &i);
+    }
+    return units;
+}
+
+static size_t scalar_from_utf8(uint8_t* dst, mc_utf8_char const* src, size_t const length) {
+    size_t units = 0;
+    for (size_t i = 0; i < length;) {
+        units += from_utf8_step(dst + units * sizeof(uint16_t), src, length, &i);
+    }
+    return units;
+}
+
+static int scalar_to_utf8(mc_utf8_char* dst, size_t const capacity, uint8_t const* src, size_t const units) {
+    size_t out = 0;
+    for (size_t i = 0; i < units;) {
+        if (!to_utf8_step(dst, capacity, &out, src, units, &i)) {
+            return -1;
+        }
+    }
+    return out;
+}
+
+static struct mc_ucs2_kernels const scalar_kernels = {
+    .name = "scalar",
+    .length = scalar_length,
+    .from_utf8 = scalar_from_utf8,
+    .to_utf8 = scalar_to_utf8,
+};
+
+
+#if defined(__x86_64__)
+
+/*
+ * Vector implementations. A block of ASCII characters is converted at once: UTF-8 bytes below 0x80 are widened to
+ * big-endian characters with a zero high byte, and big-endian characters below 0x80 are narrowed back. A block with
+ * anything else in it is converted one character at a time.
+ */
+
+/// Mask of the bits that must be clear in a big-endian UCS-2 character, loaded as little-endian, for it to be ASCII.
+#define UCS2_NON_ASCII_BITS ((short) 0x80FF)
+
+static size_t sse2_length(mc_utf8_char const* src, size_t const length) {
+    size_t units = 0;
+    for (size_t i = 0; i < length;) {
+        if (length - i >= 16 && _mm_movemask_epi8(_mm_loadu_si128((__m128i const*) (src + i))) == 0) {
+            units += 16;
+            i += 16;
+            continue;
+        }
+        size_t const end = length - i > 16 ? i + 16 : length;
+        while (i < end) {
+            units += length_step(src, length, &i);
+        }
+    }
+    return units;
+}
+
+static size_t sse2_from_utf8(uint8_t* dst, mc_utf8_char const* src, size_t const length) {
+    __m128i const zero = _mm_setzero_si128();
+    size_t units = 0;
+    for (size_t i = 0; i < length;) {
+        if (length - i >= 16) {
+            __m128i const v = _mm_loadu_si128((__m128i const*) (src + i));
+            if (_mm_movemask_epi8(v) == 0) {
+                uint8_t* out = dst + units * sizeof(uint16_t);
+                _mm_storeu_si128((__m128i*) out, _mm_unpacklo_epi8(zero, v));
+                _mm_storeu_si128((__m128i*) (out + 16), _mm_unpackhi_epi8(zero, v));
+                units += 16;
+                i += 16;
+                continue;
+            }
+        }
+        size_t const end = length - i > 16 ? i + 16 : length;
+        while (i < end) {
+            units += from_utf8_step(dst + units * sizeof(uint16_t), src, length, &i);
+        }
+    }
+    return units;
+}
+
+static int sse2_to_utf8(mc_utf8_char* dst, size_t const capacity, uint8_t const* src, size_t const units) {
+    __m128i const mask = _mm_set1_epi16(UCS2_NON_ASCII_BITS);
+    __m128i const zero = _mm_setzero_si128();
+    size_t out = 0;
+    for (size_t i = 0; i < units;) {
+        if (units - i >= 16 && capacity - out >= 16) {
+            __m128i const a = _mm_loadu_si128((__m128i const*) (src + i * sizeof(uint16_t)));
+            __m128i const b = _mm_loadu_si128((__m128i const*) (src + i * sizeof(uint16_t) + 16));
+            __m128i const bits = _mm_and_si128(_mm_or_si128(a, b), mask);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(bits, zero)) == 0xFFFF) {
+                __m128i const ascii = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+                _mm_storeu_si128((__m128i*) (dst + out), ascii);
+                out += 16;
+                i += 16;
+                continue;
+            }
+        }
+        size_t const end = units - i > 16 ? i + 16 : units;
+        while (i < end) {
+            if (!to_utf8_step(dst, capacity, &out, src, units, &i)) {
+                return -1;
+            }
+        }
+    }
+    return out;
+}
+
+static struct mc_ucs2_kernels const sse2_kernels = {
+    .name = "SSE2",
+    .length = sse2_length,
+    .from_utf8 = sse2_from_utf8,
+    .to_utf8 = sse2_to_utf8,
+};
+
+__attribute__((target("avx2")))
+static size_t avx2_length(mc_utf8_char const* src, size_t const length) {
+    size_t units = 0;
+    for (size_t i = 0; i < length;) {
+        if (length - i >= 32 && _mm256_movemask_epi8(_mm256_loadu_si256((__m256i const*) (src + i))) == 0) {
+            units += 32;
+            i += 32;
+            continue;
+        }
+        size_t const end = length - i > 32 ? i + 32 : length;
+        while (i < end) {
+            units += length_step(src, length, &i);
+        }
+    }
+    return units;
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_from_utf8(uint8_t* dst, mc_utf8_char const* src, size_t const length) {
+    size_t units = 0;
+    for (size_t i = 0; i < length;) {
+        if (length - i >= 32) {
+            __m256i const v = _mm256_loadu_si256((__m256i const*) (src + i));
+            if (_mm256_movemask_epi8(v) == 0) {
+                uint8_t* out = dst + units * sizeof(uint16_t);
+                __m256i const lo = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)), 8);
+                __m256i const hi = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)), 8);
+                _mm256_storeu_si256((__m256i*) out, lo);
+                _mm256_storeu_si256((__m256i*) (out + 32), hi);
+                units += 32;
+                i += 32;
+                continue;
+            }
+        }
+        size_t const end = length - i > 32 ? i + 32 : length;
+        while (i < end) {
+            units += from_utf8_step(dst + units * sizeof(uint16_t), src, length, &i);
+        }
+    }
+    return units;
+}
+
+__attribute__((target("avx2")))
+static int avx2_to_utf8(mc_utf8_char* dst, size_t const capacity, uint8_t const* src, size_t const units) {
+    __m256i const mask = _mm256_set1_epi16(UCS2_NON_ASCII_BITS);
+    __m256i const zero = _mm256_setzero_si256();
+    size_t out = 0;
+    for (size_t i = 0; i < units;) {
+        if (units - i >= 32 && capacity - out >= 32) {
+            __m256i const a = _mm256_loadu_si256((__m256i const*) (src + i * sizeof(uint16_t)));
+            __m256i const b = _mm256_loadu_si256((__m256i const*) (src + i * sizeof(uint16_t) + 32));
+            __m256i const bits = _mm256_and_si256(_mm256_or_si256(a, b), mask);
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(bits, zero)) == -1) {
+                // Packing works per 128-bit lane, put the 64-bit quarters back in order afterwards.
+                __m256i const ascii = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+                _mm256_storeu_si256((__m256i*) (dst + out), _mm256_permute4x64_epi64(ascii, 0xD8));
+                out += 32;
+                i += 32;
+                continue;
+            }
+        }
+        size_t const end = units - i > 32 ? i + 32 : units;
+        while (i < end) {
+            if (!to_utf8_step(dst, capacity, &out, src, units, &i)) {
+                return -1;
+            }
+        }
+    }
+    return out;
+}
+
+static struct mc_ucs2_kernels const avx2_kernels = {
+    .name = "AVX2",
+    .length = avx2_length,
+    .from_utf8 = avx2_from_utf8,
+    .to_utf8 = avx2_to_utf8,
+};
+
+#endif // __x86_64__
+
+
+/// Implementation in use, picked by mc_ucs2_init().
+static struct mc_ucs2_kernels const* kernels = &scalar_kernels;
+
+
+void mc_ucs2_init(void) {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels = &avx2_kernels;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        kernels = &sse2_kernels;
+    }
+#endif
+    OBS_LOG_DEBUG("ucs2", "Using %s string conversion", kernels->name);
+}
+
+size_t mc_ucs2_length(mc_utf8_char const* src, size_t const length) {
+    return kernels->length(src, length);
+}
+
+size_t mc_ucs2_from_utf8(void* dst, mc_utf8_char const* src, size_t const length) {
+    return kernels->from_utf8(dst, src, length);
+}
+
+int mc_ucs2_to_utf8(mc_utf8_char* dst, size_t const capacity, void const* src, size_t const units) {
+    return kernels->to_utf8(dst, capacity, src, units);
+}
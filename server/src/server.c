@@ -17,19 +17,80 @@
  */
 
 #include "obsidian/server.h"
+#include "obsidian/disk_queue.h"
 #include "obsidian/log.h"
 #include "obsidian/memory.h"
+#include "obsidian/minecraft/chunk_cache.h"
+#include "obsidian/minecraft/chunk_compressor.h"
+#include "obsidian/minecraft/chunk_map.h"
+#include "obsidian/minecraft/chunk_stream.h"
+#include "obsidian/minecraft/entity_store.h"
+#include "obsidian/minecraft/entity_tracker.h"
+#include "obsidian/minecraft/interest_grid.h"
+#include "obsidian/minecraft/region.h"
 #include "obsidian/minecraft/protocol.h"
 
+#include <fcntl.h>
 #include <liburing.h>
+#include <math.h>
 #include <netdb.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <time.h>
 
 
+/// Maximum amount of packets framed in one pass over the receive buffer.
+#define OBS_SCAN_BATCH_SIZE 64
+
+/// Size of the buffer a packet is encoded into when its payload is sent separately. Fits every fixed header.
+#define OBS_PACKET_HEADER_SIZE 64
+
+/// Time between updates of the chunk compression level in nanoseconds.
+#define OBS_COMPRESSION_UPDATE_INTERVAL 250000000ull
+
+/// Lowest chunk compression level used when the server is short on CPU time.
+#define OBS_MIN_COMPRESSION_LEVEL 1
+
+/// Highest chunk compression level used when clients are short on bandwidth.
+#define OBS_MAX_COMPRESSION_LEVEL 9
+
+/// Share of the I/O ring queue depth disk operations may take up when no limit is configured.
+#define OBS_DEFAULT_DISK_OP_SHARE 4
+
+/// Duration of a tick in nanoseconds.
+#define OBS_TICK_TIME 50000000ull
+
+/// View radius in chunks when none is configured, which is about 400 chunks per player.
+#define OBS_DEFAULT_VIEW_RADIUS 10
+
+/// Maximum amount of entities when none is configured.
+#define OBS_DEFAULT_MAX_ENTITIES 8192
+
+/// Bytes of chunk data sent per tick when no budget is configured.
+#define OBS_DEFAULT_CHUNK_STREAM_BUDGET (1024 * 1024)
+
+/// Outbound backlog in bytes above which no more chunks are streamed to a session.
+#define OBS_STREAM_BACKLOG_LIMIT (256 * 1024)
+
+/// Maximum amount of chunks of a single session that are being compressed at once.
+#define OBS_STREAM_JOB_LIMIT 8
+
+/// Largest distance from the origin in blocks a player may move to.
+#define OBS_WORLD_LIMIT 32000000.0
+
+/// Largest horizontal distance in blocks a player may move with a single movement packet, which also bounds how far
+/// its chunk view moves at once.
+#define OBS_MOVE_LIMIT 10.0
+
+/// Largest angle in degrees a player may turn to, which is a lot of turns.
+#define OBS_ANGLE_LIMIT 1.0e9f
+
+/// Most protocol versions a broadcast packet is encoded for at once.
+#define OBS_BROADCAST_CODECS 4
+
 /*!
  * A simple wrapper around obs_ring_buffer that keeps track of a read and write cursor.
  * \see obs_rw_buffer_size()
@@ -120,14 +181,82 @@ struct obs_session {
     /// Port of the connecting client.
     uint16_t port;
 
+    /// Packet codec for the protocol version of the client. NULL until the first packet is received.
+    struct mc_proto_codec const* codec;
+
     /// Read ring buffer.
     struct obs_rw_buffer in;
 
+    /// Amount of bytes the packet at the read cursor needs at least before framing it can succeed, 0 if unknown.
+    size_t pending_bytes;
+
     /// Total amount of bytes received from this client.
     size_t total_in;
 
     /// Total amount of bytes sent to this client.
     size_t total_out;
+
+    /// Amount of bytes queued to be sent to this client whose send has not completed yet.
+    size_t out_backlog;
+
+    /// Number of the connection, telling apart the sessions that reuse this slot.
+    uint64_t connection;
+
+    /// Chunks to send to the player, or NULL until the player has joined.
+    struct mc_chunk_stream* stream;
+
+    /// Amount of chunks of this session that are being compressed.
+    unsigned stream_jobs;
+
+    /// Entities the client was told about, or NULL until the player has joined.
+    struct mc_entity_tracker* tracker;
+
+    /// Monotonic time in nanoseconds at which the player joined.
+    uint64_t join_time;
+
+    /// Whether every chunk in view has been streamed since the player joined.
+    bool view_streamed;
+
+    /// Entity ID of the player as seen by other clients.
+    mc_dword entity_id;
+
+    /// Y coordinate of the eyes of the player in blocks, the rest of its position is kept in the entity store.
+    double stance;
+
+    /// Amount of movement packets that changed the player in this tick.
+    unsigned movement_updates;
+};
+
+
+/*!
+ * A region file of the world, opened the first time a chunk in it is loaded.
+ */
+struct obs_region_entry {
+    /// X coordinate of the region.
+    int32_t x;
+
+    /// Z coordinate of the region.
+    int32_t z;
+
+    /// The mapped region, or NULL if the world does not have the region file or it is still being opened.
+    struct mc_region* region;
+
+    /// Whether the region file is being opened through the I/O ring.
+    bool opening;
+};
+
+/*!
+ * A region file being opened through the I/O ring.
+ */
+struct obs_region_open {
+    /// X coordinate of the region.
+    int32_t x;
+
+    /// Z coordinate of the region.
+    int32_t z;
+
+    /// Path to the region file, which has to outlive the open.
+    char path[4096];
 };
 
 
@@ -144,8 +273,101 @@ struct obs_server {
     /// I/O operation ring buffers.
     struct io_uring ring;
 
+    /// Amount of entries in the submission queue of the ring.
+    unsigned queue_depth;
+
     /// Pool allocator for packet frames.
     struct obs_pool_allocator* frame_allocator;
+
+    /// Counters exposed through obs_server_get_metrics().
+    struct obs_server_metrics metrics;
+
+    /// Worker threads that compress chunk data.
+    struct mc_chunk_compressor* chunk_compressor;
+
+    /// Compressed chunk data shared between sessions.
+    struct mc_chunk_cache* chunk_cache;
+
+    /// Loaded chunks by coordinate.
+    struct mc_chunk_map* chunks;
+
+    /// Directory of the world, or NULL if the server has no world on disk.
+    char const* world_path;
+
+    /// Region files that were looked up so far, each opened only once.
+    struct obs_region_entry* regions;
+
+    /// Amount of looked up region files.
+    size_t region_count;
+
+    /// Size of the region array.
+    size_t region_capacity;
+
+    /// Picks the chunk compression level from the load of the server.
+    struct mc_chunk_level_controller compression_controller;
+
+    /// Tick headroom last reported through obs_server_report_tick().
+    double tick_headroom;
+
+    /// Monotonic time in nanoseconds at which the compression level is next updated.
+    uint64_t next_compression_update;
+
+    /// Limits the disk operations in flight at once.
+    struct obs_disk_queue disk_queue;
+
+    /// Amount of connections accepted so far.
+    uint64_t connection_count;
+
+    /// Radius in chunks of the square of chunks sent around each player.
+    unsigned view_radius;
+
+    /// Bytes of chunk data sent per tick.
+    size_t chunk_stream_budget;
+
+    /// Bytes of chunk data that may still be sent this tick. Negative if the budget was overrun.
+    int64_t stream_budget_left;
+
+    /// Monotonic time in nanoseconds at which the next tick starts.
+    uint64_t next_tick;
+
+    /// Session that gets to stream chunks first in the next pass, so all sessions get their turn at the budget.
+    size_t stream_cursor;
+
+    /// Keys of the chunks that are being loaded.
+    uint64_t* loading;
+
+    /// Amount of chunks that are being loaded.
+    size_t loading_count;
+
+    /// Size of the loading array.
+    size_t loading_capacity;
+
+    /// Amount of entity slots.
+    uint32_t entity_capacity;
+
+    /// Every entity in the world, players included.
+    struct mc_entity_store* entities;
+
+    /// Movements of the entities relayed on a tick.
+    struct mc_entity_move* entity_moves;
+
+    /// Session of the player of every entity slot, NULL for slots that are not used by a player.
+    struct obs_session** entity_players;
+
+    /// Entity slots of players that left, released once every client has been told to forget them.
+    uint32_t* released_entities;
+
+    /// Amount of entity slots waiting to be released.
+    size_t released_count;
+
+    /// Cells of the entities in the world, numbered by entity slot.
+    struct mc_interest_grid* interest_grid;
+
+    /// Radius in cells around a player in which its client is told about the other players.
+    unsigned interest_radius;
+
+    /// Session slots found by the last query of the interest grid.
+    uint32_t* interest_members;
 };
 
 
@@ -175,6 +397,12 @@ struct obs_session* obs_server_get_available_session(struct obs_server const* se
 void obs_session_release(struct obs_session* session) {
     OBS_LOG_TRACE("server", "Releasing session %08X:%d", session->address, session->port);
     obs_free_ring_buffer(session->in.ring);
+    if (session->stream != NULL) {
+        mc_chunk_stream_destroy(session->stream);
+    }
+    if (session->tracker != NULL) {
+        mc_entity_tracker_destroy(session->tracker);
+    }
     *session = (struct obs_session){0};
 }
 
@@ -218,6 +446,18 @@ enum obs_frame_type {
 
     /// Packet frame for a close() operation.
     OBS_FRAME_CLOSE,
+
+    /// Disk frame for an openat() operation.
+    OBS_FRAME_OPEN,
+
+    /// Disk frame for a read() operation.
+    OBS_FRAME_READ,
+
+    /// Disk frame for a write() operation.
+    OBS_FRAME_WRITE,
+
+    /// Disk frame for an fsync() operation.
+    OBS_FRAME_FSYNC,
 };
 
 
@@ -236,6 +476,14 @@ static char const* obs_frame_type_to_string(enum obs_frame_type const type) {
             return "ACCEPT";
         case OBS_FRAME_CLOSE:
             return "CLOSE";
+        case OBS_FRAME_OPEN:
+            return "OPEN";
+        case OBS_FRAME_READ:
+            return "READ";
+        case OBS_FRAME_WRITE:
+            return "WRITE";
+        case OBS_FRAME_FSYNC:
+            return "FSYNC";
         default:
             return "UNKNOWN";
     }
@@ -254,6 +502,18 @@ struct obs_send_frame {
 
     /// Amount of bytes written to the client.
     size_t bytes_out;
+
+    /// Shared payload sent after the buffer, or NULL. A reference to it is held until the send completes.
+    struct obs_shared_buffer* payload;
+
+    /// Message header for a sendmsg() of what is left to send of the buffer and the payload.
+    struct msghdr message;
+
+    /// The buffer and the payload as referenced by the message header, moved ahead after a partial write.
+    struct iovec parts[2];
+
+    /// Flags the send was queued with, used again to send the rest after a partial write.
+    int flags;
 };
 
 
@@ -284,6 +544,42 @@ struct obs_accept_frame {
 };
 
 
+/*!
+ * Frame data associated with an OPEN, READ, WRITE or FSYNC request.
+ */
+struct obs_disk_frame {
+    /// File descriptor, or the path for an OPEN.
+    union {
+        int fd;
+        char const* path;
+    };
+
+    /// Flags of an OPEN.
+    int flags;
+
+    /// Mode of an OPEN.
+    unsigned mode;
+
+    /// Buffer of a READ or WRITE.
+    void* buffer;
+
+    /// Size of the buffer in bytes.
+    size_t size;
+
+    /// Offset in the file of a READ or WRITE.
+    uint64_t offset;
+
+    /// Called when the operation completes.
+    obs_disk_callback callback;
+
+    /// Passed to the callback.
+    void* user_data;
+
+    /// The operation as seen by the disk queue.
+    struct obs_disk_entry entry;
+};
+
+
 /*!
  * Packet frame data.
  *
@@ -300,18 +596,32 @@ struct obs_frame {
     /// Pointer to the connection session.
     struct obs_session* session;
 
+    /// Number of the connection the session had when the frame was created, see obs_session.connection.
+    uint64_t connection;
+
 
     /// Union of possible frame data types. See type for how to interpret this data.
     union {
         struct obs_send_frame send;
         struct obs_receive_frame receive;
         struct obs_accept_frame accept;
+        struct obs_disk_frame disk;
     };
 };
 
 
 static uint32_t trace_counter = 1;
 
+/*!
+ * Gets the monotonic time.
+ * \return Time in nanoseconds.
+ */
+static uint64_t obs_monotonic_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
 /*!
  * Allocates a new packet frame.
  * \param server Pointer to a server structure.
@@ -324,6 +634,7 @@ struct obs_frame* obs_server_create_frame(struct obs_server const* server, struc
     struct obs_frame* frame = obs_pool_allocator_alloc(server->frame_allocator);
     frame->type = type;
     frame->session = session;
+    frame->connection = session != NULL ? session->connection : 0;
     frame->trace = trace_counter++;
     OBS_LOG_TRACE("server", "Created new %s packet frame[%llu]", obs_frame_type_to_string(type), frame->trace);
     return frame;
@@ -353,6 +664,15 @@ struct obs_frame* obs_frame_create_send(struct obs_server const* server, struct
     frame->send.buffer = buffer;
     frame->send.buffer_size = buffer_size;
     frame->send.bytes_out = 0;
+    frame->send.payload = NULL;
+    frame->send.parts[0] = (struct iovec) {.iov_base = buffer, .iov_len = buffer_size};
+    frame->send.parts[1] = (struct iovec) {0};
+    frame->send.message = (struct msghdr) {
+        .msg_iov = frame->send.parts,
+        .msg_iovlen = 1,
+    };
+    frame->send.flags = 0;
+    session->out_backlog += buffer_size;
     return frame;
 }
 
@@ -407,6 +727,40 @@ int obs_server_submit_queue(struct obs_server* server) {
     return io_uring_submit(&server->ring);
 }
 
+/*!
+ * Gets a free submission queue entry. If the submission queue is full, the enqueued operations are submitted first.
+ * \param server Pointer to a server structure.
+ * \return Pointer to the submission queue entry, or NULL if the kernel did not take the enqueued operations.
+ */
+static struct io_uring_sqe* obs_server_get_sqe(struct obs_server* server) {
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&server->ring);
+    if (sqe != NULL) {
+        return sqe;
+    }
+    // Loops that queue an operation per chunk or per recipient can outgrow the queue depth within a single call.
+    ++server->metrics.early_submits;
+    int const result = obs_server_submit_queue(server);
+    sqe = io_uring_get_sqe(&server->ring);
+    if (sqe == NULL) {
+        OBS_LOG_URING_ERROR("server", "submit", result < 0 ? result : -EBUSY);
+    }
+    return sqe;
+}
+
+/*!
+ * Gets a free submission queue entry for an operation the server cannot do without.
+ * \param server Pointer to a server structure.
+ * \return Pointer to the submission queue entry.
+ */
+static struct io_uring_sqe* obs_server_require_sqe(struct obs_server* server) {
+    struct io_uring_sqe* sqe = obs_server_get_sqe(server);
+    if (sqe == NULL) {
+        OBS_LOG_FATAL("server", "The kernel does not take any more I/O operations!");
+        exit(EXIT_FAILURE);
+    }
+    return sqe;
+}
+
 /*!
  * Queues a send() operation to the I/O ring buffer.
  * \param server Pointer to a server structure.
@@ -415,14 +769,78 @@ int obs_server_submit_queue(struct obs_server* server) {
  * \param buffer Pointer to memory to send.
  * \param buffer_size Size of the buffer.
  * \param flags Flags to pass to send().
+ * \return Whether the operation was queued. If not, the buffer is released.
  */
-void obs_server_queue_send(struct obs_server* server, struct obs_session* session,
+bool obs_server_queue_send(struct obs_server* server, struct obs_session* session,
                            int const socket, void* buffer, size_t const buffer_size, int const flags) {
     OBS_LOG_TRACE("server", "Queueing 'send' I/O operation");
-    struct io_uring_sqe* sqe = io_uring_get_sqe(&server->ring);
+    struct io_uring_sqe* sqe = obs_server_get_sqe(server);
+    if (sqe == NULL) {
+        obs_server_release_buffer(server, buffer);
+        return false;
+    }
     struct obs_frame* frame = obs_frame_create_send(server, session, buffer, buffer_size);
+    frame->send.flags = flags;
     io_uring_prep_send(sqe, socket, buffer, buffer_size, flags);
     io_uring_sqe_set_data(sqe, frame);
+    return true;
+}
+
+/*!
+ * Queues a sendmsg() operation of an encoded packet and its payload to the I/O ring buffer.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param socket Socket file descriptor.
+ * \param buffer Pointer to the buffer holding everything but the payload. Released when the send completes.
+ * \param parts The packet as returned by mc_proto_encode_server_packet_iov().
+ * \param payload Shared buffer holding the payload, or NULL. The reference is released when the send completes.
+ * \param flags Flags to pass to sendmsg().
+ * \return Whether the operation was queued. If not, the buffer and the payload reference are released.
+ */
+bool obs_server_queue_sendmsg(struct obs_server* server, struct obs_session* session, int const socket,
+                              void* buffer, struct iovec const parts[2], struct obs_shared_buffer* payload,
+                              int const flags) {
+    OBS_LOG_TRACE("server", "Queueing 'sendmsg' I/O operation");
+    struct io_uring_sqe* sqe = obs_server_get_sqe(server);
+    if (sqe == NULL) {
+        obs_server_release_buffer(server, buffer);
+        if (payload != NULL) {
+            obs_shared_buffer_release(payload);
+        }
+        return false;
+    }
+    struct obs_frame* frame = obs_frame_create_send(server, session, buffer, parts[0].iov_len + parts[1].iov_len);
+    frame->send.payload = payload;
+    frame->send.parts[0] = parts[0];
+    frame->send.parts[1] = parts[1];
+    // The message header lives in the frame, the kernel may read it after this function returns.
+    frame->send.message.msg_iovlen = parts[1].iov_len > 0 ? 2 : 1;
+    frame->send.flags = flags;
+    io_uring_prep_sendmsg(sqe, socket, &frame->send.message, flags);
+    io_uring_sqe_set_data(sqe, frame);
+    return true;
+}
+
+/*!
+ * Queues a sendmsg() of what is left to send of a SEND frame after a partial write, reusing the frame.
+ * \param server Pointer to a server structure.
+ * \param frame Pointer to the send frame. Its buffer and payload stay held until the rest is sent.
+ * \param bytes_sent Amount of bytes the last write sent.
+ */
+void obs_server_queue_send_rest(struct obs_server* server, struct obs_frame* frame, size_t bytes_sent) {
+    OBS_LOG_TRACE("server", "Queueing 'sendmsg' I/O operation for the rest of frame[%llu]", frame->trace);
+    struct msghdr* message = &frame->send.message;
+    // Skip the parts that were sent entirely, then the sent start of the part the write stopped in.
+    while (bytes_sent >= message->msg_iov->iov_len && message->msg_iovlen > 1) {
+        bytes_sent -= message->msg_iov->iov_len;
+        ++message->msg_iov;
+        --message->msg_iovlen;
+    }
+    message->msg_iov->iov_base = (uint8_t*) message->msg_iov->iov_base + bytes_sent;
+    message->msg_iov->iov_len -= bytes_sent;
+    struct io_uring_sqe* sqe = obs_server_require_sqe(server);
+    io_uring_prep_sendmsg(sqe, frame->session->socket, message, frame->send.flags);
+    io_uring_sqe_set_data(sqe, frame);
 }
 
 /*!
@@ -438,7 +856,7 @@ void obs_server_queue_send(struct obs_server* server, struct obs_session* sessio
 void obs_server_queue_recv(struct obs_server* server, struct obs_session* session,
                            int const socket, void* buffer, size_t const buffer_size, int const flags) {
     OBS_LOG_TRACE("server", "Queueing 'recv' I/O operation");
-    struct io_uring_sqe* sqe = io_uring_get_sqe(&server->ring);
+    struct io_uring_sqe* sqe = obs_server_require_sqe(server);
     struct obs_frame* frame = obs_frame_create_receive(server, session, buffer, buffer_size);
     io_uring_prep_recv(sqe, socket, buffer, buffer_size, flags);
     io_uring_sqe_set_data(sqe, frame);
@@ -458,7 +876,7 @@ void obs_server_queue_recv(struct obs_server* server, struct obs_session* sessio
 void obs_server_queue_recv_offset(struct obs_server* server, struct obs_session* session, int const socket,
                                   void* buffer, size_t const buffer_size, size_t offset, int const flags) {
     OBS_LOG_TRACE("server", "Queueing 'recv' I/O operation for additional data");
-    struct io_uring_sqe* sqe = io_uring_get_sqe(&server->ring);
+    struct io_uring_sqe* sqe = obs_server_require_sqe(server);
     struct obs_frame* frame = obs_frame_create_receive(server, session, buffer, buffer_size);
     frame->receive.bytes_in = offset;
     io_uring_prep_recv(sqe, socket, buffer + offset, buffer_size - offset, flags);
@@ -473,7 +891,7 @@ void obs_server_queue_recv_offset(struct obs_server* server, struct obs_session*
  */
 void obs_server_queue_accept(struct obs_server* server, int const flags) {
     OBS_LOG_TRACE("server", "Queueing 'accept' I/O operation");
-    struct io_uring_sqe* sqe = io_uring_get_sqe(&server->ring);
+    struct io_uring_sqe* sqe = obs_server_require_sqe(server);
     struct obs_frame* frame = obs_frame_create_accept(server, NULL);
     io_uring_prep_accept(sqe, server->socket,
                          (struct sockaddr*) &frame->accept.address,
@@ -490,199 +908,1186 @@ void obs_server_queue_accept(struct obs_server* server, int const flags) {
  */
 void obs_server_queue_close(struct obs_server* server, struct obs_session* session, int const fd) {
     OBS_LOG_TRACE("server", "Queueing 'close' I/O operation");
-    struct io_uring_sqe* sqe = io_uring_get_sqe(&server->ring);
+    struct io_uring_sqe* sqe = obs_server_require_sqe(server);
     struct obs_frame* frame = obs_frame_create_close(server, session);
     io_uring_prep_close(sqe, fd);
     io_uring_sqe_set_data(sqe, frame);
 }
 
 /*!
- * Sends a heartbeat packet to the client in response to a heartbeat.
+ * Allocates a new disk frame.
  * \param server Pointer to a server structure.
- * \param session Pointer to a client session structure.
- * \param heartbeat Pointer to heartbeat packet structure.
+ * \param type One of the disk frame types of obs_frame_type.
+ * \param callback Called when the operation completes.
+ * \param user_data Passed to the callback.
+ * \return Pointer to the allocated frame.
  */
-void obs_server_heartbeat(struct obs_server* server, struct obs_session* session,
-                          struct mc_proto_heartbeat const* heartbeat) {
-    OBS_LOG_TRACE("server", "Received heartbeat from %.*s (%08X:%d)",
-                  session->username_length, session->username, session->address, session->port);
-    // This is, presumably, the keepalive packet. For now, let's just reply with an identical message.
-    struct mc_proto_heartbeat const response = {};
-    size_t const length = -mc_proto_encode_heartbeat(NULL, 0, &response);
-    uint8_t* buffer = obs_server_get_buffer(server, length);
-    mc_proto_encode_heartbeat(buffer, length, &response);
-    obs_server_queue_send(server, session, session->socket, buffer, length, 0);
-    obs_server_submit_queue(server);
+struct obs_frame* obs_frame_create_disk(struct obs_server const* server, enum obs_frame_type const type,
+                                        obs_disk_callback const callback, void* user_data) {
+    struct obs_frame* frame = obs_server_create_frame(server, NULL, type);
+    frame->disk = (struct obs_disk_frame) {
+        .callback = callback,
+        .user_data = user_data,
+        .entry = {
+            .op = (enum obs_disk_op) (type - OBS_FRAME_OPEN),
+        },
+    };
+    return frame;
 }
 
 /*!
- * Handles an authentication request.
+ * Queues a disk operation to the I/O ring buffer.
  * \param server Pointer to a server structure.
- * \param session Pointer to a client session structure.
- * \param authentication Pointer to an authenticate request packet structure.
+ * \param frame Pointer to the disk frame describing the operation.
  */
-void obs_server_authenticate(struct obs_server* server, struct obs_session* session,
-                             struct mc_proto_authentication_request const* authentication) {
-    OBS_LOG_DEBUG("server", "Handling authentication request from %08X:%d", session->address, session->port);
-    if (session->status != SESSION_AUTHENTICATING) {
-        OBS_LOG_WARN(
-            "server", "Received authentication from %08X:%d, but session status is not AUTHENTICATING. Disconnecting!",
-            session->address, session->port);
-        obs_server_queue_close(server, session, session->socket);
-        obs_server_submit_queue(server);
-        return;
+void obs_server_queue_disk(struct obs_server* server, struct obs_frame* frame) {
+    OBS_LOG_TRACE("server", "Queueing '%s' I/O operation", obs_frame_type_to_string(frame->type));
+    struct obs_disk_frame* disk = &frame->disk;
+    struct io_uring_sqe* sqe = obs_server_require_sqe(server);
+    switch (frame->type) {
+        case OBS_FRAME_OPEN:
+            io_uring_prep_openat(sqe, AT_FDCWD, disk->path, disk->flags, disk->mode);
+            break;
+        case OBS_FRAME_READ:
+            io_uring_prep_read(sqe, disk->fd, disk->buffer, disk->size, disk->offset);
+            break;
+        case OBS_FRAME_WRITE:
+            io_uring_prep_write(sqe, disk->fd, disk->buffer, disk->size, disk->offset);
+            break;
+        default:
+            io_uring_prep_fsync(sqe, disk->fd, 0);
+            break;
     }
-    if (authentication->protocol_version != 1) {
-        OBS_LOG_INFO("server", "Player %.*s (%08X:%d) is running incompatible protocol version %d. Disconnecting!",
-                     session->username_length, session->username, session->address, session->port,
-                     authentication->protocol_version);
-        obs_server_queue_close(server, session, session->socket);
-        obs_server_submit_queue(server);
+    io_uring_sqe_set_data(sqe, frame);
+}
+
+/*!
+ * Submits a disk operation, or defers it if the limit of disk operations in flight is reached.
+ * \param server Pointer to a server structure.
+ * \param frame Pointer to the disk frame describing the operation.
+ */
+void obs_server_submit_disk(struct obs_server* server, struct obs_frame* frame) {
+    if (!obs_disk_queue_admit(&server->disk_queue, &frame->disk.entry, obs_monotonic_time())) {
+        OBS_LOG_TRACE("server", "Deferring frame[%llu], %llu disk operations are in flight",
+                      frame->trace, server->metrics.disk_ops_in_flight);
         return;
     }
-    session->status = SESSION_CONNECTED;
-    // Send the response packet.
-    OBS_LOG_DEBUG("server", "Sending authentication response to %.*s (%08X:%d)",
-                  session->username_length, session->username, session->address, session->port);
-    struct mc_proto_authentication_response const response = {
-        .entity_id = 0,
-        .unknown0_length = 0,
-        .unknown0 = "",
-        .unknown1_length = 0,
-        .unknown1 = "",
-    };
-    size_t const length = -mc_proto_encode_authentication_response(NULL, 0, &response);
-    uint8_t* buffer = obs_server_get_buffer(server, length);
-    mc_proto_encode_authentication_response(buffer, length, &response);
-    obs_server_queue_send(server, session, session->socket, buffer, length, 0);
+    obs_server_queue_disk(server, frame);
     obs_server_submit_queue(server);
-    OBS_LOG_INFO("server", "Player %.*s (%08X:%d) has joined the game",
-                 session->username_length, session->username, session->address, session->port);
 }
 
 /*!
- * Handles a handshake request.
+ * Converts a disconnect reason to a string for logging.
+ * \param reason Disconnect reason.
+ * \return Description of the reason.
+ */
+static char const* obs_disconnect_reason_to_string(enum obs_disconnect_reason const reason) {
+    switch (reason) {
+        case OBS_DISCONNECT_UNKNOWN_PACKET:
+            return "unknown packet";
+        case OBS_DISCONNECT_MALFORMED_PACKET:
+            return "malformed packet";
+        case OBS_DISCONNECT_OVERSIZED_PACKET:
+            return "oversized packet";
+        case OBS_DISCONNECT_UNEXPECTED_PACKET:
+            return "unexpected packet";
+        case OBS_DISCONNECT_INCOMPATIBLE_VERSION:
+            return "incompatible version";
+        case OBS_DISCONNECT_INVALID_USERNAME:
+            return "invalid username";
+        case OBS_DISCONNECT_SERVER_FULL:
+            return "server full";
+        case OBS_DISCONNECT_CONNECTION_ERROR:
+            return "connection error";
+        case OBS_DISCONNECT_CONNECTION_CLOSED:
+            return "connection closed";
+        default:
+            return "unknown";
+    }
+}
+
+/*!
+ * Closes a session. Other sessions are not affected.
  * \param server Pointer to a server structure.
  * \param session Pointer to a client session structure.
- * \param request Pointer to a handshake request packet.
+ * \param reason Reason for closing the session, recorded in the server metrics.
+ * \note No further packets are processed for the session. Closing a session that is already closed does nothing, so
+ *       its socket is never closed twice; by the time the second close ran, the descriptor may belong to another
+ *       connection.
  */
-void obs_server_handshake(struct obs_server* server, struct obs_session* session,
-                          struct mc_proto_handshake_request const* request) {
-    OBS_LOG_DEBUG("server", "Handling handshake request from %08X:%d", session->address, session->port);
-    if (session->status != SESSION_HANDSHAKING) {
-        OBS_LOG_WARN("server", "Received handshake from %08X:%d, but session status is not HANDSHAKING. Disconnecting!",
-                     session->address, session->port);
-        obs_server_queue_close(server, session, session->socket);
-        obs_server_submit_queue(server);
+void obs_server_disconnect(struct obs_server* server, struct obs_session* session,
+                           enum obs_disconnect_reason const reason) {
+    if (session->status == SESSION_DISCONNECTED) {
         return;
     }
-    // Copy over the username of the player.
-    session->username_length = request->name_length;
-    memcpy(session->username, request->name, request->name_length);
-    session->status = SESSION_AUTHENTICATING;
-    // Send back to the appropriate response to the client.
-    OBS_LOG_DEBUG("server", "Sending handshake response to %.*s (%08X:%d)",
-                  session->username_length, session->username, session->address, session->port);
-    struct mc_proto_handshake_response const response = {
-        .unknown_length = 1,
-        .unknown = "-",
-    };
-    size_t const length = -mc_proto_encode_handshake_response(NULL, 0, &response);
-    uint8_t* buffer = obs_server_get_buffer(server, length);
-    mc_proto_encode_handshake_response(buffer, length, &response);
-    obs_server_queue_send(server, session, session->socket, buffer, length, 0);
+    OBS_LOG_DEBUG("server", "Disconnecting %08X:%d: %s",
+                  session->address, session->port, obs_disconnect_reason_to_string(reason));
+    ++server->metrics.disconnects[reason];
+    session->status = SESSION_DISCONNECTED;
+    obs_server_queue_close(server, session, session->socket);
     obs_server_submit_queue(server);
-    OBS_LOG_INFO("server", "Player %.*s (%08X:%d) is joining the game",
-                 session->username_length, session->username, session->address, session->port);
 }
 
 /*!
- * Dispatches a packet based on its type.
+ * Encodes a packet and queues it to be sent to a client.
  * \param server Pointer to a server structure.
- * \param session Pointer to a session structure.
- * \param packet Pointer to a client packet structure.
+ * \param session Pointer to a client session structure.
+ * \param packet Pointer to the packet to send.
+ * \return Whether the packet was queued, which fails if the protocol of the client does not have it or the kernel does
+ *         not take any more I/O operations.
+ * \note This is an asynchronous function, to start the queued operation call obs_server_submit_queue().
  */
-void obs_server_dispatch_packet(struct obs_server* server, struct obs_session* session,
-                                struct mc_proto_client_packet const* packet) {
-    switch (packet->type) {
-        case MC_PACKET_HEARTBEAT:
-            return obs_server_heartbeat(server, session, &packet->heartbeat);
-
-        case MC_PACKET_AUTHENTICATION:
-            return obs_server_authenticate(server, session, &packet->authentication);
-
-        case MC_PACKET_HANDSHAKE:
-            return obs_server_handshake(server, session, &packet->handshake);
-
-        default:
-            OBS_LOG_ERROR("server", "Received packet with ID 0x%02X, this packet is unhandled!", packet->type);
-            return;
+bool obs_server_queue_packet(struct obs_server* server, struct obs_session* session,
+                             struct mc_proto_server_packet const* packet) {
+    // Encode straight into a buffer of the maximum size, the packet is only written once.
+    size_t const capacity = mc_proto_server_packet_size(session->codec, packet);
+    if (capacity == 0) {
+        OBS_LOG_ERROR("server", "Cannot send packet with type ID 0x%02X to %08X:%d, %s does not have it",
+                      packet->type, session->address, session->port, session->codec->name);
+        return false;
     }
+    uint8_t* buffer = obs_server_get_buffer(server, capacity);
+    int const length = mc_proto_encode_server_packet(session->codec, buffer, capacity, packet);
+    if (length <= 0) {
+        OBS_LOG_ERROR("server", "Failed to encode packet with type ID 0x%02X for %08X:%d",
+                      packet->type, session->address, session->port);
+        obs_server_release_buffer(server, buffer);
+        return false;
+    }
+    return obs_server_queue_send(server, session, session->socket, buffer, length, 0);
 }
 
 /*!
- * Processes received data from a client connection.
+ * Encodes a packet and queues it to be sent to a client, referencing its payload instead of copying it.
  * \param server Pointer to a server structure.
  * \param session Pointer to a client session structure.
- * \param frame Pointer to a packet frame structure.
+ * \param packet Pointer to the packet to send. Its payload field must point into the payload buffer.
+ * \param payload Shared buffer holding the payload of the packet. A reference is taken until the send completes.
+ * \return Whether the packet was queued.
+ * \note This is an asynchronous function, to start the queued operation call obs_server_submit_queue().
  */
-void obs_server_process_data(struct obs_server* server, struct obs_session* session, struct obs_frame* frame) {
-    // Read all packets in the buffer.
-    for (size_t cursor = 0; cursor < frame->receive.bytes_in;) {
-        OBS_LOG_TRACE("server", "Attempting to decode client packet");
-        struct mc_proto_client_packet packet;
-        int const result = mc_proto_decode_client_packet(frame->receive.buffer + cursor,
-                                                         frame->receive.bytes_in - cursor,
-                                                         &packet);
-        if (result > 0) {
-            OBS_LOG_TRACE("server", "Read %llu bytes from receive buffer on frame[%llu]", result, frame->trace);
-            OBS_LOG_TRACE("server", "Dispatching packet with type ID 0x%02X on frame[%llu]",
-                          packet.type, frame->trace);
-            cursor += result;
-            session->in.read_cursor += result;
-            obs_server_dispatch_packet(server, session, &packet);
-        }
-        else if (result < 0 && cursor < frame->receive.bytes_in) {
-            OBS_LOG_TRACE("server", "Data in receive buffer is incomplete by %llu bytes on frame[%llu]", -result,
-                          frame->trace);
-            // Queue up another receive, we need more data!
-            obs_server_queue_recv_offset(server, session, session->socket,
-                                         obs_rw_buffer_read_ptr(&session->in),
-                                         obs_rw_buffer_capacity(&session->in),
-                                         frame->receive.bytes_in - cursor,
-                                         0);
-
-            obs_server_release_frame(server, frame);
-            return;
-        }
-        else {
-            OBS_LOG_FATAL("server", "Received unparseable data from %08X:%d on frame[%llu], aborting!!",
-                          session->address, session->port, frame->trace);
-            exit(EXIT_FAILURE);
-        }
+bool obs_server_queue_packet_payload(struct obs_server* server, struct obs_session* session,
+                                     struct mc_proto_server_packet const* packet, struct obs_shared_buffer* payload) {
+    if (session->codec->iov_encoders[(uint8_t) packet->type] == NULL) {
+        OBS_LOG_ERROR("server", "Cannot send packet with type ID 0x%02X to %08X:%d, %s does not have it",
+                      packet->type, session->address, session->port, session->codec->name);
+        return false;
     }
-    OBS_LOG_TRACE("server", "All data in receive buffer is processed, queueing new recv");
-    obs_server_release_frame(server, frame);
-    obs_server_queue_recv(server, session, session->socket,
-                          obs_rw_buffer_write_ptr(&session->in),
-                          obs_rw_buffer_capacity(&session->in), 0);
+    struct iovec parts[2];
+    size_t capacity = OBS_PACKET_HEADER_SIZE;
+    uint8_t* buffer = obs_server_get_buffer(server, capacity);
+    int length = mc_proto_encode_server_packet_iov(session->codec, buffer, capacity, packet, parts);
+    if (length < 0) {
+        // Only packets with long strings or arrays in front of their payload end up here.
+        obs_server_release_buffer(server, buffer);
+        capacity += (size_t) -length;
+        buffer = obs_server_get_buffer(server, capacity);
+        length = mc_proto_encode_server_packet_iov(session->codec, buffer, capacity, packet, parts);
+    }
+    if (length <= 0) {
+        OBS_LOG_ERROR("server", "Failed to encode packet with type ID 0x%02X for %08X:%d",
+                      packet->type, session->address, session->port);
+        obs_server_release_buffer(server, buffer);
+        return false;
+    }
+    return obs_server_queue_sendmsg(server, session, session->socket, buffer, parts, obs_shared_buffer_retain(payload),
+                                    0);
 }
 
 /*!
- * Completes a send() operation.
+ * Queues the chunk data packet of a whole chunk to be sent to a client.
  * \param server Pointer to a server structure.
- * \param frame Pointer to a packet frame structure.
- * \param cqe Pointer to the completion queue entry.
+ * \param session Pointer to a client session structure.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param compressed Compressed data of the chunk, sent without being copied.
+ * \return Whether the packet was queued.
  */
-void obs_server_handle_send(struct obs_server* server, struct obs_frame* frame, struct io_uring_cqe const* cqe) {
-    struct obs_session* session = frame->session;
-    struct obs_send_frame* send_frame = &frame->send;
-    if (cqe->res < 0) {
-        // If we get -EBADF, that just means the connection was closed. This is not an error!
-        if (cqe->res != -EBADF) {
-            OBS_LOG_URING_ERROR("server", "send", cqe->res);
-            obs_server_queue_close(server, session, session->socket);
+bool obs_server_queue_chunk_data(struct obs_server* server, struct obs_session* session,
+                                 int32_t const chunk_x, int32_t const chunk_z, struct obs_shared_buffer* compressed) {
+    struct mc_proto_server_packet const packet = {
+        .type = MC_PACKET_CHUNK_DATA,
+        .chunk_data = {
+            .x = chunk_x * 16,
+            .y = 0,
+            .z = chunk_z * 16,
+            .x_size = 15,
+            .y_size = 127,
+            .z_size = 15,
+            .compressed_size = (mc_dword) compressed->size,
+            .data = (mc_byte const*) compressed->data,
+        },
+    };
+    return obs_server_queue_packet_payload(server, session, &packet, compressed);
+}
+
+/*!
+ * Queues the packet that tells a client to prepare or unload a chunk.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param initialize MC_TRUE to prepare the chunk for its data, MC_FALSE to unload it.
+ * \return Whether the packet was queued.
+ */
+bool obs_server_queue_pre_chunk(struct obs_server* server, struct obs_session* session,
+                                int32_t const chunk_x, int32_t const chunk_z, mc_bool const initialize) {
+    struct mc_proto_server_packet const packet = {
+        .type = MC_PACKET_CHUNK,
+        .chunk = {
+            .x = chunk_x,
+            .z = chunk_z,
+            .initialize = initialize,
+        },
+    };
+    return obs_server_queue_packet(server, session, &packet);
+}
+
+/*!
+ * A session whose view moved, passed to obs_server_unload_chunk().
+ */
+struct obs_view_move {
+    struct obs_server* server;
+    struct obs_session* session;
+};
+
+/*!
+ * Tells a client to unload a chunk that left its view.
+ * \param user_data Pointer to an obs_view_move structure.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ */
+void obs_server_unload_chunk(void* user_data, int32_t const chunk_x, int32_t const chunk_z) {
+    struct obs_view_move const* move = user_data;
+    obs_server_queue_pre_chunk(move->server, move->session, chunk_x, chunk_z, MC_FALSE);
+    ++move->server->metrics.chunks_unloaded;
+}
+
+/*!
+ * Moves the view of a session to the chunk its player is in, unloading the chunks that left it.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param chunk_x X coordinate of the chunk the player is in.
+ * \param chunk_z Z coordinate of the chunk the player is in.
+ */
+void obs_server_move_view(struct obs_server* server, struct obs_session* session,
+                          int32_t const chunk_x, int32_t const chunk_z) {
+    if (session->stream == NULL) {
+        return;
+    }
+    struct obs_view_move move = {
+        .server = server,
+        .session = session,
+    };
+    mc_chunk_stream_move(session->stream, chunk_x, chunk_z, obs_server_unload_chunk, &move);
+    obs_server_submit_queue(server);
+}
+
+/*!
+ * A packet sent to many sessions, encoded once for every protocol version among them.
+ */
+struct obs_broadcast {
+    /// The packet.
+    struct mc_proto_server_packet const* packet;
+
+    /// Amount of protocol versions the packet was encoded for.
+    size_t encoded_count;
+
+    /// Codecs the packet was encoded with.
+    struct mc_proto_codec const* codecs[OBS_BROADCAST_CODECS];
+
+    /// The packet encoded with each codec, or NULL if encoding failed.
+    struct obs_shared_buffer* encoded[OBS_BROADCAST_CODECS];
+};
+
+/*!
+ * Queues a broadcast packet to be sent to a session.
+ * The packet is encoded the first time it is sent to a session using a given protocol version.
+ * \param server Pointer to a server structure.
+ * \param broadcast Pointer to the broadcast.
+ * \param session Pointer to a client session structure.
+ * \return Whether the packet was queued.
+ * \note This is an asynchronous function, to start the queued operation call obs_server_submit_queue().
+ */
+bool obs_server_queue_broadcast(struct obs_server* server, struct obs_broadcast* broadcast,
+                                struct obs_session* session) {
+    size_t i = 0;
+    while (i < broadcast->encoded_count && broadcast->codecs[i] != session->codec) {
+        ++i;
+    }
+    if (i == OBS_BROADCAST_CODECS) {
+        return obs_server_queue_packet(server, session, broadcast->packet);
+    }
+    if (i == broadcast->encoded_count) {
+        size_t const capacity = mc_proto_server_packet_size(session->codec, broadcast->packet);
+        // A size of 0 means the protocol version does not have the packet, which then fails to encode below.
+        struct obs_shared_buffer* encoded = capacity > 0 ? obs_shared_buffer_create(capacity) : NULL;
+        int length = 0;
+        if (encoded != NULL) {
+            length = mc_proto_encode_server_packet(session->codec, encoded->data, capacity, broadcast->packet);
+        }
+        if (length <= 0) {
+            OBS_LOG_ERROR("server", "Failed to encode broadcast packet with type ID 0x%02X for protocol %s",
+                          broadcast->packet->type, session->codec->name);
+            if (encoded != NULL) {
+                obs_shared_buffer_release(encoded);
+                encoded = NULL;
+            }
+        }
+        else {
+            encoded->size = length;
+        }
+        broadcast->codecs[i] = session->codec;
+        broadcast->encoded[i] = encoded;
+        ++broadcast->encoded_count;
+    }
+    struct obs_shared_buffer* encoded = broadcast->encoded[i];
+    if (encoded == NULL) {
+        return false;
+    }
+    // Every session gets a reference to the same bytes, nothing is copied per session.
+    struct iovec const parts[2] = {
+        {.iov_base = encoded->data, .iov_len = encoded->size},
+        {.iov_base = NULL, .iov_len = 0},
+    };
+    return obs_server_queue_sendmsg(server, session, session->socket, NULL, parts, obs_shared_buffer_retain(encoded),
+                                    0);
+}
+
+/*!
+ * Releases the encoded packets of a broadcast once it has been queued to every session.
+ * \param broadcast Pointer to the broadcast.
+ */
+void obs_broadcast_finish(struct obs_broadcast* broadcast) {
+    for (size_t i = 0; i < broadcast->encoded_count; ++i) {
+        if (broadcast->encoded[i] != NULL) {
+            obs_shared_buffer_release(broadcast->encoded[i]);
+        }
+    }
+    broadcast->encoded_count = 0;
+}
+
+/*!
+ * Gets the coordinate of the cell of the interest grid an absolute integer coordinate is in.
+ * \param absolute X or Z coordinate in absolute integer coordinates.
+ * \return The same coordinate of the cell.
+ */
+static inline int32_t obs_interest_cell(int32_t const absolute) {
+    return mc_interest_cell(absolute >> 9);
+}
+
+/*!
+ * Finds the entities within the interest radius of a cell, into the interest members of the server.
+ * \param server Pointer to a server structure.
+ * \param cell_x X coordinate of the cell.
+ * \param cell_z Z coordinate of the cell.
+ * \return Amount of entity slots found.
+ */
+size_t obs_server_find_interested(struct obs_server* server, int32_t const cell_x, int32_t const cell_z) {
+    return mc_interest_grid_query(server->interest_grid, cell_x, cell_z, server->interest_radius,
+                                  server->interest_members, server->entity_capacity);
+}
+
+/*!
+ * Sends a packet about an entity to every client near it that knows the entity.
+ * \param server Pointer to a server structure.
+ * \param slot Slot of the entity.
+ * \param cell_x X coordinate of the cell the entity is in.
+ * \param cell_z Z coordinate of the cell the entity is in.
+ * \param packet Pointer to the packet.
+ * \return Amount of sessions the packet was sent to.
+ */
+size_t obs_server_broadcast_entity(struct obs_server* server, uint32_t const slot, int32_t const cell_x,
+                                   int32_t const cell_z, struct mc_proto_server_packet const* packet) {
+    struct obs_broadcast broadcast = {
+        .packet = packet,
+    };
+    size_t const count = obs_server_find_interested(server, cell_x, cell_z);
+    size_t recipients = 0;
+    size_t batch = 0;
+    for (size_t i = 0; i < count; ++i) {
+        struct obs_session* other = server->entity_players[server->interest_members[i]];
+        // Clients that do not know the entity yet are told about it on the next tick, where it is by then.
+        if (other == NULL || other->tracker == NULL || !mc_entity_tracker_knows(other->tracker, slot) ||
+            !obs_server_queue_broadcast(server, &broadcast, other)) {
+            continue;
+        }
+        ++recipients;
+        // A crowd is sent in batches of the queue depth, the kernel starts on a batch while the next one is queued.
+        if (++batch == server->queue_depth) {
+            obs_server_submit_queue(server);
+            batch = 0;
+        }
+    }
+    obs_broadcast_finish(&broadcast);
+    obs_server_submit_queue(server);
+    return recipients;
+}
+
+/*!
+ * Gives a player that joined an entity slot.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to the session of the player that joined.
+ * \return Whether there was an entity slot left.
+ */
+bool obs_server_allocate_player(struct obs_server* server, struct obs_session* session) {
+    // The player starts out above the origin, where its chunk stream is centered.
+    uint32_t const slot = mc_entity_store_spawn(server->entities, MC_ENTITY_PLAYER, 0.5, 64.0, 0.5);
+    if (slot == MC_ENTITY_NO_SLOT) {
+        return false;
+    }
+    session->entity_id = mc_entity_ids_id(server->entities->ids, slot);
+    server->entity_players[slot] = session;
+    return true;
+}
+
+/*!
+ * Puts a player that joined in the interest grid. The clients near it are told about it on the next tick.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to the session of the player that joined.
+ */
+void obs_server_spawn_player(struct obs_server* server, struct obs_session* session) {
+    uint32_t const slot = mc_entity_slot(session->entity_id);
+    mc_interest_grid_insert(server->interest_grid, slot, obs_interest_cell(server->entities->relayed_x[slot]),
+                            obs_interest_cell(server->entities->relayed_z[slot]));
+}
+
+/*!
+ * Takes a player that left out of the interest grid. The clients that know it are told to forget it on the next tick,
+ * after which its entity slot is released.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to the session of the player that left.
+ */
+void obs_server_despawn_player(struct obs_server* server, struct obs_session* session) {
+    uint32_t const slot = mc_entity_slot(session->entity_id);
+    if (slot >= server->entity_capacity || server->entity_players[slot] != session) {
+        return;
+    }
+    if (mc_interest_grid_contains(server->interest_grid, slot)) {
+        mc_interest_grid_remove(server->interest_grid, slot);
+    }
+    server->entity_players[slot] = NULL;
+    server->released_entities[server->released_count++] = slot;
+}
+
+/*!
+ * Entities a client has to be told about, or told to forget, on a tick.
+ */
+struct obs_tracker_update {
+    struct obs_server* server;
+    struct obs_session* observer;
+};
+
+/*!
+ * Tells a client about an entity that came near it.
+ * \param user_data Pointer to an obs_tracker_update structure.
+ * \param slot Slot of the entity.
+ * \return Whether the client was told.
+ */
+bool obs_server_track_spawn(void* user_data, uint32_t const slot) {
+    struct obs_tracker_update const* update = user_data;
+    struct obs_server* server = update->server;
+    struct mc_entity_store const* entities = server->entities;
+    mc_dword const entity_id = mc_entity_ids_id(entities->ids, slot);
+    struct mc_proto_server_packet packet;
+    switch (entities->type[slot]) {
+        case MC_ENTITY_PLAYER: {
+            struct obs_session const* spawned = server->entity_players[slot];
+            if (spawned == NULL) {
+                return false;
+            }
+            packet = (struct mc_proto_server_packet) {
+                .type = MC_PACKET_PLAYER_SPAWN,
+                .player_spawn = {
+                    .entity_id = entity_id,
+                    .name_length = (mc_word) spawned->username_length,
+                    .name = spawned->username,
+                    .x = entities->relayed_x[slot],
+                    .y = entities->relayed_y[slot],
+                    .z = entities->relayed_z[slot],
+                    .yaw = (mc_byte) entities->relayed_yaw[slot],
+                    .pitch = (mc_byte) entities->relayed_pitch[slot],
+                    .item_id = 0,
+                },
+            };
+            break;
+        }
+
+        case MC_ENTITY_ITEM:
+            packet = (struct mc_proto_server_packet) {
+                .type = MC_PACKET_PICKUP_SPAWN,
+                .pickup_spawn = {
+                    .entity_id = entity_id,
+                    .item_id = (mc_word) entities->variant[slot],
+                    .count = (mc_byte) entities->count[slot],
+                    .damage = (mc_word) entities->data[slot],
+                    .x = entities->relayed_x[slot],
+                    .y = entities->relayed_y[slot],
+                    .z = entities->relayed_z[slot],
+                    .yaw = (mc_byte) entities->relayed_yaw[slot],
+                    .pitch = (mc_byte) entities->relayed_pitch[slot],
+                    .roll = 0,
+                },
+            };
+            break;
+
+        case MC_ENTITY_FALLING_BLOCK:
+        case MC_ENTITY_ARROW:
+            packet = (struct mc_proto_server_packet) {
+                .type = MC_PACKET_OBJECT_SPAWN,
+                .object_spawn = {
+                    .entity_id = entity_id,
+                    .type = (mc_byte) entities->variant[slot],
+                    .x = entities->relayed_x[slot],
+                    .y = entities->relayed_y[slot],
+                    .z = entities->relayed_z[slot],
+                },
+            };
+            break;
+
+        case MC_ENTITY_MOB: {
+            // Beta clients read entity metadata up to its terminator, none of it is tracked.
+            static mc_byte const empty_metadata[] = {0x7F};
+            packet = (struct mc_proto_server_packet) {
+                .type = MC_PACKET_MOB_SPAWN,
+                .mob_spawn = {
+                    .entity_id = entity_id,
+                    .type = (mc_byte) entities->variant[slot],
+                    .x = entities->relayed_x[slot],
+                    .y = entities->relayed_y[slot],
+                    .z = entities->relayed_z[slot],
+                    .yaw = (mc_byte) entities->relayed_yaw[slot],
+                    .pitch = (mc_byte) entities->relayed_pitch[slot],
+                    .metadata_size = sizeof(empty_metadata),
+                    .metadata = empty_metadata,
+                },
+            };
+            break;
+        }
+
+        default:
+            return false;
+    }
+    if (!obs_server_queue_packet(server, update->observer, &packet)) {
+        return false;
+    }
+    ++server->metrics.entities_spawned;
+    return true;
+}
+
+/*!
+ * Tells a client to forget an entity that left its surroundings or the world.
+ * \param user_data Pointer to an obs_tracker_update structure.
+ * \param slot Slot of the entity.
+ * \return Whether the client was told.
+ */
+bool obs_server_track_destroy(void* user_data, uint32_t const slot) {
+    struct obs_tracker_update const* update = user_data;
+    struct mc_proto_server_packet const packet = {
+        .type = MC_PACKET_ENTITY_DESTROY,
+        .entity_destroy = {
+            .entity_id = mc_entity_ids_id(update->server->entities->ids, slot),
+        },
+    };
+    if (!obs_server_queue_packet(update->server, update->observer, &packet)) {
+        return false;
+    }
+    ++update->server->metrics.entities_destroyed;
+    return true;
+}
+
+/*!
+ * Checks whether any client still knows an entity.
+ * \param server Pointer to a server structure.
+ * \param slot Slot of the entity.
+ * \return Whether a client knows the entity.
+ */
+bool obs_server_entity_known(struct obs_server const* server, uint32_t const slot) {
+    for (size_t i = 0; i < server->session_limit; ++i) {
+        struct obs_session const* observer = &server->sessions[i];
+        if (observer->status == SESSION_CONNECTED && observer->tracker != NULL &&
+            mc_entity_tracker_knows(observer->tracker, slot)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * Tells every client about the entities that came near it and to forget the ones that left, then releases the entity
+ * slots of the players that left, which no client knows anymore.
+ *
+ * The packets of each client are submitted before the next client is updated. A spawn or destroy that could not be
+ * queued leaves the tracker of the client as it was, so it is tried again on the next tick.
+ * \param server Pointer to a server structure.
+ */
+void obs_server_track_entities(struct obs_server* server) {
+    for (size_t i = 0; i < server->session_limit; ++i) {
+        struct obs_session* observer = &server->sessions[i];
+        if (observer->status != SESSION_CONNECTED || observer->tracker == NULL) {
+            continue;
+        }
+        uint32_t const self = mc_entity_slot(observer->entity_id);
+        mc_entity_tracker_clear(observer->tracker);
+        size_t const count = obs_server_find_interested(server, obs_interest_cell(server->entities->relayed_x[self]),
+                                                        obs_interest_cell(server->entities->relayed_z[self]));
+        for (size_t j = 0; j < count; ++j) {
+            if (server->interest_members[j] != self) {
+                mc_entity_tracker_want(observer->tracker, server->interest_members[j]);
+            }
+        }
+        struct obs_tracker_update update = {
+            .server = server,
+            .observer = observer,
+        };
+        mc_entity_tracker_update(observer->tracker, obs_server_track_spawn, obs_server_track_destroy, &update);
+        obs_server_submit_queue(server);
+    }
+    // A slot is only reused once every client was told to forget its entity.
+    size_t kept = 0;
+    for (size_t i = 0; i < server->released_count; ++i) {
+        uint32_t const slot = server->released_entities[i];
+        if (obs_server_entity_known(server, slot)) {
+            server->released_entities[kept++] = slot;
+        }
+        else {
+            mc_entity_store_remove(server->entities, slot);
+        }
+    }
+    server->released_count = kept;
+}
+
+/*!
+ * Relays an animation of a player to the players near it.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param animation Pointer to the animation packet.
+ */
+void obs_server_animate_player(struct obs_server* server, struct obs_session* session,
+                               struct mc_proto_animation const* animation) {
+    if (session->status != SESSION_CONNECTED) {
+        obs_server_disconnect(server, session, OBS_DISCONNECT_UNEXPECTED_PACKET);
+        return;
+    }
+    struct mc_proto_server_packet const packet = {
+        .type = MC_PACKET_ANIMATION,
+        .animation = {
+            .entity_id = session->entity_id,
+            .animation = animation->animation,
+        },
+    };
+    uint32_t const slot = mc_entity_slot(session->entity_id);
+    obs_server_broadcast_entity(server, slot, obs_interest_cell(server->entities->relayed_x[slot]),
+                                obs_interest_cell(server->entities->relayed_z[slot]), &packet);
+}
+
+/*!
+ * Relays the movement of an entity to the clients near it that know it, and moves it in the interest grid.
+ *
+ * Movement of less than four blocks since the last relayed position is sent as a relative move, which is a third of
+ * the size of a teleport. The relayed position is kept in absolute integer coordinates, so the relative moves add up
+ * to exactly the position the other clients are told about.
+ * \param server Pointer to a server structure.
+ * \param move Pointer to the movement of the entity.
+ * \return Amount of sessions the movement was sent to.
+ */
+size_t obs_server_relay_movement(struct obs_server* server, struct mc_entity_move const* move) {
+    mc_dword const entity_id = mc_entity_ids_id(server->entities->ids, move->slot);
+    struct mc_proto_server_packet packet;
+    if (move->dx < INT8_MIN || move->dx > INT8_MAX || move->dy < INT8_MIN || move->dy > INT8_MAX ||
+        move->dz < INT8_MIN || move->dz > INT8_MAX) {
+        packet = (struct mc_proto_server_packet) {
+            .type = MC_PACKET_ENTITY_TELEPORT,
+            .entity_teleport = {
+                .entity_id = entity_id,
+                .x = move->x,
+                .y = move->y,
+                .z = move->z,
+                .yaw = (mc_byte) move->yaw,
+                .pitch = (mc_byte) move->pitch,
+            },
+        };
+    }
+    else if (move->moved && move->rotated) {
+        packet = (struct mc_proto_server_packet) {
+            .type = MC_PACKET_ENTITY_MOVE_ROTATE,
+            .entity_move_rotate = {
+                .entity_id = entity_id,
+                .dx = (mc_byte) move->dx,
+                .dy = (mc_byte) move->dy,
+                .dz = (mc_byte) move->dz,
+                .yaw = (mc_byte) move->yaw,
+                .pitch = (mc_byte) move->pitch,
+            },
+        };
+    }
+    else if (move->moved) {
+        packet = (struct mc_proto_server_packet) {
+            .type = MC_PACKET_ENTITY_MOVE,
+            .entity_move = {
+                .entity_id = entity_id,
+                .dx = (mc_byte) move->dx,
+                .dy = (mc_byte) move->dy,
+                .dz = (mc_byte) move->dz,
+            },
+        };
+    }
+    else {
+        packet = (struct mc_proto_server_packet) {
+            .type = MC_PACKET_ENTITY_ROTATE,
+            .entity_rotate = {
+                .entity_id = entity_id,
+                .yaw = (mc_byte) move->yaw,
+                .pitch = (mc_byte) move->pitch,
+            },
+        };
+    }
+    int32_t const cell_x = obs_interest_cell(move->x);
+    int32_t const cell_z = obs_interest_cell(move->z);
+    mc_interest_grid_move(server->interest_grid, move->slot, cell_x, cell_z);
+    size_t const recipients = obs_server_broadcast_entity(server, move->slot, cell_x, cell_z, &packet);
+    server->metrics.movement_packets_sent += recipients;
+    return recipients;
+}
+
+/*!
+ * Sends a player back to the position the server has for it.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ */
+void obs_server_correct_position(struct obs_server* server, struct obs_session* session) {
+    struct mc_entity_store const* entities = server->entities;
+    uint32_t const slot = mc_entity_slot(session->entity_id);
+    struct mc_proto_server_packet const packet = {
+        .type = MC_PACKET_PLAYER_TRANSFORM,
+        .transform = {
+            .x = entities->x[slot],
+            .y = entities->y[slot],
+            .head_y = session->stance,
+            .z = entities->z[slot],
+            .yaw = entities->yaw[slot],
+            .pitch = entities->pitch[slot],
+            .grounded = (entities->flags[slot] & MC_ENTITY_GROUNDED) != 0 ? MC_TRUE : MC_FALSE,
+        },
+    };
+    obs_server_queue_packet(server, session, &packet);
+    obs_server_submit_queue(server);
+}
+
+/*!
+ * Handles a movement packet of a player, which is relayed to the other players on the next tick.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param position Pointer to the new position, or NULL if the player did not move.
+ * \param rotation Pointer to the new yaw and pitch, or NULL if the player did not turn.
+ * \param grounded Whether the player is standing on the ground.
+ */
+void obs_server_move_player(struct obs_server* server, struct obs_session* session,
+                            struct mc_proto_player_position const* position, mc_float const rotation[2],
+                            mc_bool const grounded) {
+    if (session->status != SESSION_CONNECTED) {
+        obs_server_disconnect(server, session, OBS_DISCONNECT_UNEXPECTED_PACKET);
+        return;
+    }
+    struct mc_entity_store* entities = server->entities;
+    uint32_t const slot = mc_entity_slot(session->entity_id);
+    bool changed = false;
+    if (position != NULL) {
+        // Positions the world cannot hold are dropped instead of being relayed to everyone else.
+        if (!(fabs(position->x) < OBS_WORLD_LIMIT && fabs(position->y) < OBS_WORLD_LIMIT &&
+              fabs(position->head_y) < OBS_WORLD_LIMIT && fabs(position->z) < OBS_WORLD_LIMIT)) {
+            OBS_LOG_DEBUG("server", "Ignoring invalid position of %.*s (%08X:%d)",
+                          session->username_length, session->username, session->address, session->port);
+            return;
+        }
+        // A single packet cannot move the player, and with it the chunk view, across the world.
+        double const dx = position->x - entities->x[slot];
+        double const dz = position->z - entities->z[slot];
+        if (!(dx * dx + dz * dz <= OBS_MOVE_LIMIT * OBS_MOVE_LIMIT)) {
+            OBS_LOG_DEBUG("server", "%.*s (%08X:%d) moved too far, sending it back",
+                          session->username_length, session->username, session->address, session->port);
+            obs_server_correct_position(server, session);
+            return;
+        }
+        int32_t const old_chunk_x = mc_entity_absolute(entities->x[slot]) >> 9;
+        int32_t const old_chunk_z = mc_entity_absolute(entities->z[slot]) >> 9;
+        changed = position->x != entities->x[slot] || position->y != entities->y[slot] ||
+                  position->z != entities->z[slot];
+        entities->x[slot] = position->x;
+        entities->y[slot] = position->y;
+        entities->z[slot] = position->z;
+        session->stance = position->head_y;
+        int32_t const chunk_x = mc_entity_absolute(entities->x[slot]) >> 9;
+        int32_t const chunk_z = mc_entity_absolute(entities->z[slot]) >> 9;
+        if (chunk_x != old_chunk_x || chunk_z != old_chunk_z) {
+            obs_server_move_view(server, session, chunk_x, chunk_z);
+        }
+    }
+    if (rotation != NULL && fabsf(rotation[0]) < OBS_ANGLE_LIMIT && fabsf(rotation[1]) < OBS_ANGLE_LIMIT) {
+        changed |= rotation[0] != entities->yaw[slot] || rotation[1] != entities->pitch[slot];
+        entities->yaw[slot] = rotation[0];
+        entities->pitch[slot] = rotation[1];
+    }
+    uint8_t const flags = entities->flags[slot];
+    if (grounded != MC_FALSE) {
+        entities->flags[slot] |= MC_ENTITY_GROUNDED;
+    }
+    else {
+        entities->flags[slot] &= (uint8_t) ~MC_ENTITY_GROUNDED;
+    }
+    changed |= entities->flags[slot] != flags;
+    ++server->metrics.movement_updates;
+    // The movement is relayed once per tick, however many packets the client sends within it. A packet that changes
+    // nothing, such as the grounded packet an idle client keeps sending, would not have been relayed on its own.
+    if (changed) {
+        ++session->movement_updates;
+    }
+}
+
+/*!
+ * Sends a heartbeat packet to the client in response to a heartbeat.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param heartbeat Pointer to heartbeat packet structure.
+ */
+void obs_server_heartbeat(struct obs_server* server, struct obs_session* session,
+                          struct mc_proto_heartbeat const* heartbeat) {
+    OBS_LOG_TRACE("server", "Received heartbeat from %.*s (%08X:%d)",
+                  session->username_length, session->username, session->address, session->port);
+    // This is, presumably, the keepalive packet. For now, let's just reply with an identical message.
+    struct mc_proto_server_packet const response = {
+        .type = MC_PACKET_HEARTBEAT,
+        .heartbeat = {},
+    };
+    obs_server_queue_packet(server, session, &response);
+    obs_server_submit_queue(server);
+}
+
+/*!
+ * Handles an authentication request.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param authentication Pointer to an authenticate request packet structure.
+ */
+void obs_server_authenticate(struct obs_server* server, struct obs_session* session,
+                             struct mc_proto_authentication_request_view const* authentication) {
+    OBS_LOG_DEBUG("server", "Handling authentication request from %08X:%d", session->address, session->port);
+    if (session->status != SESSION_AUTHENTICATING) {
+        OBS_LOG_WARN(
+            "server", "Received authentication from %08X:%d, but session status is not AUTHENTICATING. Disconnecting!",
+            session->address, session->port);
+        obs_server_disconnect(server, session, OBS_DISCONNECT_UNEXPECTED_PACKET);
+        return;
+    }
+    // The codec detected from the handshake only knows the string encoding of the client, the protocol version decides
+    // which codec is used from here on.
+    struct mc_proto_codec const* codec = mc_proto_codec_for_version(authentication->protocol_version);
+    if (codec == NULL || codec->string_encoding != session->codec->string_encoding) {
+        OBS_LOG_INFO("server", "Player %.*s (%08X:%d) is running incompatible protocol version %d. Disconnecting!",
+                     session->username_length, session->username, session->address, session->port,
+                     authentication->protocol_version);
+        obs_server_disconnect(server, session, OBS_DISCONNECT_INCOMPATIBLE_VERSION);
+        return;
+    }
+    if (!obs_server_allocate_player(server, session)) {
+        OBS_LOG_INFO("server", "No entity ID left for player %.*s (%08X:%d). Disconnecting!",
+                     session->username_length, session->username, session->address, session->port);
+        obs_server_disconnect(server, session, OBS_DISCONNECT_SERVER_FULL);
+        return;
+    }
+    session->codec = codec;
+    session->status = SESSION_CONNECTED;
+    // Send the response packet.
+    OBS_LOG_DEBUG("server", "Sending authentication response to %.*s (%08X:%d)",
+                  session->username_length, session->username, session->address, session->port);
+    struct mc_proto_server_packet const response = {
+        .type = MC_PACKET_AUTHENTICATION,
+        .authentication = {
+            .entity_id = session->entity_id,
+            .unknown0_length = 0,
+            .unknown0 = "",
+            .unknown1_length = 0,
+            .unknown1 = "",
+            .map_seed = 0,
+            .dimension = 0,
+        },
+    };
+    obs_server_queue_packet(server, session, &response);
+    obs_server_submit_queue(server);
+    OBS_LOG_INFO("server", "Player %.*s (%08X:%d) has joined the game using protocol %s",
+                 session->username_length, session->username, session->address, session->port, codec->name);
+    // Players join at the origin until there is a world spawn to put them at.
+    session->stream = mc_chunk_stream_create(server->view_radius, 0, 0);
+    if (session->stream == NULL) {
+        OBS_LOG_ERROR("server", "Out of memory, no chunks will be sent to %.*s (%08X:%d)",
+                      session->username_length, session->username, session->address, session->port);
+    }
+    session->join_time = obs_monotonic_time();
+    session->view_streamed = false;
+    session->tracker = mc_entity_tracker_create(server->entity_capacity);
+    if (session->tracker == NULL) {
+        OBS_LOG_ERROR("server", "Out of memory, no other players will be shown to %.*s (%08X:%d)",
+                      session->username_length, session->username, session->address, session->port);
+    }
+    session->stance = 65.62;
+    obs_server_spawn_player(server, session);
+}
+
+/*!
+ * Handles a handshake request.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param request Pointer to a handshake request packet.
+ */
+void obs_server_handshake(struct obs_server* server, struct obs_session* session,
+                          struct mc_proto_handshake_request_view const* request) {
+    OBS_LOG_DEBUG("server", "Handling handshake request from %08X:%d", session->address, session->port);
+    if (session->status != SESSION_HANDSHAKING) {
+        OBS_LOG_WARN("server", "Received handshake from %08X:%d, but session status is not HANDSHAKING. Disconnecting!",
+                     session->address, session->port);
+        obs_server_disconnect(server, session, OBS_DISCONNECT_UNEXPECTED_PACKET);
+        return;
+    }
+    // Copy over the username of the player.
+    int const username_length = mc_proto_string_view_to_utf8(&request->name, session->username,
+                                                             sizeof(session->username));
+    if (username_length < 0) {
+        OBS_LOG_WARN("server", "Received handshake from %08X:%d with a username that is too long. Disconnecting!",
+                     session->address, session->port);
+        obs_server_disconnect(server, session, OBS_DISCONNECT_INVALID_USERNAME);
+        return;
+    }
+    session->username_length = username_length;
+    session->status = SESSION_AUTHENTICATING;
+    // Send back to the appropriate response to the client.
+    OBS_LOG_DEBUG("server", "Sending handshake response to %.*s (%08X:%d)",
+                  session->username_length, session->username, session->address, session->port);
+    struct mc_proto_server_packet const response = {
+        .type = MC_PACKET_HANDSHAKE,
+        .handshake = {
+            .unknown_length = 1,
+            .unknown = "-",
+        },
+    };
+    obs_server_queue_packet(server, session, &response);
+    obs_server_submit_queue(server);
+    OBS_LOG_INFO("server", "Player %.*s (%08X:%d) is joining the game",
+                 session->username_length, session->username, session->address, session->port);
+}
+
+/*!
+ * Dispatches a packet based on its type.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a session structure.
+ * \param packet Pointer to a view of the client packet, valid until the read cursor of the session moves past it.
+ */
+void obs_server_dispatch_packet(struct obs_server* server, struct obs_session* session,
+                                struct mc_proto_client_view const* packet) {
+    switch ((uint8_t) packet->type) {
+        case MC_PACKET_HEARTBEAT:
+            return obs_server_heartbeat(server, session, &packet->heartbeat);
+
+        case MC_PACKET_AUTHENTICATION:
+            return obs_server_authenticate(server, session, &packet->authentication);
+
+        case MC_PACKET_HANDSHAKE:
+            return obs_server_handshake(server, session, &packet->handshake);
+
+        case MC_PACKET_PLAYER_GROUNDED:
+            return obs_server_move_player(server, session, NULL, NULL, packet->grounded.grounded);
+
+        case MC_PACKET_PLAYER_POSITION:
+            return obs_server_move_player(server, session, &packet->position, NULL, packet->position.grounded);
+
+        case MC_PACKET_PLAYER_ROTATION:
+            return obs_server_move_player(server, session, NULL,
+                                          (mc_float const[2]) {packet->rotation.yaw, packet->rotation.pitch},
+                                          packet->rotation.grounded);
+
+        case MC_PACKET_ANIMATION:
+            return obs_server_animate_player(server, session, &packet->animation);
+
+        case MC_PACKET_PLAYER_TRANSFORM: {
+            struct mc_proto_player_transform const* transform = &packet->transform;
+            struct mc_proto_player_position const position = {
+                .x = transform->x,
+                .y = transform->y,
+                .head_y = transform->head_y,
+                .z = transform->z,
+            };
+            return obs_server_move_player(server, session, &position,
+                                          (mc_float const[2]) {transform->yaw, transform->pitch},
+                                          transform->grounded);
+        }
+
+        // Valid client packets the server does not act on yet, a client sends these during normal play.
+        case MC_PACKET_CHAT:
+        case MC_PACKET_INVENTORY:
+        case MC_PACKET_USE_ENTITY:
+        case MC_PACKET_RESPAWN:
+        case MC_PACKET_PLAYER_DIG:
+        case MC_PACKET_PLAYER_PLACE:
+        case MC_PACKET_HOLDING:
+        case MC_PACKET_ENTITY_ACTION:
+        case MC_PACKET_PICKUP_SPAWN:
+        case MC_PACKET_COMPLEX_ENTITY:
+        case MC_PACKET_WINDOW_CLOSE:
+        case MC_PACKET_WINDOW_CLICK:
+        case MC_PACKET_TRANSACTION:
+        case MC_PACKET_SIGN_UPDATE:
+        case MC_PACKET_KICK:
+            OBS_LOG_TRACE("server", "Ignoring packet with ID 0x%02X", packet->type);
+            return;
+
+        default:
+            OBS_LOG_DEBUG("server", "Received packet with ID 0x%02X, this packet is unhandled!", packet->type);
+            return;
+    }
+}
+
+/*!
+ * Processes received data from a client connection.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param frame Pointer to a packet frame structure.
+ */
+void obs_server_process_data(struct obs_server* server, struct obs_session* session, struct obs_frame* frame) {
+    uint8_t const* data = frame->receive.buffer;
+    size_t const bytes_in = frame->receive.bytes_in;
+    size_t cursor = 0;
+    // Result of framing the data at the cursor, see mc_proto_frame_client_packet().
+    int status = -1;
+    while (cursor < bytes_in) {
+        if (bytes_in - cursor < session->pending_bytes) {
+            // Still short of what the packet was known to need last time, framing it again would fail the same way.
+            status = -(int) (session->pending_bytes - (bytes_in - cursor));
+            break;
+        }
+        if (session->codec == NULL) {
+            // The first packet tells which protocol family the client speaks.
+            status = mc_proto_detect_codec(data + cursor, bytes_in - cursor, &session->codec);
+            if (status <= 0) {
+                break;
+            }
+        }
+        // Find every complete packet up front, so only complete packets are decoded.
+        OBS_LOG_TRACE("server", "Scanning receive buffer for complete packets on frame[%llu]", frame->trace);
+        size_t lengths[OBS_SCAN_BATCH_SIZE];
+        size_t const count = mc_proto_scan_client_packets(session->codec, data + cursor, bytes_in - cursor,
+                                                          lengths, OBS_SCAN_BATCH_SIZE, &status);
+        if (count == 0) {
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            struct mc_proto_client_view packet;
+            int const result = mc_proto_view_client_packet(session->codec, data + cursor, lengths[i], &packet);
+            if (result != (int) lengths[i]) {
+                status = 0;
+                break;
+            }
+            OBS_LOG_TRACE("server", "Read %llu bytes from receive buffer on frame[%llu]", result, frame->trace);
+            OBS_LOG_TRACE("server", "Dispatching packet with type ID 0x%02X on frame[%llu]",
+                          packet.type, frame->trace);
+            struct mc_proto_codec const* codec = session->codec;
+            obs_server_dispatch_packet(server, session, &packet);
+            if (session->status == SESSION_DISCONNECTED) {
+                // The packet got the session closed, ignore whatever else the client sent.
+                obs_server_release_frame(server, frame);
+                return;
+            }
+            // The packet points into the receive buffer, only release its bytes once it is handled.
+            cursor += result;
+            session->in.read_cursor += result;
+            if (session->codec != codec) {
+                // Packets after this one may be framed differently, scan them again.
+                status = 1;
+                break;
+            }
+        }
+        if (status <= 0) {
+            break;
+        }
+    }
+    if (status == 0) {
+        OBS_LOG_WARN("server", "Received unparseable data from %08X:%d on frame[%llu], disconnecting!",
+                     session->address, session->port, frame->trace);
+        enum obs_disconnect_reason reason = OBS_DISCONNECT_MALFORMED_PACKET;
+        if (session->codec == NULL) {
+            reason = OBS_DISCONNECT_UNEXPECTED_PACKET;
+        }
+        else if (session->codec->framers[data[cursor]] == NULL) {
+            reason = OBS_DISCONNECT_UNKNOWN_PACKET;
+        }
+        obs_server_disconnect(server, session, reason);
+        obs_server_release_frame(server, frame);
+        return;
+    }
+    if (cursor < bytes_in) {
+        OBS_LOG_TRACE("server", "Data in receive buffer is incomplete by %llu bytes on frame[%llu]", -status,
+                      frame->trace);
+        size_t const unread = bytes_in - cursor;
+        session->pending_bytes = unread + -status;
+        if (session->pending_bytes > session->in.ring->size) {
+            OBS_LOG_WARN("server", "Received packet of at least %llu bytes from %08X:%d on frame[%llu], which does "
+                         "not fit in the receive buffer, disconnecting!",
+                         session->pending_bytes, session->address, session->port, frame->trace);
+            obs_server_disconnect(server, session, OBS_DISCONNECT_OVERSIZED_PACKET);
+            obs_server_release_frame(server, frame);
+            return;
+        }
+        // Queue up another receive for exactly the missing bytes. No wakeups are needed before they have all arrived.
+        obs_server_queue_recv_offset(server, session, session->socket,
+                                     obs_rw_buffer_read_ptr(&session->in),
+                                     session->pending_bytes,
+                                     unread,
+                                     MSG_WAITALL);
+        obs_server_release_frame(server, frame);
+        return;
+    }
+    session->pending_bytes = 0;
+    OBS_LOG_TRACE("server", "All data in receive buffer is processed, queueing new recv");
+    obs_server_release_frame(server, frame);
+    obs_server_queue_recv(server, session, session->socket,
+                          obs_rw_buffer_write_ptr(&session->in),
+                          obs_rw_buffer_capacity(&session->in), 0);
+}
+
+/*!
+ * Releases the buffer and payload of a SEND frame.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to the client session the data was sent to.
+ * \param send_frame Pointer to the send frame.
+ */
+void obs_server_release_send_data(struct obs_server const* server, struct obs_session* session,
+                                  struct obs_send_frame* send_frame) {
+    // The session may have been closed and reused while the send was in flight.
+    session->out_backlog -= send_frame->buffer_size < session->out_backlog ? send_frame->buffer_size
+                                                                           : session->out_backlog;
+    obs_server_release_buffer(server, send_frame->buffer);
+    if (send_frame->payload != NULL) {
+        obs_shared_buffer_release(send_frame->payload);
+    }
+}
+
+/*!
+ * Completes a send() or sendmsg() operation.
+ * \param server Pointer to a server structure.
+ * \param frame Pointer to a packet frame structure.
+ * \param cqe Pointer to the completion queue entry.
+ */
+void obs_server_handle_send(struct obs_server* server, struct obs_frame* frame, struct io_uring_cqe const* cqe) {
+    struct obs_session* session = frame->session;
+    struct obs_send_frame* send_frame = &frame->send;
+    if (cqe->res < 0) {
+        // If we get -EBADF, that just means the connection was closed. This is not an error!
+        if (cqe->res != -EBADF) {
+            OBS_LOG_URING_ERROR("server", "send", cqe->res);
+        }
+        // The session may have been closed and reused while the send was in flight, leave the new connection be.
+        if (frame->connection == session->connection) {
+            obs_server_disconnect(server, session, OBS_DISCONNECT_CONNECTION_ERROR);
         }
+        obs_server_release_send_data(server, session, send_frame);
         obs_server_release_frame(server, frame);
     }
     else {
@@ -693,14 +2098,20 @@ void obs_server_handle_send(struct obs_server* server, struct obs_frame* frame,
                       bytes_sent, send_frame->bytes_out, session->address, session->port);
         if (send_frame->bytes_out == send_frame->buffer_size) {
             OBS_LOG_TRACE("server", "Fully sent data for frame[%llu]", frame->trace);
-            obs_server_release_buffer(server, send_frame->buffer);
+            obs_server_release_send_data(server, session, send_frame);
             obs_server_release_frame(server, frame);
         }
-        else {
-            // TODO: Incomplete write, queue up another one.
-            free(send_frame->buffer);
+        else if (frame->connection != session->connection || session->status == SESSION_DISCONNECTED) {
+            // Nobody is listening for the rest anymore.
+            obs_server_release_send_data(server, session, send_frame);
             obs_server_release_frame(server, frame);
         }
+        else {
+            // Dropping the rest would leave the client in the middle of a packet, keep the frame and send the rest.
+            OBS_LOG_TRACE("server", "Partially sent data for frame[%llu], %llu bytes left", frame->trace,
+                          send_frame->buffer_size - send_frame->bytes_out);
+            obs_server_queue_send_rest(server, frame, bytes_sent);
+        }
     }
     obs_server_submit_queue(server);
 }
@@ -713,17 +2124,21 @@ void obs_server_handle_send(struct obs_server* server, struct obs_frame* frame,
  */
 void obs_server_handle_recv(struct obs_server* server, struct obs_frame* frame, struct io_uring_cqe const* cqe) {
     struct obs_session* session = frame->session;
-    if (cqe->res < 0) {
+    if (frame->connection != session->connection) {
+        // The session was closed and reused while the receive was in flight.
+        obs_server_release_frame(server, frame);
+    }
+    else if (cqe->res < 0) {
         // If we get -EBADF, this is not really an error. Anything else is an error!
         if (cqe->res != -EBADF) {
             OBS_LOG_URING_ERROR("server", "recv", cqe->res);
-            obs_server_queue_close(server, session, session->socket);
         }
+        obs_server_disconnect(server, session, OBS_DISCONNECT_CONNECTION_ERROR);
         obs_server_release_frame(server, frame);
     }
     else if (cqe->res == 0) {
         OBS_LOG_INFO("server", "%08X:%d has disconnected", session->address, session->port);
-        obs_server_queue_close(server, session, session->socket);
+        obs_server_disconnect(server, session, OBS_DISCONNECT_CONNECTION_CLOSED);
         obs_server_release_frame(server, frame);
     }
     else {
@@ -764,6 +2179,12 @@ void obs_server_handle_accept(struct obs_server* server, struct obs_frame* frame
             session->address = address;
             session->port = port;
             session->status = SESSION_HANDSHAKING;
+            session->codec = NULL;
+            session->pending_bytes = 0;
+            session->out_backlog = 0;
+            session->connection = ++server->connection_count;
+            session->stream = NULL;
+            session->stream_jobs = 0;
             session->in.ring = obs_alloc_ring_buffer(4096, 1);
             obs_server_queue_recv(server, session, session->socket,
                                   obs_rw_buffer_write_ptr(&session->in),
@@ -782,13 +2203,14 @@ void obs_server_handle_accept(struct obs_server* server, struct obs_frame* frame
  * \param frame Pointer to the packet frame.
  * \param cqe Pointer to the completion queue entry.
  */
-void obs_server_handle_close(struct obs_server const* server, struct obs_frame* frame, struct io_uring_cqe const* cqe) {
+void obs_server_handle_close(struct obs_server* server, struct obs_frame* frame, struct io_uring_cqe const* cqe) {
     if (cqe->res < 0) {
         OBS_LOG_URING_ERROR("server", "close", cqe->res);
     }
     else {
         struct obs_session* session = frame->session;
         if (session != NULL) {
+            obs_server_despawn_player(server, session);
             OBS_LOG_INFO("server", "Server closed connection to %08X:%d", session->address, session->port);
             obs_session_release(session);
         }
@@ -799,6 +2221,30 @@ void obs_server_handle_close(struct obs_server const* server, struct obs_frame*
     obs_server_release_frame(server, frame);
 }
 
+/*!
+ * Completes a disk operation and submits the oldest deferred one in its place.
+ * \param server Pointer to the server structure.
+ * \param frame Pointer to the disk frame.
+ * \param cqe Pointer to the completion queue entry.
+ */
+void obs_server_handle_disk(struct obs_server* server, struct obs_frame* frame, struct io_uring_cqe const* cqe) {
+    struct obs_disk_frame const* disk = &frame->disk;
+    if (cqe->res < 0) {
+        OBS_LOG_URING_ERROR("server", obs_frame_type_to_string(frame->type), cqe->res);
+    }
+    struct obs_disk_entry* next = obs_disk_queue_complete(&server->disk_queue, &disk->entry, obs_monotonic_time());
+    if (next != NULL) {
+        obs_server_queue_disk(server, (struct obs_frame*) ((char*) next - offsetof(struct obs_frame, disk.entry)));
+        obs_server_submit_queue(server);
+    }
+    obs_disk_callback const callback = disk->callback;
+    void* user_data = disk->user_data;
+    obs_server_release_frame(server, frame);
+    if (callback != NULL) {
+        callback(server, cqe->res, user_data);
+    }
+}
+
 /*!
  * Handle a completion queue event.
  * \param server Pointer to a server structure.
@@ -821,6 +2267,12 @@ void obs_server_handle_cqe(struct obs_server* server, struct io_uring_cqe const*
         case OBS_FRAME_CLOSE:
             return obs_server_handle_close(server, frame, cqe);
 
+        case OBS_FRAME_OPEN:
+        case OBS_FRAME_READ:
+        case OBS_FRAME_WRITE:
+        case OBS_FRAME_FSYNC:
+            return obs_server_handle_disk(server, frame, cqe);
+
         default:
             OBS_LOG_FATAL("server", "Received unknown frame[%llu] type or invalid CQE!", frame->trace);
             exit(EXIT_FAILURE);
@@ -845,22 +2297,153 @@ struct obs_server* obs_server_create(struct obs_server_params const* params) {
         return NULL;
     }
     OBS_LOG_TRACE("server", "Initializing io_uring buffers (queue depth: %llu)", params->queue_depth);
+    server->metrics = (struct obs_server_metrics){
+        .compression_level = params->compression_level,
+    };
     if (io_uring_queue_init(params->queue_depth, &server->ring, 0) < 0) {
         obs_pool_allocator_destroy(server->frame_allocator);
         free(server->sessions);
         free(server);
         return NULL;
     }
+    server->queue_depth = params->queue_depth;
+    server->chunk_compressor = mc_chunk_compressor_create(&(struct mc_chunk_compressor_params){
+        .worker_count = params->compression_workers,
+        .level = params->compression_level,
+    });
+    if (server->chunk_compressor == NULL) {
+        io_uring_queue_exit(&server->ring);
+        obs_pool_allocator_destroy(server->frame_allocator);
+        free(server->sessions);
+        free(server);
+        return NULL;
+    }
+    server->chunk_cache = mc_chunk_cache_create(&(struct mc_chunk_cache_params){
+        .memory_budget = params->chunk_cache_size,
+        .max_entries = params->chunk_cache_entries,
+    });
+    if (server->chunk_cache == NULL) {
+        mc_chunk_compressor_destroy(server->chunk_compressor);
+        io_uring_queue_exit(&server->ring);
+        obs_pool_allocator_destroy(server->frame_allocator);
+        free(server->sessions);
+        free(server);
+        return NULL;
+    }
+    server->chunks = mc_chunk_map_create(params->loaded_chunks);
+    if (server->chunks == NULL) {
+        mc_chunk_cache_destroy(server->chunk_cache);
+        mc_chunk_compressor_destroy(server->chunk_compressor);
+        io_uring_queue_exit(&server->ring);
+        obs_pool_allocator_destroy(server->frame_allocator);
+        free(server->sessions);
+        free(server);
+        return NULL;
+    }
+    server->compression_controller = (struct mc_chunk_level_controller){
+        .level = params->compression_level,
+        .idle_level = params->compression_level,
+        .min_level = OBS_MIN_COMPRESSION_LEVEL,
+        .max_level = OBS_MAX_COMPRESSION_LEVEL,
+    };
+    server->world_path = params->world_path;
+    server->regions = NULL;
+    server->region_count = 0;
+    server->region_capacity = 0;
+    server->tick_headroom = 1.0;
+    server->next_compression_update = 0;
+    size_t max_disk_ops = params->max_disk_ops;
+    if (max_disk_ops == 0) {
+        max_disk_ops = params->queue_depth > OBS_DEFAULT_DISK_OP_SHARE
+                           ? params->queue_depth / OBS_DEFAULT_DISK_OP_SHARE : 1;
+    }
+    obs_disk_queue_init(&server->disk_queue, max_disk_ops, &server->metrics);
+    server->connection_count = 0;
+    server->view_radius = params->view_radius > 0 ? params->view_radius : OBS_DEFAULT_VIEW_RADIUS;
+    if (server->view_radius > MC_CHUNK_STREAM_MAX_RADIUS) {
+        server->view_radius = MC_CHUNK_STREAM_MAX_RADIUS;
+    }
+    server->chunk_stream_budget = params->chunk_stream_budget > 0 ? params->chunk_stream_budget
+                                                                  : OBS_DEFAULT_CHUNK_STREAM_BUDGET;
+    server->stream_budget_left = 0;
+    server->next_tick = 0;
+    server->stream_cursor = 0;
+    server->loading = NULL;
+    server->loading_count = 0;
+    server->loading_capacity = 0;
+    // Cells are rounded up, so every chunk in view of a player is covered by the cells in its interest radius.
+    server->interest_radius = (server->view_radius + (1u << MC_INTEREST_CELL_SHIFT) - 1) >> MC_INTEREST_CELL_SHIFT;
+    // Every player needs an entity slot of its own.
+    server->entity_capacity = params->max_entities > 0 ? params->max_entities : OBS_DEFAULT_MAX_ENTITIES;
+    if (server->entity_capacity < params->max_connections) {
+        server->entity_capacity = (uint32_t) params->max_connections;
+    }
+    if (server->entity_capacity > MC_ENTITY_MAX_SLOTS) {
+        server->entity_capacity = MC_ENTITY_MAX_SLOTS;
+    }
+    server->entities = mc_entity_store_create(server->entity_capacity);
+    server->entity_moves = malloc(server->entity_capacity * sizeof(struct mc_entity_move));
+    server->entity_players = calloc(server->entity_capacity, sizeof(struct obs_session*));
+    server->released_entities = malloc(server->entity_capacity * sizeof(uint32_t));
+    server->released_count = 0;
+    server->interest_grid = mc_interest_grid_create(server->entity_capacity);
+    server->interest_members = malloc(server->entity_capacity * sizeof(uint32_t));
+    if (server->entities == NULL || server->entity_moves == NULL || server->entity_players == NULL ||
+        server->released_entities == NULL || server->interest_grid == NULL || server->interest_members == NULL) {
+        obs_server_destroy(server);
+        return NULL;
+    }
     return server;
 }
 
 void obs_server_destroy(struct obs_server* server) {
+    mc_chunk_compressor_destroy(server->chunk_compressor);
+    mc_chunk_cache_destroy(server->chunk_cache);
+    for (size_t i = 0; i < server->region_count; ++i) {
+        if (server->regions[i].region != NULL) {
+            mc_region_close(server->regions[i].region);
+        }
+    }
+    free(server->regions);
+    free(server->loading);
+    if (server->entities != NULL) {
+        mc_entity_store_destroy(server->entities);
+    }
+    free(server->entity_moves);
+    free(server->entity_players);
+    free(server->released_entities);
+    if (server->interest_grid != NULL) {
+        mc_interest_grid_destroy(server->interest_grid);
+    }
+    free(server->interest_members);
+    for (size_t i = 0; i < server->session_limit; ++i) {
+        if (server->sessions[i].stream != NULL) {
+            mc_chunk_stream_destroy(server->sessions[i].stream);
+        }
+        if (server->sessions[i].tracker != NULL) {
+            mc_entity_tracker_destroy(server->sessions[i].tracker);
+        }
+    }
+    size_t cursor = 0;
+    struct mc_chunk* chunk;
+    while ((chunk = mc_chunk_map_next(server->chunks, &cursor)) != NULL) {
+        mc_chunk_destroy(chunk);
+    }
+    mc_chunk_map_destroy(server->chunks);
     io_uring_queue_exit(&server->ring);
     obs_pool_allocator_destroy(server->frame_allocator);
     free(server->sessions);
     free(server);
 }
 
+struct obs_server_metrics const* obs_server_get_metrics(struct obs_server const* server) {
+    return &server->metrics;
+}
+
+struct mc_chunk_cache_metrics const* obs_server_get_chunk_cache_metrics(struct obs_server const* server) {
+    return mc_chunk_cache_get_metrics(server->chunk_cache);
+}
+
 void obs_server_listen(struct obs_server* server, uint16_t const port) {
     server->socket = socket(PF_INET, SOCK_STREAM, 0);
     OBS_LOG_TRACE("server", "Acquiring socket file descriptor");
@@ -905,10 +2488,509 @@ void obs_server_close(struct obs_server* server) {
     obs_server_submit_queue(server);
 }
 
+void obs_server_compress_chunk(struct obs_server* server, struct mc_chunk_job* job) {
+    mc_chunk_compressor_submit(server->chunk_compressor, job);
+}
+
+bool obs_server_send_cached_chunk(struct obs_server* server, struct obs_session* session,
+                                  int32_t const chunk_x, int32_t const chunk_z, uint64_t const modification) {
+    struct obs_shared_buffer* compressed = mc_chunk_cache_get(server->chunk_cache, chunk_x, chunk_z,
+                                                              session->codec->protocol_version, modification);
+    if (compressed == NULL) {
+        return false;
+    }
+    bool const queued = obs_server_queue_chunk_data(server, session, chunk_x, chunk_z, compressed);
+    // The send holds a reference of its own until it completes.
+    obs_shared_buffer_release(compressed);
+    return queued;
+}
+
+bool obs_server_send_chunk(struct obs_server* server, struct obs_session* session,
+                           int32_t const chunk_x, int32_t const chunk_z, uint64_t const modification,
+                           struct obs_shared_buffer* compressed) {
+    mc_chunk_cache_put(server->chunk_cache, chunk_x, chunk_z, session->codec->protocol_version, modification,
+                       compressed);
+    return obs_server_queue_chunk_data(server, session, chunk_x, chunk_z, compressed);
+}
+
+/*!
+ * Resolves a chunk in the chunk streams of every session.
+ * \param server Pointer to a server structure.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param state One of mc_chunk_stream_state.
+ */
+void obs_server_resolve_chunk(struct obs_server* server, int32_t const chunk_x, int32_t const chunk_z,
+                              enum mc_chunk_stream_state const state) {
+    for (size_t i = 0; i < server->session_limit; ++i) {
+        if (server->sessions[i].stream != NULL) {
+            mc_chunk_stream_resolve(server->sessions[i].stream, chunk_x, chunk_z, state);
+        }
+    }
+}
+
+/*!
+ * Completes opening a region file by mapping it, then loads the chunks that waited for it.
+ * \param server Pointer to a server structure.
+ * \param result File descriptor of the region file, or a negative error number if it could not be opened.
+ * \param user_data Pointer to the obs_region_open of the region.
+ */
+void obs_server_complete_region_open(struct obs_server* server, int const result, void* user_data) {
+    struct obs_region_open* open = user_data;
+    struct mc_region* region = result >= 0 ? mc_region_map(result, open->path) : NULL;
+    for (size_t i = 0; i < server->region_count; ++i) {
+        if (server->regions[i].x == open->x && server->regions[i].z == open->z) {
+            server->regions[i].region = region;
+            server->regions[i].opening = false;
+            break;
+        }
+    }
+    // Nothing of the region could be loaded before it was open, so its chunks being loaded are the ones that waited.
+    // Going backwards, the chunks loading starts for now are appended past the ones still to be looked at.
+    for (size_t i = server->loading_count; i-- > 0;) {
+        uint64_t const key = server->loading[i];
+        int32_t const chunk_x = (int32_t) (uint32_t) (key >> 32);
+        int32_t const chunk_z = (int32_t) (uint32_t) key;
+        if (mc_region_coordinate(chunk_x) != open->x || mc_region_coordinate(chunk_z) != open->z) {
+            continue;
+        }
+        server->loading[i] = server->loading[--server->loading_count];
+        if (!obs_server_load_chunk(server, chunk_x, chunk_z)) {
+            obs_server_resolve_chunk(server, chunk_x, chunk_z, MC_CHUNK_STREAM_SKIPPED);
+        }
+    }
+    free(open);
+}
+
+/*!
+ * Finds the region file holding a chunk, starting to open it through the I/O ring the first time.
+ * \param server Pointer to a server structure.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \return Pointer to the entry of the region, valid until the next region is looked up, or NULL if out of memory.
+ */
+struct obs_region_entry const* obs_server_get_region(struct obs_server* server, int32_t const chunk_x,
+                                                     int32_t const chunk_z) {
+    int32_t const x = mc_region_coordinate(chunk_x);
+    int32_t const z = mc_region_coordinate(chunk_z);
+    for (size_t i = 0; i < server->region_count; ++i) {
+        if (server->regions[i].x == x && server->regions[i].z == z) {
+            return &server->regions[i];
+        }
+    }
+    if (server->region_count == server->region_capacity) {
+        size_t const capacity = server->region_capacity > 0 ? server->region_capacity * 2 : 16;
+        struct obs_region_entry* regions = realloc(server->regions, capacity * sizeof(struct obs_region_entry));
+        if (regions == NULL) {
+            return NULL;
+        }
+        server->regions = regions;
+        server->region_capacity = capacity;
+    }
+    struct obs_region_open* open = malloc(sizeof(struct obs_region_open));
+    if (open == NULL) {
+        return NULL;
+    }
+    open->x = x;
+    open->z = z;
+    snprintf(open->path, sizeof(open->path), "%s/region/r.%d.%d.mcr", server->world_path, x, z);
+    // Regions that do not exist are remembered as well, so they are not looked for again.
+    struct obs_region_entry* entry = &server->regions[server->region_count++];
+    *entry = (struct obs_region_entry) {
+        .x = x,
+        .z = z,
+        .region = NULL,
+        .opening = true,
+    };
+    obs_server_disk_open(server, open->path, O_RDONLY | O_CLOEXEC, 0, obs_server_complete_region_open, open);
+    return entry;
+}
+
+/*!
+ * Completes loading a chunk by adding it to the loaded chunks.
+ * \param job Pointer to the load job.
+ */
+void obs_server_complete_load(struct mc_chunk_job* job) {
+    struct obs_server* server = job->user_data;
+    uint64_t const key = mc_chunk_key(job->chunk_x, job->chunk_z);
+    for (size_t i = 0; i < server->loading_count; ++i) {
+        if (server->loading[i] == key) {
+            server->loading[i] = server->loading[--server->loading_count];
+            break;
+        }
+    }
+    if (job->chunk != NULL) {
+        struct mc_chunk* replaced = mc_chunk_map_put(server->chunks, job->chunk);
+        if (replaced != NULL) {
+            mc_chunk_destroy(replaced);
+        }
+    }
+    // Every player waiting for the chunk gets it in its turn, or skips it if it could not be loaded.
+    obs_server_resolve_chunk(server, job->chunk_x, job->chunk_z,
+                             job->chunk != NULL ? MC_CHUNK_STREAM_UNSENT : MC_CHUNK_STREAM_SKIPPED);
+    free(job);
+}
+
+bool obs_server_load_chunk(struct obs_server* server, int32_t const chunk_x, int32_t const chunk_z) {
+    if (server->world_path == NULL) {
+        return false;
+    }
+    uint64_t const key = mc_chunk_key(chunk_x, chunk_z);
+    for (size_t i = 0; i < server->loading_count; ++i) {
+        if (server->loading[i] == key) {
+            return true;
+        }
+    }
+    struct obs_region_entry const* entry = obs_server_get_region(server, chunk_x, chunk_z);
+    if (entry == NULL || (!entry->opening && (entry->region == NULL ||
+                                              !mc_region_has_chunk(entry->region, chunk_x, chunk_z)))) {
+        return false;
+    }
+    if (server->loading_count == server->loading_capacity) {
+        size_t const capacity = server->loading_capacity > 0 ? server->loading_capacity * 2 : 64;
+        uint64_t* loading = realloc(server->loading, capacity * sizeof(uint64_t));
+        if (loading == NULL) {
+            return false;
+        }
+        server->loading = loading;
+        server->loading_capacity = capacity;
+    }
+    if (entry->opening) {
+        // The chunk waits with the others of its region, see obs_server_complete_region_open().
+        server->loading[server->loading_count++] = key;
+        return true;
+    }
+    struct mc_chunk_job* job = malloc(sizeof(struct mc_chunk_job));
+    if (job == NULL) {
+        return false;
+    }
+    server->loading[server->loading_count++] = key;
+    *job = (struct mc_chunk_job) {
+        .type = MC_CHUNK_JOB_LOAD,
+        .region = entry->region,
+        .chunk_x = chunk_x,
+        .chunk_z = chunk_z,
+        .complete = obs_server_complete_load,
+        .user_data = server,
+    };
+    mc_chunk_compressor_submit(server->chunk_compressor, job);
+    return true;
+}
+
+void obs_server_disk_open(struct obs_server* server, char const* path, int const flags, unsigned const mode,
+                          obs_disk_callback const callback, void* user_data) {
+    struct obs_frame* frame = obs_frame_create_disk(server, OBS_FRAME_OPEN, callback, user_data);
+    frame->disk.path = path;
+    frame->disk.flags = flags;
+    frame->disk.mode = mode;
+    obs_server_submit_disk(server, frame);
+}
+
+void obs_server_disk_read(struct obs_server* server, int const fd, void* buffer, size_t const size,
+                          uint64_t const offset, obs_disk_callback const callback, void* user_data) {
+    struct obs_frame* frame = obs_frame_create_disk(server, OBS_FRAME_READ, callback, user_data);
+    frame->disk.fd = fd;
+    frame->disk.buffer = buffer;
+    frame->disk.size = size;
+    frame->disk.offset = offset;
+    obs_server_submit_disk(server, frame);
+}
+
+void obs_server_disk_write(struct obs_server* server, int const fd, void const* buffer, size_t const size,
+                           uint64_t const offset, obs_disk_callback const callback, void* user_data) {
+    struct obs_frame* frame = obs_frame_create_disk(server, OBS_FRAME_WRITE, callback, user_data);
+    frame->disk.fd = fd;
+    frame->disk.buffer = (void*) buffer;
+    frame->disk.size = size;
+    frame->disk.offset = offset;
+    obs_server_submit_disk(server, frame);
+}
+
+void obs_server_disk_fsync(struct obs_server* server, int const fd, obs_disk_callback const callback,
+                           void* user_data) {
+    struct obs_frame* frame = obs_frame_create_disk(server, OBS_FRAME_FSYNC, callback, user_data);
+    frame->disk.fd = fd;
+    obs_server_submit_disk(server, frame);
+}
+
+/*!
+ * A chunk being compressed to be streamed to a session.
+ */
+struct obs_stream_request {
+    /// The compression job, first so the job can be cast back to the request.
+    struct mc_chunk_job job;
+
+    /// Pointer to the server structure.
+    struct obs_server* server;
+
+    /// Pointer to the session the chunk is streamed to.
+    struct obs_session* session;
+
+    /// Connection number of the session when the chunk was requested.
+    uint64_t connection;
+
+    /// Protocol version of the session the chunk is compressed for.
+    mc_dword protocol_version;
+
+    /// Modification counter of the chunk the snapshot was taken from.
+    uint64_t modification;
+};
+
+/*!
+ * Completes compressing a streamed chunk by sending it, if the session still wants it.
+ * \param job Pointer to the compression job of an obs_stream_request.
+ */
+void obs_server_complete_stream(struct mc_chunk_job* job) {
+    struct obs_stream_request* request = (struct obs_stream_request*) job;
+    struct obs_server* server = request->server;
+    struct obs_session* session = request->session;
+    int32_t const chunk_x = job->packet.x / 16;
+    int32_t const chunk_z = job->packet.z / 16;
+    // The session may have disconnected, and its slot may have been reused, while the chunk was compressed.
+    bool const connected = session->connection == request->connection && session->stream != NULL;
+    if (connected) {
+        --session->stream_jobs;
+    }
+    if (job->compressed == NULL) {
+        if (connected) {
+            mc_chunk_stream_resolve(session->stream, chunk_x, chunk_z, MC_CHUNK_STREAM_SKIPPED);
+        }
+    }
+    else if (connected && mc_chunk_stream_pending(session->stream, chunk_x, chunk_z)) {
+        bool const sent = obs_server_queue_pre_chunk(server, session, chunk_x, chunk_z, MC_TRUE) &&
+                          obs_server_send_chunk(server, session, chunk_x, chunk_z, request->modification,
+                                                job->compressed);
+        if (sent) {
+            mc_chunk_stream_resolve(session->stream, chunk_x, chunk_z, MC_CHUNK_STREAM_SENT);
+            obs_server_submit_queue(server);
+            server->stream_budget_left -= (int64_t) job->compressed->size;
+            ++server->metrics.chunks_streamed;
+        }
+        else {
+            // The chunk is handed out again in its turn, and then found in the cache.
+            mc_chunk_stream_resolve(session->stream, chunk_x, chunk_z, MC_CHUNK_STREAM_UNSENT);
+        }
+    }
+    else {
+        // Nobody wants the chunk right now, but the work is not wasted on the next player to see it.
+        mc_chunk_cache_put(server->chunk_cache, chunk_x, chunk_z, request->protocol_version, request->modification,
+                           job->compressed);
+    }
+    obs_shared_buffer_release(job->snapshot);
+    if (job->compressed != NULL) {
+        obs_shared_buffer_release(job->compressed);
+    }
+    free(request);
+}
+
+/*!
+ * Streams a chunk handed out by the chunk stream of a session.
+ * \param server Pointer to a server structure.
+ * \param session Pointer to a client session structure.
+ * \param chunk_x X coordinate of the chunk.
+ * \param chunk_z Z coordinate of the chunk.
+ * \param size Set to the amount of bytes queued to be sent. Chunks that have to be loaded or compressed first are
+ *             sent later.
+ * \return Whether the chunk was dealt with. If not, it could not be queued and was handed back to the stream, so
+ *         nothing more should be streamed to the session this tick.
+ */
+bool obs_server_stream_chunk(struct obs_server* server, struct obs_session* session,
+                             int32_t const chunk_x, int32_t const chunk_z, size_t* size) {
+    *size = 0;
+    struct mc_chunk const* chunk = mc_chunk_map_get(server->chunks, mc_chunk_key(chunk_x, chunk_z));
+    if (chunk == NULL) {
+        // The chunk stays pending until it is loaded.
+        if (!obs_server_load_chunk(server, chunk_x, chunk_z)) {
+            mc_chunk_stream_resolve(session->stream, chunk_x, chunk_z, MC_CHUNK_STREAM_SKIPPED);
+        }
+        return true;
+    }
+    struct obs_shared_buffer* compressed = mc_chunk_cache_get(server->chunk_cache, chunk_x, chunk_z,
+                                                              session->codec->protocol_version, chunk->modification);
+    if (compressed != NULL) {
+        bool const sent = obs_server_queue_pre_chunk(server, session, chunk_x, chunk_z, MC_TRUE) &&
+                          obs_server_queue_chunk_data(server, session, chunk_x, chunk_z, compressed);
+        size_t const compressed_size = compressed->size;
+        obs_shared_buffer_release(compressed);
+        if (!sent) {
+            // A column prepared without its data is sent again with the chunk when it comes around.
+            mc_chunk_stream_resolve(session->stream, chunk_x, chunk_z, MC_CHUNK_STREAM_UNSENT);
+            return false;
+        }
+        mc_chunk_stream_resolve(session->stream, chunk_x, chunk_z, MC_CHUNK_STREAM_SENT);
+        ++server->metrics.chunks_streamed;
+        *size = compressed_size;
+        return true;
+    }
+    struct obs_stream_request* request = malloc(sizeof(struct obs_stream_request));
+    struct obs_shared_buffer* snapshot = request != NULL ? mc_chunk_snapshot(chunk) : NULL;
+    if (snapshot == NULL) {
+        OBS_LOG_ERROR("server", "Out of memory, skipping chunk %d, %d for %.*s (%08X:%d)", chunk_x, chunk_z,
+                      session->username_length, session->username, session->address, session->port);
+        free(request);
+        mc_chunk_stream_resolve(session->stream, chunk_x, chunk_z, MC_CHUNK_STREAM_SKIPPED);
+        return true;
+    }
+    *request = (struct obs_stream_request) {
+        .job = {
+            .type = MC_CHUNK_JOB_COMPRESS,
+            .snapshot = snapshot,
+            .packet = {
+                .x = chunk_x * 16,
+                .y = 0,
+                .z = chunk_z * 16,
+                .x_size = 15,
+                .y_size = 127,
+                .z_size = 15,
+            },
+            .complete = obs_server_complete_stream,
+        },
+        .server = server,
+        .session = session,
+        .connection = session->connection,
+        .protocol_version = session->codec->protocol_version,
+        .modification = chunk->modification,
+    };
+    ++session->stream_jobs;
+    mc_chunk_compressor_submit(server->chunk_compressor, &request->job);
+    return true;
+}
+
+/*!
+ * Streams chunks to every session, nearest chunks first, within the budget of this tick.
+ * \param server Pointer to a server structure.
+ */
+void obs_server_stream_chunks(struct obs_server* server) {
+    size_t const start = server->stream_cursor;
+    for (size_t n = 0; n < server->session_limit && server->stream_budget_left > 0; ++n) {
+        struct obs_session* session = &server->sessions[(start + n) % server->session_limit];
+        if (session->stream == NULL || session->status != SESSION_CONNECTED) {
+            continue;
+        }
+        int32_t chunk_x;
+        int32_t chunk_z;
+        size_t queued = 0;
+        while (server->stream_budget_left > 0 && session->out_backlog < OBS_STREAM_BACKLOG_LIMIT &&
+               session->stream_jobs < OBS_STREAM_JOB_LIMIT &&
+               mc_chunk_stream_next(session->stream, &chunk_x, &chunk_z)) {
+            size_t size;
+            bool const streamed = obs_server_stream_chunk(server, session, chunk_x, chunk_z, &size);
+            server->stream_budget_left -= (int64_t) size;
+            queued += size;
+            if (!streamed) {
+                break;
+            }
+        }
+        if (queued > 0) {
+            obs_server_submit_queue(server);
+        }
+        if (!session->view_streamed && mc_chunk_stream_done(session->stream)) {
+            session->view_streamed = true;
+            OBS_LOG_DEBUG("server", "Streamed the view of %.*s (%08X:%d) in %llu ms",
+                          session->username_length, session->username, session->address, session->port,
+                          (obs_monotonic_time() - session->join_time) / 1000000);
+        }
+    }
+    server->stream_cursor = (start + 1) % server->session_limit;
+}
+
+/*!
+ * Moves the entities for a tick, and relays the latest movement of every entity that moved since the last tick.
+ * \param server Pointer to a server structure.
+ */
+void obs_server_relay_moved_entities(struct obs_server* server) {
+    mc_entity_store_step(server->entities);
+    size_t const count = mc_entity_store_collect_moves(server->entities, server->entity_moves);
+    uint64_t saved = 0;
+    for (size_t i = 0; i < count; ++i) {
+        struct mc_entity_move const* move = &server->entity_moves[i];
+        // Players that left are still in the store until the clients are told to forget them.
+        if (!mc_interest_grid_contains(server->interest_grid, move->slot)) {
+            continue;
+        }
+        size_t const recipients = obs_server_relay_movement(server, move);
+        struct obs_session const* session = server->entity_players[move->slot];
+        if (session != NULL && session->movement_updates > 0) {
+            saved += (uint64_t) (session->movement_updates - 1) * recipients;
+        }
+    }
+    // Packets of players whose movement was not relayed did not save anything, so every count starts over.
+    for (size_t i = 0; i < server->session_limit; ++i) {
+        server->sessions[i].movement_updates = 0;
+    }
+    server->metrics.movement_packets_saved += saved;
+    server->metrics.movement_packets_saved_last_tick = saved;
+}
+
+/*!
+ * Runs the work done once per tick.
+ * \param server Pointer to a server structure.
+ */
+void obs_server_tick(struct obs_server* server) {
+    // Budget that was not used is not carried over, so a quiet tick does not turn into a burst.
+    server->stream_budget_left = (int64_t) server->chunk_stream_budget;
+    obs_server_relay_moved_entities(server);
+    obs_server_track_entities(server);
+    // Nothing probes the loaded chunks between ticks, so tables retired by growing the map can be freed now.
+    mc_chunk_map_reclaim(server->chunks);
+}
+
+void obs_server_report_tick(struct obs_server* server, uint64_t const tick_time, uint64_t const tick_budget) {
+    server->tick_headroom = tick_time < tick_budget ? (double) (tick_budget - tick_time) / (double) tick_budget : 0.0;
+}
+
+/*!
+ * Updates the chunk compression level from the load of the server.
+ * \param server Pointer to a server structure.
+ */
+void obs_server_update_compression_level(struct obs_server* server) {
+    uint64_t const time = obs_monotonic_time();
+    if (time < server->next_compression_update) {
+        return;
+    }
+    server->next_compression_update = time + OBS_COMPRESSION_UPDATE_INTERVAL;
+
+    struct mc_chunk_level_signals signals = {
+        .tick_headroom = server->tick_headroom,
+        .queue_depth = (double) mc_chunk_compressor_pending(server->chunk_compressor) /
+                       (double) mc_chunk_compressor_worker_count(server->chunk_compressor),
+        .outbound_backlog = 0,
+    };
+    for (size_t i = 0; i < server->session_limit; ++i) {
+        if (server->sessions[i].out_backlog > signals.outbound_backlog) {
+            signals.outbound_backlog = server->sessions[i].out_backlog;
+        }
+    }
+    int const previous = server->compression_controller.level;
+    int const level = mc_chunk_level_update(&server->compression_controller, &signals);
+    if (level == previous) {
+        return;
+    }
+    OBS_LOG_DEBUG("server", "Chunk compression level %d -> %d (headroom %.2f, queue depth %.1f, backlog %zu bytes)",
+                  previous, level, signals.tick_headroom, signals.queue_depth, signals.outbound_backlog);
+    if (level > previous) {
+        ++server->metrics.compression_level_raises;
+    }
+    else {
+        ++server->metrics.compression_level_drops;
+    }
+    server->metrics.compression_level = level;
+    mc_chunk_compressor_set_level(server->chunk_compressor, level);
+}
+
 void obs_server_poll(struct obs_server* server) {
     struct io_uring_cqe* cqe;
     while (io_uring_peek_cqe(&server->ring, &cqe) == 0) {
         obs_server_handle_cqe(server, cqe);
         io_uring_cqe_seen(&server->ring, cqe);
     }
+    mc_chunk_compressor_poll(server->chunk_compressor);
+    uint64_t const time = obs_monotonic_time();
+    if (time >= server->next_tick) {
+        server->next_tick = time + OBS_TICK_TIME;
+        obs_server_tick(server);
+        obs_server_report_tick(server, obs_monotonic_time() - time, OBS_TICK_TIME);
+    }
+    obs_server_stream_chunks(server);
+    obs_server_update_compression_level(server);
 }
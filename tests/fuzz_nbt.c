@@ -0,0 +1,241 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+ * Fuzz driver for the NBT reader, walking trees the way the region loader does.
+ *
+ * Built with clang using -fsanitize=fuzzer,address -DOBSIDIAN_LIBFUZZER, libFuzzer drives LLVMFuzzerTestOneInput().
+ * Otherwise main() feeds it mutations of valid NBT from a fixed seed, so the driver also runs as a regular test.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/nbt.h"
+
+#include <stdint.h>
+#include <string.h>
+
+
+/// Amount of inputs main() tries.
+#define ITERATIONS 20000
+
+/// Largest input main() builds.
+#define MAX_INPUT_SIZE 1024
+
+
+/// Sum of every byte read out of a tag, so the reads are not optimized away.
+static volatile uint64_t sink;
+
+/*!
+ * Reads everything a tag points at, checking it lies within the data.
+ */
+static void touch(uint8_t const* data, size_t const size, struct mc_nbt_tag const* tag) {
+    uint8_t const* end = data + size;
+    uint8_t const* name = (uint8_t const*) tag->name;
+    CHECK(tag->name_length == 0 || (name >= data && tag->name_length <= end - name));
+    CHECK(tag->payload >= data && tag->payload <= end);
+    uint64_t sum = 0;
+    for (uint16_t i = 0; i < tag->name_length; ++i) {
+        sum += (uint8_t) tag->name[i];
+    }
+    switch (tag->type) {
+        case MC_NBT_BYTE_ARRAY:
+        case MC_NBT_STRING: {
+            size_t const prefix = tag->type == MC_NBT_STRING ? 2 : 4;
+            CHECK(prefix + tag->length <= (size_t) (end - tag->payload));
+            for (size_t i = 0; i < prefix + tag->length; ++i) {
+                sum += tag->payload[i];
+            }
+            break;
+        }
+        case MC_NBT_FLOAT:
+        case MC_NBT_DOUBLE:
+            sum += (uint64_t) (mc_nbt_real(tag) != 0.0);
+            break;
+        default:
+            sum += (uint64_t) mc_nbt_integer(tag);
+            break;
+    }
+    sink += sum;
+}
+
+/*!
+ * Visits every tag, entering every compound and list.
+ * \return Whether the whole tree was read without the reader failing.
+ */
+static bool walk(uint8_t const* data, size_t const size) {
+    struct mc_nbt_reader reader;
+    struct mc_nbt_tag tag;
+    mc_nbt_reader_init(&reader, data, size);
+    // Every step reads a byte or leaves a compound or list, so a walk that runs longer is stuck.
+    size_t steps = 0;
+    while (!reader.error && steps++ <= 4 * size + 64) {
+        if (mc_nbt_next(&reader, &tag)) {
+            touch(data, size, &tag);
+            if (tag.type == MC_NBT_COMPOUND || tag.type == MC_NBT_LIST) {
+                mc_nbt_enter(&reader);
+            }
+        }
+        else if (reader.depth == 1) {
+            break;
+        }
+    }
+    CHECK(steps <= 4 * size + 64);
+    return !reader.error;
+}
+
+/*!
+ * Looks for the tags of a chunk, skipping everything else whole, like loading a chunk from a region does.
+ */
+static void find_chunk_tags(uint8_t const* data, size_t const size) {
+    struct mc_nbt_reader reader;
+    struct mc_nbt_tag tag;
+    mc_nbt_reader_init(&reader, data, size);
+    if (!mc_nbt_next(&reader, &tag) || tag.type != MC_NBT_COMPOUND || !mc_nbt_enter(&reader) ||
+        !mc_nbt_find(&reader, "Level", MC_NBT_COMPOUND, &tag) || !mc_nbt_enter(&reader)) {
+        return;
+    }
+    while (mc_nbt_next(&reader, &tag)) {
+        if ((tag.type == MC_NBT_INT && mc_nbt_is_named(&tag, "xPos")) || tag.type == MC_NBT_BYTE_ARRAY) {
+            touch(data, size, &tag);
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(uint8_t const* data, size_t const size) {
+    // An exact copy, so reads past the end are caught by the sanitizers.
+    uint8_t* copy = malloc(size > 0 ? size : 1);
+    memcpy(copy, data, size);
+    walk(copy, size);
+    find_chunk_tags(copy, size);
+    free(copy);
+    if (test_failures > 0) {
+        abort();
+    }
+    return 0;
+}
+
+#if !defined(OBSIDIAN_LIBFUZZER)
+
+/*!
+ * Writes a chunk as a region file holds it, cut down to a few blocks, with an entity that has a nested compound.
+ * \return Size of the NBT in bytes.
+ */
+static size_t write_chunk(uint8_t* buffer, size_t const capacity) {
+    static uint8_t const blocks[16] = {7, 7, 7, 7, 1, 1, 3, 3, 2, 0, 0, 0, 0, 0, 0, 0};
+    static uint8_t const nibbles[8] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0};
+    struct mc_nbt_writer writer;
+    mc_nbt_writer_init(&writer, buffer, capacity);
+    mc_nbt_write_header(&writer, MC_NBT_COMPOUND, "");
+    mc_nbt_write_header(&writer, MC_NBT_COMPOUND, "Level");
+    mc_nbt_write_int(&writer, "xPos", -3);
+    mc_nbt_write_int(&writer, "zPos", 12);
+    mc_nbt_write_long(&writer, "LastUpdate", 123456789);
+    mc_nbt_write_byte(&writer, "TerrainPopulated", 1);
+    mc_nbt_write_byte_array(&writer, "Blocks", blocks, sizeof(blocks));
+    mc_nbt_write_byte_array(&writer, "Data", nibbles, sizeof(nibbles));
+    mc_nbt_write_byte_array(&writer, "SkyLight", nibbles, sizeof(nibbles));
+    mc_nbt_write_list(&writer, "Entities", MC_NBT_COMPOUND, 2);
+    mc_nbt_write_string(&writer, "id", "Sheep");
+    mc_nbt_write_short(&writer, "Health", 8);
+    mc_nbt_write_end(&writer);
+    mc_nbt_write_string(&writer, "id", "Item");
+    mc_nbt_write_header(&writer, MC_NBT_COMPOUND, "Item");
+    mc_nbt_write_short(&writer, "id", 4);
+    mc_nbt_write_byte(&writer, "Count", 64);
+    mc_nbt_write_end(&writer);
+    mc_nbt_write_end(&writer);
+    mc_nbt_write_list(&writer, "TileEntities", MC_NBT_COMPOUND, 0);
+    mc_nbt_write_end(&writer);
+    mc_nbt_write_end(&writer);
+    return writer.cursor;
+}
+
+/*!
+ * A compound with lists of numbers and a list of lists, which the writer has no calls for.
+ */
+static uint8_t const lists[] = {
+    MC_NBT_COMPOUND, 0, 0,
+    MC_NBT_LIST, 0, 3, 'P', 'o', 's', MC_NBT_DOUBLE, 0, 0, 0, 2,
+    0x40, 0x50, 0, 0, 0, 0, 0, 0, 0xC0, 0x24, 0, 0, 0, 0, 0, 0,
+    MC_NBT_LIST, 0, 8, 'R', 'o', 't', 'a', 't', 'i', 'o', 'n', MC_NBT_FLOAT, 0, 0, 0, 1, 0x3F, 0x80, 0, 0,
+    MC_NBT_LIST, 0, 1, 'l', MC_NBT_LIST, 0, 0, 0, 2,
+    MC_NBT_INT, 0, 0, 0, 1, 0, 0, 0, 9,
+    MC_NBT_STRING, 0, 0, 0, 1, 0, 2, 'h', 'i',
+    MC_NBT_END,
+};
+
+/*!
+ * Xorshift generator, so every run tries the same inputs.
+ */
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+int main(void) {
+    uint8_t chunk[256];
+    size_t const chunk_size = write_chunk(chunk, sizeof(chunk));
+    CHECK(chunk_size <= sizeof(chunk));
+    // Both seeds read back whole before they are mutated.
+    CHECK(walk(chunk, chunk_size));
+    CHECK(walk(lists, sizeof(lists)));
+
+    uint32_t state = 0x0BEE;
+    uint8_t input[MAX_INPUT_SIZE];
+    for (unsigned i = 0; i < ITERATIONS; ++i) {
+        size_t size;
+        if (next_random(&state) % 2 == 0) {
+            memcpy(input, chunk, chunk_size);
+            size = chunk_size;
+        }
+        else {
+            memcpy(input, lists, sizeof(lists));
+            size = sizeof(lists);
+        }
+        // Flip some bytes, and now and then write a big-endian value that is far too large or negative as a length.
+        unsigned const flips = next_random(&state) % 4;
+        for (unsigned f = 0; f < flips; ++f) {
+            input[next_random(&state) % size] = (uint8_t) next_random(&state);
+        }
+        if (next_random(&state) % 4 == 0) {
+            size_t const at = next_random(&state) % (size - 3);
+            uint8_t const fill = next_random(&state) % 2 == 0 ? 0xFF : 0x7F;
+            input[at] = fill;
+            memset(input + at + 1, 0xFF, 3);
+        }
+        // Sometimes repeat a part of the input, nesting whatever it holds deeper.
+        if (next_random(&state) % 8 == 0) {
+            size_t const start = next_random(&state) % size;
+            size_t const length = next_random(&state) % (size - start + 1);
+            if (size + length <= sizeof(input)) {
+                memmove(input + start + length, input + start, size - start);
+                size += length;
+            }
+        }
+        if (next_random(&state) % 4 == 0) {
+            size = next_random(&state) % (size + 1);
+        }
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    return TEST_RESULT();
+}
+
+#endif // !OBSIDIAN_LIBFUZZER
@@ -0,0 +1,146 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Fuzz driver for the detection, framing and decoding of client packets.
+ *
+ * Built with clang using -fsanitize=fuzzer,address -DOBSIDIAN_LIBFUZZER, libFuzzer drives LLVMFuzzerTestOneInput().
+ * Otherwise main() feeds it mutations of valid packets from a fixed seed, so the driver also runs as a regular test.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/protocol.h"
+
+#include <stdint.h>
+#include <string.h>
+
+
+/// Amount of inputs main() tries.
+#define ITERATIONS 20000
+
+/// Largest input main() builds.
+#define MAX_INPUT_SIZE 512
+
+
+/*!
+ * Frames data with a codec and decodes every complete packet, checking the results agree with each other.
+ */
+static void fuzz_codec(struct mc_proto_codec const* codec, uint8_t const* data, size_t const size) {
+    size_t lengths[16];
+    int status;
+    size_t const count = mc_proto_scan_client_packets(codec, data, size, lengths, 16, &status);
+    CHECK(count <= 16);
+    CHECK(count == 16 || status <= 0);
+    size_t cursor = 0;
+    for (size_t i = 0; i < count; ++i) {
+        CHECK(lengths[i] > 0 && lengths[i] <= size - cursor);
+        // Framing only reads length prefixes, decoding may still refuse what frames correctly.
+        struct mc_proto_client_view view;
+        int const viewed = mc_proto_view_client_packet(codec, data + cursor, lengths[i], &view);
+        CHECK(viewed == 0 || viewed == (int) lengths[i]);
+        struct mc_proto_client_packet packet;
+        int const decoded = mc_proto_decode_client_packet(codec, data + cursor, lengths[i], &packet);
+        CHECK(decoded == 0 || decoded == (int) lengths[i]);
+        cursor += lengths[i];
+    }
+}
+
+int LLVMFuzzerTestOneInput(uint8_t const* data, size_t const size) {
+    // An exact copy, so reads past the end are caught by the sanitizers.
+    uint8_t* copy = malloc(size > 0 ? size : 1);
+    memcpy(copy, data, size);
+
+    struct mc_proto_codec const* codec = NULL;
+    int const detected = size > 0 ? mc_proto_detect_codec(copy, size, &codec) : -1;
+    CHECK(detected <= (int) size);
+    CHECK(detected <= 0 || codec != NULL);
+    if (size > 0) {
+        fuzz_codec(mc_proto_codec_for_version(1), copy, size);
+        fuzz_codec(mc_proto_codec_for_version(14), copy, size);
+    }
+    free(copy);
+    if (test_failures > 0) {
+        abort();
+    }
+    return 0;
+}
+
+#if !defined(OBSIDIAN_LIBFUZZER)
+
+/*!
+ * A valid packet to mutate.
+ */
+struct seed {
+    uint8_t const* data;
+    size_t size;
+};
+
+#define SEED(...) {(uint8_t const[]) {__VA_ARGS__}, sizeof((uint8_t const[]) {__VA_ARGS__})}
+
+static struct seed const seeds[] = {
+    SEED(MC_PACKET_HEARTBEAT),
+    SEED(MC_PACKET_HANDSHAKE, 0, 3, 'b', 'e', 'e'),
+    SEED(MC_PACKET_HANDSHAKE, 0, 3, 0, 'b', 0, 'e', 0, 'e'),
+    SEED(MC_PACKET_CHAT, 0, 2, 'h', 'i'),
+    SEED(MC_PACKET_CHAT, 0, 2, 0, 'h', 0, 'i'),
+    SEED(MC_PACKET_PLAYER_GROUNDED, 1),
+    SEED(MC_PACKET_PLAYER_ROTATION, 0x3F, 0x80, 0, 0, 0xBF, 0x80, 0, 0, 1),
+    SEED(MC_PACKET_PLAYER_POSITION, 0, 0, 0, 0, 0, 0, 0, 0, 0x40, 0x50, 0, 0, 0, 0, 0, 0,
+         0x40, 0x50, 0x30, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+    SEED(MC_PACKET_ANIMATION, 0, 0, 0, 1, 1),
+    SEED(MC_PACKET_KICK, 0, 3, 'b', 'y', 'e'),
+};
+
+/*!
+ * Xorshift generator, so every run tries the same inputs.
+ */
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+int main(void) {
+    uint32_t state = 0x0BEE;
+    uint8_t input[MAX_INPUT_SIZE];
+    for (unsigned i = 0; i < ITERATIONS; ++i) {
+        // A few valid packets back to back.
+        size_t size = 0;
+        unsigned const packets = 1 + next_random(&state) % 4;
+        for (unsigned p = 0; p < packets; ++p) {
+            struct seed const* seed = &seeds[next_random(&state) % (sizeof(seeds) / sizeof(seeds[0]))];
+            memcpy(input + size, seed->data, seed->size);
+            size += seed->size;
+        }
+        // Then flip some bytes, and sometimes cut the input short.
+        unsigned const flips = next_random(&state) % 4;
+        for (unsigned f = 0; f < flips; ++f) {
+            input[next_random(&state) % size] = (uint8_t) next_random(&state);
+        }
+        if (next_random(&state) % 4 == 0) {
+            size = next_random(&state) % (size + 1);
+        }
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    return TEST_RESULT();
+}
+
+#endif // !OBSIDIAN_LIBFUZZER
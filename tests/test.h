@@ -0,0 +1,46 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBSIDIAN_TESTS_TEST_H
+#define OBSIDIAN_TESTS_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/// Amount of checks that failed in this test.
+static int test_failures = 0;
+
+
+/*!
+ * Checks that a condition holds, reporting it and failing the test when it does not.
+ */
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++test_failures; \
+        } \
+    } while (0)
+
+/*!
+ * Exit status of the test.
+ */
+#define TEST_RESULT() (test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+#endif // !OBSIDIAN_TESTS_TEST_H
@@ -0,0 +1,170 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/bswap.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+
+/// Longest array converted, past a few AVX2 blocks of every width so each kernel also runs its tail.
+#define MAX_COUNT 70
+
+/// Bytes of the largest array, with room for the misaligned starts and the guard bytes behind it.
+#define BUFFER_SIZE (MAX_COUNT * 8 + 64)
+
+/// Value of the bytes around the destination array, which no conversion may touch.
+#define GUARD 0xA5
+
+
+/*!
+ * A conversion of an array of one of the widths.
+ */
+struct conversion {
+    void (*convert)(void*, void const*, size_t);
+    size_t width;
+};
+
+/*!
+ * Xorshift generator, so every run converts the same bytes.
+ */
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/*!
+ * Converts an array one byte at a time, which is what the kernels are checked against.
+ */
+static void reference_convert(uint8_t* dst, uint8_t const* src, size_t const width, size_t const count) {
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t byte = 0; byte < width; ++byte) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            dst[i * width + byte] = src[i * width + byte];
+#else
+            dst[i * width + byte] = src[i * width + width - 1 - byte];
+#endif
+        }
+    }
+}
+
+/*!
+ * Checks a conversion against the reference for every count up to MAX_COUNT and every misalignment of the arrays,
+ * both into another array and in place.
+ * \return Whether every result matched and nothing outside the destination was written.
+ */
+static bool conversion_matches(struct conversion const* conversion, uint32_t* state) {
+    static uint8_t src[BUFFER_SIZE];
+    static uint8_t dst[BUFFER_SIZE];
+    static uint8_t expected[BUFFER_SIZE];
+    size_t const width = conversion->width;
+    for (size_t count = 0; count <= MAX_COUNT; ++count) {
+        size_t const size = count * width;
+        for (size_t offset = 0; offset < 8; ++offset) {
+            for (size_t i = 0; i < BUFFER_SIZE; ++i) {
+                src[i] = (uint8_t) next_random(state);
+            }
+            // Into another array, with the source and the destination misaligned differently.
+            size_t const dst_offset = 7 - offset;
+            memset(dst, GUARD, BUFFER_SIZE);
+            conversion->convert(dst + dst_offset, src + offset, count);
+            reference_convert(expected, src + offset, width, count);
+            if (memcmp(dst + dst_offset, expected, size) != 0) {
+                return false;
+            }
+            for (size_t i = 0; i < BUFFER_SIZE; ++i) {
+                if ((i < dst_offset || i >= dst_offset + size) && dst[i] != GUARD) {
+                    return false;
+                }
+            }
+            // In place, which must leave the bytes behind the array alone too.
+            memcpy(dst, src, BUFFER_SIZE);
+            conversion->convert(dst + offset, dst + offset, count);
+            if (memcmp(dst + offset, expected, size) != 0 || memcmp(dst, src, offset) != 0 ||
+                memcmp(dst + offset + size, src + offset + size, BUFFER_SIZE - offset - size) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*!
+ * Converting twice gives back the original array.
+ */
+static bool conversion_round_trips(struct conversion const* conversion, uint32_t* state) {
+    uint8_t original[MAX_COUNT * 8];
+    uint8_t converted[MAX_COUNT * 8];
+    for (size_t i = 0; i < sizeof(original); ++i) {
+        original[i] = (uint8_t) next_random(state);
+    }
+    conversion->convert(converted, original, MAX_COUNT);
+    conversion->convert(converted, converted, MAX_COUNT);
+    return memcmp(converted, original, MAX_COUNT * conversion->width) == 0;
+}
+
+/*!
+ * Checks every width against the reference, first with the scalar implementation and then with whichever one the CPU
+ * supports.
+ */
+static void test_conversions(void) {
+    struct conversion const conversions[] = {
+        {obs_bswap16_array, 2},
+        {obs_bswap32_array, 4},
+        {obs_bswap64_array, 8},
+    };
+    uint32_t state = 0x0BEE;
+    for (size_t c = 0; c < sizeof(conversions) / sizeof(conversions[0]); ++c) {
+        CHECK(conversion_matches(&conversions[c], &state));
+        CHECK(conversion_round_trips(&conversions[c], &state));
+    }
+    obs_bswap_init();
+    for (size_t c = 0; c < sizeof(conversions) / sizeof(conversions[0]); ++c) {
+        CHECK(conversion_matches(&conversions[c], &state));
+        CHECK(conversion_round_trips(&conversions[c], &state));
+    }
+}
+
+/*!
+ * A known value ends up in network byte order.
+ */
+static void test_known_values(void) {
+    obs_bswap_init();
+    uint16_t const value16 = 0x0102;
+    uint32_t const value32 = 0x01020304;
+    uint64_t const value64 = 0x0102030405060708;
+    uint8_t bytes[8];
+    obs_bswap16_array(bytes, &value16, 1);
+    CHECK(memcmp(bytes, "\x01\x02", 2) == 0);
+    obs_bswap32_array(bytes, &value32, 1);
+    CHECK(memcmp(bytes, "\x01\x02\x03\x04", 4) == 0);
+    obs_bswap64_array(bytes, &value64, 1);
+    CHECK(memcmp(bytes, "\x01\x02\x03\x04\x05\x06\x07\x08", 8) == 0);
+}
+
+int main(void) {
+    test_conversions();
+    test_known_values();
+    return TEST_RESULT();
+}
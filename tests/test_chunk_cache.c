@@ -0,0 +1,194 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/chunk_cache.h"
+
+#include <stdbool.h>
+
+
+/*!
+ * Creates compressed data of a size to put in a cache.
+ */
+static struct obs_shared_buffer* make_data(size_t const size) {
+    struct obs_shared_buffer* data = obs_shared_buffer_create(size);
+    CHECK(data != NULL);
+    return data;
+}
+
+/*!
+ * Puts data of a size in a cache, letting the cache own it.
+ */
+static void put(struct mc_chunk_cache* cache, int32_t const x, int32_t const z, uint64_t const modification,
+                size_t const size) {
+    struct obs_shared_buffer* data = make_data(size);
+    mc_chunk_cache_put(cache, x, z, 14, modification, data);
+    obs_shared_buffer_release(data);
+}
+
+/*!
+ * Looks up a chunk.
+ * \return Whether it was cached.
+ */
+static bool has(struct mc_chunk_cache* cache, int32_t const x, int32_t const z, uint64_t const modification) {
+    struct obs_shared_buffer* data = mc_chunk_cache_get(cache, x, z, 14, modification);
+    if (data == NULL) {
+        return false;
+    }
+    obs_shared_buffer_release(data);
+    return true;
+}
+
+/*!
+ * Hits return the cached data, keyed by both the position and the protocol version.
+ */
+static void test_hit(void) {
+    struct mc_chunk_cache_params const params = {.memory_budget = 1024, .max_entries = 4};
+    struct mc_chunk_cache* cache = mc_chunk_cache_create(&params);
+    struct obs_shared_buffer* data = make_data(100);
+    mc_chunk_cache_put(cache, 1, 2, 14, 5, data);
+
+    struct obs_shared_buffer* hit = mc_chunk_cache_get(cache, 1, 2, 14, 5);
+    CHECK(hit == data);
+    obs_shared_buffer_release(hit);
+    CHECK(mc_chunk_cache_get(cache, 1, 2, 1, 5) == NULL);
+    CHECK(mc_chunk_cache_get(cache, 2, 1, 14, 5) == NULL);
+
+    struct mc_chunk_cache_metrics const* metrics = mc_chunk_cache_get_metrics(cache);
+    CHECK(metrics->hits == 1);
+    CHECK(metrics->misses == 2);
+    CHECK(metrics->entries == 1);
+    CHECK(metrics->memory_used == 100);
+
+    // The cache holds its own reference, the data outlives the caller's.
+    obs_shared_buffer_release(data);
+    CHECK(has(cache, 1, 2, 5));
+    mc_chunk_cache_destroy(cache);
+}
+
+/*!
+ * A lookup with a newer modification counter drops the entry, and late results of older versions are ignored.
+ */
+static void test_lazy_invalidation(void) {
+    struct mc_chunk_cache_params const params = {.memory_budget = 1024, .max_entries = 4};
+    struct mc_chunk_cache* cache = mc_chunk_cache_create(&params);
+    struct mc_chunk_cache_metrics const* metrics = mc_chunk_cache_get_metrics(cache);
+    put(cache, 0, 0, 1, 100);
+    CHECK(!has(cache, 0, 0, 2));
+    CHECK(metrics->invalidations == 1);
+    CHECK(metrics->entries == 0);
+    CHECK(metrics->memory_used == 0);
+    CHECK(!has(cache, 0, 0, 1));
+
+    put(cache, 0, 0, 3, 100);
+    put(cache, 0, 0, 2, 100);
+    CHECK(has(cache, 0, 0, 3));
+    CHECK(metrics->entries == 1);
+    mc_chunk_cache_destroy(cache);
+}
+
+/*!
+ * The clock hand evicts the first entry that was not hit since it last passed, clearing the hits on its way.
+ */
+static void test_eviction_order(void) {
+    struct mc_chunk_cache_params const params = {.memory_budget = 1024, .max_entries = 3};
+    struct mc_chunk_cache* cache = mc_chunk_cache_create(&params);
+    struct mc_chunk_cache_metrics const* metrics = mc_chunk_cache_get_metrics(cache);
+    put(cache, 0, 0, 0, 10);
+    put(cache, 1, 0, 0, 10);
+    put(cache, 2, 0, 0, 10);
+    CHECK(has(cache, 0, 0, 0));
+
+    // The first chunk was hit and gets a second chance, the second is evicted.
+    put(cache, 3, 0, 0, 10);
+    CHECK(metrics->evictions == 1);
+    CHECK(has(cache, 0, 0, 0));
+    CHECK(!has(cache, 1, 0, 0));
+    CHECK(has(cache, 3, 0, 0));
+
+    // The hand continues after the second chunk. The third was never hit.
+    put(cache, 4, 0, 0, 10);
+    CHECK(metrics->evictions == 2);
+    CHECK(!has(cache, 2, 0, 0));
+    CHECK(has(cache, 0, 0, 0));
+    CHECK(has(cache, 3, 0, 0));
+    CHECK(has(cache, 4, 0, 0));
+    CHECK(metrics->entries == 3);
+    mc_chunk_cache_destroy(cache);
+}
+
+/*!
+ * Entries are evicted until new data fits the memory budget, and data larger than the budget is not cached.
+ */
+static void test_memory_budget(void) {
+    struct mc_chunk_cache_params const params = {.memory_budget = 300, .max_entries = 8};
+    struct mc_chunk_cache* cache = mc_chunk_cache_create(&params);
+    struct mc_chunk_cache_metrics const* metrics = mc_chunk_cache_get_metrics(cache);
+    put(cache, 0, 0, 0, 100);
+    put(cache, 1, 0, 0, 100);
+    put(cache, 2, 0, 0, 100);
+    put(cache, 3, 0, 0, 200);
+    CHECK(metrics->evictions == 2);
+    CHECK(metrics->memory_used == 300);
+    CHECK(has(cache, 2, 0, 0));
+    CHECK(has(cache, 3, 0, 0));
+
+    put(cache, 4, 0, 0, 301);
+    CHECK(!has(cache, 4, 0, 0));
+    CHECK(metrics->memory_used == 300);
+    mc_chunk_cache_destroy(cache);
+}
+
+/*!
+ * Removing entries from the middle of probe sequences keeps every other entry reachable.
+ */
+static void test_backward_shift(void) {
+    struct mc_chunk_cache_params const params = {.memory_budget = SIZE_MAX, .max_entries = 256};
+    struct mc_chunk_cache* cache = mc_chunk_cache_create(&params);
+    struct mc_chunk_cache_metrics const* metrics = mc_chunk_cache_get_metrics(cache);
+    for (int32_t x = 0; x < 16; ++x) {
+        for (int32_t z = 0; z < 16; ++z) {
+            put(cache, x, z, 0, 1);
+        }
+    }
+    CHECK(metrics->entries == 256);
+    for (int32_t x = 0; x < 16; ++x) {
+        for (int32_t z = 0; z < 16; ++z) {
+            if ((x + z) % 3 == 0) {
+                CHECK(!has(cache, x, z, 1));
+            }
+        }
+    }
+    for (int32_t x = 0; x < 16; ++x) {
+        for (int32_t z = 0; z < 16; ++z) {
+            CHECK(has(cache, x, z, 0) == ((x + z) % 3 != 0));
+        }
+    }
+    CHECK(metrics->evictions == 0);
+    mc_chunk_cache_destroy(cache);
+}
+
+int main(void) {
+    test_hit();
+    test_lazy_invalidation();
+    test_eviction_order();
+    test_memory_budget();
+    test_backward_shift();
+    return TEST_RESULT();
+}
@@ -0,0 +1,184 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/chunk.h"
+#include "obsidian/minecraft/chunk_compressor.h"
+
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+
+/// Amount of jobs submitted at once, more than there are workers.
+#define JOB_COUNT 16
+
+
+/*!
+ * Counts the jobs that completed.
+ */
+static void count_completion(struct mc_chunk_job* job) {
+    ++*(size_t*) job->user_data;
+}
+
+/*!
+ * Polls the compressor until no job is pending, or a few seconds have passed.
+ */
+static void wait_for_jobs(struct mc_chunk_compressor* compressor) {
+    struct timespec const pause = {.tv_nsec = 1000000};
+    for (unsigned i = 0; i < 5000 && mc_chunk_compressor_pending(compressor) > 0; ++i) {
+        mc_chunk_compressor_poll(compressor);
+        nanosleep(&pause, NULL);
+    }
+}
+
+/*!
+ * Snapshots compressed by the workers inflate back to the snapshot, and every job completes exactly once.
+ */
+static void test_compress_round_trip(void) {
+    struct mc_chunk* chunk = mc_chunk_create(3, -7);
+    CHECK(chunk != NULL);
+    for (unsigned x = 0; x < MC_CHUNK_WIDTH; ++x) {
+        for (unsigned z = 0; z < MC_CHUNK_DEPTH; ++z) {
+            mc_chunk_set_block(chunk, x, (x * 7 + z * 3) % MC_CHUNK_HEIGHT, z, 1, (x + z) & 0x0F);
+        }
+    }
+    mc_chunk_update(chunk);
+    struct obs_shared_buffer* snapshot = mc_chunk_snapshot(chunk);
+    CHECK(snapshot != NULL);
+
+    struct mc_chunk_compressor_params const params = {.worker_count = 2, .level = 6};
+    struct mc_chunk_compressor* compressor = mc_chunk_compressor_create(&params);
+    CHECK(compressor != NULL);
+    CHECK(mc_chunk_compressor_worker_count(compressor) == 2);
+
+    size_t completed = 0;
+    struct mc_chunk_job jobs[JOB_COUNT];
+    for (size_t i = 0; i < JOB_COUNT; ++i) {
+        jobs[i] = (struct mc_chunk_job) {
+            .type = MC_CHUNK_JOB_COMPRESS,
+            .snapshot = snapshot,
+            .complete = count_completion,
+            .user_data = &completed,
+        };
+        // Changing the level between jobs must not corrupt the output.
+        mc_chunk_compressor_set_level(compressor, i % 2 == 0 ? 1 : 9);
+        mc_chunk_compressor_submit(compressor, &jobs[i]);
+    }
+    CHECK(mc_chunk_compressor_pending(compressor) == JOB_COUNT);
+    wait_for_jobs(compressor);
+    CHECK(mc_chunk_compressor_pending(compressor) == 0);
+    CHECK(completed == JOB_COUNT);
+
+    uint8_t* inflated = malloc(snapshot->size);
+    for (size_t i = 0; i < JOB_COUNT; ++i) {
+        CHECK(jobs[i].compressed != NULL);
+        if (jobs[i].compressed == NULL) {
+            continue;
+        }
+        CHECK(jobs[i].packet.compressed_size == (mc_dword) jobs[i].compressed->size);
+        CHECK(jobs[i].packet.data == (mc_byte const*) jobs[i].compressed->data);
+        uLongf size = snapshot->size;
+        CHECK(uncompress(inflated, &size, jobs[i].compressed->data, jobs[i].compressed->size) == Z_OK);
+        CHECK(size == snapshot->size && memcmp(inflated, snapshot->data, size) == 0);
+        obs_shared_buffer_release(jobs[i].compressed);
+    }
+    free(inflated);
+
+    mc_chunk_compressor_destroy(compressor);
+    obs_shared_buffer_release(snapshot);
+    mc_chunk_destroy(chunk);
+}
+
+/*!
+ * Destroying the compressor completes the jobs that are still queued.
+ */
+static void test_destroy_completes_queued_jobs(void) {
+    struct mc_chunk* chunk = mc_chunk_create(0, 0);
+    struct obs_shared_buffer* snapshot = mc_chunk_snapshot(chunk);
+    struct mc_chunk_compressor_params const params = {.worker_count = 1, .level = 9};
+    struct mc_chunk_compressor* compressor = mc_chunk_compressor_create(&params);
+    CHECK(compressor != NULL);
+
+    size_t completed = 0;
+    struct mc_chunk_job jobs[JOB_COUNT];
+    for (size_t i = 0; i < JOB_COUNT; ++i) {
+        jobs[i] = (struct mc_chunk_job) {
+            .type = MC_CHUNK_JOB_COMPRESS,
+            .snapshot = snapshot,
+            .complete = count_completion,
+            .user_data = &completed,
+        };
+        mc_chunk_compressor_submit(compressor, &jobs[i]);
+    }
+    mc_chunk_compressor_destroy(compressor);
+    CHECK(completed == JOB_COUNT);
+    for (size_t i = 0; i < JOB_COUNT; ++i) {
+        if (jobs[i].compressed != NULL) {
+            obs_shared_buffer_release(jobs[i].compressed);
+        }
+    }
+    obs_shared_buffer_release(snapshot);
+    mc_chunk_destroy(chunk);
+}
+
+/*!
+ * The level steps towards the minimum under CPU pressure, towards the maximum when the network is the bottleneck and
+ * there is CPU to spare, and back to the idle level otherwise.
+ */
+static void test_level_update(void) {
+    struct mc_chunk_level_controller controller = {.level = 6, .idle_level = 6, .min_level = 1, .max_level = 9};
+    struct mc_chunk_level_signals const slow_ticks = {.tick_headroom = 0.1, .queue_depth = 0.0};
+    struct mc_chunk_level_signals const deep_queue = {.tick_headroom = 0.9, .queue_depth = 8.0};
+    struct mc_chunk_level_signals const backlog_spare = {
+        .tick_headroom = 0.9, .queue_depth = 0.5, .outbound_backlog = 1024 * 1024,
+    };
+    struct mc_chunk_level_signals const backlog_busy = {
+        .tick_headroom = 0.3, .queue_depth = 2.0, .outbound_backlog = 1024 * 1024,
+    };
+    struct mc_chunk_level_signals const idle = {.tick_headroom = 0.9, .queue_depth = 0.0};
+
+    // One step per update.
+    CHECK(mc_chunk_level_update(&controller, &slow_ticks) == 5);
+    for (unsigned i = 0; i < 10; ++i) {
+        mc_chunk_level_update(&controller, &slow_ticks);
+    }
+    CHECK(controller.level == 1);
+    CHECK(mc_chunk_level_update(&controller, &deep_queue) == 1);
+
+    // Without CPU to spare a backlog holds the level instead of raising it.
+    CHECK(mc_chunk_level_update(&controller, &backlog_busy) == 1);
+    for (unsigned i = 0; i < 10; ++i) {
+        mc_chunk_level_update(&controller, &backlog_spare);
+    }
+    CHECK(controller.level == 9);
+    CHECK(mc_chunk_level_update(&controller, &backlog_busy) == 9);
+
+    for (unsigned i = 0; i < 10; ++i) {
+        mc_chunk_level_update(&controller, &idle);
+    }
+    CHECK(controller.level == 6);
+}
+
+int main(void) {
+    test_compress_round_trip();
+    test_destroy_completes_queued_jobs();
+    test_level_update();
+    return TEST_RESULT();
+}
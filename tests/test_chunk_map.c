@@ -0,0 +1,139 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/chunk_map.h"
+
+
+/// Amount of chunks inserted, enough to grow a map created for a single group several times.
+#define CHUNK_COUNT 300
+
+
+/*!
+ * Creates the chunks, spread over negative and positive coordinates.
+ */
+static void create_chunks(struct mc_chunk* chunks[CHUNK_COUNT]) {
+    for (int32_t i = 0; i < CHUNK_COUNT; ++i) {
+        chunks[i] = mc_chunk_create(i % 20 - 10, i / 20 - 7);
+        CHECK(chunks[i] != NULL);
+    }
+}
+
+static void destroy_chunks(struct mc_chunk* chunks[CHUNK_COUNT]) {
+    for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+        mc_chunk_destroy(chunks[i]);
+    }
+}
+
+static uint64_t key_of(struct mc_chunk const* chunk) {
+    return mc_chunk_key(chunk->x, chunk->z);
+}
+
+/*!
+ * Chunks stay reachable while the map grows over more groups, after others are removed and when they are put back
+ * into the deleted slots.
+ */
+static void test_insert_erase_reinsert(void) {
+    struct mc_chunk* chunks[CHUNK_COUNT];
+    create_chunks(chunks);
+    struct mc_chunk_map* map = mc_chunk_map_create(8);
+    CHECK(map != NULL);
+
+    for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+        CHECK(mc_chunk_map_put(map, chunks[i]) == NULL);
+    }
+    CHECK(mc_chunk_map_size(map) == CHUNK_COUNT);
+    // Readers may still be in the tables the map grew out of, the owner reclaims them when that is no longer so.
+    mc_chunk_map_reclaim(map);
+    for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+        CHECK(mc_chunk_map_get(map, key_of(chunks[i])) == chunks[i]);
+    }
+    CHECK(mc_chunk_map_get(map, mc_chunk_key(1000, 1000)) == NULL);
+
+    for (size_t i = 0; i < CHUNK_COUNT; i += 2) {
+        CHECK(mc_chunk_map_remove(map, key_of(chunks[i])) == chunks[i]);
+    }
+    CHECK(mc_chunk_map_remove(map, key_of(chunks[0])) == NULL);
+    CHECK(mc_chunk_map_size(map) == CHUNK_COUNT / 2);
+    for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+        CHECK(mc_chunk_map_get(map, key_of(chunks[i])) == (i % 2 == 0 ? NULL : chunks[i]));
+    }
+
+    for (size_t i = 0; i < CHUNK_COUNT; i += 2) {
+        CHECK(mc_chunk_map_put(map, chunks[i]) == NULL);
+    }
+    CHECK(mc_chunk_map_size(map) == CHUNK_COUNT);
+    for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+        CHECK(mc_chunk_map_get(map, key_of(chunks[i])) == chunks[i]);
+    }
+
+    // Every chunk is visited exactly once.
+    size_t visited = 0;
+    size_t cursor = 0;
+    for (struct mc_chunk* chunk; (chunk = mc_chunk_map_next(map, &cursor)) != NULL; ++visited) {
+        CHECK(mc_chunk_map_get(map, key_of(chunk)) == chunk);
+    }
+    CHECK(visited == CHUNK_COUNT);
+
+    mc_chunk_map_destroy(map);
+    destroy_chunks(chunks);
+}
+
+/*!
+ * Putting a chunk at a position that is already in the map replaces it.
+ */
+static void test_replace(void) {
+    struct mc_chunk_map* map = mc_chunk_map_create(8);
+    struct mc_chunk* first = mc_chunk_create(4, -4);
+    struct mc_chunk* second = mc_chunk_create(4, -4);
+    CHECK(mc_chunk_map_put(map, first) == NULL);
+    CHECK(mc_chunk_map_put(map, second) == first);
+    CHECK(mc_chunk_map_get(map, mc_chunk_key(4, -4)) == second);
+    CHECK(mc_chunk_map_size(map) == 1);
+    mc_chunk_map_destroy(map);
+    mc_chunk_destroy(second);
+    mc_chunk_destroy(first);
+}
+
+/*!
+ * Deleted slots left by a constant churn of chunks are recycled instead of filling up the map.
+ */
+static void test_churn(void) {
+    struct mc_chunk* chunks[CHUNK_COUNT];
+    create_chunks(chunks);
+    struct mc_chunk_map* map = mc_chunk_map_create(8);
+    for (size_t round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+            CHECK(mc_chunk_map_put(map, chunks[i]) == NULL);
+            CHECK(mc_chunk_map_remove(map, key_of(chunks[i])) == chunks[i]);
+        }
+    }
+    CHECK(mc_chunk_map_size(map) == 0);
+    CHECK(mc_chunk_map_get(map, key_of(chunks[0])) == NULL);
+    mc_chunk_map_reclaim(map);
+    mc_chunk_map_destroy(map);
+    destroy_chunks(chunks);
+}
+
+int main(void) {
+    test_insert_erase_reinsert();
+    test_replace();
+    test_churn();
+    return TEST_RESULT();
+}
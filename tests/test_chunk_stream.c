@@ -0,0 +1,249 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/chunk_stream.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/// Chunks of the model world range from -WORLD_EXTENT to WORLD_EXTENT - 1 along both axes.
+#define WORLD_EXTENT 128
+
+
+/*!
+ * What the client is expected to know, tracked chunk by chunk.
+ */
+struct model {
+    bool known[2 * WORLD_EXTENT][2 * WORLD_EXTENT];
+    size_t unloads;
+    bool unexpected_unload;
+};
+
+static bool* model_cell(struct model* model, int32_t const x, int32_t const z) {
+    return &model->known[x + WORLD_EXTENT][z + WORLD_EXTENT];
+}
+
+static bool in_view(int32_t const center_x, int32_t const center_z, int32_t const radius, int32_t const x,
+                    int32_t const z) {
+    return abs(x - center_x) <= radius && abs(z - center_z) <= radius;
+}
+
+/*!
+ * Unload callback, checks the chunk was known and forgets it.
+ */
+static void model_unload(void* user_data, int32_t const x, int32_t const z) {
+    struct model* model = user_data;
+    bool* known = model_cell(model, x, z);
+    if (!*known) {
+        model->unexpected_unload = true;
+    }
+    *known = false;
+    ++model->unloads;
+}
+
+/*!
+ * Hands out every chunk the stream has left and resolves it as sent.
+ * \return Amount of chunks handed out.
+ */
+static size_t send_all(struct mc_chunk_stream* stream, struct model* model, int32_t const center_x,
+                       int32_t const center_z, int32_t const radius) {
+    size_t count = 0;
+    int64_t last_distance = -1;
+    int32_t x;
+    int32_t z;
+    while (mc_chunk_stream_next(stream, &x, &z)) {
+        CHECK(in_view(center_x, center_z, radius, x, z));
+        CHECK(!*model_cell(model, x, z));
+        // Nearest first.
+        int64_t const distance = (int64_t) (x - center_x) * (x - center_x) + (int64_t) (z - center_z) * (z - center_z);
+        CHECK(distance >= last_distance);
+        last_distance = distance;
+        CHECK(mc_chunk_stream_resolve(stream, x, z, MC_CHUNK_STREAM_SENT));
+        *model_cell(model, x, z) = true;
+        ++count;
+    }
+    CHECK(mc_chunk_stream_done(stream));
+    return count;
+}
+
+/*!
+ * Checks the stream knows exactly the chunks of the model around a center.
+ */
+static void check_known(struct mc_chunk_stream const* stream, struct model* model, int32_t const center_x,
+                        int32_t const center_z, int32_t const radius) {
+    for (int32_t x = center_x - radius - 2; x <= center_x + radius + 2; ++x) {
+        for (int32_t z = center_z - radius - 2; z <= center_z + radius + 2; ++z) {
+            CHECK(mc_chunk_stream_knows(stream, x, z) == *model_cell(model, x, z));
+        }
+    }
+}
+
+/*!
+ * Moving the view unloads exactly the chunks that leave it, keeps the others and streams only the ones that enter it.
+ */
+static void test_moves(int32_t const radius) {
+    static int32_t const moves[][2] = {
+        {0, 0}, {1, 0}, {1, 1}, {-1, 3}, {-2, -2}, {0, -7}, {-30, -30}, {-29, -31}, {40, 50}, {40, 50}, {37, 49},
+    };
+    struct model* model = calloc(1, sizeof(struct model));
+    struct mc_chunk_stream* stream = mc_chunk_stream_create(radius, moves[0][0], moves[0][1]);
+    size_t const area = (size_t) (2 * radius + 1) * (2 * radius + 1);
+    CHECK(send_all(stream, model, moves[0][0], moves[0][1], radius) == area);
+    for (size_t i = 1; i < sizeof(moves) / sizeof(moves[0]); ++i) {
+        int32_t const x = moves[i][0];
+        int32_t const z = moves[i][1];
+        size_t kept = 0;
+        for (int32_t cx = -WORLD_EXTENT; cx < WORLD_EXTENT; ++cx) {
+            for (int32_t cz = -WORLD_EXTENT; cz < WORLD_EXTENT; ++cz) {
+                kept += *model_cell(model, cx, cz) && in_view(x, z, radius, cx, cz);
+            }
+        }
+        model->unloads = 0;
+        mc_chunk_stream_move(stream, x, z, model_unload, model);
+        CHECK(!model->unexpected_unload);
+        CHECK(model->unloads == (x == moves[i - 1][0] && z == moves[i - 1][1] ? 0 : area - kept));
+        check_known(stream, model, x, z, radius);
+        CHECK(send_all(stream, model, x, z, radius) == area - kept);
+        check_known(stream, model, x, z, radius);
+    }
+    mc_chunk_stream_destroy(stream);
+    free(model);
+}
+
+/*!
+ * Xorshift generator, so every run makes the same moves.
+ */
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/*!
+ * Moving the view while it is only partly streamed does not lose any chunk, wherever the stream picks up again.
+ */
+static void test_partial_moves(int32_t const radius) {
+    struct model* model = calloc(1, sizeof(struct model));
+    int32_t center_x = 0;
+    int32_t center_z = 0;
+    struct mc_chunk_stream* stream = mc_chunk_stream_create(radius, center_x, center_z);
+    size_t const area = (size_t) (2 * radius + 1) * (2 * radius + 1);
+    uint32_t state = 0x0BEE;
+    for (size_t i = 0; i < 200; ++i) {
+        // Hand out part of the view, some of it going back to the stream unsent.
+        size_t const count = next_random(&state) % (area / 2 + 1);
+        int32_t x;
+        int32_t z;
+        for (size_t n = 0; n < count && mc_chunk_stream_next(stream, &x, &z); ++n) {
+            bool const sent = next_random(&state) % 8 != 0;
+            CHECK(mc_chunk_stream_resolve(stream, x, z, sent ? MC_CHUNK_STREAM_SENT : MC_CHUNK_STREAM_UNSENT));
+            *model_cell(model, x, z) |= sent;
+        }
+        // Mostly walk a few chunks, now and then jump further than the view is wide.
+        int32_t const reach = next_random(&state) % 16 == 0 ? 2 * radius + 2 : 2;
+        int32_t const to_x = center_x + (int32_t) (next_random(&state) % (2 * reach + 1)) - reach;
+        int32_t const to_z = center_z + (int32_t) (next_random(&state) % (2 * reach + 1)) - reach;
+        if (abs(to_x) + radius + 2 < WORLD_EXTENT && abs(to_z) + radius + 2 < WORLD_EXTENT) {
+            center_x = to_x;
+            center_z = to_z;
+        }
+        mc_chunk_stream_move(stream, center_x, center_z, model_unload, model);
+        CHECK(!model->unexpected_unload);
+        check_known(stream, model, center_x, center_z, radius);
+    }
+    size_t kept = 0;
+    for (int32_t x = center_x - radius; x <= center_x + radius; ++x) {
+        for (int32_t z = center_z - radius; z <= center_z + radius; ++z) {
+            kept += *model_cell(model, x, z);
+        }
+    }
+    CHECK(send_all(stream, model, center_x, center_z, radius) == area - kept);
+    check_known(stream, model, center_x, center_z, radius);
+    mc_chunk_stream_destroy(stream);
+    free(model);
+}
+
+/*!
+ * Chunks resolved as unsent are handed out again, skipped ones are not, and neither becomes known.
+ */
+static void test_resolve(void) {
+    struct mc_chunk_stream* stream = mc_chunk_stream_create(1, 5, 5);
+    int32_t x;
+    int32_t z;
+    CHECK(!mc_chunk_stream_pending(stream, 5, 5));
+    CHECK(mc_chunk_stream_next(stream, &x, &z) && x == 5 && z == 5);
+    CHECK(mc_chunk_stream_pending(stream, 5, 5));
+    CHECK(!mc_chunk_stream_resolve(stream, 5, 5, MC_CHUNK_STREAM_PENDING));
+    CHECK(mc_chunk_stream_resolve(stream, 5, 5, MC_CHUNK_STREAM_UNSENT));
+    CHECK(!mc_chunk_stream_pending(stream, 5, 5));
+    CHECK(!mc_chunk_stream_resolve(stream, 5, 5, MC_CHUNK_STREAM_SENT));
+    CHECK(mc_chunk_stream_next(stream, &x, &z) && x == 5 && z == 5);
+    CHECK(mc_chunk_stream_resolve(stream, 5, 5, MC_CHUNK_STREAM_SKIPPED));
+    CHECK(!mc_chunk_stream_knows(stream, 5, 5));
+
+    size_t count = 0;
+    while (mc_chunk_stream_next(stream, &x, &z)) {
+        CHECK(x != 5 || z != 5);
+        ++count;
+    }
+    CHECK(count == 8);
+    CHECK(!mc_chunk_stream_done(stream));
+    // Chunks outside the view were never handed out.
+    CHECK(!mc_chunk_stream_resolve(stream, 7, 5, MC_CHUNK_STREAM_SENT));
+    mc_chunk_stream_destroy(stream);
+}
+
+/*!
+ * The rectangles of a view difference cover exactly the chunks of the old view that are not in the new one.
+ */
+static void test_view_difference(void) {
+    static int32_t const targets[][2] = {{0, 0}, {1, 0}, {0, -1}, {2, 3}, {-4, 4}, {5, 0}, {5, 5}, {20, -1}};
+    int32_t const radius = 2;
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i) {
+        int32_t const to_x = targets[i][0];
+        int32_t const to_z = targets[i][1];
+        struct mc_chunk_rect rects[2];
+        size_t const count = mc_chunk_view_difference(0, 0, to_x, to_z, radius, rects);
+        for (int32_t x = -radius; x <= radius; ++x) {
+            for (int32_t z = -radius; z <= radius; ++z) {
+                unsigned covered = 0;
+                for (size_t r = 0; r < count; ++r) {
+                    covered += x >= rects[r].min_x && x <= rects[r].max_x && z >= rects[r].min_z && z <= rects[r].max_z;
+                }
+                CHECK(covered == (in_view(to_x, to_z, radius, x, z) ? 0 : 1));
+            }
+        }
+    }
+}
+
+int main(void) {
+    mc_chunk_stream_init();
+    test_moves(2);
+    test_moves(MC_CHUNK_STREAM_MAX_RADIUS);
+    test_partial_moves(2);
+    test_partial_moves(MC_CHUNK_STREAM_MAX_RADIUS);
+    test_resolve();
+    test_view_difference();
+    return TEST_RESULT();
+}
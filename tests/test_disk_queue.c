@@ -0,0 +1,119 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/disk_queue.h"
+
+#include <string.h>
+
+
+/// Nanoseconds in a microsecond.
+#define US 1000ull
+
+
+/*!
+ * No more operations than the limit are in flight, the rest are counted as deferred.
+ */
+static void test_limit(void) {
+    struct obs_server_metrics metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    struct obs_disk_queue queue;
+    obs_disk_queue_init(&queue, 2, &metrics);
+    struct obs_disk_entry entries[3] = {{.op = OBS_DISK_READ}, {.op = OBS_DISK_READ}, {.op = OBS_DISK_READ}};
+    CHECK(obs_disk_queue_admit(&queue, &entries[0], 0));
+    CHECK(obs_disk_queue_admit(&queue, &entries[1], 0));
+    CHECK(!obs_disk_queue_admit(&queue, &entries[2], 0));
+    CHECK(metrics.disk_ops_in_flight == 2);
+    CHECK(metrics.disk_ops_deferred == 1);
+
+    // A completion lets the waiting operation in without the amount in flight going over the limit.
+    CHECK(obs_disk_queue_complete(&queue, &entries[0], 0) == &entries[2]);
+    CHECK(metrics.disk_ops_in_flight == 2);
+    CHECK(obs_disk_queue_complete(&queue, &entries[1], 0) == NULL);
+    CHECK(obs_disk_queue_complete(&queue, &entries[2], 0) == NULL);
+    CHECK(metrics.disk_ops_in_flight == 0);
+    CHECK(obs_disk_queue_admit(&queue, &entries[0], 0));
+    CHECK(metrics.disk_ops_deferred == 1);
+}
+
+/*!
+ * Deferred operations are let in oldest first, including ones deferred while others were being let in.
+ */
+static void test_fifo(void) {
+    struct obs_server_metrics metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    struct obs_disk_queue queue;
+    obs_disk_queue_init(&queue, 1, &metrics);
+    struct obs_disk_entry entries[5];
+    memset(entries, 0, sizeof(entries));
+    CHECK(obs_disk_queue_admit(&queue, &entries[0], 0));
+    for (size_t i = 1; i < 4; ++i) {
+        CHECK(!obs_disk_queue_admit(&queue, &entries[i], 0));
+    }
+    CHECK(obs_disk_queue_complete(&queue, &entries[0], 0) == &entries[1]);
+    CHECK(obs_disk_queue_complete(&queue, &entries[1], 0) == &entries[2]);
+    CHECK(!obs_disk_queue_admit(&queue, &entries[4], 0));
+    CHECK(obs_disk_queue_complete(&queue, &entries[2], 0) == &entries[3]);
+    CHECK(obs_disk_queue_complete(&queue, &entries[3], 0) == &entries[4]);
+    CHECK(obs_disk_queue_complete(&queue, &entries[4], 0) == NULL);
+    CHECK(metrics.disk_ops_in_flight == 0);
+    CHECK(metrics.disk_ops_deferred == 4);
+}
+
+/*!
+ * Latencies are counted per operation in power of two buckets of microseconds, from when the operation was let in.
+ */
+static void test_latency(void) {
+    CHECK(obs_disk_latency_bucket(0) == 0);
+    CHECK(obs_disk_latency_bucket(1) == 1);
+    CHECK(obs_disk_latency_bucket(3) == 2);
+    CHECK(obs_disk_latency_bucket(4) == 3);
+    CHECK(obs_disk_latency_bucket((1ull << (OBS_DISK_LATENCY_BUCKETS - 1)) - 1) == OBS_DISK_LATENCY_BUCKETS - 1);
+    CHECK(obs_disk_latency_bucket(UINT64_MAX) == OBS_DISK_LATENCY_BUCKETS - 1);
+
+    struct obs_server_metrics metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    struct obs_disk_queue queue;
+    obs_disk_queue_init(&queue, 1, &metrics);
+    struct obs_disk_entry open = {.op = OBS_DISK_OPEN};
+    struct obs_disk_entry fsync = {.op = OBS_DISK_FSYNC};
+    CHECK(obs_disk_queue_admit(&queue, &open, 100 * US));
+    CHECK(!obs_disk_queue_admit(&queue, &fsync, 150 * US));
+    // 500 us is counted in the bucket below 512 us, the waiting fsync starts its clock now.
+    CHECK(obs_disk_queue_complete(&queue, &open, 600 * US) == &fsync);
+    CHECK(metrics.disk_latency[OBS_DISK_OPEN][9] == 1);
+    // The fsync waited 450 us, but only the 3 ms it was in flight count.
+    CHECK(obs_disk_queue_complete(&queue, &fsync, 3600 * US) == NULL);
+    CHECK(metrics.disk_latency[OBS_DISK_FSYNC][12] == 1);
+
+    uint64_t total = 0;
+    for (size_t op = 0; op < OBS_DISK_OP_COUNT; ++op) {
+        for (size_t bucket = 0; bucket < OBS_DISK_LATENCY_BUCKETS; ++bucket) {
+            total += metrics.disk_latency[op][bucket];
+        }
+    }
+    CHECK(total == 2);
+}
+
+int main(void) {
+    test_limit();
+    test_fifo();
+    test_latency();
+    return TEST_RESULT();
+}
@@ -0,0 +1,212 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/entity_ids.h"
+#include "obsidian/minecraft/entity_store.h"
+
+
+/// Amount of generations of a slot before its entity IDs repeat.
+#define GENERATION_COUNT (1u << MC_ENTITY_GENERATION_BITS)
+
+
+/*!
+ * Slots are handed out lowest first, a released slot is reused, and running out is reported.
+ */
+static void test_allocation(void) {
+    struct mc_entity_ids* ids = mc_entity_ids_create(3);
+    CHECK(ids != NULL);
+    CHECK(mc_entity_ids_allocate(ids) == 0);
+    CHECK(mc_entity_ids_allocate(ids) == 1);
+    CHECK(mc_entity_ids_allocate(ids) == 2);
+    CHECK(mc_entity_ids_allocate(ids) == MC_ENTITY_NO_SLOT);
+    CHECK(mc_entity_ids_bound(ids) == 3);
+    mc_entity_ids_release(ids, 1);
+    CHECK(mc_entity_ids_allocate(ids) == 1);
+    CHECK(mc_entity_ids_bound(ids) == 3);
+    // Entity IDs are never zero, slot zero is named by one in its first generation.
+    CHECK(mc_entity_ids_id(ids, 0) == 1);
+    CHECK(mc_entity_slot(mc_entity_ids_id(ids, 2)) == 2);
+    CHECK(mc_entity_slot(0) == MC_ENTITY_NO_SLOT);
+    mc_entity_ids_destroy(ids);
+}
+
+/*!
+ * The lowest free slot is handed out whatever the order of release, and the bound drops once the top slots are free.
+ */
+static void test_lowest_first(void) {
+    struct mc_entity_ids* ids = mc_entity_ids_create(8);
+    CHECK(ids != NULL);
+    for (uint32_t i = 0; i < 6; ++i) {
+        mc_entity_ids_allocate(ids);
+    }
+    mc_entity_ids_release(ids, 1);
+    mc_entity_ids_release(ids, 4);
+    mc_entity_ids_release(ids, 3);
+    CHECK(mc_entity_ids_bound(ids) == 6);
+    CHECK(mc_entity_ids_allocate(ids) == 1);
+    CHECK(mc_entity_ids_allocate(ids) == 3);
+
+    // Freeing the top slot lowers the bound past every free slot below it.
+    mc_entity_ids_release(ids, 5);
+    CHECK(mc_entity_ids_bound(ids) == 4);
+    CHECK(mc_entity_ids_allocate(ids) == 4);
+    CHECK(mc_entity_ids_bound(ids) == 5);
+    for (uint32_t i = 0; i < 5; ++i) {
+        mc_entity_ids_release(ids, i);
+    }
+    CHECK(mc_entity_ids_bound(ids) == 0);
+    CHECK(mc_entity_ids_allocate(ids) == 0);
+    mc_entity_ids_destroy(ids);
+}
+
+/*!
+ * An entity ID no longer resolves once its slot is released, also after the slot is handed out again.
+ */
+static void test_stale_ids(void) {
+    struct mc_entity_ids* ids = mc_entity_ids_create(4);
+    CHECK(ids != NULL);
+    uint32_t const slot = mc_entity_ids_allocate(ids);
+    int32_t const old_id = mc_entity_ids_id(ids, slot);
+    CHECK(mc_entity_ids_resolve(ids, old_id) == slot);
+
+    mc_entity_ids_release(ids, slot);
+    CHECK(mc_entity_ids_resolve(ids, old_id) == MC_ENTITY_NO_SLOT);
+    CHECK(mc_entity_ids_allocate(ids) == slot);
+    int32_t const new_id = mc_entity_ids_id(ids, slot);
+    CHECK(new_id != old_id);
+    CHECK(mc_entity_slot(new_id) == slot);
+    CHECK(mc_entity_ids_resolve(ids, old_id) == MC_ENTITY_NO_SLOT);
+    CHECK(mc_entity_ids_resolve(ids, new_id) == slot);
+
+    // Zero, free slots and slots past the capacity name nothing.
+    CHECK(mc_entity_ids_resolve(ids, 0) == MC_ENTITY_NO_SLOT);
+    CHECK(mc_entity_ids_resolve(ids, mc_entity_ids_id(ids, 3)) == MC_ENTITY_NO_SLOT);
+    CHECK(mc_entity_ids_resolve(ids, 5) == MC_ENTITY_NO_SLOT);
+    CHECK(mc_entity_ids_resolve(ids, -1) == MC_ENTITY_NO_SLOT);
+    mc_entity_ids_destroy(ids);
+}
+
+/*!
+ * The generation wraps around to the first one after every generation was used, and the entity IDs stay positive.
+ */
+static void test_generation_wraparound(void) {
+    struct mc_entity_ids* ids = mc_entity_ids_create(MC_ENTITY_MAX_SLOTS);
+    CHECK(ids != NULL);
+    // The highest slot gives the entity IDs with the most bits set.
+    uint32_t const slot = MC_ENTITY_MAX_SLOTS - 1;
+    for (uint32_t i = 0; i < slot; ++i) {
+        mc_entity_ids_allocate(ids);
+    }
+    CHECK(mc_entity_ids_allocate(ids) == slot);
+    int32_t const first_id = mc_entity_ids_id(ids, slot);
+    bool positive = true;
+    bool repeated = false;
+    for (uint32_t generation = 1; generation < GENERATION_COUNT; ++generation) {
+        mc_entity_ids_release(ids, slot);
+        mc_entity_ids_allocate(ids);
+        int32_t const id = mc_entity_ids_id(ids, slot);
+        positive &= id > 0 && mc_entity_slot(id) == slot;
+        repeated |= id == first_id;
+    }
+    CHECK(positive);
+    CHECK(!repeated);
+    CHECK(mc_entity_ids_id(ids, slot) == INT32_MAX);
+
+    mc_entity_ids_release(ids, slot);
+    CHECK(mc_entity_ids_allocate(ids) == slot);
+    CHECK(mc_entity_ids_id(ids, slot) == first_id);
+    CHECK(mc_entity_ids_resolve(ids, first_id) == slot);
+    mc_entity_ids_destroy(ids);
+}
+
+/*!
+ * Moves are listed once with the change since the last relayed state, which is then taken as relayed.
+ */
+static void test_collect_moves(void) {
+    struct mc_entity_store* store = mc_entity_store_create(8);
+    CHECK(store != NULL);
+    struct mc_entity_move moves[8];
+    uint32_t const player = mc_entity_store_spawn(store, MC_ENTITY_PLAYER, 0.5, 64.0, 0.5);
+    CHECK(player == 0);
+    CHECK(store->relayed_x[player] == 16 && store->relayed_y[player] == 2048 && store->relayed_z[player] == 16);
+    // A new entity counts as relayed where it is.
+    CHECK(mc_entity_store_collect_moves(store, moves) == 0);
+
+    store->x[player] = 1.5;
+    store->z[player] = -0.01;
+    CHECK(mc_entity_store_collect_moves(store, moves) == 1);
+    CHECK(moves[0].slot == player && moves[0].moved && !moves[0].rotated);
+    CHECK(moves[0].dx == 32 && moves[0].dy == 0 && moves[0].dz == -17);
+    CHECK(moves[0].x == 48 && moves[0].y == 2048 && moves[0].z == -1);
+    CHECK(store->relayed_x[player] == 48 && store->relayed_z[player] == -1);
+    CHECK(mc_entity_store_collect_moves(store, moves) == 0);
+
+    // Turning a little past a full turn only moves the angle by the part of the turn.
+    store->yaw[player] = 450.0f;
+    CHECK(mc_entity_store_collect_moves(store, moves) == 1);
+    CHECK(!moves[0].moved && moves[0].rotated && moves[0].yaw == 64 && moves[0].pitch == 0);
+    CHECK(store->relayed_yaw[player] == 64);
+
+    // Less than a unit is not relayed, and adds up until it is.
+    store->x[player] = 1.5 + 0.02;
+    CHECK(mc_entity_store_collect_moves(store, moves) == 0);
+    store->x[player] = 1.5 + 0.04;
+    CHECK(mc_entity_store_collect_moves(store, moves) == 1 && moves[0].dx == 1);
+    mc_entity_store_destroy(store);
+}
+
+/*!
+ * The physics step moves falling entities, but not players, and removed entities are no longer listed.
+ */
+static void test_step_and_remove(void) {
+    struct mc_entity_store* store = mc_entity_store_create(8);
+    CHECK(store != NULL);
+    struct mc_entity_move moves[8];
+    uint32_t const player = mc_entity_store_spawn(store, MC_ENTITY_PLAYER, 0.5, 64.0, 0.5);
+    uint32_t const item = mc_entity_store_spawn(store, MC_ENTITY_ITEM, 0.5, 64.0, 0.5);
+    uint32_t const mob = mc_entity_store_spawn(store, MC_ENTITY_MOB, 0.5, 64.0, 0.5);
+    mc_entity_store_step(store);
+    CHECK(store->y[player] == 64.0);
+    CHECK(store->y[item] < 64.0 && store->y[mob] < store->y[item]);
+    CHECK(mc_entity_store_collect_moves(store, moves) == 2);
+    CHECK(moves[0].slot == item && moves[0].dy == -2 && moves[0].dx == 0 && moves[0].dz == 0);
+    CHECK(moves[1].slot == mob && moves[1].dy == -3);
+
+    int32_t const item_id = mc_entity_ids_id(store->ids, item);
+    mc_entity_store_remove(store, item);
+    CHECK(mc_entity_ids_resolve(store->ids, item_id) == MC_ENTITY_NO_SLOT);
+    store->x[item] = 100.0;
+    mc_entity_store_step(store);
+    CHECK(mc_entity_store_collect_moves(store, moves) == 1 && moves[0].slot == mob);
+    // The slot of the removed entity is handed out again, without the velocity of the entity it held.
+    CHECK(mc_entity_store_spawn(store, MC_ENTITY_PLAYER, 0.5, 64.0, 0.5) == item);
+    CHECK(store->velocity_y[item] == 0.0 && store->gravity[item] == 0.0);
+    mc_entity_store_destroy(store);
+}
+
+int main(void) {
+    test_allocation();
+    test_lowest_first();
+    test_stale_ids();
+    test_generation_wraparound();
+    test_collect_moves();
+    test_step_and_remove();
+    return TEST_RESULT();
+}
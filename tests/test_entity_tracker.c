@@ -0,0 +1,108 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/entity_tracker.h"
+
+
+/*!
+ * Records the callbacks of an update, failing those for the slots in a set.
+ */
+struct calls {
+    uint32_t spawned[8];
+    size_t spawn_count;
+    uint32_t destroyed[8];
+    size_t destroy_count;
+    uint32_t failing;
+};
+
+static bool spawn(void* user_data, uint32_t const slot) {
+    struct calls* calls = user_data;
+    calls->spawned[calls->spawn_count++] = slot;
+    return slot != calls->failing;
+}
+
+static bool destroy(void* user_data, uint32_t const slot) {
+    struct calls* calls = user_data;
+    calls->destroyed[calls->destroy_count++] = slot;
+    return slot != calls->failing;
+}
+
+/*!
+ * Entities entering and leaving are reported once, across words.
+ */
+static void test_update(void) {
+    struct mc_entity_tracker* tracker = mc_entity_tracker_create(200);
+    CHECK(tracker != NULL);
+    struct calls calls = {.failing = UINT32_MAX};
+    mc_entity_tracker_want(tracker, 3);
+    mc_entity_tracker_want(tracker, 130);
+    mc_entity_tracker_update(tracker, spawn, destroy, &calls);
+    CHECK(calls.spawn_count == 2 && calls.spawned[0] == 3 && calls.spawned[1] == 130);
+    CHECK(calls.destroy_count == 0);
+    CHECK(mc_entity_tracker_knows(tracker, 3) && mc_entity_tracker_knows(tracker, 130));
+
+    calls = (struct calls) {.failing = UINT32_MAX};
+    mc_entity_tracker_clear(tracker);
+    mc_entity_tracker_want(tracker, 130);
+    mc_entity_tracker_want(tracker, 64);
+    mc_entity_tracker_update(tracker, spawn, destroy, &calls);
+    CHECK(calls.destroy_count == 1 && calls.destroyed[0] == 3);
+    CHECK(calls.spawn_count == 1 && calls.spawned[0] == 64);
+    CHECK(!mc_entity_tracker_knows(tracker, 3) && mc_entity_tracker_knows(tracker, 64));
+    CHECK(!mc_entity_tracker_knows(tracker, 200));
+    mc_entity_tracker_destroy(tracker);
+}
+
+/*!
+ * An entity the client could not be told about keeps its state and is tried again on the next update.
+ */
+static void test_failed_callbacks(void) {
+    struct mc_entity_tracker* tracker = mc_entity_tracker_create(128);
+    CHECK(tracker != NULL);
+    struct calls calls = {.failing = 70};
+    mc_entity_tracker_want(tracker, 1);
+    mc_entity_tracker_want(tracker, 70);
+    mc_entity_tracker_update(tracker, spawn, destroy, &calls);
+    CHECK(calls.spawn_count == 2);
+    CHECK(mc_entity_tracker_knows(tracker, 1) && !mc_entity_tracker_knows(tracker, 70));
+
+    calls = (struct calls) {.failing = UINT32_MAX};
+    mc_entity_tracker_update(tracker, spawn, destroy, &calls);
+    CHECK(calls.spawn_count == 1 && calls.spawned[0] == 70);
+    CHECK(mc_entity_tracker_knows(tracker, 70));
+
+    calls = (struct calls) {.failing = 1};
+    mc_entity_tracker_clear(tracker);
+    mc_entity_tracker_update(tracker, spawn, destroy, &calls);
+    CHECK(calls.destroy_count == 2);
+    CHECK(mc_entity_tracker_knows(tracker, 1) && !mc_entity_tracker_knows(tracker, 70));
+
+    calls = (struct calls) {.failing = UINT32_MAX};
+    mc_entity_tracker_update(tracker, spawn, destroy, &calls);
+    CHECK(calls.destroy_count == 1 && calls.destroyed[0] == 1);
+    CHECK(!mc_entity_tracker_knows(tracker, 1));
+    mc_entity_tracker_destroy(tracker);
+}
+
+int main(void) {
+    test_update();
+    test_failed_callbacks();
+    return TEST_RESULT();
+}
@@ -0,0 +1,216 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/interest_grid.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+
+/// Amount of members, few enough that the grid keeps the smallest cell table of 16 slots.
+#define MEMBER_COUNT 8
+
+/// Slots of the cell table of a grid of MEMBER_COUNT members.
+#define SLOT_COUNT 16
+
+/// Cells of the model range from -WORLD_EXTENT to WORLD_EXTENT - 1 along both axes.
+#define WORLD_EXTENT 4
+
+/// Amount of random operations checked against the model.
+#define ITERATIONS 20000
+
+
+/*!
+ * Where every member is, compared against the grid by brute force.
+ */
+struct model {
+    bool present[MEMBER_COUNT];
+    int32_t x[MEMBER_COUNT];
+    int32_t z[MEMBER_COUNT];
+};
+
+/*!
+ * Xorshift generator, so every run tries the same operations.
+ */
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/*!
+ * The slot a cell hashes to in a table of SLOT_COUNT slots, mirroring interest_grid.c.
+ */
+static size_t home_slot(int32_t const cell_x, int32_t const cell_z) {
+    uint64_t h = (uint64_t) (uint32_t) cell_x << 32 | (uint32_t) cell_z;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h & (SLOT_COUNT - 1);
+}
+
+/*!
+ * Finds cells along the X axis that hash to a slot.
+ */
+static void find_colliding_cells(size_t const slot, int32_t* cells, size_t const count) {
+    size_t found = 0;
+    for (int32_t x = 0; found < count; ++x) {
+        if (home_slot(x, 0) == slot) {
+            cells[found++] = x;
+        }
+    }
+}
+
+/*!
+ * Checks that a query lists exactly the members of the model within the radius, each once.
+ */
+static bool query_matches(struct mc_interest_grid const* grid, struct model const* model, int32_t const cell_x,
+                          int32_t const cell_z, unsigned const radius) {
+    uint32_t members[MEMBER_COUNT + 1];
+    size_t const count = mc_interest_grid_query(grid, cell_x, cell_z, radius, members, MEMBER_COUNT + 1);
+    bool listed[MEMBER_COUNT] = {0};
+    for (size_t i = 0; i < count; ++i) {
+        if (members[i] >= MEMBER_COUNT || listed[members[i]]) {
+            return false;
+        }
+        listed[members[i]] = true;
+    }
+    for (uint32_t member = 0; member < MEMBER_COUNT; ++member) {
+        bool const near = model->present[member] && model->x[member] >= cell_x - (int32_t) radius &&
+                          model->x[member] <= cell_x + (int32_t) radius &&
+                          model->z[member] >= cell_z - (int32_t) radius &&
+                          model->z[member] <= cell_z + (int32_t) radius;
+        if (listed[member] != near) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * Cells that hash to the same slot stay reachable when the cell in front of them is emptied, including when the run
+ * of cells wraps around the end of the table.
+ */
+static void test_colliding_cells(void) {
+    for (size_t slot = 0; slot < SLOT_COUNT; slot += SLOT_COUNT - 1) {
+        int32_t cells[4];
+        find_colliding_cells(slot, cells, 4);
+        struct mc_interest_grid* grid = mc_interest_grid_create(MEMBER_COUNT);
+        CHECK(grid != NULL);
+        struct model model = {0};
+        for (uint32_t member = 0; member < 4; ++member) {
+            mc_interest_grid_insert(grid, member, cells[member], 0);
+            model.present[member] = true;
+            model.x[member] = cells[member];
+        }
+        // Emptying the first cell of the run shifts the others back into the hole.
+        mc_interest_grid_remove(grid, 0);
+        model.present[0] = false;
+        for (uint32_t member = 0; member < 4; ++member) {
+            CHECK(query_matches(grid, &model, cells[member], 0, 0));
+        }
+        // Moving a member out of the middle of the run, then into the first cell again.
+        mc_interest_grid_move(grid, 2, cells[0], 0);
+        model.x[2] = cells[0];
+        for (uint32_t member = 0; member < 4; ++member) {
+            CHECK(query_matches(grid, &model, cells[member], 0, 0));
+        }
+        mc_interest_grid_remove(grid, 1);
+        mc_interest_grid_remove(grid, 3);
+        model.present[1] = false;
+        model.present[3] = false;
+        for (uint32_t member = 0; member < 4; ++member) {
+            CHECK(query_matches(grid, &model, cells[member], 0, 0));
+        }
+        CHECK(mc_interest_grid_contains(grid, 2) && !mc_interest_grid_contains(grid, 1));
+        mc_interest_grid_destroy(grid);
+    }
+}
+
+/*!
+ * Random inserts, removes and moves over a small patch of cells, which collide in the table all the time, list the
+ * same members as the model for every cell and radius.
+ */
+static void test_against_model(void) {
+    struct mc_interest_grid* grid = mc_interest_grid_create(MEMBER_COUNT);
+    CHECK(grid != NULL);
+    struct model model = {0};
+    uint32_t state = 0x0BEE;
+    unsigned mismatches = 0;
+    for (unsigned i = 0; i < ITERATIONS; ++i) {
+        uint32_t const member = next_random(&state) % MEMBER_COUNT;
+        int32_t const x = (int32_t) (next_random(&state) % (2 * WORLD_EXTENT)) - WORLD_EXTENT;
+        int32_t const z = (int32_t) (next_random(&state) % (2 * WORLD_EXTENT)) - WORLD_EXTENT;
+        if (!model.present[member]) {
+            mc_interest_grid_insert(grid, member, x, z);
+            model.present[member] = true;
+        }
+        else if (next_random(&state) % 4 == 0) {
+            mc_interest_grid_remove(grid, member);
+            model.present[member] = false;
+        }
+        else {
+            mc_interest_grid_move(grid, member, x, z);
+        }
+        model.x[member] = x;
+        model.z[member] = z;
+        if (mc_interest_grid_contains(grid, member) != model.present[member]) {
+            ++mismatches;
+        }
+        unsigned const radius = next_random(&state) % 3;
+        int32_t const center_x = (int32_t) (next_random(&state) % (2 * WORLD_EXTENT)) - WORLD_EXTENT;
+        int32_t const center_z = (int32_t) (next_random(&state) % (2 * WORLD_EXTENT)) - WORLD_EXTENT;
+        if (!query_matches(grid, &model, center_x, center_z, radius)) {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+    // Every cell at once, which also checks nothing is left behind in cells that were emptied.
+    CHECK(query_matches(grid, &model, 0, 0, WORLD_EXTENT));
+    mc_interest_grid_destroy(grid);
+}
+
+/*!
+ * Listing stops when the array is full.
+ */
+static void test_query_capacity(void) {
+    struct mc_interest_grid* grid = mc_interest_grid_create(MEMBER_COUNT);
+    CHECK(grid != NULL);
+    for (uint32_t member = 0; member < 5; ++member) {
+        mc_interest_grid_insert(grid, member, -1, 1);
+    }
+    uint32_t members[3];
+    memset(members, 0xFF, sizeof(members));
+    CHECK(mc_interest_grid_query(grid, 0, 0, 1, members, 2) == 2);
+    CHECK(members[0] < 5 && members[1] < 5 && members[0] != members[1] && members[2] == UINT32_MAX);
+    CHECK(mc_interest_grid_query(grid, 2, 2, 1, members, 3) == 0);
+    mc_interest_grid_destroy(grid);
+}
+
+int main(void) {
+    test_colliding_cells();
+    test_against_model();
+    test_query_capacity();
+    return TEST_RESULT();
+}
@@ -0,0 +1,229 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/nbt.h"
+
+#include <string.h>
+
+
+/*!
+ * Writes a compound with a field of every kind the writer has, and a list of compounds.
+ * \return Size of the NBT in bytes.
+ */
+static size_t write_sample(uint8_t* buffer, size_t const capacity) {
+    static uint8_t const bytes[5] = {1, 2, 3, 4, 5};
+    struct mc_nbt_writer writer;
+    mc_nbt_writer_init(&writer, buffer, capacity);
+    mc_nbt_write_header(&writer, MC_NBT_COMPOUND, "");
+    mc_nbt_write_byte(&writer, "byte", -5);
+    mc_nbt_write_short(&writer, "short", -300);
+    mc_nbt_write_int(&writer, "int", -70000);
+    mc_nbt_write_long(&writer, "long", -5000000000);
+    mc_nbt_write_string(&writer, "string", "obsidian");
+    mc_nbt_write_byte_array(&writer, "bytes", bytes, sizeof(bytes));
+    mc_nbt_write_list(&writer, "items", MC_NBT_COMPOUND, 2);
+    mc_nbt_write_byte(&writer, "count", 1);
+    mc_nbt_write_end(&writer);
+    mc_nbt_write_byte(&writer, "count", 2);
+    mc_nbt_write_end(&writer);
+    mc_nbt_write_int(&writer, "last", 42);
+    mc_nbt_write_end(&writer);
+    return writer.cursor;
+}
+
+/*!
+ * Visits every tag, entering every compound and list.
+ * \return Whether the whole tree was read without the reader failing.
+ */
+static bool walk(struct mc_nbt_reader* reader) {
+    struct mc_nbt_tag tag;
+    while (!reader->error) {
+        if (mc_nbt_next(reader, &tag)) {
+            if (tag.type == MC_NBT_COMPOUND || tag.type == MC_NBT_LIST) {
+                mc_nbt_enter(reader);
+            }
+        }
+        else if (reader->depth == 1) {
+            break;
+        }
+    }
+    return !reader->error;
+}
+
+/*!
+ * Everything written reads back, in order, with its name and value.
+ */
+static void test_round_trip(void) {
+    uint8_t buffer[256];
+    size_t const size = write_sample(buffer, sizeof(buffer));
+    CHECK(size <= sizeof(buffer));
+
+    struct mc_nbt_reader reader;
+    struct mc_nbt_tag tag;
+    mc_nbt_reader_init(&reader, buffer, size);
+    CHECK(mc_nbt_next(&reader, &tag) && tag.type == MC_NBT_COMPOUND && tag.name_length == 0);
+    CHECK(mc_nbt_enter(&reader));
+    CHECK(mc_nbt_next(&reader, &tag) && mc_nbt_is_named(&tag, "byte") && mc_nbt_integer(&tag) == -5);
+    CHECK(mc_nbt_next(&reader, &tag) && mc_nbt_is_named(&tag, "short") && mc_nbt_integer(&tag) == -300);
+    CHECK(mc_nbt_next(&reader, &tag) && mc_nbt_is_named(&tag, "int") && mc_nbt_integer(&tag) == -70000);
+    CHECK(mc_nbt_next(&reader, &tag) && mc_nbt_is_named(&tag, "long") && mc_nbt_integer(&tag) == -5000000000);
+    CHECK(mc_nbt_next(&reader, &tag) && tag.type == MC_NBT_STRING && tag.length == 8);
+    CHECK(memcmp(tag.payload + 2, "obsidian", 8) == 0);
+    CHECK(mc_nbt_next(&reader, &tag) && tag.type == MC_NBT_BYTE_ARRAY && tag.length == 5);
+    CHECK(tag.payload[4] == 1 && tag.payload[8] == 5);
+
+    CHECK(mc_nbt_next(&reader, &tag) && tag.type == MC_NBT_LIST && tag.element_type == MC_NBT_COMPOUND);
+    CHECK(tag.length == 2);
+    CHECK(mc_nbt_enter(&reader));
+    for (int64_t count = 1; count <= 2; ++count) {
+        CHECK(mc_nbt_next(&reader, &tag) && tag.type == MC_NBT_COMPOUND && tag.name_length == 0);
+        CHECK(mc_nbt_enter(&reader));
+        CHECK(mc_nbt_next(&reader, &tag) && mc_nbt_integer(&tag) == count);
+        CHECK(!mc_nbt_next(&reader, &tag));
+    }
+    CHECK(!mc_nbt_next(&reader, &tag));
+
+    CHECK(mc_nbt_next(&reader, &tag) && mc_nbt_is_named(&tag, "last"));
+    CHECK(!mc_nbt_next(&reader, &tag));
+    CHECK(!reader.error);
+}
+
+/*!
+ * Tags that are not entered are skipped whole, including nested ones.
+ */
+static void test_find_skips(void) {
+    uint8_t buffer[256];
+    size_t const size = write_sample(buffer, sizeof(buffer));
+    struct mc_nbt_reader reader;
+    struct mc_nbt_tag tag;
+    mc_nbt_reader_init(&reader, buffer, size);
+    CHECK(mc_nbt_next(&reader, &tag) && mc_nbt_enter(&reader));
+    CHECK(mc_nbt_find(&reader, "last", MC_NBT_INT, &tag) && mc_nbt_integer(&tag) == 42);
+    CHECK(!reader.error);
+
+    // The name must match the type as well.
+    mc_nbt_reader_init(&reader, buffer, size);
+    CHECK(mc_nbt_next(&reader, &tag) && mc_nbt_enter(&reader));
+    CHECK(!mc_nbt_find(&reader, "last", MC_NBT_LONG, &tag));
+}
+
+/*!
+ * The writer counts what does not fit instead of writing past its buffer.
+ */
+static void test_writer_overflow(void) {
+    uint8_t buffer[32];
+    memset(buffer, 0xAA, sizeof(buffer));
+    size_t const size = write_sample(buffer, 16);
+    uint8_t full[256];
+    CHECK(size == write_sample(full, sizeof(full)));
+    CHECK(buffer[16] == 0xAA);
+}
+
+/*!
+ * Every prefix of valid NBT fails to read, without reading past its end.
+ */
+static void test_truncated(void) {
+    uint8_t buffer[256];
+    size_t const size = write_sample(buffer, sizeof(buffer));
+    struct mc_nbt_reader reader;
+    mc_nbt_reader_init(&reader, buffer, size);
+    CHECK(walk(&reader));
+    for (size_t length = 0; length < size; ++length) {
+        // A copy of exactly the prefix, so reading past it is caught by tools like ASan.
+        uint8_t* prefix = malloc(length > 0 ? length : 1);
+        memcpy(prefix, buffer, length);
+        mc_nbt_reader_init(&reader, prefix, length);
+        CHECK(!walk(&reader));
+        free(prefix);
+    }
+}
+
+/*!
+ * Negative or impossible lengths and counts are rejected.
+ */
+static void test_invalid_lengths(void) {
+    struct mc_nbt_reader reader;
+    struct mc_nbt_tag tag;
+
+    uint8_t const negative_list[] = {MC_NBT_LIST, 0, 0, MC_NBT_INT, 0xFF, 0xFF, 0xFF, 0xFF};
+    mc_nbt_reader_init(&reader, negative_list, sizeof(negative_list));
+    CHECK(!mc_nbt_next(&reader, &tag) && reader.error);
+
+    uint8_t const negative_array[] = {MC_NBT_BYTE_ARRAY, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0};
+    mc_nbt_reader_init(&reader, negative_array, sizeof(negative_array));
+    CHECK(!mc_nbt_next(&reader, &tag) && reader.error);
+
+    uint8_t const long_string[] = {MC_NBT_STRING, 0, 0, 0, 4, 'a', 'b', 'c'};
+    mc_nbt_reader_init(&reader, long_string, sizeof(long_string));
+    CHECK(!mc_nbt_next(&reader, &tag) && reader.error);
+
+    uint8_t const list_of_nothing[] = {MC_NBT_LIST, 0, 0, MC_NBT_END, 0, 0, 0, 1};
+    mc_nbt_reader_init(&reader, list_of_nothing, sizeof(list_of_nothing));
+    CHECK(!mc_nbt_next(&reader, &tag) && reader.error);
+
+    uint8_t const long_name[] = {MC_NBT_BYTE, 0, 9, 'a', 1};
+    mc_nbt_reader_init(&reader, long_name, sizeof(long_name));
+    CHECK(!mc_nbt_next(&reader, &tag) && reader.error);
+
+    uint8_t const unknown_type[] = {13, 0, 0, 0};
+    mc_nbt_reader_init(&reader, unknown_type, sizeof(unknown_type));
+    CHECK(!mc_nbt_next(&reader, &tag) && reader.error);
+
+    // A list of ints claiming more elements than there are bytes left is caught when it is skipped.
+    uint8_t const short_list[] = {
+        MC_NBT_COMPOUND, 0, 0,
+        MC_NBT_LIST, 0, 1, 'l', MC_NBT_INT, 0, 0, 0, 3, 0, 0, 0, 1,
+        MC_NBT_END,
+    };
+    mc_nbt_reader_init(&reader, short_list, sizeof(short_list));
+    CHECK(mc_nbt_next(&reader, &tag) && mc_nbt_enter(&reader));
+    CHECK(mc_nbt_next(&reader, &tag));
+    CHECK(!mc_nbt_next(&reader, &tag) && reader.error);
+}
+
+/*!
+ * Nesting deeper than the reader follows is rejected instead of overflowing its stack of frames.
+ */
+static void test_depth_limit(void) {
+    uint8_t nested[3 + 5 * (MC_NBT_MAX_DEPTH + 1)];
+    size_t size = 0;
+    nested[size++] = MC_NBT_LIST;
+    nested[size++] = 0;
+    nested[size++] = 0;
+    for (unsigned i = 0; i <= MC_NBT_MAX_DEPTH; ++i) {
+        uint8_t const element = i < MC_NBT_MAX_DEPTH ? MC_NBT_LIST : MC_NBT_BYTE;
+        uint8_t const header[5] = {element, 0, 0, 0, 1};
+        memcpy(nested + size, header, sizeof(header));
+        size += sizeof(header);
+    }
+    struct mc_nbt_reader reader;
+    mc_nbt_reader_init(&reader, nested, size);
+    CHECK(!walk(&reader));
+}
+
+int main(void) {
+    test_round_trip();
+    test_find_skips();
+    test_writer_overflow();
+    test_truncated();
+    test_invalid_lengths();
+    test_depth_limit();
+    return TEST_RESULT();
+}
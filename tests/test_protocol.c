@@ -0,0 +1,446 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/memory.h"
+#include "obsidian/minecraft/protocol.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+
+/*!
+ * Complete packets are framed one after the other, and a partial one at the end reports how much is missing.
+ */
+static void test_scan_complete_and_partial(void) {
+    struct mc_proto_codec const* alpha = mc_proto_codec_for_version(1);
+    uint8_t const data[] = {
+        MC_PACKET_HEARTBEAT,
+        MC_PACKET_PLAYER_GROUNDED, 1,
+        MC_PACKET_CHAT, 0, 2, 'h', 'i',
+        // A position packet of which only the type and the first 9 bytes of its 33 have arrived.
+        MC_PACKET_PLAYER_POSITION, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    };
+    size_t lengths[8];
+    int status;
+    size_t const count = mc_proto_scan_client_packets(alpha, data, sizeof(data), lengths, 8, &status);
+    CHECK(count == 3);
+    CHECK(lengths[0] == 1);
+    CHECK(lengths[1] == 2);
+    CHECK(lengths[2] == 5);
+    CHECK(status == -24);
+
+    // Once everything is consumed the scan ends asking for the next type byte.
+    size_t const complete = 1 + 2 + 5;
+    CHECK(mc_proto_scan_client_packets(alpha, data, complete, lengths, 8, &status) == 3);
+    CHECK(status == -1);
+}
+
+/*!
+ * The scan stops at the capacity of the lengths array, and at invalid packets.
+ */
+static void test_scan_limits(void) {
+    struct mc_proto_codec const* alpha = mc_proto_codec_for_version(1);
+    uint8_t const heartbeats[] = {MC_PACKET_HEARTBEAT, MC_PACKET_HEARTBEAT, MC_PACKET_HEARTBEAT};
+    size_t lengths[2];
+    int status;
+    CHECK(mc_proto_scan_client_packets(alpha, heartbeats, sizeof(heartbeats), lengths, 2, &status) == 2);
+    CHECK(status > 0);
+
+    uint8_t const unknown[] = {MC_PACKET_HEARTBEAT, 0xEE, MC_PACKET_HEARTBEAT};
+    CHECK(mc_proto_scan_client_packets(alpha, unknown, sizeof(unknown), lengths, 2, &status) == 1);
+    CHECK(status == 0);
+
+    uint8_t const negative[] = {MC_PACKET_CHAT, 0xFF, 0xFF};
+    CHECK(mc_proto_scan_client_packets(alpha, negative, sizeof(negative), lengths, 2, &status) == 0);
+    CHECK(status == 0);
+}
+
+/*!
+ * Beta strings are framed by their length in UCS-2 characters, not bytes.
+ */
+static void test_scan_beta_strings(void) {
+    struct mc_proto_codec const* beta = mc_proto_codec_for_version(14);
+    uint8_t const chat[] = {MC_PACKET_CHAT, 0, 2, 0, 'h', 0, 'i'};
+    size_t lengths[1];
+    int status;
+    CHECK(mc_proto_scan_client_packets(beta, chat, sizeof(chat), lengths, 1, &status) == 1);
+    CHECK(lengths[0] == sizeof(chat));
+    CHECK(mc_proto_scan_client_packets(beta, chat, sizeof(chat) - 1, lengths, 1, &status) == 0);
+    CHECK(status == -1);
+}
+
+/*!
+ * The codec is picked from the encoding of the handshake username.
+ */
+static void test_detect_codec(void) {
+    struct mc_proto_codec const* codec = NULL;
+    uint8_t const alpha[] = {MC_PACKET_HANDSHAKE, 0, 2, 'a', 'b'};
+    CHECK(mc_proto_detect_codec(alpha, sizeof(alpha), &codec) > 0);
+    CHECK(codec == mc_proto_codec_for_version(1));
+
+    uint8_t const beta[] = {MC_PACKET_HANDSHAKE, 0, 2, 0, 'a', 0, 'b'};
+    CHECK(mc_proto_detect_codec(beta, sizeof(beta), &codec) > 0);
+    CHECK(codec == mc_proto_codec_for_version(14));
+
+    CHECK(mc_proto_detect_codec(beta, 1, &codec) < 0);
+    CHECK(mc_proto_detect_codec(beta, 3, &codec) < 0);
+    uint8_t const other[] = {MC_PACKET_CHAT, 0, 0};
+    CHECK(mc_proto_detect_codec(other, sizeof(other), &codec) == 0);
+
+    // Versions between and after the supported ones have no codec.
+    CHECK(mc_proto_codec_for_version(2) == NULL);
+    CHECK(mc_proto_codec_for_version(13) == NULL);
+    CHECK(mc_proto_codec_for_version(17) == NULL);
+}
+
+/*!
+ * Beta object spawns carry the thrower and, only when there is one, the velocity; beta mob spawns end in metadata.
+ */
+static void test_encode_beta_spawns(void) {
+    struct mc_proto_codec const* beta = mc_proto_codec_for_version(14);
+    uint8_t buffer[64];
+    struct mc_proto_server_packet object = {
+        .type = MC_PACKET_OBJECT_SPAWN,
+        .object_spawn = {.entity_id = 1, .type = 10, .x = 2, .y = 3, .z = 4},
+    };
+    uint8_t const unthrown[] = {0x17, 0, 0, 0, 1, 10, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 4, 0, 0, 0, 0};
+    CHECK(mc_proto_server_packet_size(beta, &object) == sizeof(unthrown));
+    CHECK(mc_proto_encode_server_packet(beta, buffer, sizeof(buffer), &object) == sizeof(unthrown));
+    CHECK(memcmp(buffer, unthrown, sizeof(unthrown)) == 0);
+
+    mc_word const velocity[] = {-1, 0, 256};
+    object.object_spawn.thrower_id = 5;
+    object.object_spawn.velocity = velocity;
+    uint8_t const thrown[] = {
+        0x17, 0, 0, 0, 1, 10, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 4, 0, 0, 0, 5, 0xFF, 0xFF, 0, 0, 1, 0,
+    };
+    CHECK(mc_proto_encode_server_packet(beta, buffer, sizeof(buffer), &object) == sizeof(thrown));
+    CHECK(memcmp(buffer, thrown, sizeof(thrown)) == 0);
+
+    mc_byte const metadata[] = {0x7F};
+    struct mc_proto_server_packet const mob = {
+        .type = MC_PACKET_MOB_SPAWN,
+        .mob_spawn = {
+            .entity_id = 1, .type = 50, .x = 2, .y = 3, .z = 4, .yaw = 5, .pitch = 6,
+            .metadata_size = sizeof(metadata), .metadata = metadata,
+        },
+    };
+    uint8_t const spawned[] = {0x18, 0, 0, 0, 1, 50, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 4, 5, 6, 0x7F};
+    CHECK(mc_proto_server_packet_size(beta, &mob) == sizeof(spawned));
+    CHECK(mc_proto_encode_server_packet(beta, buffer, sizeof(buffer), &mob) == sizeof(spawned));
+    CHECK(memcmp(buffer, spawned, sizeof(spawned)) == 0);
+
+    // Alpha has neither field.
+    struct mc_proto_codec const* alpha = mc_proto_codec_for_version(1);
+    CHECK(mc_proto_encode_server_packet(alpha, buffer, sizeof(buffer), &object) == sizeof(unthrown) - 4);
+    CHECK(mc_proto_encode_server_packet(alpha, buffer, sizeof(buffer), &mob) == sizeof(spawned) - 1);
+}
+
+/*!
+ * Alpha strings are written as their UTF-8 bytes behind a single byte length prefix.
+ */
+static void test_encode_alpha_strings(void) {
+    struct mc_proto_codec const* alpha = mc_proto_codec_for_version(1);
+    uint8_t buffer[64];
+    struct mc_proto_server_packet const authentication = {
+        .type = MC_PACKET_AUTHENTICATION,
+        .authentication = {.entity_id = 7, .unknown0_length = 0, .unknown0 = "", .unknown1_length = 1, .unknown1 = "-"},
+    };
+    uint8_t const authenticated[] = {0x01, 0, 0, 0, 7, 0, 0, 0, 1, '-'};
+    CHECK(mc_proto_server_packet_size(alpha, &authentication) == sizeof(authenticated));
+    CHECK(mc_proto_encode_server_packet(alpha, buffer, sizeof(buffer), &authentication) == sizeof(authenticated));
+    CHECK(memcmp(buffer, authenticated, sizeof(authenticated)) == 0);
+
+    struct mc_proto_server_packet const handshake = {
+        .type = MC_PACKET_HANDSHAKE,
+        .handshake = {.unknown_length = 1, .unknown = "-"},
+    };
+    uint8_t const shaken[] = {0x02, 0, 1, '-'};
+    CHECK(mc_proto_server_packet_size(alpha, &handshake) == sizeof(shaken));
+    CHECK(mc_proto_encode_server_packet(alpha, buffer, sizeof(buffer), &handshake) == sizeof(shaken));
+    CHECK(memcmp(buffer, shaken, sizeof(shaken)) == 0);
+
+    struct mc_proto_server_packet const chat = {
+        .type = MC_PACKET_CHAT,
+        .chat = {.message_length = 3, .message = "h\xC3\xA9"},
+    };
+    uint8_t const said[] = {0x03, 0, 3, 'h', 0xC3, 0xA9};
+    CHECK(mc_proto_server_packet_size(alpha, &chat) == sizeof(said));
+    CHECK(mc_proto_encode_server_packet(alpha, buffer, sizeof(buffer), &chat) == sizeof(said));
+    CHECK(memcmp(buffer, said, sizeof(said)) == 0);
+}
+
+/*!
+ * Beta strings are prefixed by their length in UCS-2 characters, which is shorter than the UTF-8 length the size is
+ * computed from once there is a character outside of ASCII.
+ */
+static void test_encode_beta_strings(void) {
+    struct mc_proto_codec const* beta = mc_proto_codec_for_version(14);
+    uint8_t buffer[64];
+    struct mc_proto_server_packet const handshake = {
+        .type = MC_PACKET_HANDSHAKE,
+        .handshake = {.unknown_length = 3, .unknown = "h\xC3\xA9"},
+    };
+    uint8_t const shaken[] = {0x02, 0, 2, 0, 'h', 0, 0xE9};
+    CHECK(mc_proto_server_packet_size(beta, &handshake) == 1 + 2 + 2 * 3);
+    CHECK(mc_proto_encode_server_packet(beta, buffer, sizeof(buffer), &handshake) == sizeof(shaken));
+    CHECK(memcmp(buffer, shaken, sizeof(shaken)) == 0);
+
+    struct mc_proto_server_packet const authentication = {
+        .type = MC_PACKET_AUTHENTICATION,
+        .authentication = {
+            .entity_id = 7, .unknown0_length = 1, .unknown0 = "-", .map_seed = 0x0102030405060708, .dimension = -1,
+        },
+    };
+    uint8_t const authenticated[] = {0x01, 0, 0, 0, 7, 0, 1, 0, '-', 1, 2, 3, 4, 5, 6, 7, 8, 0xFF};
+    CHECK(mc_proto_server_packet_size(beta, &authentication) == sizeof(authenticated));
+    CHECK(mc_proto_encode_server_packet(beta, buffer, sizeof(buffer), &authentication) == sizeof(authenticated));
+    CHECK(memcmp(buffer, authenticated, sizeof(authenticated)) == 0);
+
+    // A character outside of the basic multilingual plane takes two characters, a surrogate pair.
+    struct mc_proto_server_packet const kick = {
+        .type = MC_PACKET_KICK,
+        .kick = {.reason_length = 4, .reason = "\xF0\x9F\x98\x80"},
+    };
+    uint8_t const kicked[] = {0xFF, 0, 2, 0xD8, 0x3D, 0xDE, 0x00};
+    CHECK(mc_proto_server_packet_size(beta, &kick) == 1 + 2 + 2 * 4);
+    CHECK(mc_proto_encode_server_packet(beta, buffer, sizeof(buffer), &kick) == sizeof(kicked));
+    CHECK(memcmp(buffer, kicked, sizeof(kicked)) == 0);
+}
+
+/*!
+ * Checks that the size of a packet bounds what is encoded, exactly for fixed-size packets, and that a buffer of one
+ * byte less is reported as one byte short.
+ * \return Whether the size held, or true if the codec does not have the packet.
+ */
+static bool size_bounds_encoding(struct mc_proto_codec const* codec, struct mc_proto_server_packet const* packet) {
+    static uint8_t buffer[4096];
+    size_t const size = mc_proto_server_packet_size(codec, packet);
+    if (size == 0) {
+        return mc_proto_encode_server_packet(codec, buffer, sizeof(buffer), packet) == 0;
+    }
+    int const encoded = mc_proto_encode_server_packet(codec, buffer, sizeof(buffer), packet);
+    if (encoded <= 0 || (size_t) encoded > size || buffer[0] != (uint8_t) packet->type) {
+        return false;
+    }
+    size_t const fixed = codec->fixed_sizes[(uint8_t) packet->type];
+    if (fixed != 0 && (fixed != size || (size_t) encoded != size)) {
+        return false;
+    }
+    return mc_proto_encode_server_packet(codec, buffer, size - 1, packet) == -1;
+}
+
+/*!
+ * The size of every server packet of both codecs is at least its encoded length, both empty and with strings, slots
+ * and arrays in it.
+ */
+static void test_encode_sizes(void) {
+    static mc_word const words[] = {1, 2, 3};
+    static mc_byte const bytes[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    mc_utf8_char const* const text = "h\xC3\xA9 \xF0\x9F\x98\x80";
+    mc_word const text_length = (mc_word) strlen(text);
+    struct mc_proto_server_packet filled[] = {
+        {.type = MC_PACKET_AUTHENTICATION,
+         .authentication = {.unknown0_length = text_length, .unknown0 = text, .unknown1_length = 1, .unknown1 = "-"}},
+        {.type = MC_PACKET_HANDSHAKE, .handshake = {.unknown_length = text_length, .unknown = text}},
+        {.type = MC_PACKET_CHAT, .chat = {.message_length = text_length}},
+        {.type = MC_PACKET_KICK, .kick = {.reason_length = text_length}},
+        {.type = MC_PACKET_PLAYER_SPAWN, .player_spawn = {.name_length = text_length}},
+        {.type = MC_PACKET_SIGN_UPDATE,
+         .sign_update = {.line0_length = 1, .line1_length = text_length, .line2_length = 0, .line3_length = 2}},
+        {.type = MC_PACKET_INVENTORY,
+         .inventory = {.count = 3, .slots = {{.id = 1, .count = 2, .damage = 3}, {.id = -1}, {.id = 4}}}},
+        {.type = MC_PACKET_OBJECT_SPAWN, .object_spawn = {.thrower_id = 1, .velocity = words}},
+        {.type = MC_PACKET_MOB_SPAWN, .mob_spawn = {.metadata_size = 2, .metadata = bytes}},
+        {.type = MC_PACKET_CHUNK_DATA, .chunk_data = {.compressed_size = sizeof(bytes), .data = bytes}},
+        {.type = MC_PACKET_COMPLEX_ENTITY, .complex_entity = {.size = sizeof(bytes), .data = bytes}},
+        {.type = MC_PACKET_MULTI_BLOCK_CHANGE,
+         .multi_block_change = {.count = 3, .coordinates = words, .types = bytes, .metadata = bytes}},
+        {.type = MC_PACKET_EXPLOSION, .explosion = {.record_count = 3, .records = bytes}},
+    };
+    // The strings held in arrays are copied in, the initializers only take string literals.
+    memcpy(filled[2].chat.message, text, text_length);
+    memcpy(filled[3].kick.reason, text, text_length);
+    filled[4].player_spawn.name = text;
+    memcpy(filled[5].sign_update.line0, "a", 1);
+    memcpy(filled[5].sign_update.line1, text, text_length);
+    memcpy(filled[5].sign_update.line3, "\xC3\xA9", 2);
+
+    int const protocol_versions[] = {1, 14};
+    for (size_t v = 0; v < sizeof(protocol_versions) / sizeof(protocol_versions[0]); ++v) {
+        struct mc_proto_codec const* codec = mc_proto_codec_for_version(protocol_versions[v]);
+        for (unsigned type = 0; type < 256; ++type) {
+            // Every array and string empty.
+            struct mc_proto_server_packet empty;
+            memset(&empty, 0, sizeof(empty));
+            empty.type = (mc_byte) type;
+            CHECK(size_bounds_encoding(codec, &empty));
+        }
+        for (size_t i = 0; i < sizeof(filled) / sizeof(filled[0]); ++i) {
+            CHECK(size_bounds_encoding(codec, &filled[i]));
+        }
+    }
+}
+
+/*!
+ * The payload is referenced in place, and a buffer too small for the rest grows by what the encoder reports missing.
+ */
+static void test_encode_iov(void) {
+    struct mc_proto_codec const* alpha = mc_proto_codec_for_version(1);
+    uint8_t buffer[32];
+    mc_byte const payload[] = {1, 2, 3, 4, 5};
+    struct mc_proto_server_packet const chunk = {
+        .type = MC_PACKET_CHUNK_DATA,
+        .chunk_data = {.x = 16, .y = 0, .z = -16, .x_size = 15, .y_size = 127, .z_size = 15,
+                       .compressed_size = sizeof(payload), .data = payload},
+    };
+    uint8_t const header[] = {0x33, 0, 0, 0, 16, 0, 0, 0xFF, 0xFF, 0xFF, 0xF0, 15, 127, 15, 0, 0, 0, 5};
+    struct iovec iov[2];
+    int const missing = mc_proto_encode_server_packet_iov(alpha, buffer, 10, &chunk, iov);
+    CHECK(missing == -(int) (sizeof(header) - 10));
+    CHECK(mc_proto_encode_server_packet_iov(alpha, buffer, 10 - missing, &chunk, iov) ==
+          sizeof(header) + sizeof(payload));
+    CHECK(iov[0].iov_base == buffer && iov[0].iov_len == sizeof(header));
+    CHECK(memcmp(buffer, header, sizeof(header)) == 0);
+    CHECK(iov[1].iov_base == payload && iov[1].iov_len == sizeof(payload));
+
+    // Packets without a payload leave the second entry empty.
+    struct mc_proto_server_packet const time = {.type = MC_PACKET_TIME, .time = {.time = 1}};
+    CHECK(mc_proto_encode_server_packet_iov(alpha, buffer, sizeof(buffer), &time, iov) == 9);
+    CHECK(iov[0].iov_len == 9 && iov[1].iov_len == 0);
+}
+
+/*!
+ * A packet that wraps around the end of the receive ring is viewed in place through the mirrored mapping, and the
+ * view converts to what the decoder copies out.
+ */
+static void test_view_across_ring_end(void) {
+    struct mc_proto_codec const* alpha = mc_proto_codec_for_version(1);
+    struct obs_ring_buffer* ring = obs_alloc_ring_buffer(4096, 1);
+    CHECK(ring != NULL);
+    uint8_t const chat[] = {MC_PACKET_CHAT, 0, 5, 'h', 'e', 'l', 'l', 'o'};
+    // The type and the length prefix are the last bytes of the ring, the characters wrap around to its start.
+    size_t const offset = ring->size - 3;
+    uint8_t* data = ring->data;
+    memcpy(data + offset, chat, 3);
+    memcpy(data, chat + 3, sizeof(chat) - 3);
+
+    struct mc_proto_client_view view;
+    CHECK(mc_proto_view_client_packet(alpha, data + offset, sizeof(chat), &view) == sizeof(chat));
+    CHECK(view.type == MC_PACKET_CHAT);
+    CHECK(view.chat.message.encoding == MC_PROTO_STRINGS_UTF8);
+    CHECK(view.chat.message.length == 5);
+    CHECK(view.chat.message.data == data + ring->size);
+    CHECK(memcmp(view.chat.message.data, "hello", 5) == 0);
+
+    mc_utf8_char converted[8];
+    CHECK(mc_proto_string_view_to_utf8(&view.chat.message, converted, sizeof(converted)) == 5);
+    struct mc_proto_client_packet packet;
+    CHECK(mc_proto_decode_client_packet(alpha, data + offset, sizeof(chat), &packet) == sizeof(chat));
+    CHECK(packet.chat.message_length == 5 && memcmp(packet.chat.message, converted, 5) == 0);
+    obs_free_ring_buffer(ring);
+}
+
+/*!
+ * Viewing a UCS-2 string leaves it as sent, converting it gives what the decoder gives.
+ */
+static void test_view_beta_round_trip(void) {
+    struct mc_proto_codec const* beta = mc_proto_codec_for_version(14);
+    uint8_t const chat[] = {MC_PACKET_CHAT, 0, 2, 0, 'h', 0, 0xE9};
+    struct mc_proto_client_view view;
+    CHECK(mc_proto_view_client_packet(beta, chat, sizeof(chat), &view) == sizeof(chat));
+    CHECK(view.chat.message.encoding == MC_PROTO_STRINGS_UCS2);
+    CHECK(view.chat.message.length == 2);
+    CHECK(view.chat.message.data == chat + 3);
+
+    mc_utf8_char converted[8];
+    CHECK(mc_proto_string_view_to_utf8(&view.chat.message, converted, sizeof(converted)) == 3);
+    CHECK(memcmp(converted, "h\xC3\xA9", 3) == 0);
+    CHECK(mc_proto_string_view_to_utf8(&view.chat.message, converted, 2) == -1);
+    struct mc_proto_client_packet packet;
+    CHECK(mc_proto_decode_client_packet(beta, chat, sizeof(chat), &packet) == sizeof(chat));
+    CHECK(packet.chat.message_length == 3 && memcmp(packet.chat.message, converted, 3) == 0);
+}
+
+/*!
+ * Every cut short prefix of a packet asks for exactly the missing bytes, and nothing past the buffer is read.
+ */
+static void test_view_bounds(void) {
+    struct mc_proto_codec const* alpha = mc_proto_codec_for_version(1);
+    uint8_t const chat[] = {MC_PACKET_CHAT, 0, 5, 'h', 'e', 'l', 'l', 'o'};
+    struct mc_proto_client_view view;
+    for (size_t size = 1; size < sizeof(chat); ++size) {
+        // The length prefix has to arrive before the length of the rest is known.
+        int const missing = size < 3 ? (int) (3 - size) : (int) (sizeof(chat) - size);
+        CHECK(mc_proto_view_client_packet(alpha, chat, size, &view) == -missing);
+    }
+    uint8_t const negative[] = {MC_PACKET_CHAT, 0xFF, 0xFF};
+    CHECK(mc_proto_view_client_packet(alpha, negative, sizeof(negative), &view) == 0);
+    uint8_t const unknown[] = {0xEE};
+    CHECK(mc_proto_view_client_packet(alpha, unknown, sizeof(unknown), &view) == 0);
+}
+
+/*!
+ * A string view is bounded by the capacity of the decoded field in code units, the same bound for UTF-8 bytes and
+ * UCS-2 characters, and is rejected above it before the characters arrive.
+ */
+static void test_view_string_bound(void) {
+    size_t const bound = sizeof(((struct mc_proto_chat*) NULL)->message);
+    static uint8_t data[3 + 2 * sizeof(((struct mc_proto_chat*) NULL)->message)];
+    struct mc_proto_client_view view;
+    struct {
+        int protocol_version;
+        size_t unit_size;
+    } const versions[] = {{1, 1}, {14, 2}};
+    for (size_t v = 0; v < sizeof(versions) / sizeof(versions[0]); ++v) {
+        struct mc_proto_codec const* codec = mc_proto_codec_for_version(versions[v].protocol_version);
+        size_t const size = 3 + versions[v].unit_size * bound;
+        memset(data, 0, sizeof(data));
+        data[0] = MC_PACKET_CHAT;
+        // The characters are zeroes, which are valid in both encodings.
+        data[1] = (uint8_t) (bound >> 8);
+        data[2] = (uint8_t) bound;
+        CHECK(mc_proto_view_client_packet(codec, data, size, &view) == (int) size);
+        CHECK((size_t) view.chat.message.length == bound);
+        CHECK(mc_proto_view_client_packet(codec, data, 3, &view) == -(int) (size - 3));
+
+        data[1] = (uint8_t) ((bound + 1) >> 8);
+        data[2] = (uint8_t) (bound + 1);
+        CHECK(mc_proto_view_client_packet(codec, data, 3, &view) == 0);
+        CHECK(mc_proto_view_client_packet(codec, data, sizeof(data), &view) == 0);
+    }
+}
+
+int main(void) {
+    test_scan_complete_and_partial();
+    test_scan_limits();
+    test_scan_beta_strings();
+    test_detect_codec();
+    test_encode_beta_spawns();
+    test_encode_alpha_strings();
+    test_encode_beta_strings();
+    test_encode_sizes();
+    test_encode_iov();
+    test_view_across_ring_end();
+    test_view_beta_round_trip();
+    test_view_bounds();
+    test_view_string_bound();
+    return TEST_RESULT();
+}
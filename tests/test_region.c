@@ -0,0 +1,228 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/region.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+
+/// Size of a sector of a region file in bytes.
+#define SECTOR_SIZE 4096
+
+/// Size of the header of a region file.
+#define HEADER_SIZE (2 * SECTOR_SIZE)
+
+/// Room for the NBT of a chunk.
+#define NBT_CAPACITY (128 * 1024)
+
+
+/*!
+ * A region file under construction, in memory.
+ */
+struct region_image {
+    uint8_t* data;
+    size_t size;
+};
+
+static void store_u32(uint8_t* p, uint32_t const value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+/*!
+ * Appends zlib-compressed data as the chunk at a position, in the sectors after the ones already used.
+ * \param declared_length Length written in front of the data, 0 for the real length.
+ */
+static void add_chunk(struct region_image* image, int32_t const chunk_x, int32_t const chunk_z,
+                      void const* nbt, size_t const nbt_size, uint32_t const declared_length) {
+    uLongf compressed_size = compressBound(nbt_size);
+    uint8_t* compressed = malloc(compressed_size);
+    CHECK(compress(compressed, &compressed_size, nbt, nbt_size) == Z_OK);
+    size_t const sectors = (5 + compressed_size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    size_t const offset = image->size;
+    image->size += sectors * SECTOR_SIZE;
+    image->data = realloc(image->data, image->size);
+    memset(image->data + offset, 0, sectors * SECTOR_SIZE);
+    store_u32(image->data + offset, declared_length != 0 ? declared_length : compressed_size + 1);
+    image->data[offset + 4] = 2;
+    memcpy(image->data + offset + 5, compressed, compressed_size);
+    store_u32(image->data + 4 * ((chunk_x & 31) + (chunk_z & 31) * MC_REGION_SIZE),
+              (uint32_t) (offset / SECTOR_SIZE) << 8 | (uint32_t) sectors);
+    free(compressed);
+}
+
+/*!
+ * Writes a region image to a temporary file and opens it.
+ */
+static struct mc_region* open_image(struct region_image const* image) {
+    char path[] = "/tmp/obsidian-region-XXXXXX";
+    int const fd = mkstemp(path);
+    CHECK(fd >= 0);
+    CHECK(write(fd, image->data, image->size) == (ssize_t) image->size);
+    close(fd);
+    struct mc_region* region = mc_region_open(path);
+    unlink(path);
+    return region;
+}
+
+/*!
+ * Fills a chunk with a pattern that differs for every block.
+ */
+static struct mc_chunk* create_chunk(int32_t const x, int32_t const z) {
+    struct mc_chunk* chunk = mc_chunk_create(x, z);
+    for (size_t i = 0; i < MC_CHUNK_DATA_SIZE; ++i) {
+        chunk->data[i] = (uint8_t) (i * 31 + 7);
+    }
+    for (size_t i = 0; i < sizeof(chunk->heightmap); ++i) {
+        chunk->heightmap[i] = (uint8_t) i;
+    }
+    return chunk;
+}
+
+/*!
+ * Chunks written with mc_region_write_chunk() load back with the same data, and damaged ones are refused.
+ */
+static void test_round_trip(void) {
+    struct region_image image = {.data = calloc(1, HEADER_SIZE), .size = HEADER_SIZE};
+    uint8_t* nbt = malloc(NBT_CAPACITY);
+
+    struct mc_chunk* chunk = create_chunk(-33, 65);
+    size_t const nbt_size = mc_region_write_chunk(chunk, 1234, nbt, NBT_CAPACITY);
+    CHECK(nbt_size > MC_CHUNK_DATA_SIZE && nbt_size <= NBT_CAPACITY);
+    CHECK(mc_region_write_chunk(chunk, 1234, nbt, 1024) > 1024);
+    add_chunk(&image, chunk->x, chunk->z, nbt, nbt_size, 0);
+    // A length that runs past the sectors of the chunk.
+    add_chunk(&image, 1, 0, nbt, nbt_size, 64 * SECTOR_SIZE);
+    // NBT cut off halfway through the block array.
+    add_chunk(&image, 2, 0, nbt, MC_CHUNK_BLOCKS / 2, 0);
+
+    struct mc_region* region = open_image(&image);
+    CHECK(region != NULL);
+    if (region == NULL) {
+        return;
+    }
+    CHECK(mc_region_has_chunk(region, -33, 65));
+    CHECK(!mc_region_has_chunk(region, 0, 0));
+
+    z_stream stream = {0};
+    CHECK(inflateInit2(&stream, 15 + 32) == Z_OK);
+    uint8_t* scratch = NULL;
+    size_t scratch_size = 0;
+    struct mc_chunk* loaded = mc_region_load_chunk(region, -33, 65, &stream, &scratch, &scratch_size);
+    CHECK(loaded != NULL);
+    if (loaded != NULL) {
+        CHECK(loaded->x == -33 && loaded->z == 65);
+        CHECK(memcmp(loaded->data, chunk->data, MC_CHUNK_DATA_SIZE) == 0);
+        CHECK(memcmp(loaded->heightmap, chunk->heightmap, sizeof(chunk->heightmap)) == 0);
+        mc_chunk_destroy(loaded);
+    }
+    CHECK(mc_region_load_chunk(region, 0, 0, &stream, &scratch, &scratch_size) == NULL);
+    CHECK(mc_region_load_chunk(region, 1, 0, &stream, &scratch, &scratch_size) == NULL);
+    CHECK(mc_region_load_chunk(region, 2, 0, &stream, &scratch, &scratch_size) == NULL);
+
+    free(scratch);
+    inflateEnd(&stream);
+    mc_region_close(region);
+    mc_chunk_destroy(chunk);
+    free(nbt);
+    free(image.data);
+}
+
+/*!
+ * Data that inflates to more than any chunk could is refused before the scratch buffer grows without bound.
+ */
+static void test_inflate_limit(void) {
+    struct region_image image = {.data = calloc(1, HEADER_SIZE), .size = HEADER_SIZE};
+    size_t const bomb_size = 16 * 1024 * 1024;
+    uint8_t* bomb = calloc(1, bomb_size);
+    add_chunk(&image, 0, 0, bomb, bomb_size, 0);
+    free(bomb);
+
+    struct mc_region* region = open_image(&image);
+    CHECK(region != NULL);
+    if (region == NULL) {
+        return;
+    }
+    z_stream stream = {0};
+    CHECK(inflateInit2(&stream, 15 + 32) == Z_OK);
+    uint8_t* scratch = NULL;
+    size_t scratch_size = 0;
+    CHECK(mc_region_load_chunk(region, 0, 0, &stream, &scratch, &scratch_size) == NULL);
+    CHECK(scratch_size <= 4 * 1024 * 1024);
+    free(scratch);
+    inflateEnd(&stream);
+    mc_region_close(region);
+    free(image.data);
+}
+
+/*!
+ * Files too small to hold the header are not regions.
+ */
+static void test_truncated_header(void) {
+    struct region_image image = {.data = calloc(1, HEADER_SIZE / 2), .size = HEADER_SIZE / 2};
+    CHECK(open_image(&image) == NULL);
+    free(image.data);
+}
+
+/*!
+ * A region file opened elsewhere maps the same as one opened by path, and its descriptor is closed either way.
+ */
+static void test_map_descriptor(void) {
+    struct region_image image = {.data = calloc(1, HEADER_SIZE), .size = HEADER_SIZE};
+    uint8_t const nbt[] = {10, 0, 0, 0};
+    add_chunk(&image, 3, 4, nbt, sizeof(nbt), 0);
+    char path[] = "/tmp/obsidian-region-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    CHECK(write(fd, image.data, image.size) == (ssize_t) image.size);
+    close(fd);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct mc_region* region = mc_region_map(fd, path);
+    CHECK(region != NULL);
+    CHECK(fcntl(fd, F_GETFD) < 0);
+    if (region != NULL) {
+        CHECK(mc_region_has_chunk(region, 3, 4));
+        CHECK(!mc_region_has_chunk(region, 4, 3));
+        mc_region_close(region);
+    }
+
+    // Too short to be a region now.
+    CHECK(truncate(path, HEADER_SIZE / 2) == 0);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    CHECK(mc_region_map(fd, path) == NULL);
+    CHECK(fcntl(fd, F_GETFD) < 0);
+    unlink(path);
+    free(image.data);
+}
+
+int main(void) {
+    test_round_trip();
+    test_inflate_limit();
+    test_truncated_header();
+    test_map_descriptor();
+    return TEST_RESULT();
+}
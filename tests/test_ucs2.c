@@ -0,0 +1,90 @@
+/*
+ * Obsidian: a fast Minecraft server
+ * Copyright (C) 2024  Jesse Gerard Brands
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test.h"
+
+#include "obsidian/minecraft/ucs2.h"
+
+#include <stdint.h>
+#include <string.h>
+
+
+/// ASCII long enough for the vector implementations to convert a whole block at once.
+#define ASCII_RUN "The quick brown fox jumps over the lazy dog"
+
+/// Text with characters of every UTF-8 width, including one outside the BMP that takes a surrogate pair.
+static char const mixed[] = ASCII_RUN "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80" ASCII_RUN;
+
+/*!
+ * Reads a big-endian UCS-2 character.
+ */
+static uint16_t unit_at(uint8_t const* ucs2, size_t const index) {
+    return (uint16_t) (ucs2[index * 2] << 8 | ucs2[index * 2 + 1]);
+}
+
+/*!
+ * Converts text with characters of every width to UCS-2 and back.
+ */
+static void test_round_trip(void) {
+    size_t const ascii = sizeof(ASCII_RUN) - 1;
+    size_t const length = sizeof(mixed) - 1;
+    size_t const units = mc_ucs2_length(mixed, length);
+    CHECK(units == 2 * ascii + 4);
+
+    uint8_t ucs2[2 * sizeof(mixed)];
+    CHECK(mc_ucs2_from_utf8(ucs2, mixed, length) == units);
+    CHECK(unit_at(ucs2, 0) == 'T');
+    CHECK(unit_at(ucs2, ascii) == 0x00E9);
+    CHECK(unit_at(ucs2, ascii + 1) == 0x20AC);
+    CHECK(unit_at(ucs2, ascii + 2) == 0xD83D);
+    CHECK(unit_at(ucs2, ascii + 3) == 0xDE00);
+    CHECK(unit_at(ucs2, units - 1) == 'g');
+
+    char utf8[sizeof(mixed)];
+    CHECK(mc_ucs2_to_utf8(utf8, sizeof(utf8), ucs2, units) == (int) length);
+    CHECK(memcmp(utf8, mixed, length) == 0);
+    CHECK(mc_ucs2_to_utf8(utf8, length - 1, ucs2, units) == -1);
+}
+
+/*!
+ * Malformed input on either side is converted without reading or writing out of bounds.
+ */
+static void test_malformed(void) {
+    // A truncated sequence becomes a replacement character.
+    char const truncated[] = {'a', (char) 0xE2, (char) 0x82};
+    uint8_t ucs2[8];
+    CHECK(mc_ucs2_length(truncated, sizeof(truncated)) == 3);
+    CHECK(mc_ucs2_from_utf8(ucs2, truncated, sizeof(truncated)) == 3);
+    CHECK(unit_at(ucs2, 1) == '?');
+
+    // Lone surrogates are kept as they are.
+    uint8_t const lone[] = {0xD8, 0x00, 0x00, 'a', 0xDC, 0x00};
+    char utf8[16];
+    CHECK(mc_ucs2_to_utf8(utf8, sizeof(utf8), lone, 3) == 7);
+    CHECK(memcmp(utf8, "\xED\xA0\x80" "a" "\xED\xB0\x80", 7) == 0);
+}
+
+int main(void) {
+    // Until initialized the scalar implementation is used, run everything against the vector ones as well.
+    test_round_trip();
+    test_malformed();
+    mc_ucs2_init();
+    test_round_trip();
+    test_malformed();
+    return TEST_RESULT();
+}